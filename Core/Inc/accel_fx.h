@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include "bma4_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Integer-only acceleration magnitude / impact feature kernel.
+// Works on raw struct bma4_accel counts, so 1g == lsb_per_g (2048 at the 16g capture range).
+// |a|^2 of three int16 axes is < 3 * 2^30 and always fits in a uint32_t.
+
+// Running statistics over one capture window; feed it in as many chunks as needed
+typedef struct
+{
+    uint16_t one_g;         // counts per g
+    uint32_t thr_sq;        // threshold, squared counts
+    uint16_t n;             // samples seen
+    uint16_t min_mag;       // counts
+    uint16_t max_mag;       // counts
+    int32_t  first_above;   // sample index, -1 if none above threshold
+    int32_t  last_above;
+    uint64_t sum_sq;        // sum |a|^2, for RMS
+    uint64_t sum_dyn_sq;    // sum (|a| - 1g)^2, for energy
+} accel_fx_window_t;
+
+// Floor of sqrt(v); bit-by-bit, no multiply or divide
+uint32_t accel_fx_isqrt(uint32_t v);
+
+// |a|^2 in counts^2
+static inline uint32_t accel_fx_mag_sq(const struct bma4_accel *a)
+{
+    int32_t x = a->x, y = a->y, z = a->z;
+    return (uint32_t)(x * x) + (uint32_t)(y * y) + (uint32_t)(z * z);
+}
+
+// |a| in counts
+static inline uint16_t accel_fx_mag(const struct bma4_accel *a)
+{
+    return (uint16_t)accel_fx_isqrt(accel_fx_mag_sq(a));
+}
+
+// Counts to milli-g (signed, rounded toward zero)
+static inline int32_t accel_fx_counts_to_mg(int32_t counts, uint16_t one_g)
+{
+    return (counts * 1000) / (int32_t)one_g;
+}
+
+void accel_fx_window_init(accel_fx_window_t *w, uint16_t one_g, uint16_t thr_counts);
+void accel_fx_window_add(accel_fx_window_t *w, const struct bma4_accel *s, uint16_t n);
+
+// RMS of |a| over the window, counts
+uint16_t accel_fx_window_rms(const accel_fx_window_t *w);
+
+// Samples from first to last above threshold (0 if never above)
+uint16_t accel_fx_window_span(const accel_fx_window_t *w);
+
+// sum (|a| - 1g)^2 * dt in milli-(g^2*ms), dt = 1/odr_hz
+uint32_t accel_fx_window_energy(const accel_fx_window_t *w, uint32_t odr_hz);
+
+#ifdef __cplusplus
+}
+#endif
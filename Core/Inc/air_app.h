@@ -16,9 +16,22 @@ typedef struct
     uint8_t iaq_accuracy; // 0..3
 } air_readings_t;
 
+// Fixed-point wire form of air_readings_t (UART telemetry record, BLE notification)
+typedef __PACKED_STRUCT
+{
+    int16_t  t_cdeg;        // 0.01 C
+    uint16_t rh_cpct;       // 0.01 %RH
+    uint32_t p_pa;
+    uint16_t iaq_x10;       // 0.1 IAQ
+    uint8_t  iaq_accuracy;
+} air_readings_packed_t;
+
 HAL_StatusTypeDef air_app_init(I2C_HandleTypeDef *hi2c1, UART_HandleTypeDef *huart1);
-HAL_StatusTypeDef air_app_process(void);          // call frequently (e.g. in while(1))
+HAL_StatusTypeDef air_app_process(void);          // runs as a sequencer task; re-arms itself for the next deadline
 HAL_StatusTypeDef air_app_get(air_readings_t *out); // latest readings
+void air_app_pack(const air_readings_t *in, air_readings_packed_t *out); // round to the wire form
+void air_app_tick(void);                          // call from SysTick; posts the task when work is due (1 ms resolution)
+uint32_t air_app_idle_ms(uint32_t now_ms);        // ms until air_app_tick() has work (UINT32_MAX: none)
 
 #ifdef __cplusplus
 }
@@ -456,7 +456,11 @@ typedef enum
   CFG_TASK_VTIMER,
   CFG_TASK_NVM,
   /* USER CODE BEGIN CFG_Task_Id_t */
-
+  CFG_TASK_AIR_APP,
+  CFG_TASK_BMA456,
+  CFG_TASK_TELEMETRY,
+  CFG_TASK_FLASH_MANAGER,
+  CFG_TASK_I2C_BUS,
   /* USER CODE END CFG_Task_Id_t */
   CFG_TASK_NBR,  /**< Shall be LAST in the list */
 } CFG_Task_Id_t;
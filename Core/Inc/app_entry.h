@@ -60,7 +60,8 @@ uint32_t MX_APPE_Init(void *p_param);
 void MX_APPE_Process(void);
 
 /* USER CODE BEGIN EF */
-
+void APPE_FlashManagerTick(void);
+void APPE_Idle(void);
 /* USER CODE END EF */
 
 #ifdef __cplusplus
@@ -119,6 +119,9 @@ int8_t bma4_init(struct bma4_dev *dev);
  * int8_t bma4_write_config_file(struct bma4_dev *dev);
  * \endcode
  * @details This API is used to write the binary configuration in the sensor
+ * in bursts of dev->read_write_len bytes. With dev->config_check set, the
+ * stream is read back and handed to it chunk by chunk before the sensor loads
+ * it (BMA4_E_CONFIG_VERIFY_FAIL when it rejects a chunk).
  *
  * @param[in] dev : Structure instance of bma4_dev.
  *
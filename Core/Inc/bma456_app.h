@@ -23,11 +23,13 @@ extern "C" {
 /* High-g detection threshold in 5.11g format (~2g)
  * Formula: threshold_value = (desired_g * 2048) / 16
  * For 2g: (2 * 2048) / 16 = 256
+ * Absolute g, independent of BMA456_ACCEL_RANGE: at 16g it sits well below
+ * full scale, so the peaks that trigger it are captured unclipped.
  */
 #define BMA456_HIGH_G_THRESHOLD   256
 
-/* High-g duration in 100Hz samples (10ms per sample)
- * 10 samples = 100ms
+/* High-g duration in 200Hz feature engine samples (5ms per sample),
+ * whatever the accelerometer ODR: 10 samples = 50ms
  */
 #define BMA456_HIGH_G_DURATION    10
 
@@ -39,10 +41,94 @@ extern "C" {
 /* LED on duration in milliseconds */
 #define BMA456_LED_ON_DURATION_MS 5000
 
+/* Accelerometer full scale and matching sensitivity
+ * 2g: 16384, 4g: 8192, 8g: 4096, 16g: 2048 LSB/g
+ * Impacts sampled at 1.6 kHz peak far above 2g; 16g keeps them unclipped
+ * at ~0.5 mg per LSB.
+ */
+#define BMA456_ACCEL_RANGE        BMA4_ACCEL_RANGE_16G
+#define BMA456_LSB_PER_G          2048
+
+/* FIFO impact capture
+ * The accelerometer streams into the 1 KB FIFO (header-less, accel only,
+ * 6 bytes per sample): ~170 samples = ~106 ms at 1.6 kHz. After an interrupt
+ * the task waits BMA456_CAPTURE_POST_MS (bma456_app_tick() posts it again),
+ * burst-reads the whole FIFO in one I2C transaction and keeps the window from
+ * BMA456_CAPTURE_PRE_MS before the interrupt to BMA456_CAPTURE_POST_MS after.
+ * Both plus the task latency must fit the FIFO; a late read loses pre-trigger
+ * samples first.
+ * Set BMA456_CAPTURE_ENABLE to 0 to fall back to a single register read.
+ */
+#ifndef BMA456_CAPTURE_ENABLE
+#define BMA456_CAPTURE_ENABLE     1
+#endif
+#define BMA456_CAPTURE_ODR        BMA4_OUTPUT_DATA_RATE_1600HZ
+#define BMA456_CAPTURE_ODR_HZ     1600
+#define BMA456_FIFO_SIZE_BYTES    1024
+#ifndef BMA456_CAPTURE_PRE_MS
+#define BMA456_CAPTURE_PRE_MS     50
+#endif
+#ifndef BMA456_CAPTURE_POST_MS
+#define BMA456_CAPTURE_POST_MS    30
+#endif
+#if ((BMA456_CAPTURE_PRE_MS + BMA456_CAPTURE_POST_MS) * BMA456_CAPTURE_ODR_HZ) / 1000 > BMA456_FIFO_SIZE_BYTES / 6
+#error "BMA456 capture window does not fit the FIFO"
+#endif
+
+/* Samples above this magnitude count towards the impact duration (mg) */
+#define BMA456_CAPTURE_THRESHOLD_MG 1500
+
+/* Features of one captured impact (integer, see accel_fx.h) */
+typedef struct
+{
+    uint16_t n_samples;   /* Samples in the capture window */
+    uint16_t pre_samples; /* Of which before the interrupt */
+    uint16_t peak_mg;     /* Largest |a| in the window */
+    uint16_t min_mg;      /* Smallest |a| in the window */
+    uint16_t rms_mg;      /* RMS of |a| over the window */
+    uint32_t duration_us; /* First to last sample above BMA456_CAPTURE_THRESHOLD_MG */
+    uint32_t energy;      /* Sum of (|a| - 1g)^2 * dt over the window, milli-(g^2*ms) */
+} bma456_impact_t;
+
+/* GPIOA (INT1) ISR cost, measured in core cycles with SysTick->VAL */
+typedef struct
+{
+    uint32_t count;         /* Number of ISR entries measured */
+    uint32_t max_cycles;    /* Longest ISR */
+    uint32_t total_cycles;  /* Sum, for the average (total_cycles / count) */
+    uint32_t queue_high_water; /* Most IRQ events ever waiting for the task */
+    uint32_t queue_drops;   /* IRQ events lost to a full queue */
+} bma456_isr_stats_t;
+
+/* IRQ events the EXTI ISR can queue before the task drains them (power of two) */
+#define BMA456_IRQ_QUEUE_LEN      8
+
+/* Config stream upload
+ * The 6 KB feature config goes out in bursts of BMA456_CONFIG_BURST_LEN bytes
+ * (even, up to the config size); 0 sends it in a single I2C transaction,
+ * which i2c_bus runs on DMA when a channel is linked to I2C1.
+ * BMA456_CONFIG_VERIFY reads the stream back and checks its CRC-32 before the
+ * sensor loads it. It is off by default: at 100 kHz the readback costs more
+ * than the single burst saves (init 795 ms without it, 1432 ms with it, 1202 ms
+ * with the old 32-byte bursts).
+ */
+#ifndef BMA456_CONFIG_BURST_LEN
+#define BMA456_CONFIG_BURST_LEN   0
+#endif
+#ifndef BMA456_CONFIG_VERIFY
+#define BMA456_CONFIG_VERIFY      0
+#endif
+
 /* Function prototypes */
 HAL_StatusTypeDef bma456_app_init(I2C_HandleTypeDef *hi2c, UART_HandleTypeDef *huart);
+void bma456_app_irq_notify(void);
 void bma456_app_handle_interrupt(void);
 void bma456_app_timer_callback(void);
+void bma456_app_tick(void);
+uint32_t bma456_app_idle_ms(uint32_t now_ms);
+void bma456_app_isr_record(uint32_t systick_start, uint32_t systick_end);
+void bma456_app_get_isr_stats(bma456_isr_stats_t *out);
+HAL_StatusTypeDef bma456_app_get_last_impact(bma456_impact_t *out);
 
 #ifdef __cplusplus
 }
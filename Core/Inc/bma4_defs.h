@@ -210,6 +210,9 @@
 /* Maximum length to read */
 #define BMA4_MAX_LEN                              UINT8_C(128)
 
+/* Config stream readback chunk for config_check: even, and room for the SPI dummy byte in BMA4_MAX_LEN */
+#define BMA4_CONFIG_VERIFY_CHUNK                  UINT8_C(126)
+
 /*! Macro to read sensortime byte in FIFO */
 #define BMA4_SENSORTIME_OVERHEAD_BYTE             UINT8_C(150)
 
@@ -333,6 +336,7 @@
 #define BMA4_E_REMAP_ERROR                        INT8_C(-14)
 #define BMA4_E_AVG_MODE_INVALID_CONF              INT8_C(-15)
 #define BMA4_E_INVALID_MEMS_ID                    INT8_C(-16)
+#define BMA4_E_CONFIG_VERIFY_FAIL                 INT8_C(-17)
 
 /**\name    UTILITY MACROS  */
 #define BMA4_SET_LOW_BYTE                         UINT16_C(0x00FF)
@@ -845,6 +849,21 @@ typedef BMA4_INTF_RET_TYPE (*bma4_write_fptr_t)(uint8_t reg_addr, const uint8_t
  */
 typedef void (*bma4_delay_us_fptr_t)(uint32_t period, void *intf_ptr);
 
+/*!
+ * @brief Optional config stream check, called with each chunk of the stream
+ * read back from the sensor before the sensor loads it
+ *
+ * @param[in] index          : Byte offset of the chunk in the config stream.
+ * @param[in] data           : Chunk read back from the sensor.
+ * @param[in] len            : Chunk length in bytes.
+ * @param[in, out] intf_ptr  : Void pointer that can enable the linking of descriptors
+ *                             for interface related call backs
+ *
+ * @retval 0 for Success
+ * @retval Non-zero for Failure (the config is not loaded)
+ */
+typedef int8_t (*bma4_config_check_fptr_t)(uint16_t index, const uint8_t *data, uint16_t len, void *intf_ptr);
+
 /******************************************************************************/
 /*!  @name         Enum Declarations                                  */
 /******************************************************************************/
@@ -971,7 +990,7 @@ struct bma4_dev
     /*! Config stream data buffer address will be assigned*/
     const uint8_t *config_file_ptr;
 
-    /*! Read/write length */
+    /*! Read/write length; also the config stream burst size, up to config_size */
     uint16_t read_write_len;
 
     /*! Feature len */
@@ -1000,6 +1019,9 @@ struct bma4_dev
 
     /*! Variable to store the status of performance mode */
     uint8_t perf_mode_status;
+
+    /*! When set, the config stream is read back and passed to it before loading */
+    bma4_config_check_fptr_t config_check;
 };
 
 /*!
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "stm32wb0x_hal.h"
+#include "bme69x.h"
+#include "bme690_port.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// BME690 sensor array: owns every sensor's bme69x_dev and runs their forced
+// measurements as a pipeline. All due sensors are triggered back to back, so their
+// conversion/heater phases overlap, and each is collected once its own time is up.
+
+#ifndef BME690_ARRAY_MAX
+#define BME690_ARRAY_MAX (BME690_PORT_MAX_SENSORS)
+#endif
+
+// Multi-step heater profile for parallel mode. Step i heats to temp_c[i] for
+// dur_mult[i] heater units of shared_dur_ms each; the sensor cycles through the
+// steps on its own, produces one field per unit and buffers the last three,
+// each tagged with its step (gas_index).
+typedef struct
+{
+    const uint16_t *temp_c;     // deg C, len entries
+    const uint16_t *dur_mult;   // heater units per step, len entries
+    uint8_t  len;               // 1..10
+    uint16_t shared_dur_ms;     // one unit: T/P/H conversion + shared heater time
+} bme690_heatr_profile_t;
+
+// Per-sensor configuration (kept by reference; give it static storage)
+typedef struct
+{
+    uint8_t  i2c_addr;      // 7-bit, 0x76/0x77
+    uint8_t  mux_addr;      // 7-bit mux address, BME690_PORT_NO_MUX if directly on the bus
+    uint8_t  mux_channel;
+
+    // Periodic sensors are triggered by the array every period_ms with the settings
+    // below. period_ms = 0: the owner triggers it with bme690_array_trigger().
+    uint32_t period_ms;
+    uint8_t  os_temp;       // BME69X_OS_*
+    uint8_t  os_pres;
+    uint8_t  os_hum;
+    uint8_t  filter;        // BME69X_FILTER_*
+    uint16_t heatr_temp;    // deg C
+    uint16_t heatr_dur_ms;  // 0: no gas measurement
+
+    // Non-NULL: run the sensor in parallel mode with this heater profile instead.
+    // The array harvests all buffered fields every period_ms (0: every two heater units).
+    const bme690_heatr_profile_t *profile;
+} bme690_sensor_cfg_t;
+
+// Runs in air task context from bme690_array_process(), once per collected sample.
+// trig_ms is when the measurement was started (BSEC wants that timestamp); for a
+// parallel-mode sensor it is the harvest time, and data->gas_index is the profile step.
+typedef void (*bme690_array_sample_cb_t)(uint8_t idx, const struct bme69x_data *data, uint32_t trig_ms);
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t errors;        // failed triggers/collects/harvests
+    uint32_t harvests;      // parallel mode: field reads
+    uint32_t stale;         // parallel mode: fields already delivered by an earlier read
+    uint32_t last_ms;       // trigger time of the last good sample
+} bme690_array_stats_t;
+
+void bme690_array_init(bme690_array_sample_cb_t cb);
+
+// Probe and configure one sensor; *idx receives its slot. Periodic sensors are due immediately.
+int8_t bme690_array_add(I2C_HandleTypeDef *hi2c, const bme690_sensor_cfg_t *cfg, uint8_t *idx);
+
+// Owner-scheduled sensors: apply conf/heater and start a forced measurement now.
+// BME69X_E_DEV_NOT_FOUND if idx is unknown, BME69X_W_NO_NEW_DATA if one is still running.
+int8_t bme690_array_trigger(uint8_t idx,
+                            struct bme69x_conf *conf,
+                            const struct bme69x_heatr_conf *heatr,
+                            uint32_t now_ms);
+
+// Collect finished measurements (calling the sample callback), then trigger every
+// periodic sensor that is due. Returns 1 and the next deadline in *next_ms when
+// the array has something scheduled, 0 when it is idle.
+uint8_t bme690_array_process(uint32_t now_ms, uint32_t *next_ms);
+
+// Switch a sensor to parallel mode with a new heater profile (uploaded right away), or
+// back to owner-triggered forced mode with profile = NULL. The profile is kept by reference.
+int8_t bme690_array_set_profile(uint8_t idx, const bme690_heatr_profile_t *profile, uint32_t now_ms);
+
+// 1 while a forced measurement on idx is in flight
+uint8_t bme690_array_busy(uint8_t idx);
+
+uint8_t bme690_array_count(void);
+struct bme69x_dev *bme690_array_dev(uint8_t idx);
+HAL_StatusTypeDef bme690_array_get_stats(uint8_t idx, bme690_array_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,14 +7,39 @@
 extern "C" {
 #endif
 
+// Interface contexts available to bme690_port_init_i2c*() (one per sensor)
+#ifndef BME690_PORT_MAX_SENSORS
+#define BME690_PORT_MAX_SENSORS (4u)
+#endif
+
+// No I2C mux in front of the sensor
+#define BME690_PORT_NO_MUX      (0u)
+
 // Initializes a bme69x_dev for I2C with a specific 7-bit address (0x76/0x77)
 int8_t bme690_port_init_i2c(struct bme69x_dev *dev, I2C_HandleTypeDef *hi2c, uint8_t i2c_addr_7bit);
 
+// Same, for a sensor behind a TCA9548A-style mux (7-bit mux address, channel 0..7).
+// The port switches the mux before each transfer when the channel differs from the
+// last one selected, so more than two sensors can share the 0x76/0x77 addresses.
+int8_t bme690_port_init_i2c_mux(struct bme69x_dev *dev, I2C_HandleTypeDef *hi2c, uint8_t i2c_addr_7bit,
+                                uint8_t mux_addr_7bit, uint8_t mux_channel);
+
 // Bosch SensorAPI callback signatures
 BME69X_INTF_RET_TYPE bme690_i2c_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr);
 BME69X_INTF_RET_TYPE bme690_i2c_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr);
 void bme690_delay_us(uint32_t period, void *intf_ptr);
 
+// Non-blocking forced measurement, split in two halves so the caller can do other
+// work (or sleep) during conversion + heater time.
+// Trigger: starts a forced measurement with the conf already written to the sensor.
+// *wait_us receives how long to wait before calling bme690_port_collect_forced().
+int8_t bme690_port_trigger_forced(struct bme69x_dev *dev,
+                                  struct bme69x_conf *conf,
+                                  uint16_t heatr_dur_ms,
+                                  uint32_t *wait_us);
+// Collect: reads the result; BME69X_W_NO_NEW_DATA if the sample is not ready yet.
+int8_t bme690_port_collect_forced(struct bme69x_dev *dev, struct bme69x_data *out);
+
 #ifdef __cplusplus
 }
 #endif
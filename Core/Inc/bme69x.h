@@ -183,6 +183,7 @@ int8_t bme69x_get_op_mode(uint8_t *op_mode, struct bme69x_dev *dev);
  * uint32_t bme69x_get_meas_dur(const uint8_t op_mode, struct bme69x_conf *conf, struct bme69x_dev *dev);
  * \endcode
  * @details This API is used to get the remaining duration that can be used for heating.
+ * The result for the last op mode/oversampling combination is cached in dev.
  *
  * @param[in] op_mode : Desired operation mode.
  * @param[in] conf    : Desired sensor configuration.
@@ -231,7 +232,9 @@ int8_t bme69x_get_data(uint8_t op_mode, struct bme69x_data *data, uint8_t *n_dat
  * \code
  * int8_t bme69x_set_conf(struct bme69x_conf *conf, struct bme69x_dev *dev);
  * \endcode
- * @details This API is used to set the oversampling, filter and odr configuration
+ * @details This API is used to set the oversampling, filter and odr configuration.
+ * Only registers that differ from the device's register shadow are written; if
+ * none do, the sensor is not accessed at all.
  *
  * @param[in] conf    : Desired sensor configuration.
  * @param[in,out] dev : Structure instance of bme69x_dev.
@@ -267,6 +270,8 @@ int8_t bme69x_get_conf(struct bme69x_conf *conf, struct bme69x_dev *dev);
  * int8_t bme69x_set_heatr_conf(uint8_t op_mode, const struct bme69x_heatr_conf *conf, struct bme69x_dev *dev);
  * \endcode
  * @details This API is used to set the gas configuration of the sensor.
+ * Only registers that differ from the device's register shadow are written, after
+ * putting the sensor to sleep; if none do, the sensor is not accessed at all.
  *
  * @param[in] op_mode : Expected operation mode of the sensor.
  * @param[in] conf    : Desired heating configuration.
@@ -86,12 +86,29 @@
 #endif
 #endif
 
+/*
+ * ARM cores without an FPU (the STM32WB05's Cortex-M0+) use the integer compensation.
+ * Such builds now get integer output without defining BME69X_DO_NOT_USE_FPU:
+ * temperature in degC x100, humidity in %RH x1000, pressure in Pa and gas
+ * resistance in Ohms, instead of floats in degC, %RH, Pa and Ohms.
+ */
+#if !defined(BME69X_DO_NOT_USE_FPU) && defined(__arm__) && !defined(__ARM_FP)
+#define BME69X_DO_NOT_USE_FPU
+#endif
+
 #ifndef BME69X_DO_NOT_USE_FPU
 
-/* Comment or un-comment the macro to provide floating point data output */
+/* Comment or un-comment the macro to provide floating point data output
+ * (only reached on cores with an FPU or off ARM, see above) */
 #define BME69X_USE_FPU
 #endif
 
+/*
+ * Define BME69X_FIELD_BURST_READ to read a forced-mode field together with the
+ * heater blocks behind it in one transfer (fewer but longer transfers; pays off
+ * when per-transfer overhead outweighs ~35 extra bytes on the bus)
+ */
+
 /* Period between two polls (value can be given by user) */
 #ifndef BME69X_PERIOD_POLL
 #define BME69X_PERIOD_POLL                        UINT32_C(10000)
@@ -336,12 +353,19 @@
 /* Length between two fields */
 #define BME69X_LEN_FIELD_OFFSET                   UINT8_C(17)
 
+/* Length of the 3 fields plus the heater blocks behind them (idac, res_heat, gas_wait) */
+#define BME69X_LEN_FIELD_BLOCK                    UINT8_C(81)
+
 /* Length of the configuration register */
 #define BME69X_LEN_CONFIG                         UINT8_C(5)
 
 /* Length of the interleaved buffer */
 #define BME69X_LEN_INTERLEAVE_BUFF                UINT8_C(20)
 
+/* Configuration register shadow: RES_HEAT0 (0x5a) up to CONFIG (0x75) */
+#define BME69X_SHADOW_START                       BME69X_REG_RES_HEAT0
+#define BME69X_LEN_SHADOW                         UINT8_C(28)
+
 /* Coefficient index macros */
 
 /* Coefficient T2 LSB position */
@@ -850,6 +874,33 @@ struct bme69x_calib_data
 
     /*! Variable to store the intermediate temperature coefficient */
     int32_t t_fine;
+
+    /*
+     * Calibration-only terms of the integer compensation, folded once by
+     * get_calib_data() so each sample only does the ADC-dependent work
+     */
+
+    /*! Temperature ADC offset, par_t1 * 256 */
+    uint32_t t_adc_off;
+
+    /*! Temperature linear gain, par_t2 * 2^18 */
+    uint64_t t_gain;
+
+    /*! Pressure offset: par_p1 * 2^47, par_p2 * 2^22 (t_lin), par_p3 * 16 (t_lin^2) */
+    int64_t p_off;
+    int64_t p_off_t;
+    int32_t p_off_tt;
+
+    /*! Pressure sensitivity: (par_p5 - 16384) * 2^46, (par_p6 - 16384) * 2^21, par_p7 * 4 */
+    int64_t p_sens;
+    int64_t p_sens_t;
+    int32_t p_sens_tt;
+
+    /*! Pressure non-linearity offset, par_p9 * 2^16 */
+    int32_t p_nl;
+
+    /*! Humidity offset, 16384 - par_h1 * 2^20 (the product taken as 32-bit unsigned) */
+    int64_t h_off;
 #else
 
     /*! Variable to store the intermediate temperature coefficient */
@@ -974,6 +1025,22 @@ struct bme69x_dev
 
     /*! Store the info messages */
     uint8_t info_msg;
+
+    /*!
+     * Last value written to / read from each configuration register from
+     * BME69X_SHADOW_START on (CTRL_MEAS without the mode bits). Lets the
+     * configuration APIs skip reads and unchanged writes. Cleared by soft reset.
+     */
+    uint8_t shadow[BME69X_LEN_SHADOW];
+
+    /*! Bit n set: shadow[n] holds the sensor's value */
+    uint32_t shadow_valid;
+
+    /*! Op mode and oversampling of the cached bme69x_get_meas_dur() result, 0 if none */
+    uint16_t meas_dur_key;
+
+    /*! Cached measurement duration in microseconds */
+    uint32_t meas_dur;
 };
 
 #endif /* BME69X_DEFS_H_ */
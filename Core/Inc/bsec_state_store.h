@@ -7,20 +7,39 @@
 extern "C" {
 #endif
 
+/*
+ * Flash pages holding the state log (2KB each), placed right below BT NVM.
+ * Must match FLASH_BSEC_DATASIZE in the linker script.
+ */
+#ifndef BSEC_STORE_NUM_PAGES
+#define BSEC_STORE_NUM_PAGES (4u)
+#endif
+
+/* Scans the log once to find the newest record and the append position */
 HAL_StatusTypeDef bsec_state_store_init(void);
 
-/* Call after bsec_init() and bsec_set_configuration() */
-HAL_StatusTypeDef bsec_state_store_load(void *bsec_inst);
+/*
+ * BSEC work buffers are not owned here: load and save borrow the caller's
+ * (BSEC_MAX_WORKBUFFER_SIZE bytes), which is only used for the duration of the call.
+ */
+
+/* Call after bsec_init() and bsec_set_configuration(); restores the newest valid record */
+HAL_StatusTypeDef bsec_state_store_load(void *bsec_inst, uint8_t *workbuf, uint32_t workbuf_len);
 
 /**
- * Call often; it saves at most once per interval.
+ * Call often; it starts a save at most once per interval. Each save appends one record;
+ * a page is erased only when the log moves on to it. The erase/write runs later from
+ * the Flash Manager task in radio-idle windows, and its outcome is returned by the
+ * next call after it finishes.
  *
  * Return codes:
- *  - HAL_OK   : a save was performed successfully (flash updated)
- *  - HAL_BUSY : not time to save yet (no write done)
- *  - HAL_ERROR: save attempted but failed
+ *  - HAL_OK   : the last save completed (flash updated)
+ *  - HAL_BUSY : not time to save yet, or a save is still in progress
+ *  - HAL_ERROR: the last save (or starting this one) failed
  */
 HAL_StatusTypeDef bsec_state_store_maybe_save(void *bsec_inst,
+                                              uint8_t *workbuf,
+                                              uint32_t workbuf_len,
                                               uint32_t now_ms,
                                               uint32_t save_period_ms);
 
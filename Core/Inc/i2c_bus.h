@@ -0,0 +1,69 @@
+#pragma once
+
+#include "stm32wb0x_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max transactions waiting for the bus (all devices together) */
+#ifndef I2C_BUS_QUEUE_LEN
+#define I2C_BUS_QUEUE_LEN (8u)
+#endif
+
+typedef enum
+{
+    I2C_BUS_READ = 0,
+    I2C_BUS_WRITE
+} i2c_bus_dir_t;
+
+// Completion callback; runs in I2C interrupt context (or task context on timeout)
+typedef void (*i2c_bus_done_cb_t)(HAL_StatusTypeDef status, void *user);
+
+// One register read/write. Caller owns the descriptor and the data buffer
+// until the callback fires (or status leaves HAL_BUSY).
+typedef struct
+{
+    uint16_t dev_addr_8bit;     // HAL expects 8-bit address (7-bit << 1)
+    uint8_t  reg_addr;
+    uint8_t  dir;               // i2c_bus_dir_t
+    uint8_t *data;
+    uint16_t len;
+    uint32_t timeout_ms;
+    i2c_bus_done_cb_t done;     // optional
+    void *user;
+
+    volatile HAL_StatusTypeDef status; // HAL_BUSY while queued/in flight
+    uint32_t start_ms;
+} i2c_bus_xfer_t;
+
+// Bind the queue to the (already initialized) I2C handle shared by all sensors
+// and register CFG_TASK_I2C_BUS, which resets the peripheral after a timeout
+HAL_StatusTypeDef i2c_bus_init(I2C_HandleTypeDef *hi2c);
+
+// Queue a transaction; it starts as soon as the ones ahead of it finish.
+// Transactions run strictly in submit order, so per-device ordering holds.
+// HAL_BUSY if the queue is full.
+HAL_StatusTypeDef i2c_bus_submit(i2c_bus_xfer_t *x);
+
+// Blocking convenience wrapper for the Bosch SensorAPI callbacks: submits and
+// sleeps (WFI) until the transaction completes, resetting the peripheral
+// itself if it times out. Called from an ISR it falls back to a polled HAL
+// transfer when the bus is idle, but only if SysTick can preempt that ISR:
+// the polled timeout runs on HAL_GetTick(). With SysTick at the lowest
+// priority (TICK_INT_PRIORITY) it returns HAL_ERROR from any ISR, as it does
+// with interrupts masked.
+HAL_StatusTypeDef i2c_bus_transfer(uint16_t dev_addr_8bit, uint8_t reg_addr, i2c_bus_dir_t dir,
+                                   uint8_t *data, uint16_t len, uint32_t timeout_ms);
+
+// Call from SysTick; flags the in-flight transaction when its timeout expires
+// and posts CFG_TASK_I2C_BUS to reset the peripheral and fail it
+void i2c_bus_tick(void);
+
+// ms until i2c_bus_tick() has work (UINT32_MAX: bus idle)
+uint32_t i2c_bus_idle_ms(uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "stm32wb0x_hal.h"
+#include "app_conf.h"
+#include "air_app.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary telemetry on USART1, replacing the runtime text lines.
+//
+// Records are batched into a frame, the frame is COBS-encoded and terminated
+// with 0x00, then queued in a TX ring that UART_TransmitDMA (usart_if.c)
+// drains in the background. Frame before encoding, little endian:
+//
+//   seq u16 | ts_ms u32 | { type u8 | len u8 | dt_ms u16 | payload[len] } ... | crc16 u16
+//
+// ts_ms is HAL_GetTick() when the frame was opened, dt_ms the record's offset
+// from it. crc16 is CRC-16/CCITT-FALSE over everything before it.
+// USART1 is shared with the ADV trace driver, so telemetry is compiled out
+// when CFG_DEBUG_APP_ADV_TRACE is enabled.
+
+#ifndef TELEMETRY_ENABLE
+#define TELEMETRY_ENABLE (CFG_DEBUG_APP_ADV_TRACE == 0)
+#endif
+
+#define TELEMETRY_FRAME_MAX   (128u)  // raw frame bytes, before COBS
+#define TELEMETRY_RING_SIZE   (512u)  // encoded bytes waiting for the UART, power of two
+#define TELEMETRY_BATCH_MS    (250u)  // max age of an open frame
+
+typedef enum
+{
+    TLM_REC_AIR = 1,
+    TLM_REC_IMPACT = 2,
+    TLM_REC_DIAG = 3,
+    TLM_REC_GAS = 4
+} tlm_rec_type_t;
+
+typedef enum
+{
+    TLM_DIAG_BMA_IRQ = 1,       // a: IRQ count, b: IRQ-to-task latency ms
+    TLM_DIAG_BMA_ISR = 2,       // a: ISR max cycles, b: ISR avg cycles
+    TLM_DIAG_BMA_INT = 3,       // a: INT status, b: Bosch API result
+    TLM_DIAG_BSEC_SAVE = 4,     // a: HAL status of the state save
+    TLM_DIAG_BMA_QUEUE = 5,     // a: IRQ queue high-water mark, b: IRQ events dropped
+    TLM_DIAG_BOOT_INIT = 6      // a: air_app_init us, b: bma456_app_init us (once, at boot)
+} tlm_diag_code_t;
+
+typedef air_readings_packed_t tlm_air_t;
+
+typedef __PACKED_STRUCT
+{
+    uint16_t int_status;
+    uint16_t n_samples;
+    uint16_t peak_mg;
+    uint16_t min_mg;
+    uint16_t rms_mg;
+    uint32_t duration_us;
+    uint32_t energy;        // milli-(g^2*ms)
+} tlm_impact_t;
+
+typedef __PACKED_STRUCT
+{
+    uint8_t  code;          // tlm_diag_code_t
+    uint32_t a;
+    uint32_t b;
+} tlm_diag_t;
+
+// One parallel-mode heater profile step
+typedef __PACKED_STRUCT
+{
+    uint8_t  sensor;        // array slot
+    uint8_t  step;          // profile step (gas_index)
+    uint8_t  meas_index;    // sensor's sub-measurement counter
+    uint8_t  status;        // BME69X_* status bits (GASM_VALID, HEAT_STAB)
+    int16_t  t_cdeg;
+    uint32_t gas_ohm;
+} tlm_gas_t;
+
+typedef struct
+{
+    uint32_t frames;        // frames queued for TX
+    uint32_t records;
+    uint32_t bytes;         // encoded bytes queued, delimiters included
+    uint32_t dropped;       // frames lost to a full ring
+    uint32_t ring_high_water; // max bytes ever waiting for the UART
+} telemetry_stats_t;
+
+// Call once USART1 is initialized and the boot text has been printed;
+// the stream is binary from here on.
+HAL_StatusTypeDef telemetry_init(void);
+
+// Append a record to the open frame (task context only). The frame goes out
+// when it is full, older than TELEMETRY_BATCH_MS, or on telemetry_flush().
+HAL_StatusTypeDef telemetry_put(uint8_t type, const void *payload, uint8_t len);
+
+static inline HAL_StatusTypeDef telemetry_diag(uint8_t code, uint32_t a, uint32_t b)
+{
+    tlm_diag_t d = { code, a, b };
+    return telemetry_put(TLM_REC_DIAG, &d, (uint8_t)sizeof(d));
+}
+
+// Close the open frame and start transmitting it
+void telemetry_flush(void);
+
+// Call from SysTick; schedules the flush of an aged frame
+void telemetry_tick(void);
+
+// ms until telemetry_tick() has work (UINT32_MAX: no open frame)
+uint32_t telemetry_idle_ms(uint32_t now_ms);
+
+// Call from HAL_UART_TxCpltCallback
+void telemetry_tx_cplt(void);
+
+void telemetry_get_stats(telemetry_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
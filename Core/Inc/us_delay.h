@@ -0,0 +1,32 @@
+#pragma once
+
+#include "stm32wb0x_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Microsecond delays and timestamps for the sensor drivers.
+//
+// Built on SysTick, which HAL_Init() already runs at HCLK with a 1 ms reload:
+// the tick count gives the milliseconds, the down-counter the cycles within the
+// current one. No extra timer is claimed, and the resolution is one HCLK cycle.
+
+// Waits of at least this many microseconds sleep (WFI) for their whole-ms part
+// and only spin the tail; SysTick wakes the core every millisecond. 0: always spin.
+#ifndef US_DELAY_SLEEP_MIN_US
+#define US_DELAY_SLEEP_MIN_US (2000u)
+#endif
+
+// Block for at least us microseconds. Callable from any context; waits from an
+// ISR or with interrupts masked always spin.
+void us_delay(uint32_t us);
+
+// Free-running microsecond timestamp (wraps every ~71 minutes); subtract two
+// stamps to time an interval.
+uint32_t us_delay_stamp(void);
+
+#ifdef __cplusplus
+}
+#endif
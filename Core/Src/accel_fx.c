@@ -0,0 +1,86 @@
+#include "accel_fx.h"
+
+#include <string.h>
+
+uint32_t accel_fx_isqrt(uint32_t v)
+{
+    uint32_t res = 0;
+    uint32_t bit = 1uL << 30;
+
+    while (bit > v) bit >>= 2;
+
+    while (bit)
+    {
+        if (v >= res + bit)
+        {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+void accel_fx_window_init(accel_fx_window_t *w, uint16_t one_g, uint16_t thr_counts)
+{
+    memset(w, 0, sizeof(*w));
+    w->one_g = one_g;
+    w->thr_sq = (uint32_t)thr_counts * thr_counts;
+    w->min_mag = UINT16_MAX;
+    w->first_above = -1;
+    w->last_above = -1;
+}
+
+void accel_fx_window_add(accel_fx_window_t *w, const struct bma4_accel *s, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        uint32_t sq = accel_fx_mag_sq(&s[i]);
+        uint16_t mag = (uint16_t)accel_fx_isqrt(sq);
+        // |(|a| - 1g)| reaches 27.7g at full scale on all axes: square it unsigned
+        uint32_t dyn = (mag > w->one_g) ? (uint32_t)(mag - w->one_g) : (uint32_t)(w->one_g - mag);
+
+        if (mag < w->min_mag) w->min_mag = mag;
+        if (mag > w->max_mag) w->max_mag = mag;
+
+        // Threshold on the squared value, no sqrt needed for the compare
+        if (sq > w->thr_sq)
+        {
+            if (w->first_above < 0) w->first_above = w->n;
+            w->last_above = w->n;
+        }
+
+        w->sum_sq += sq;
+        w->sum_dyn_sq += dyn * dyn;
+        w->n++;
+    }
+}
+
+uint16_t accel_fx_window_rms(const accel_fx_window_t *w)
+{
+    if (w->n == 0u) return 0;
+    return (uint16_t)accel_fx_isqrt((uint32_t)(w->sum_sq / w->n));
+}
+
+uint16_t accel_fx_window_span(const accel_fx_window_t *w)
+{
+    if (w->first_above < 0) return 0;
+    return (uint16_t)(w->last_above - w->first_above + 1);
+}
+
+uint32_t accel_fx_window_energy(const accel_fx_window_t *w, uint32_t odr_hz)
+{
+    // sum / one_g^2 [g^2] * 1000 / odr [ms] * 1000 [milli], split in two
+    // steps so a full 65535-sample window cannot overflow the 64-bit product
+    uint64_t one_g_sq = (uint64_t)w->one_g * w->one_g;
+    uint64_t e = (w->sum_dyn_sq * 1000u + one_g_sq / 2u) / one_g_sq;
+
+    if (odr_hz == 0u) return 0;
+    e = (e * 1000u + odr_hz / 2u) / odr_hz;
+
+    return (e > UINT32_MAX) ? UINT32_MAX : (uint32_t)e;
+}
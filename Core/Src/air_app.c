@@ -4,7 +4,15 @@
 #include <string.h>
 
 #include "bme69x.h"
-#include "bme690_port.h"
+#include "bme690_array.h"
+
+/* Sequencer */
+#include "app_conf.h"
+#include "stm32_seq.h"
+
+/* Binary UART telemetry, BLE notifications */
+#include "telemetry.h"
+#include "p2p_server_app.h"
 
 /* BSEC */
 #include "bsec_interface.h"
@@ -15,31 +23,114 @@
 #include "bsec_state_store.h"
 
 /* ---------- USER TUNABLES ---------- */
-#define I2C_ADDR_BME_RAW   (0x77)
-#define I2C_ADDR_BME_BSEC  (0x76)
-
 #define PRINT_PERIOD_MS    (10000)
 #define UART_TIMEOUT_MS    (200)
 
 /* Save BSEC state every 5 minutes */
 #define BSEC_SAVE_PERIOD_MS (5u * 60u * 1000u)
 
+/* Re-poll BSEC after this long if bsec_sensor_control() gave us no schedule (LP period) */
+#define BSEC_FALLBACK_PERIOD_MS (3000u)
+
+/* Optional third BME690 running a parallel-mode heater scan; every step goes out
+   as a TLM_REC_GAS record (raw gas resistance, not fed to BSEC) */
+#ifndef AIR_GAS_SCAN_ENABLE
+#define AIR_GAS_SCAN_ENABLE (0)
+#endif
+#ifndef AIR_GAS_SCAN_I2C_ADDR
+#define AIR_GAS_SCAN_I2C_ADDR (0x76)
+#endif
+#ifndef AIR_GAS_SCAN_MUX_ADDR
+#define AIR_GAS_SCAN_MUX_ADDR (0x70)     /* TCA9548A */
+#endif
+#ifndef AIR_GAS_SCAN_MUX_CHANNEL
+#define AIR_GAS_SCAN_MUX_CHANNEL (0)
+#endif
+
 /* ---------- STATIC STATE ---------- */
 static I2C_HandleTypeDef *s_hi2c = NULL;
 static UART_HandleTypeDef *s_huart = NULL;
 
-static struct bme69x_dev s_bme_raw;
-static struct bme69x_dev s_bme_bsec;
+/*
+ * BME690 array. Slot order follows this table: the first entry is the raw T/H/P
+ * sensor the array triggers every PRINT_PERIOD_MS, the second is driven by BSEC.
+ * More periodic sensors (another address, or behind a mux) can be appended; the
+ * array triggers them together so their heater phases overlap.
+ */
+enum
+{
+    AIR_BME_RAW = 0,
+    AIR_BME_BSEC,
+#if AIR_GAS_SCAN_ENABLE
+    AIR_BME_SCAN,
+#endif
+    AIR_BME_COUNT
+};
+
+#if AIR_GAS_SCAN_ENABLE
+/* 10-step scan, 140 ms heater units: hot cleaning pulse, slow rise at 100 C, two plateaus */
+static const uint16_t s_scan_temp_c[10]   = { 320, 100, 100, 100, 200, 200, 200, 320, 320, 320 };
+static const uint16_t s_scan_dur_mult[10] = {   5,   2,  10,  30,   5,   5,   5,   5,   5,   5 };
+
+static const bme690_heatr_profile_t s_scan_profile =
+{
+    .temp_c = s_scan_temp_c,
+    .dur_mult = s_scan_dur_mult,
+    .len = 10,
+    .shared_dur_ms = 140,
+};
+#endif
+
+static const bme690_sensor_cfg_t s_bme_cfg[AIR_BME_COUNT] =
+{
+    [AIR_BME_RAW] = {
+        .i2c_addr = 0x77, .mux_addr = BME690_PORT_NO_MUX,
+        .period_ms = PRINT_PERIOD_MS,
+        .os_temp = BME69X_OS_2X, .os_pres = BME69X_OS_16X, .os_hum = BME69X_OS_1X,
+        .filter = BME69X_FILTER_SIZE_3,
+    },
+    [AIR_BME_BSEC] = {
+        .i2c_addr = 0x76, .mux_addr = BME690_PORT_NO_MUX,
+        .period_ms = 0, /* BSEC decides when and how to measure */
+    },
+#if AIR_GAS_SCAN_ENABLE
+    [AIR_BME_SCAN] = {
+        .i2c_addr = AIR_GAS_SCAN_I2C_ADDR, .mux_addr = AIR_GAS_SCAN_MUX_ADDR,
+        .mux_channel = AIR_GAS_SCAN_MUX_CHANNEL,
+        .os_temp = BME69X_OS_2X, .os_pres = BME69X_OS_1X, .os_hum = BME69X_OS_1X,
+        .filter = BME69X_FILTER_OFF,
+        .profile = &s_scan_profile, /* harvested every two heater units */
+    },
+#endif
+};
+
+static uint8_t s_bme_idx[AIR_BME_COUNT];
 
 static air_readings_t s_latest;
 
 static uint32_t s_last_print_ms = 0;
-static uint32_t s_last_raw_ms = 0;
+
+/* A raw sample came in since the last print */
+static uint8_t s_raw_fresh = 0;
+
+/* Next time BSEC wants bsec_sensor_control() to be called */
+static uint32_t s_next_bsec_ms = 0;
+
+/* Signals BSEC asked for in the measurement in flight */
+static uint32_t s_bsec_process_data = 0;
+
+/* Earliest of all deadlines above; checked from SysTick by air_app_tick(). While the
+   core idles, APPE_Idle() stops SysTick and sleeps until the earliest of this and
+   the other tick users' deadlines (air_app_idle_ms()). */
+static volatile uint32_t s_next_wake_ms = 0;
+static volatile uint8_t s_wake_armed = 0;
 
 /* ---- BSEC instance memory */
 static uint8_t s_bsec_inst_mem[6000];
 static void *s_bsec_inst = s_bsec_inst_mem;
 
+/* The one BSEC scratch buffer: configuration, state load and state save all borrow it
+   from the air task, so they never overlap */
 static uint8_t s_bsec_workbuf[BSEC_MAX_WORKBUFFER_SIZE];
 
 /* Track whether we successfully loaded state once (optional) */
@@ -50,64 +141,49 @@ static int64_t millis_to_ns(uint32_t ms)
     return (int64_t)ms * 1000000LL;
 }
 
-static void uart_print_line(const char *s)
+/* Wrap-safe "now is at or past deadline" for HAL_GetTick() values */
+static uint8_t deadline_reached(uint32_t now_ms, uint32_t deadline_ms)
 {
-    if (!s_huart || !s) return;
-    HAL_UART_Transmit(s_huart, (uint8_t*)s, (uint16_t)strlen(s), UART_TIMEOUT_MS);
+    return ((int32_t)(now_ms - deadline_ms) >= 0) ? 1u : 0u;
 }
 
-/* Configure BME69x basic T/H/P settings (used for raw sensor) */
-static int8_t config_bme_tph(struct bme69x_dev *dev)
+/* Return whichever deadline comes first, relative to now */
+static uint32_t earliest(uint32_t now_ms, uint32_t a_ms, uint32_t b_ms)
 {
-    struct bme69x_conf conf = {0};
-    conf.os_temp = BME69X_OS_2X;
-    conf.os_pres = BME69X_OS_16X;
-    conf.os_hum  = BME69X_OS_1X;
-    conf.filter  = BME69X_FILTER_SIZE_3;
-    conf.odr     = BME69X_ODR_NONE;
-
-    return bme69x_set_conf(&conf, dev);
+    return ((int32_t)(a_ms - now_ms) <= (int32_t)(b_ms - now_ms)) ? a_ms : b_ms;
 }
 
-/* Raw sensor read helper (0x77).
-   This is the ONLY source for: temperature, RH, pressure display. */
-static int8_t read_raw_sensor(float *t_c, float *rh, float *p_pa)
+/* Sequencer task body: run whatever is due, then re-arm for the next deadline */
+static void air_app_task(void)
 {
-    int8_t rslt;
-    struct bme69x_data data;
-    uint8_t n = 0;
-
-    rslt = bme69x_set_op_mode(BME69X_FORCED_MODE, &s_bme_raw);
-    if (rslt != BME69X_OK) return rslt;
-
-    /* Wait for measurement completion */
-    struct bme69x_conf conf;
-    rslt = bme69x_get_conf(&conf, &s_bme_raw);
-    if (rslt != BME69X_OK) return rslt;
-
-    uint32_t dur_us = bme69x_get_meas_dur(BME69X_FORCED_MODE, &conf, &s_bme_raw);
-    s_bme_raw.delay_us(dur_us + 20000, s_bme_raw.intf_ptr); /* +20ms margin */
+    (void)air_app_process();
+}
 
-    rslt = bme69x_get_data(BME69X_FORCED_MODE, &data, &n, &s_bme_raw);
-    if (rslt != BME69X_OK || n == 0) return rslt;
+static void uart_print_line(const char *s)
+{
+    if (!s_huart || !s) return;
+    HAL_UART_Transmit(s_huart, (uint8_t*)s, (uint16_t)strlen(s), UART_TIMEOUT_MS);
+}
 
+/* Raw sensor sample: this is the ONLY source for temperature, RH, pressure display */
+static void raw_sensor_sample(const struct bme69x_data *data)
+{
 #ifdef BME69X_USE_FPU
-    *t_c = data.temperature;
-    *p_pa = data.pressure;
-    *rh = data.humidity;
+    s_latest.t_c = data->temperature;
+    s_latest.p_pa = data->pressure;
+    s_latest.rh = data->humidity;
 #else
-    *t_c = data.temperature / 100.0f;
-    *p_pa = (float)data.pressure;
-    *rh = data.humidity / 1000.0f;
+    s_latest.t_c = data->temperature / 100.0f;
+    s_latest.p_pa = (float)data->pressure;
+    s_latest.rh = data->humidity / 1000.0f;
 #endif
-    return BME69X_OK;
+    s_raw_fresh = 1;
 }
 
-/* Apply BSEC-requested settings to the BME sensor @0x76 and trigger measurement if needed. */
-static int8_t bsec_apply_settings_and_measure(const bsec_bme_settings_t *s, struct bme69x_data *out)
+/* Apply BSEC-requested settings to the BSEC sensor and start the measurement.
+   The array hands the result to bsec_measurement_sample() once the heater time has elapsed. */
+static int8_t bsec_measurement_trigger(const bsec_bme_settings_t *s, uint32_t now_ms)
 {
-    int8_t rslt;
-
     if (!s->trigger_measurement)
     {
         return BME69X_W_NO_NEW_DATA;
@@ -121,9 +197,6 @@ static int8_t bsec_apply_settings_and_measure(const bsec_bme_settings_t *s, stru
     conf.filter  = BME69X_FILTER_SIZE_3;
     conf.odr     = BME69X_ODR_NONE;
 
-    rslt = bme69x_set_conf(&conf, &s_bme_bsec);
-    if (rslt != BME69X_OK) return rslt;
-
     /* Configure heater if requested */
     struct bme69x_heatr_conf h = {0};
     if (s->run_gas)
@@ -139,41 +212,127 @@ static int8_t bsec_apply_settings_and_measure(const bsec_bme_settings_t *s, stru
         h.heatr_dur  = 0;
     }
 
-    rslt = bme69x_set_heatr_conf(BME69X_FORCED_MODE, &h, &s_bme_bsec);
+    /* Trigger measurement; do not wait for it here */
+    int8_t rslt = bme690_array_trigger(s_bme_idx[AIR_BME_BSEC], &conf, &h, now_ms);
     if (rslt != BME69X_OK) return rslt;
 
-    /* Trigger measurement */
-    rslt = bme69x_set_op_mode(BME69X_FORCED_MODE, &s_bme_bsec);
-    if (rslt != BME69X_OK) return rslt;
+    s_bsec_process_data = s->process_data;
+    return BME69X_OK;
+}
 
-    /* Wait until measurement should be done */
-    uint32_t dur_us = bme69x_get_meas_dur(BME69X_FORCED_MODE, &conf, &s_bme_bsec);
-    s_bme_bsec.delay_us(dur_us + ((uint32_t)s->heater_duration * 1000U) + 20000U, s_bme_bsec.intf_ptr);
+/* Feed a finished BSEC measurement to bsec_do_steps() */
+static void bsec_measurement_sample(const struct bme69x_data *data, uint32_t trig_ms)
+{
+    const struct bme69x_data d = *data;
+    bsec_input_t in[4];
+    uint8_t n_in = 0;
 
-    /* Read data */
-    uint8_t n = 0;
-    rslt = bme69x_get_data(BME69X_FORCED_MODE, out, &n, &s_bme_bsec);
-    if (rslt != BME69X_OK || n == 0) return rslt;
+#ifdef BME69X_USE_FPU
+    float t_c = d.temperature;
+    float p_pa = d.pressure;
+    float rh = d.humidity;
+    float gas_ohm = d.gas_resistance;
+#else
+    float t_c = d.temperature / 100.0f;
+    float p_pa = (float)d.pressure;
+    float rh = d.humidity / 1000.0f;
+    float gas_ohm = (float)d.gas_resistance;
+#endif
 
-    return BME69X_OK;
+    /* BSEC wants the time the measurement was requested, not when it was read */
+    int64_t ts = millis_to_ns(trig_ms);
+
+    if (s_bsec_process_data & BSEC_PROCESS_TEMPERATURE)
+        in[n_in++] = (bsec_input_t){ .time_stamp = ts, .signal = t_c, .signal_dimensions = 1, .sensor_id = BSEC_INPUT_TEMPERATURE };
+
+    if (s_bsec_process_data & BSEC_PROCESS_HUMIDITY)
+        in[n_in++] = (bsec_input_t){ .time_stamp = ts, .signal = rh, .signal_dimensions = 1, .sensor_id = BSEC_INPUT_HUMIDITY };
+
+    if (s_bsec_process_data & BSEC_PROCESS_PRESSURE)
+        in[n_in++] = (bsec_input_t){ .time_stamp = ts, .signal = p_pa, .signal_dimensions = 1, .sensor_id = BSEC_INPUT_PRESSURE };
+
+    if (s_bsec_process_data & BSEC_PROCESS_GAS)
+        in[n_in++] = (bsec_input_t){ .time_stamp = ts, .signal = gas_ohm, .signal_dimensions = 1, .sensor_id = BSEC_INPUT_GASRESISTOR };
+
+    bsec_output_t out[8];
+    uint8_t n_out = 8;
+
+    bsec_library_return_t br = bsec_do_steps(s_bsec_inst, in, n_in, out, &n_out);
+    if (br == BSEC_OK || br > 0)
+    {
+        for (uint8_t i = 0; i < n_out; i++)
+        {
+            if (out[i].sensor_id == BSEC_OUTPUT_IAQ)
+            {
+                s_latest.iaq = out[i].signal;
+                s_latest.iaq_accuracy = out[i].accuracy;
+            }
+        }
+    }
 }
 
-static void uart_print_now(void)
+void air_app_pack(const air_readings_t *in, air_readings_packed_t *out)
 {
-    char line[220];
+    out->t_cdeg = (int16_t)((in->t_c >= 0.0f) ? (in->t_c * 100.0f + 0.5f)
+                                              : (in->t_c * 100.0f - 0.5f));
+    out->rh_cpct = (uint16_t)(in->rh * 100.0f + 0.5f);
+    out->p_pa = (uint32_t)(in->p_pa + 0.5f);
+    out->iaq_x10 = (uint16_t)(in->iaq * 10.0f + 0.5f);
+    out->iaq_accuracy = in->iaq_accuracy;
+}
+
+/* Publish the latest readings: TLM_REC_AIR record on UART (11 bytes instead of a
+ * ~60 char line) and a sample for the BLE notification batch */
+static void send_readings_now(uint32_t now_ms)
+{
+    air_readings_packed_t rec;
 
     /* IMPORTANT: T/RH/P come ONLY from raw sensor (0x77) stored in s_latest */
-    float p_hpa = s_latest.p_pa / 100.0f;
+    air_app_pack(&s_latest, &rec);
 
-    int len = snprintf(line, sizeof(line),
-                       "T=%.2f C RH=%.2f %% P=%.2f hPa | IAQ=%.1f (acc=%u)\r\n",
-                       s_latest.t_c,
-                       s_latest.rh,
-                       p_hpa,
-                       s_latest.iaq,
-                       (unsigned)s_latest.iaq_accuracy);
+    (void)telemetry_put(TLM_REC_AIR, &rec, (uint8_t)sizeof(rec));
+    P2P_SERVER_APP_PushAirSample(&rec, now_ms);
+}
 
-    HAL_UART_Transmit(s_huart, (uint8_t*)line, (uint16_t)len, UART_TIMEOUT_MS);
+#if AIR_GAS_SCAN_ENABLE
+/* One heater step of the parallel-mode scan */
+static void gas_scan_sample(uint8_t idx, const struct bme69x_data *data)
+{
+    tlm_gas_t rec;
+
+    rec.sensor = idx;
+    rec.step = data->gas_index;
+    rec.meas_index = data->meas_index;
+    rec.status = data->status;
+#ifdef BME69X_USE_FPU
+    rec.t_cdeg = (int16_t)(data->temperature * 100.0f);
+    rec.gas_ohm = (uint32_t)data->gas_resistance;
+#else
+    rec.t_cdeg = data->temperature;
+    rec.gas_ohm = data->gas_resistance;
+#endif
+
+    (void)telemetry_put(TLM_REC_GAS, &rec, (uint8_t)sizeof(rec));
+}
+#endif
+
+/* Array sample callback (air task context) */
+static void bme_sample(uint8_t idx, const struct bme69x_data *data, uint32_t trig_ms)
+{
+    if (idx == s_bme_idx[AIR_BME_RAW])
+    {
+        raw_sensor_sample(data);
+    }
+    else if (idx == s_bme_idx[AIR_BME_BSEC])
+    {
+        bsec_measurement_sample(data, trig_ms);
+    }
+#if AIR_GAS_SCAN_ENABLE
+    else if (idx == s_bme_idx[AIR_BME_SCAN])
+    {
+        gas_scan_sample(idx, data);
+    }
+#endif
 }
 
 HAL_StatusTypeDef air_app_init(I2C_HandleTypeDef *hi2c1, UART_HandleTypeDef *huart1)
@@ -184,14 +343,12 @@ HAL_StatusTypeDef air_app_init(I2C_HandleTypeDef *hi2c1, UART_HandleTypeDef *hua
 
     uart_print_line("\r\n--- BME690 Boot ---\r\n");
 
-    /* -------- RAW BME @0x77 ---------- */
-    if (bme690_port_init_i2c(&s_bme_raw, s_hi2c, I2C_ADDR_BME_RAW) != BME69X_OK) return HAL_ERROR;
-    if (bme69x_init(&s_bme_raw) != BME69X_OK) return HAL_ERROR;
-    if (config_bme_tph(&s_bme_raw) != BME69X_OK) return HAL_ERROR;
-
-    /* -------- BSEC BME @0x76 ---------- */
-    if (bme690_port_init_i2c(&s_bme_bsec, s_hi2c, I2C_ADDR_BME_BSEC) != BME69X_OK) return HAL_ERROR;
-    if (bme69x_init(&s_bme_bsec) != BME69X_OK) return HAL_ERROR;
+    /* -------- BME690 array (raw @0x77, BSEC @0x76) ---------- */
+    bme690_array_init(bme_sample);
+    for (uint8_t i = 0; i < AIR_BME_COUNT; i++)
+    {
+        if (bme690_array_add(s_hi2c, &s_bme_cfg[i], &s_bme_idx[i]) != BME69X_OK) return HAL_ERROR;
+    }
 
     /* -------- BSEC init ---------- */
     size_t need = bsec_get_instance_size();
@@ -216,7 +373,7 @@ HAL_StatusTypeDef air_app_init(I2C_HandleTypeDef *hi2c1, UART_HandleTypeDef *hua
     }
     else
     {
-        if (bsec_state_store_load(s_bsec_inst) == HAL_OK)
+        if (bsec_state_store_load(s_bsec_inst, s_bsec_workbuf, sizeof(s_bsec_workbuf)) == HAL_OK)
         {
             s_bsec_state_loaded = 1;
             uart_print_line("BSEC state: LOADED from flash\r\n");
@@ -240,9 +397,13 @@ HAL_StatusTypeDef air_app_init(I2C_HandleTypeDef *hi2c1, UART_HandleTypeDef *hua
 
     uart_print_line("--- Air App Ready ---\r\n");
 
-    /* Force an immediate first update+print on the first air_app_process() call */
-    s_last_raw_ms   = HAL_GetTick() - PRINT_PERIOD_MS;
+    /* Print as soon as the first raw sample is in (the array triggers it right away) */
     s_last_print_ms = HAL_GetTick() - PRINT_PERIOD_MS;
+    s_next_bsec_ms  = HAL_GetTick();
+
+    /* Run from the sequencer; first pass is scheduled right away */
+    UTIL_SEQ_RegTask(1U << CFG_TASK_AIR_APP, UTIL_SEQ_RFU, air_app_task);
+    UTIL_SEQ_SetTask(1U << CFG_TASK_AIR_APP, CFG_SEQ_PRIO_1);
 
     return HAL_OK;
 }
@@ -251,102 +412,81 @@ HAL_StatusTypeDef air_app_process(void)
 {
     uint32_t now_ms = HAL_GetTick();
 
-    /* ---- Update raw sensor (0x77) every 10 seconds */
-    if ((now_ms - s_last_raw_ms) >= PRINT_PERIOD_MS)
-    {
-        float t, rh, p;
-        if (read_raw_sensor(&t, &rh, &p) == BME69X_OK)
-        {
-            s_latest.t_c = t;
-            s_latest.rh = rh;
-            s_latest.p_pa = p;
-        }
-        s_last_raw_ms = now_ms;
-    }
+    s_wake_armed = 0;
 
-    /* ---- Run BSEC state machine (0x76) ---- */
-    bsec_bme_settings_t s;
-    bsec_library_return_t br;
+    /* ---- Collect finished measurements, start the periodic ones that are due */
+    uint32_t array_next_ms = now_ms;
+    uint8_t array_armed = bme690_array_process(now_ms, &array_next_ms);
 
-    br = bsec_sensor_control(s_bsec_inst, millis_to_ns(now_ms), &s);
-    if (br == BSEC_OK)
+    uint8_t bsec_busy = bme690_array_busy(s_bme_idx[AIR_BME_BSEC]);
+
+    /* ---- Run BSEC state machine only when BSEC asked to be called ---- */
+    if (!bsec_busy && deadline_reached(now_ms, s_next_bsec_ms))
     {
-        if (s.trigger_measurement)
+        bsec_bme_settings_t s = {0};
+        bsec_library_return_t br = bsec_sensor_control(s_bsec_inst, millis_to_ns(now_ms), &s);
+        if (br == BSEC_OK)
         {
-            struct bme69x_data d;
-            int8_t r = bsec_apply_settings_and_measure(&s, &d);
-
-            if (r == BME69X_OK)
+            s_next_bsec_ms = (uint32_t)(s.next_call / 1000000LL);
+            if (s.trigger_measurement &&
+                bsec_measurement_trigger(&s, now_ms) == BME69X_OK)
             {
-                bsec_input_t in[4];
-                uint8_t n_in = 0;
-
-#ifdef BME69X_USE_FPU
-                float t_c = d.temperature;
-                float p_pa = d.pressure;
-                float rh = d.humidity;
-                float gas_ohm = d.gas_resistance;
-#else
-                float t_c = d.temperature / 100.0f;
-                float p_pa = (float)d.pressure;
-                float rh = d.humidity / 1000.0f;
-                float gas_ohm = (float)d.gas_resistance;
-#endif
-
-                int64_t ts = millis_to_ns(now_ms);
-
-                if (s.process_data & BSEC_PROCESS_TEMPERATURE)
-                    in[n_in++] = (bsec_input_t){ .time_stamp = ts, .signal = t_c, .signal_dimensions = 1, .sensor_id = BSEC_INPUT_TEMPERATURE };
-
-                if (s.process_data & BSEC_PROCESS_HUMIDITY)
-                    in[n_in++] = (bsec_input_t){ .time_stamp = ts, .signal = rh, .signal_dimensions = 1, .sensor_id = BSEC_INPUT_HUMIDITY };
-
-                if (s.process_data & BSEC_PROCESS_PRESSURE)
-                    in[n_in++] = (bsec_input_t){ .time_stamp = ts, .signal = p_pa, .signal_dimensions = 1, .sensor_id = BSEC_INPUT_PRESSURE };
-
-                if (s.process_data & BSEC_PROCESS_GAS)
-                    in[n_in++] = (bsec_input_t){ .time_stamp = ts, .signal = gas_ohm, .signal_dimensions = 1, .sensor_id = BSEC_INPUT_GASRESISTOR };
-
-                bsec_output_t out[8];
-                uint8_t n_out = 8;
-
-                br = bsec_do_steps(s_bsec_inst, in, n_in, out, &n_out);
-                if (br == BSEC_OK || br > 0)
-                {
-                    for (uint8_t i = 0; i < n_out; i++)
-                    {
-                        if (out[i].sensor_id == BSEC_OUTPUT_IAQ)
-                        {
-                            s_latest.iaq = out[i].signal;
-                            s_latest.iaq_accuracy = out[i].accuracy;
-                        }
-                    }
-                }
+                /* Its collect deadline must be part of this pass's wakeup */
+                bsec_busy = 1;
+                array_armed = bme690_array_process(now_ms, &array_next_ms);
             }
         }
+        else
+        {
+            s_next_bsec_ms = now_ms + BSEC_FALLBACK_PERIOD_MS;
+        }
     }
 
-    /* ---- UART print every 10 seconds */
-    if ((now_ms - s_last_print_ms) >= PRINT_PERIOD_MS)
+    /* ---- UART print every 10 seconds, once the fresh raw sample is in */
+    if (s_raw_fresh && (now_ms - s_last_print_ms) >= PRINT_PERIOD_MS)
     {
-        uart_print_now();
+        send_readings_now(now_ms);
         s_last_print_ms = now_ms;
+        s_raw_fresh = 0;
     }
 
     /* ---- Save BSEC state every 5 minutes (only when accuracy >= 1) */
     if (s_latest.iaq_accuracy >= 1)
     {
-        HAL_StatusTypeDef st = bsec_state_store_maybe_save(s_bsec_inst, now_ms, BSEC_SAVE_PERIOD_MS);
+        HAL_StatusTypeDef st = bsec_state_store_maybe_save(s_bsec_inst,
+                                                           s_bsec_workbuf, sizeof(s_bsec_workbuf),
+                                                           now_ms, BSEC_SAVE_PERIOD_MS);
 
-        if (st == HAL_OK)
-        {
-            uart_print_line("BSEC state: SAVE succeeded\r\n");
-        }
-        else if (st == HAL_ERROR)
+        /* HAL_BUSY => not time yet or still being written */
+        if (st != HAL_BUSY)
         {
-            uart_print_line("BSEC state: SAVE FAILED\r\n");
+            (void)telemetry_diag(TLM_DIAG_BSEC_SAVE, (uint32_t)st, 0);
         }
-        /* HAL_BUSY => not time yet */
+    }
+
+    /* ---- Sleep until the next collect/trigger/print deadline ---- */
+    uint32_t next_ms = s_next_bsec_ms;
+    if (bsec_busy)
+    {
+        /* BSEC is polled again after its sample is collected */
+        next_ms = array_next_ms;
+    }
+    else if (array_armed)
+    {
+        next_ms = earliest(now_ms, next_ms, array_next_ms);
+    }
+    if (s_raw_fresh)
+    {
+        next_ms = earliest(now_ms, next_ms, s_last_print_ms + PRINT_PERIOD_MS);
+    }
+
+    s_next_wake_ms = next_ms;
+    s_wake_armed = 1;
+    if (deadline_reached(HAL_GetTick(), next_ms))
+    {
+        /* Already late; go again without waiting for the tick */
+        s_wake_armed = 0;
+        UTIL_SEQ_SetTask(1U << CFG_TASK_AIR_APP, CFG_SEQ_PRIO_1);
     }
 
     (void)s_bsec_state_loaded;
@@ -359,3 +499,20 @@ HAL_StatusTypeDef air_app_get(air_readings_t *out)
     *out = s_latest;
     return HAL_OK;
 }
+
+void air_app_tick(void)
+{
+    if (s_wake_armed && deadline_reached(HAL_GetTick(), s_next_wake_ms))
+    {
+        s_wake_armed = 0;
+        UTIL_SEQ_SetTask(1U << CFG_TASK_AIR_APP, CFG_SEQ_PRIO_1);
+    }
+}
+
+uint32_t air_app_idle_ms(uint32_t now_ms)
+{
+    uint32_t next_ms = s_next_wake_ms;
+
+    if (!s_wake_armed) return UINT32_MAX;
+    return deadline_reached(now_ms, next_ms) ? 0u : (next_ms - now_ms);
+}
@@ -36,7 +36,11 @@
 
 /* Private includes -----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "flash_manager.h"
+#include "air_app.h"
+#include "i2c_bus.h"
+#include "telemetry.h"
+#include "bma456_app.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -48,7 +52,12 @@
 /* Private defines -----------------------------------------------------------*/
 
 /* USER CODE BEGIN PD */
-
+/* Idle stretches shorter than this keep SysTick running */
+#define APPE_TICKLESS_MIN_MS      (2U)
+/* Longest sleep without SysTick */
+#define APPE_TICKLESS_MAX_MS      (60000U)
+/* Radio timer system time units (625/256 us) per ms, times 5 to stay an integer */
+#define APPE_STU_X5_PER_MS        (2048U)
 /* USER CODE END PD */
 
 /* Private macros ------------------------------------------------------------*/
@@ -59,7 +68,13 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-
+/* Flash Manager asked to run again later (the radio left no room for the operation) */
+static volatile uint8_t fm_retry_pending = 0;
+/* One-shot wakeup of APPE_Idle(); waking the core is all it has to do */
+static void IdleTimer_Callback(void *arg);
+static VTIMER_HandleType idle_timer = { .callback = IdleTimer_Callback };
+/* Part of the slept time below 1 ms, in fifths of a system time unit */
+static uint32_t idle_stu_x5_rest = 0;
 /* USER CODE END PV */
 
 /* Global variables ----------------------------------------------------------*/
@@ -114,14 +129,78 @@ uint32_t MX_APPE_Init(void *p_param)
   UTIL_LPM_Init();
 #endif /* CFG_LPM_SUPPORTED */
 /* USER CODE BEGIN APPE_Init_2 */
-
+  UTIL_SEQ_RegTask(1U << CFG_TASK_FLASH_MANAGER, UTIL_SEQ_RFU, FM_BackgroundProcess);
 /* USER CODE END APPE_Init_2 */
   APP_DEBUG_SIGNAL_RESET(APP_APPE_INIT);
   return BLE_STATUS_SUCCESS;
 }
 
 /* USER CODE BEGIN FD */
+/**
+  * @brief  Called from SysTick: re-posts a Flash Manager request deferred by FM_ProcessRequest().
+  */
+void APPE_FlashManagerTick(void)
+{
+  if (fm_retry_pending)
+  {
+    fm_retry_pending = 0;
+    UTIL_SEQ_SetTask(1U << CFG_TASK_FLASH_MANAGER, CFG_SEQ_PRIO_1);
+  }
+}
+
+/**
+  * @brief  Main loop idle without the low power manager. When no SysTick user has work
+  *         within APPE_TICKLESS_MIN_MS, SysTick is stopped and a one-shot radio timer
+  *         wakes the core at the earliest deadline (air_app, telemetry, i2c_bus,
+  *         bma456_app). The HAL tick is then advanced by the time slept and SysTick
+  *         runs its hooks at once. Otherwise the core waits for the next interrupt with SysTick running.
+  *         WFE, not WFI: an interrupt that posted a task after the sequencer's last
+  *         check has set the event register, so the wait returns at once.
+  */
+void APPE_Idle(void)
+{
+  uint32_t now_ms = HAL_GetTick();
+  uint32_t idle_ms = air_app_idle_ms(now_ms);
+  uint64_t start_stu;
+  uint64_t slept_stu_x5;
+  uint32_t slept_ms;
+
+  idle_ms = MIN(idle_ms, telemetry_idle_ms(now_ms));
+  idle_ms = MIN(idle_ms, i2c_bus_idle_ms(now_ms));
+  idle_ms = MIN(idle_ms, bma456_app_idle_ms(now_ms));
+  if (fm_retry_pending)
+  {
+    idle_ms = 0;
+  }
+
+  if (idle_ms < APPE_TICKLESS_MIN_MS)
+  {
+    __WFE();
+    return;
+  }
+  idle_ms = MIN(idle_ms, APPE_TICKLESS_MAX_MS);
+
+  HAL_SuspendTick();
+  start_stu = HAL_RADIO_TIMER_GetCurrentSysTime();
+  if (HAL_RADIO_TIMER_StartVirtualTimer(&idle_timer, idle_ms) == 0U)
+  {
+    __WFE();
+    /* Another interrupt may have ended the sleep first */
+    HAL_RADIO_TIMER_StopVirtualTimer(&idle_timer);
+  }
+
+  slept_stu_x5 = (HAL_RADIO_TIMER_GetCurrentSysTime() - start_stu) * 5U + idle_stu_x5_rest;
+  slept_ms = (uint32_t)(slept_stu_x5 / APPE_STU_X5_PER_MS);
+  idle_stu_x5_rest = (uint32_t)(slept_stu_x5 % APPE_STU_X5_PER_MS);
 
+  HAL_ResumeTick();
+  if (slept_ms > 0U)
+  {
+    /* The pended SysTick counts the last ms and runs the tick hooks */
+    uwTick += slept_ms - 1U;
+    SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+  }
+}
 /* USER CODE END FD */
 
 /*************************************************************
@@ -228,5 +307,25 @@ void UTIL_SEQ_Idle( void )
 }
 
 /* USER CODE BEGIN FD_WRAP_FUNCTIONS */
+static void IdleTimer_Callback(void *arg)
+{
+  UNUSED(arg);
+}
 
+/**
+  * @brief  Schedule FM_BackgroundProcess(). A new request runs on the next sequencer pass;
+  *         a retry (radio event too close for the flash operation) waits for the next
+  *         SysTick so the sequencer does not spin while the radio is busy.
+  */
+void FM_ProcessRequest(uint8_t immediate)
+{
+  if (immediate)
+  {
+    UTIL_SEQ_SetTask(1U << CFG_TASK_FLASH_MANAGER, CFG_SEQ_PRIO_1);
+  }
+  else
+  {
+    fm_retry_pending = 1;
+  }
+}
 /* USER CODE END FD_WRAP_FUNCTIONS */
@@ -354,15 +354,28 @@ static void move_next_frame(uint16_t *data_index, uint8_t current_frame_length,
 /*!
  *  @brief This API writes the config stream data in memory using burst mode
  *
- *  @param[in] stream_data : Pointer to store data of 32 bytes
- *  @param[in] index : Represents value in multiple of 32 bytes
+ *  @param[in] stream_data : Pointer to the config stream chunk
+ *  @param[in] index : Byte offset of the chunk in the config stream (even)
+ *  @param[in] len : Chunk length in bytes (even)
  *  @param[in] dev : Structure instance of bma4_dev.
  *
  *  @return Result of API execution status
  *  @retval 0 -> Success
  *  @retval < 0 -> Fail
  */
-static int8_t stream_transfer_write(const uint8_t *stream_data, uint16_t index, struct bma4_dev *dev);
+static int8_t stream_transfer_write(const uint8_t *stream_data, uint16_t index, uint16_t len, struct bma4_dev *dev);
+
+/*!
+ *  @brief This API reads the config stream back from the sensor and passes
+ *  it to dev->config_check
+ *
+ *  @param[in] dev : Structure instance of bma4_dev.
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval < 0 -> Fail
+ */
+static int8_t verify_config_stream(struct bma4_dev *dev);
 
 /*!
  *  @brief This API enables or disables the Accel self-test feature in the
@@ -971,6 +984,7 @@ int8_t bma4_write_config_file(struct bma4_dev *dev)
     /* Config loading disable*/
     uint8_t config_load = 0;
     uint16_t index = 0;
+    uint16_t len = 0;
     uint8_t config_stream_status = 0;
 
     /* Disable advanced power save */
@@ -983,10 +997,23 @@ int8_t bma4_write_config_file(struct bma4_dev *dev)
 
         if (rslt == BMA4_OK)
         {
-            /* Write the config stream */
-            for (index = 0; index < dev->config_size; index += dev->read_write_len)
+            /* Write the config stream, read_write_len bytes per burst; the last
+             * burst only carries what is left of the stream
+             */
+            for (index = 0; (index < dev->config_size) && (rslt == BMA4_OK); index += len)
             {
-                rslt = stream_transfer_write((dev->config_file_ptr + index), index, dev);
+                len = dev->config_size - index;
+                if (len > dev->read_write_len)
+                {
+                    len = dev->read_write_len;
+                }
+
+                rslt = stream_transfer_write((dev->config_file_ptr + index), index, len, dev);
+            }
+
+            if ((rslt == BMA4_OK) && (dev->config_check != NULL))
+            {
+                rslt = verify_config_stream(dev);
             }
 
             if (rslt == BMA4_OK)
@@ -3966,7 +3993,7 @@ static void convert_lsb_g(const struct bma4_selftest_delta_limit *accel_data_dif
  *  @brief This API writes the config stream data in memory using burst mode
  *  @note index value should be even number.
  */
-static int8_t stream_transfer_write(const uint8_t *stream_data, uint16_t index, struct bma4_dev *dev)
+static int8_t stream_transfer_write(const uint8_t *stream_data, uint16_t index, uint16_t len, struct bma4_dev *dev)
 {
     int8_t rslt;
     uint8_t asic_msb = (uint8_t)((index / 2) >> 4);
@@ -3983,7 +4010,7 @@ static int8_t stream_transfer_write(const uint8_t *stream_data, uint16_t index,
             rslt = bma4_write_regs(BMA4_RESERVED_REG_5C_ADDR, &asic_msb, 1, dev);
             if (rslt == BMA4_OK)
             {
-                rslt = write_regs(BMA4_FEATURE_CONFIG_ADDR, (uint8_t *)stream_data, dev->read_write_len, dev);
+                rslt = write_regs(BMA4_FEATURE_CONFIG_ADDR, (uint8_t *)stream_data, len, dev);
             }
         }
     }
@@ -3995,6 +4022,48 @@ static int8_t stream_transfer_write(const uint8_t *stream_data, uint16_t index,
     return rslt;
 }
 
+/*!
+ *  @brief This API reads the config stream back from the sensor and passes
+ *  it to dev->config_check
+ */
+static int8_t verify_config_stream(struct bma4_dev *dev)
+{
+    int8_t rslt = BMA4_OK;
+    uint8_t chunk[BMA4_CONFIG_VERIFY_CHUNK];
+    uint16_t index;
+    uint16_t len = 0;
+    uint8_t asic_msb;
+    uint8_t asic_lsb;
+
+    /* Chunk by chunk, so no copy of the stream is needed in RAM */
+    for (index = 0; (index < dev->config_size) && (rslt == BMA4_OK); index += len)
+    {
+        len = dev->config_size - index;
+        if (len > BMA4_CONFIG_VERIFY_CHUNK)
+        {
+            len = BMA4_CONFIG_VERIFY_CHUNK;
+        }
+
+        asic_msb = (uint8_t)((index / 2) >> 4);
+        asic_lsb = ((index / 2) & 0x0F);
+        rslt = bma4_write_regs(BMA4_RESERVED_REG_5B_ADDR, &asic_lsb, 1, dev);
+        if (rslt == BMA4_OK)
+        {
+            rslt = bma4_write_regs(BMA4_RESERVED_REG_5C_ADDR, &asic_msb, 1, dev);
+            if (rslt == BMA4_OK)
+            {
+                rslt = read_regs(BMA4_FEATURE_CONFIG_ADDR, chunk, len, dev);
+                if ((rslt == BMA4_OK) && (dev->config_check(index, chunk, len, dev->intf_ptr) != 0))
+                {
+                    rslt = BMA4_E_CONFIG_VERIFY_FAIL;
+                }
+            }
+        }
+    }
+
+    return rslt;
+}
+
 /*!
  *  @brief This API enables or disables the Accel self-test feature in the
  *  sensor.
@@ -13,8 +13,10 @@
   * 
   * Behavior:
   *   - On high-g detection (>~2g), INT1 goes high
-  *   - PA9 interrupt handler turns on PB1 LED
-  *   - Accelerometer data is read and force magnitude calculated
+  *   - PA9 interrupt only timestamps the event and posts CFG_TASK_BMA456
+  *   - The sequencer task reads the status and turns on PB1 LED
+  *   - BMA456_CAPTURE_POST_MS later the FIFO window around the event is read
+  *     and its impact features calculated
   *   - Force value and axis components sent via UART
   *   - TIM16 is started for 5-second timeout
   *   - After 5 seconds, LED is turned off
@@ -23,9 +25,19 @@
   */
 
 #include "bma456_app.h"
+#include "i2c_bus.h"
+#include "us_delay.h"
+#include "accel_fx.h"
+#include "telemetry.h"
+#include "spsc_ring.h"
+#if BMA456_CONFIG_VERIFY
+#include "crc_calc.h"
+#endif
+#include "app_conf.h"
+#include "stm32_seq.h"
+#include "utilities_conf.h"
 #include <string.h>
 #include <stdio.h>
-#include <math.h>
 
 /* Private variables */
 static struct bma4_dev bma456_dev;
@@ -34,13 +46,61 @@ static UART_HandleTypeDef *bma456_huart = NULL;
 extern TIM_HandleTypeDef htim16;
 static volatile uint8_t led_timer_active = 0;
 
+/* One INT1 edge, queued by the EXTI ISR and drained by the sequencer task */
+typedef struct
+{
+    uint32_t seq;   /* IRQ number since boot */
+    uint32_t tick;  /* HAL_GetTick() in the ISR */
+} bma456_irq_evt_t;
+
+static bma456_irq_evt_t irq_evt_buf[BMA456_IRQ_QUEUE_LEN];
+static spsc_ring_t irq_evt_ring;
+static uint32_t irq_count = 0;  /* ISR only */
+
+/* GPIOA ISR cost instrumentation */
+static bma456_isr_stats_t isr_stats;
+
+#if BMA456_CAPTURE_ENABLE
+/* Raw FIFO image of the last capture (+ sensortime overhead byte if headers get enabled) */
+static uint8_t fifo_buf[BMA456_FIFO_SIZE_BYTES + 4];
+static bma456_impact_t last_impact;
+static uint8_t last_impact_valid = 0;
+
+/* Samples are unpacked from fifo_buf in chunks of this many frames */
+#define BMA456_CAPTURE_CHUNK  32
+
+/* Capture window either side of the interrupt, in samples */
+#define BMA456_CAPTURE_PRE_SAMPLES   ((BMA456_CAPTURE_PRE_MS * BMA456_CAPTURE_ODR_HZ) / 1000u)
+#define BMA456_CAPTURE_POST_SAMPLES  ((BMA456_CAPTURE_POST_MS * BMA456_CAPTURE_ODR_HZ) / 1000u)
+
+/* Interrupt waiting for its post-trigger samples: set and cleared by the task,
+   polled by bma456_app_tick() */
+static volatile uint8_t capture_pending = 0;
+static uint32_t capture_tick;        /* HAL_GetTick() of the interrupt */
+static uint16_t capture_int_status;  /* Its interrupt status */
+#endif
+
 /* UART timeout for transmit */
 #define UART_TIMEOUT_MS  200
 
+/* I2C transaction timeout (was HAL_MAX_DELAY: a stuck bus hung the caller forever) */
+#define BMA456_I2C_TIMEOUT_MS  100
+
+/* Long bursts (config upload, FIFO) get extra time: ~0.1 ms per byte at 100 kHz */
+#define BMA456_I2C_TIMEOUT(len)  (BMA456_I2C_TIMEOUT_MS + (uint32_t)(len) / 8u)
+
 /* Private function prototypes */
+static void bma456_app_task(void);
+#if BMA456_CAPTURE_ENABLE
+static int8_t bma456_capture_impact(bma456_impact_t *impact, uint32_t trigger_tick);
+static void bma456_capture_send(void);
+#endif
 static BMA4_INTF_RET_TYPE bma456_i2c_read(uint8_t reg_addr, uint8_t *read_data, uint32_t len, void *intf_ptr);
 static BMA4_INTF_RET_TYPE bma456_i2c_write(uint8_t reg_addr, const uint8_t *write_data, uint32_t len, void *intf_ptr);
 static void bma456_delay_us(uint32_t period, void *intf_ptr);
+#if BMA456_CONFIG_VERIFY
+static int8_t bma456_config_check(uint16_t index, const uint8_t *data, uint16_t len, void *intf_ptr);
+#endif
 
 /**
   * @brief  BMA456 I2C read callback
@@ -52,12 +112,13 @@ static void bma456_delay_us(uint32_t period, void *intf_ptr);
   */
 static BMA4_INTF_RET_TYPE bma456_i2c_read(uint8_t reg_addr, uint8_t *read_data, uint32_t len, void *intf_ptr)
 {
-    I2C_HandleTypeDef *hi2c = (I2C_HandleTypeDef *)intf_ptr;
     HAL_StatusTypeDef status;
     
-    /* Read from I2C device */
-    status = HAL_I2C_Mem_Read(hi2c, (BMA456_I2C_ADDR << 1), reg_addr, 
-                               I2C_MEMADD_SIZE_8BIT, read_data, len, HAL_MAX_DELAY);
+    (void)intf_ptr;
+    
+    /* Read from I2C device through the shared transaction queue */
+    status = i2c_bus_transfer((BMA456_I2C_ADDR << 1), reg_addr, I2C_BUS_READ,
+                              read_data, (uint16_t)len, BMA456_I2C_TIMEOUT(len));
     
     return (status == HAL_OK) ? 0 : -1;
 }
@@ -72,12 +133,13 @@ static BMA4_INTF_RET_TYPE bma456_i2c_read(uint8_t reg_addr, uint8_t *read_data,
   */
 static BMA4_INTF_RET_TYPE bma456_i2c_write(uint8_t reg_addr, const uint8_t *write_data, uint32_t len, void *intf_ptr)
 {
-    I2C_HandleTypeDef *hi2c = (I2C_HandleTypeDef *)intf_ptr;
     HAL_StatusTypeDef status;
     
-    /* Write to I2C device */
-    status = HAL_I2C_Mem_Write(hi2c, (BMA456_I2C_ADDR << 1), reg_addr,
-                                I2C_MEMADD_SIZE_8BIT, (uint8_t *)write_data, len, HAL_MAX_DELAY);
+    (void)intf_ptr;
+    
+    /* Write to I2C device through the shared transaction queue */
+    status = i2c_bus_transfer((BMA456_I2C_ADDR << 1), reg_addr, I2C_BUS_WRITE,
+                              (uint8_t *)write_data, (uint16_t)len, BMA456_I2C_TIMEOUT(len));
     
     return (status == HAL_OK) ? 0 : -1;
 }
@@ -92,16 +154,37 @@ static void bma456_delay_us(uint32_t period, void *intf_ptr)
 {
     (void)intf_ptr;
     
-    /* Convert microseconds to milliseconds for HAL_Delay */
-    uint32_t delay_ms = period / 1000;
-    if (delay_ms == 0 && period > 0) {
-        delay_ms = 1;  /* Minimum 1ms delay for HAL_Delay */
+    /* Not rounded to ticks: the config upload waits 450us after every write */
+    us_delay(period);
+}
+
+#if BMA456_CONFIG_VERIFY
+/**
+  * @brief  BMA456 config stream check callback
+  * @param  index: Byte offset of the chunk read back from the sensor
+  * @param  data: Chunk data
+  * @param  len: Chunk length in bytes
+  * @param  intf_ptr: Interface pointer (not used)
+  * @retval 0 while the stream matches, -1 when its CRC-32 differs from the blob's
+  */
+static int8_t bma456_config_check(uint16_t index, const uint8_t *data, uint16_t len, void *intf_ptr)
+{
+    static uint32_t crc;
+    
+    (void)intf_ptr;
+    
+    /* Chunks come in order; only the running CRC is kept */
+    if (index == 0) {
+        crc = CRC32_INIT;
     }
+    crc = crc32_update(crc, data, len);
     
-    if (delay_ms > 0) {
-        HAL_Delay(delay_ms);
+    if ((uint32_t)index + len < bma456_dev.config_size) {
+        return 0;
     }
+    return (crc32_final(crc) == crc32_calc(bma456_dev.config_file_ptr, bma456_dev.config_size)) ? 0 : -1;
 }
+#endif
 
 /**
   * @brief  Initialize BMA456 accelerometer
@@ -123,6 +206,10 @@ HAL_StatusTypeDef bma456_app_init(I2C_HandleTypeDef *hi2c, UART_HandleTypeDef *h
     bma456_hi2c = hi2c;
     bma456_huart = huart;
     
+    /* Interrupt work runs here, not in the EXTI ISR */
+    (void)spsc_ring_init(&irq_evt_ring, irq_evt_buf, sizeof(bma456_irq_evt_t), BMA456_IRQ_QUEUE_LEN);
+    UTIL_SEQ_RegTask(1U << CFG_TASK_BMA456, UTIL_SEQ_RFU, bma456_app_task);
+    
     /* Debug: Initialization start */
     len = snprintf(debug_msg, sizeof(debug_msg), "[BMA456] Init start...\r\n");
     HAL_UART_Transmit(bma456_huart, (uint8_t*)debug_msg, (uint16_t)len, UART_TIMEOUT_MS);
@@ -134,7 +221,11 @@ HAL_StatusTypeDef bma456_app_init(I2C_HandleTypeDef *hi2c, UART_HandleTypeDef *h
     bma456_dev.delay_us = bma456_delay_us;
     bma456_dev.intf_ptr = hi2c;
     bma456_dev.variant = BMA42X_VARIANT;
-    bma456_dev.read_write_len = 32;  /* Typical maximum read/write length */
+#if BMA456_CONFIG_VERIFY
+    bma456_dev.config_check = bma456_config_check;
+#else
+    bma456_dev.config_check = NULL;
+#endif
     
     /* Initialize BMA456MM sensor */
     rslt = bma456mm_init(&bma456_dev);
@@ -147,6 +238,9 @@ HAL_StatusTypeDef bma456_app_init(I2C_HandleTypeDef *hi2c, UART_HandleTypeDef *h
     len = snprintf(debug_msg, sizeof(debug_msg), "[BMA456] Sensor init OK, ChipID=0x%02X\r\n", bma456_dev.chip_id);
     HAL_UART_Transmit(bma456_huart, (uint8_t*)debug_msg, (uint16_t)len, UART_TIMEOUT_MS);
     
+    /* Config upload burst size; the init above filled in config_size */
+    bma456_dev.read_write_len = BMA456_CONFIG_BURST_LEN ? BMA456_CONFIG_BURST_LEN : bma456_dev.config_size;
+    
     /* Write config file to enable sensor features - CRITICAL STEP! */
     rslt = bma456mm_write_config_file(&bma456_dev);
     if (rslt != BMA4_OK) {
@@ -160,10 +254,14 @@ HAL_StatusTypeDef bma456_app_init(I2C_HandleTypeDef *hi2c, UART_HandleTypeDef *h
     /* Wait for sensor to be ready */
     HAL_Delay(10);
     
-    /* Configure accelerometer: 2g range, 100Hz ODR */
+    /* Configure accelerometer: 16g range (BMA456_ACCEL_RANGE), 100Hz ODR (1.6kHz when FIFO capture is enabled) */
     struct bma4_accel_config accel_config;
+#if BMA456_CAPTURE_ENABLE
+    accel_config.odr = BMA456_CAPTURE_ODR;
+#else
     accel_config.odr = BMA4_OUTPUT_DATA_RATE_100HZ;
-    accel_config.range = BMA4_ACCEL_RANGE_2G;
+#endif
+    accel_config.range = BMA456_ACCEL_RANGE;
     accel_config.bandwidth = BMA4_ACCEL_NORMAL_AVG4;
     accel_config.perf_mode = BMA4_CONTINUOUS_MODE;
     
@@ -193,9 +291,24 @@ HAL_StatusTypeDef bma456_app_init(I2C_HandleTypeDef *hi2c, UART_HandleTypeDef *h
     /* Wait for power mode to stabilize */
     HAL_Delay(5);
     
+#if BMA456_CAPTURE_ENABLE
+    /* FIFO: accel only, header-less, stream mode (oldest frames overwritten) */
+    rslt = bma4_set_fifo_config(BMA4_FIFO_ALL, BMA4_DISABLE, &bma456_dev);
+    if (rslt == BMA4_OK) {
+        rslt = bma4_set_fifo_config(BMA4_FIFO_ACCEL, BMA4_ENABLE, &bma456_dev);
+    }
+    if (rslt != BMA4_OK) {
+        len = snprintf(debug_msg, sizeof(debug_msg), "[BMA456] FIFO config failed! rslt=%d\r\n", rslt);
+        HAL_UART_Transmit(bma456_huart, (uint8_t*)debug_msg, (uint16_t)len, UART_TIMEOUT_MS);
+        return HAL_ERROR;
+    }
+    len = snprintf(debug_msg, sizeof(debug_msg), "[BMA456] FIFO capture enabled @%dHz\r\n", BMA456_CAPTURE_ODR_HZ);
+    HAL_UART_Transmit(bma456_huart, (uint8_t*)debug_msg, (uint16_t)len, UART_TIMEOUT_MS);
+#endif
+    
     /* Configure high-g detection
      * Threshold: ~2g (in 5.11g format)
-     * Duration: 10 samples at 100Hz = 100ms
+     * Duration: 10 feature engine samples at 200Hz = 50ms, independent of the ODR
      * Hysteresis: ~0.5g
      * Enable all axes (X, Y, Z)
      */
@@ -338,74 +451,305 @@ HAL_StatusTypeDef bma456_app_init(I2C_HandleTypeDef *hi2c, UART_HandleTypeDef *h
 }
 
 /**
-  * @brief  Handle BMA456 interrupt (called from EXTI callback)
-  *         Turns on LED, reads accelerometer data, and sends force via UART
+  * @brief  BMA456 INT1 top half (called from EXTI callback)
+  *         Only queues when the interrupt happened and posts the task;
+  *         I2C and UART work is done in bma456_app_handle_interrupt()
+  * @note   Lock-free: the ISR is the only producer of irq_evt_ring. A full
+  *         queue drops the event (counted) but the task is still posted.
+  * @retval None
+  */
+void bma456_app_irq_notify(void)
+{
+    bma456_irq_evt_t evt;
+    
+    evt.seq = ++irq_count;
+    evt.tick = HAL_GetTick();
+    (void)spsc_ring_push(&irq_evt_ring, &evt);
+    UTIL_SEQ_SetTask(1U << CFG_TASK_BMA456, CFG_SEQ_PRIO_0);
+}
+
+/**
+  * @brief  Sequencer task wrapper for the interrupt bottom half
+  * @retval None
+  */
+static void bma456_app_task(void)
+{
+    bma456_app_handle_interrupt();
+}
+
+/**
+  * @brief  Accumulate one GPIOA ISR duration
+  * @param  systick_start: SysTick->VAL on ISR entry
+  * @param  systick_end: SysTick->VAL on ISR exit
+  * @note   SysTick counts down and reloads every 1 ms; the ISR is assumed
+  *         to be shorter than one reload period (at most one wrap).
+  * @retval None
+  */
+void bma456_app_isr_record(uint32_t systick_start, uint32_t systick_end)
+{
+    uint32_t reload = (SysTick->LOAD & SysTick_LOAD_RELOAD_Msk) + 1U;
+    uint32_t cycles = (systick_start >= systick_end) ? (systick_start - systick_end)
+                                                     : (systick_start + reload - systick_end);
+    
+    isr_stats.count++;
+    isr_stats.total_cycles += cycles;
+    if (cycles > isr_stats.max_cycles) {
+        isr_stats.max_cycles = cycles;
+    }
+}
+
+/**
+  * @brief  Snapshot of the GPIOA ISR cost counters
+  * @param  out: Destination
+  * @retval None
+  */
+void bma456_app_get_isr_stats(bma456_isr_stats_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    
+    UTILS_ENTER_CRITICAL_SECTION();
+    *out = isr_stats;
+    out->queue_high_water = irq_evt_ring.high_water;
+    out->queue_drops = irq_evt_ring.drops;
+    UTILS_EXIT_CRITICAL_SECTION();
+}
+
+#if BMA456_CAPTURE_ENABLE
+/**
+  * @brief  Burst-read the FIFO and compute the impact features of the capture window
+  * @param  impact: Output features
+  * @param  trigger_tick: HAL_GetTick() of the interrupt
+  * @retval BMA4_OK on success, Bosch API error otherwise
+  */
+static int8_t bma456_capture_impact(bma456_impact_t *impact, uint32_t trigger_tick)
+{
+    struct bma4_fifo_frame fifo;
+    struct bma4_accel chunk[BMA456_CAPTURE_CHUNK];
+    accel_fx_window_t win;
+    uint32_t read_tick, frames, lag, trigger, first, last, idx, lo, hi;
+    uint16_t n;
+    int8_t rslt;
+    
+    memset(&fifo, 0, sizeof(fifo));
+    memset(impact, 0, sizeof(*impact));
+    fifo.data = fifo_buf;
+    accel_fx_window_init(&win, BMA456_LSB_PER_G,
+                         (uint16_t)((BMA456_CAPTURE_THRESHOLD_MG * (uint32_t)BMA456_LSB_PER_G) / 1000u));
+    
+    /* Whole FIFO in one I2C transaction; its length is latched first, so the
+       last frame read is the one sampled now */
+    read_tick = HAL_GetTick();
+    rslt = bma4_read_fifo_data(&fifo, &bma456_dev);
+    if (rslt != BMA4_OK) {
+        return rslt;
+    }
+    
+    /* Frame of the interrupt, counted back from the newest at the ODR */
+    frames = fifo.length / BMA4_FIFO_A_LENGTH;
+    lag = ((read_tick - trigger_tick) * BMA456_CAPTURE_ODR_HZ) / 1000u;
+    trigger = (lag < frames) ? (frames - lag) : 0u;
+    first = (trigger > BMA456_CAPTURE_PRE_SAMPLES) ? (trigger - BMA456_CAPTURE_PRE_SAMPLES) : 0u;
+    last = MIN(frames, trigger + BMA456_CAPTURE_POST_SAMPLES);
+    
+    /* Unpack in chunks; extract_accel remembers where it stopped. Only the
+       frames in [first, last) go into the window */
+    idx = 0u;
+    do {
+        n = BMA456_CAPTURE_CHUNK;
+        rslt = bma4_extract_accel(chunk, &n, &fifo, &bma456_dev);
+        if (rslt != BMA4_OK) {
+            return rslt;
+        }
+        lo = (first > idx) ? MIN(first - idx, n) : 0u;
+        hi = (last > idx) ? MIN(last - idx, n) : 0u;
+        if (hi > lo) {
+            accel_fx_window_add(&win, &chunk[lo], (uint16_t)(hi - lo));
+        }
+        idx += n;
+    } while ((n == BMA456_CAPTURE_CHUNK) && (idx < last));
+    
+    if (win.n == 0u) {
+        return BMA4_OK;
+    }
+    impact->n_samples = win.n;
+    impact->pre_samples = (uint16_t)(MIN(trigger, last) - MIN(first, last));
+    impact->peak_mg = (uint16_t)accel_fx_counts_to_mg(win.max_mag, BMA456_LSB_PER_G);
+    impact->min_mg = (uint16_t)accel_fx_counts_to_mg(win.min_mag, BMA456_LSB_PER_G);
+    impact->rms_mg = (uint16_t)accel_fx_counts_to_mg(accel_fx_window_rms(&win), BMA456_LSB_PER_G);
+    impact->duration_us = (accel_fx_window_span(&win) * 1000000uL) / BMA456_CAPTURE_ODR_HZ;
+    impact->energy = accel_fx_window_energy(&win, BMA456_CAPTURE_ODR_HZ);
+    
+    return BMA4_OK;
+}
+
+/**
+  * @brief  Capture the window of the pending interrupt and send its impact record
+  * @retval None
+  */
+static void bma456_capture_send(void)
+{
+    tlm_impact_t rec;
+    
+    memset(&rec, 0, sizeof(rec));
+    rec.int_status = capture_int_status;
+    if (bma456_capture_impact(&last_impact, capture_tick) == BMA4_OK) {
+        last_impact_valid = 1;
+        
+        rec.n_samples = last_impact.n_samples;
+        rec.peak_mg = last_impact.peak_mg;
+        rec.min_mg = last_impact.min_mg;
+        rec.rms_mg = last_impact.rms_mg;
+        rec.duration_us = last_impact.duration_us;
+        rec.energy = last_impact.energy;
+    }
+    capture_pending = 0;
+    
+    /* Impacts go out right away instead of waiting for the batch window */
+    (void)telemetry_put(TLM_REC_IMPACT, &rec, (uint8_t)sizeof(rec));
+    telemetry_flush();
+}
+#endif
+
+/**
+  * @brief  Posts the task once a pending capture has its post-trigger samples
+  *         Called from SysTick
+  * @retval None
+  */
+void bma456_app_tick(void)
+{
+#if BMA456_CAPTURE_ENABLE
+    if (capture_pending && (HAL_GetTick() - capture_tick) >= BMA456_CAPTURE_POST_MS) {
+        UTIL_SEQ_SetTask(1U << CFG_TASK_BMA456, CFG_SEQ_PRIO_0);
+    }
+#endif
+}
+
+/**
+  * @brief  Time until bma456_app_tick() has work
+  * @param  now_ms: HAL_GetTick()
+  * @retval ms until a pending capture is due (UINT32_MAX: none pending)
+  */
+uint32_t bma456_app_idle_ms(uint32_t now_ms)
+{
+#if BMA456_CAPTURE_ENABLE
+    uint32_t age;
+    
+    if (!capture_pending) {
+        return UINT32_MAX;
+    }
+    age = now_ms - capture_tick;
+    return (age >= BMA456_CAPTURE_POST_MS) ? 0U : (BMA456_CAPTURE_POST_MS - age);
+#else
+    (void)now_ms;
+    return UINT32_MAX;
+#endif
+}
+
+/**
+  * @brief  Features of the most recent FIFO capture
+  * @param  out: Destination
+  * @retval HAL_OK if a capture exists, HAL_ERROR otherwise
+  */
+HAL_StatusTypeDef bma456_app_get_last_impact(bma456_impact_t *out)
+{
+#if BMA456_CAPTURE_ENABLE
+    if (out == NULL || !last_impact_valid) {
+        return HAL_ERROR;
+    }
+    *out = last_impact;
+    return HAL_OK;
+#else
+    (void)out;
+    return HAL_ERROR;
+#endif
+}
+
+/**
+  * @brief  Handle BMA456 interrupt (runs as CFG_TASK_BMA456, posted by the EXTI ISR)
+  *         Turns on LED, reads accelerometer data, and sends the impact record via telemetry
   * @retval None
   */
 void bma456_app_handle_interrupt(void)
 {
-    uint16_t int_status;
+    uint16_t int_status = 0;
     int8_t rslt;
+#if !BMA456_CAPTURE_ENABLE
     struct bma4_accel accel_data;
-    char debug_msg[80];
-    int len;
+    tlm_impact_t rec;
+#endif
+    bma456_isr_stats_t stats;
+    bma456_irq_evt_t evt;
+    uint32_t trigger_tick = 0;
+    uint32_t n_evt = 0;
+    
+    /* Debug: each queued interrupt and how long it waited for the task, then ISR cost so far */
+    while (spsc_ring_pop(&irq_evt_ring, &evt)) {
+        if (n_evt++ == 0U) {
+            trigger_tick = evt.tick;
+        }
+        (void)telemetry_diag(TLM_DIAG_BMA_IRQ, evt.seq, HAL_GetTick() - evt.tick);
+    }
     
-    /* Debug: Interrupt triggered */
-    len = snprintf(debug_msg, sizeof(debug_msg), "[BMA456] IRQ triggered!\r\n");
-    HAL_UART_Transmit(bma456_huart, (uint8_t*)debug_msg, (uint16_t)len, UART_TIMEOUT_MS);
+#if BMA456_CAPTURE_ENABLE
+    /* A pending capture has its post-trigger samples: read its window */
+    if (capture_pending && (HAL_GetTick() - capture_tick) >= BMA456_CAPTURE_POST_MS) {
+        bma456_capture_send();
+    }
+    if (n_evt == 0U) {
+        /* Posted by bma456_app_tick(), no new interrupt */
+        return;
+    }
+#else
+    (void)trigger_tick;
+#endif
+    bma456_app_get_isr_stats(&stats);
+    (void)telemetry_diag(TLM_DIAG_BMA_ISR, stats.max_cycles,
+                         stats.count ? (stats.total_cycles / stats.count) : 0U);
+    (void)telemetry_diag(TLM_DIAG_BMA_QUEUE, stats.queue_high_water, stats.queue_drops);
     
     /* Read and clear interrupt status */
     rslt = bma456mm_read_int_status(&int_status, &bma456_dev);
-    
-    len = snprintf(debug_msg, sizeof(debug_msg), "[BMA456] INT status=0x%04X, rslt=%d\r\n", int_status, rslt);
-    HAL_UART_Transmit(bma456_huart, (uint8_t*)debug_msg, (uint16_t)len, UART_TIMEOUT_MS);
+    (void)telemetry_diag(TLM_DIAG_BMA_INT, int_status, (uint32_t)(int32_t)rslt);
     
     /* Check if high-g OR any-motion interrupt occurred */
     if ((rslt == BMA4_OK) && (int_status & (BMA456MM_HIGH_G_INT | BMA456MM_ANY_MOT_INT))) {
-        /* Report which interrupt triggered */
-        if (int_status & BMA456MM_HIGH_G_INT) {
-            len = snprintf(debug_msg, sizeof(debug_msg), "[BMA456] High-G detected!\r\n");
-            HAL_UART_Transmit(bma456_huart, (uint8_t*)debug_msg, (uint16_t)len, UART_TIMEOUT_MS);
-        }
-        if (int_status & BMA456MM_ANY_MOT_INT) {
-            len = snprintf(debug_msg, sizeof(debug_msg), "[BMA456] Any-motion detected!\r\n");
-            HAL_UART_Transmit(bma456_huart, (uint8_t*)debug_msg, (uint16_t)len, UART_TIMEOUT_MS);
-        }
         /* Turn on LED (active LOW - RESET=ON) */
         HAL_GPIO_WritePin(LED_YELLO_GPIO_Port, LED_YELLO_Pin, GPIO_PIN_RESET);
         
+#if BMA456_CAPTURE_ENABLE
+        /* Waveform around the event from the FIFO, read once its post-trigger
+           samples are in; a later interrupt inside that window joins it */
+        if (!capture_pending) {
+            capture_tick = trigger_tick;
+            capture_int_status = int_status;
+            capture_pending = 1;
+        }
+#else
+        memset(&rec, 0, sizeof(rec));
+        rec.int_status = int_status;
+        
         /* Read current accelerometer data */
         rslt = bma4_read_accel_xyz(&accel_data, &bma456_dev);
         
-        if (rslt == BMA4_OK && bma456_huart != NULL) {
-            /* Convert raw accelerometer data to g-force
-             * For 2g range: LSB = 16384 counts/g
-             * Formula: g = (raw_value / 16384.0)
-             * 
-             * Note: Using floating-point math in ISR is acceptable here because:
-             * - Event rate is low (only on impacts > 2g)
-             * - STM32WB05 has hardware FPU
-             * - Non-critical path (after LED control)
+        if (rslt == BMA4_OK) {
+            /* Single sample: magnitude in mg via isqrt of the raw counts
+             * BMA456_LSB_PER_G counts/g at BMA456_ACCEL_RANGE
              */
-            float accel_x_g = accel_data.x / 16384.0f;
-            float accel_y_g = accel_data.y / 16384.0f;
-            float accel_z_g = accel_data.z / 16384.0f;
+            uint16_t magnitude_mg = (uint16_t)accel_fx_counts_to_mg(accel_fx_mag(&accel_data), BMA456_LSB_PER_G);
             
-            /* Calculate magnitude of acceleration vector */
-            float magnitude_g = sqrtf(accel_x_g * accel_x_g + 
-                                      accel_y_g * accel_y_g + 
-                                      accel_z_g * accel_z_g);
-            
-            /* Send force data via UART */
-            char uart_msg[80];
-            int len = snprintf(uart_msg, sizeof(uart_msg),
-                             "Impact detected! Force: %.2fg (X:%.2fg Y:%.2fg Z:%.2fg)\r\n",
-                             magnitude_g, accel_x_g, accel_y_g, accel_z_g);
-            
-            /* Transmit via UART - ignore errors to avoid blocking in ISR */
-            (void)HAL_UART_Transmit(bma456_huart, (uint8_t*)uart_msg, (uint16_t)len, UART_TIMEOUT_MS);
+            rec.n_samples = 1;
+            rec.peak_mg = magnitude_mg;
+            rec.min_mg = magnitude_mg;
+            rec.rms_mg = magnitude_mg;
         }
         
+        /* Impacts go out right away instead of waiting for the batch window */
+        (void)telemetry_put(TLM_REC_IMPACT, &rec, (uint8_t)sizeof(rec));
+        telemetry_flush();
+#endif
+        
         /* Stop timer if already running (retriggerable behavior) */
         if (led_timer_active) {
             HAL_TIM_Base_Stop_IT(&htim16);
@@ -0,0 +1,325 @@
+#include "bme690_array.h"
+
+#include <string.h>
+
+#include "bme690_port.h"
+
+typedef struct
+{
+    struct bme69x_dev dev;
+    struct bme69x_conf conf;        // last conf written to the sensor (meas_dur input)
+    const bme690_sensor_cfg_t *cfg;
+    uint16_t heatr_dur_ms;          // heater time of the measurement in flight
+    uint8_t  busy;
+    uint32_t trig_ms;
+    uint32_t ready_ms;
+    uint32_t next_trig_ms;          // periodic sensors only
+
+    // Parallel mode
+    const bme690_heatr_profile_t *profile;
+    uint32_t poll_ms;               // harvest interval
+    uint8_t  have_meas_idx;
+    uint8_t  last_meas_idx;         // sub-measurement index of the newest delivered field
+
+    bme690_array_stats_t stats;
+} bme690_slot_t;
+
+static bme690_slot_t s_slot[BME690_ARRAY_MAX];
+static uint8_t s_count = 0;
+static bme690_array_sample_cb_t s_cb = NULL;
+
+// Wrap-safe "now is at or past deadline" for HAL_GetTick() values
+static uint8_t reached(uint32_t now_ms, uint32_t deadline_ms)
+{
+    return ((int32_t)(now_ms - deadline_ms) >= 0) ? 1u : 0u;
+}
+
+static void keep_earliest(uint8_t *any, uint32_t *next_ms, uint32_t now_ms, uint32_t t_ms)
+{
+    if (!*any || (int32_t)(t_ms - now_ms) < (int32_t)(*next_ms - now_ms))
+    {
+        *next_ms = t_ms;
+    }
+    *any = 1;
+}
+
+static int8_t start(bme690_slot_t *s, uint32_t now_ms)
+{
+    uint32_t wait_us = 0;
+    int8_t rslt = bme690_port_trigger_forced(&s->dev, &s->conf, s->heatr_dur_ms, &wait_us);
+    if (rslt != BME69X_OK)
+    {
+        s->stats.errors++;
+        return rslt;
+    }
+
+    s->trig_ms = now_ms;
+    s->ready_ms = now_ms + (wait_us + 999u) / 1000u;
+    s->busy = 1;
+    return BME69X_OK;
+}
+
+static int8_t upload_profile(bme690_slot_t *s, const bme690_heatr_profile_t *p)
+{
+    if (!p->temp_c || !p->dur_mult) return BME69X_E_NULL_PTR;
+    if (p->len == 0u || p->len > 10u || p->shared_dur_ms == 0u) return BME69X_E_INVALID_LENGTH;
+
+    // Each heater unit is one T/P/H conversion plus the shared heater time
+    uint32_t tph_ms = bme69x_get_meas_dur(BME69X_PARALLEL_MODE, &s->conf, &s->dev) / 1000u;
+    if (tph_ms >= p->shared_dur_ms) return BME69X_E_INVALID_LENGTH;
+
+    struct bme69x_heatr_conf h = {0};
+    h.enable = BME69X_ENABLE;
+    h.heatr_temp_prof = (uint16_t*)p->temp_c;   // read only by the driver
+    h.heatr_dur_prof = (uint16_t*)p->dur_mult;
+    h.profile_len = p->len;
+    h.shared_heatr_dur = (uint16_t)(p->shared_dur_ms - tph_ms);
+
+    int8_t rslt = bme69x_set_heatr_conf(BME69X_PARALLEL_MODE, &h, &s->dev);
+    if (rslt == BME69X_OK) rslt = bme69x_set_op_mode(BME69X_PARALLEL_MODE, &s->dev);
+    return rslt;
+}
+
+// Read the (up to three) buffered fields in one go and deliver the ones not seen yet.
+// The driver returns new fields first, in measurement order.
+static void harvest(uint8_t idx, bme690_slot_t *s, uint32_t now_ms)
+{
+    struct bme69x_data d[3];
+    uint8_t n = 0;
+
+    s->stats.harvests++;
+    int8_t rslt = bme69x_get_data(BME69X_PARALLEL_MODE, d, &n, &s->dev);
+    if (rslt == BME69X_W_NO_NEW_DATA) return;
+    if (rslt != BME69X_OK)
+    {
+        s->stats.errors++;
+        return;
+    }
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        // A field keeps its new-data flag until overwritten, so a fast poll sees it again
+        if (s->have_meas_idx && (int8_t)(d[i].meas_index - s->last_meas_idx) <= 0)
+        {
+            s->stats.stale++;
+            continue;
+        }
+
+        s->have_meas_idx = 1;
+        s->last_meas_idx = d[i].meas_index;
+        s->stats.samples++;
+        s->stats.last_ms = now_ms;
+        if (s_cb) s_cb(idx, &d[i], now_ms);
+    }
+}
+
+void bme690_array_init(bme690_array_sample_cb_t cb)
+{
+    memset(s_slot, 0, sizeof(s_slot));
+    s_count = 0;
+    s_cb = cb;
+}
+
+int8_t bme690_array_add(I2C_HandleTypeDef *hi2c, const bme690_sensor_cfg_t *cfg, uint8_t *idx)
+{
+    if (!hi2c || !cfg || !idx) return BME69X_E_NULL_PTR;
+    if (s_count >= BME690_ARRAY_MAX) return BME69X_E_INVALID_LENGTH;
+
+    bme690_slot_t *s = &s_slot[s_count];
+    memset(s, 0, sizeof(*s));
+    s->cfg = cfg;
+
+    int8_t rslt = bme690_port_init_i2c_mux(&s->dev, hi2c, cfg->i2c_addr, cfg->mux_addr, cfg->mux_channel);
+    if (rslt != BME69X_OK) return rslt;
+
+    rslt = bme69x_init(&s->dev);
+    if (rslt != BME69X_OK) return rslt;
+
+    if (cfg->profile)
+    {
+        s->conf.os_temp = cfg->os_temp;
+        s->conf.os_pres = cfg->os_pres;
+        s->conf.os_hum  = cfg->os_hum;
+        s->conf.filter  = cfg->filter;
+        s->conf.odr     = BME69X_ODR_NONE;
+        rslt = bme69x_set_conf(&s->conf, &s->dev);
+        if (rslt != BME69X_OK) return rslt;
+
+        *idx = s_count++;
+        return bme690_array_set_profile(*idx, cfg->profile, HAL_GetTick());
+    }
+
+    if (cfg->period_ms)
+    {
+        // Settings stay in the sensor; each period only re-enters forced mode
+        s->conf.os_temp = cfg->os_temp;
+        s->conf.os_pres = cfg->os_pres;
+        s->conf.os_hum  = cfg->os_hum;
+        s->conf.filter  = cfg->filter;
+        s->conf.odr     = BME69X_ODR_NONE;
+        rslt = bme69x_set_conf(&s->conf, &s->dev);
+        if (rslt != BME69X_OK) return rslt;
+
+        struct bme69x_heatr_conf h = {0};
+        h.enable = cfg->heatr_dur_ms ? BME69X_ENABLE : BME69X_DISABLE;
+        h.heatr_temp = cfg->heatr_temp;
+        h.heatr_dur = cfg->heatr_dur_ms;
+        rslt = bme69x_set_heatr_conf(BME69X_FORCED_MODE, &h, &s->dev);
+        if (rslt != BME69X_OK) return rslt;
+
+        s->heatr_dur_ms = cfg->heatr_dur_ms;
+        s->next_trig_ms = HAL_GetTick();
+    }
+
+    *idx = s_count++;
+    return BME69X_OK;
+}
+
+int8_t bme690_array_trigger(uint8_t idx,
+                            struct bme69x_conf *conf,
+                            const struct bme69x_heatr_conf *heatr,
+                            uint32_t now_ms)
+{
+    if (!conf || !heatr) return BME69X_E_NULL_PTR;
+    if (idx >= s_count) return BME69X_E_DEV_NOT_FOUND;
+
+    bme690_slot_t *s = &s_slot[idx];
+    if (s->profile) return BME69X_W_DEFINE_OP_MODE;
+    if (s->busy) return BME69X_W_NO_NEW_DATA;
+
+    int8_t rslt = bme69x_set_conf(conf, &s->dev);
+    if (rslt == BME69X_OK) rslt = bme69x_set_heatr_conf(BME69X_FORCED_MODE, heatr, &s->dev);
+    if (rslt != BME69X_OK)
+    {
+        s->stats.errors++;
+        return rslt;
+    }
+
+    s->conf = *conf;
+    s->heatr_dur_ms = heatr->enable ? heatr->heatr_dur : 0u;
+    return start(s, now_ms);
+}
+
+int8_t bme690_array_set_profile(uint8_t idx, const bme690_heatr_profile_t *profile, uint32_t now_ms)
+{
+    if (idx >= s_count) return BME69X_E_DEV_NOT_FOUND;
+
+    bme690_slot_t *s = &s_slot[idx];
+    if (s->busy) return BME69X_W_NO_NEW_DATA;
+
+    s->profile = NULL;
+    s->have_meas_idx = 0;
+
+    if (!profile)
+    {
+        return bme69x_set_op_mode(BME69X_SLEEP_MODE, &s->dev);
+    }
+
+    int8_t rslt = upload_profile(s, profile);
+    if (rslt != BME69X_OK)
+    {
+        s->stats.errors++;
+        return rslt;
+    }
+
+    // One field per heater unit and three field buffers: draining every two units never loses one
+    uint32_t unit_ms = profile->shared_dur_ms;
+    s->poll_ms = s->cfg->period_ms ? s->cfg->period_ms : 2u * unit_ms;
+    s->profile = profile;
+    s->next_trig_ms = now_ms + unit_ms;
+    return BME69X_OK;
+}
+
+uint8_t bme690_array_process(uint32_t now_ms, uint32_t *next_ms)
+{
+    uint8_t any = 0;
+    uint32_t next = now_ms;
+
+    // Parallel-mode sensors run on their own; just drain their field buffers
+    for (uint8_t i = 0; i < s_count; i++)
+    {
+        bme690_slot_t *s = &s_slot[i];
+        if (!s->profile || !reached(now_ms, s->next_trig_ms)) continue;
+
+        harvest(i, s, now_ms);
+        s->next_trig_ms += s->poll_ms;
+        if (reached(now_ms, s->next_trig_ms))
+        {
+            s->next_trig_ms = now_ms + s->poll_ms;
+        }
+    }
+
+    // Collect first: a sensor that finishes now can be re-triggered in the same pass
+    for (uint8_t i = 0; i < s_count; i++)
+    {
+        bme690_slot_t *s = &s_slot[i];
+        if (!s->busy || !reached(now_ms, s->ready_ms)) continue;
+
+        struct bme69x_data d;
+        s->busy = 0;
+        if (bme690_port_collect_forced(&s->dev, &d) == BME69X_OK)
+        {
+            s->stats.samples++;
+            s->stats.last_ms = s->trig_ms;
+            if (s_cb) s_cb(i, &d, s->trig_ms);
+        }
+        else
+        {
+            s->stats.errors++;
+        }
+    }
+
+    // Trigger everything that is due back to back; the heaters then run in parallel
+    for (uint8_t i = 0; i < s_count; i++)
+    {
+        bme690_slot_t *s = &s_slot[i];
+        if (s->busy || s->profile || !s->cfg->period_ms || !reached(now_ms, s->next_trig_ms)) continue;
+
+        (void)start(s, now_ms);
+
+        // Keep the phase; skip missed periods instead of bursting to catch up
+        s->next_trig_ms += s->cfg->period_ms;
+        if (reached(now_ms, s->next_trig_ms))
+        {
+            s->next_trig_ms = now_ms + s->cfg->period_ms;
+        }
+    }
+
+    for (uint8_t i = 0; i < s_count; i++)
+    {
+        const bme690_slot_t *s = &s_slot[i];
+        if (s->busy)
+        {
+            keep_earliest(&any, &next, now_ms, s->ready_ms);
+        }
+        else if (s->profile || s->cfg->period_ms)
+        {
+            keep_earliest(&any, &next, now_ms, s->next_trig_ms);
+        }
+    }
+
+    if (next_ms) *next_ms = next;
+    return any;
+}
+
+uint8_t bme690_array_busy(uint8_t idx)
+{
+    return (idx < s_count) ? s_slot[idx].busy : 0u;
+}
+
+uint8_t bme690_array_count(void)
+{
+    return s_count;
+}
+
+struct bme69x_dev *bme690_array_dev(uint8_t idx)
+{
+    return (idx < s_count) ? &s_slot[idx].dev : NULL;
+}
+
+HAL_StatusTypeDef bme690_array_get_stats(uint8_t idx, bme690_array_stats_t *out)
+{
+    if (!out || idx >= s_count) return HAL_ERROR;
+    *out = s_slot[idx].stats;
+    return HAL_OK;
+}
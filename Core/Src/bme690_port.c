@@ -1,23 +1,45 @@
 #include "bme690_port.h"
 
+#include "i2c_bus.h"
+#include "us_delay.h"
+
 // We store both I2C handle + addr in one struct and pass as intf_ptr
 typedef struct
 {
     I2C_HandleTypeDef *hi2c;
     uint16_t dev_addr_8bit; // HAL expects 8-bit address (7-bit << 1)
+    uint16_t mux_addr_8bit; // 0: sensor sits directly on the bus
+    uint8_t  mux_mask;      // control byte that routes the mux to this sensor
 } bme690_i2c_ctx_t;
 
-static bme690_i2c_ctx_t s_ctx[2]; // two sensors
+static bme690_i2c_ctx_t s_ctx[BME690_PORT_MAX_SENSORS];
 static uint8_t s_ctx_count = 0;
 
+// Mux routing left by the last transfer (only the BME690s use the mux)
+static uint16_t s_mux_sel_addr = 0;
+static uint8_t  s_mux_sel_mask = 0;
+
+#define BME690_I2C_TIMEOUT_MS (100u)
+
+// Extra time added on top of the datasheet measurement duration before collecting
+#define BME690_READY_MARGIN_US (20000u)
+
 int8_t bme690_port_init_i2c(struct bme69x_dev *dev, I2C_HandleTypeDef *hi2c, uint8_t i2c_addr_7bit)
+{
+    return bme690_port_init_i2c_mux(dev, hi2c, i2c_addr_7bit, BME690_PORT_NO_MUX, 0);
+}
+
+int8_t bme690_port_init_i2c_mux(struct bme69x_dev *dev, I2C_HandleTypeDef *hi2c, uint8_t i2c_addr_7bit,
+                                uint8_t mux_addr_7bit, uint8_t mux_channel)
 {
     if (!dev || !hi2c) return BME69X_E_NULL_PTR;
-    if (s_ctx_count >= 2) return BME69X_E_INVALID_LENGTH;
+    if (s_ctx_count >= BME690_PORT_MAX_SENSORS || mux_channel > 7u) return BME69X_E_INVALID_LENGTH;
 
     bme690_i2c_ctx_t *ctx = &s_ctx[s_ctx_count++];
     ctx->hi2c = hi2c;
     ctx->dev_addr_8bit = (uint16_t)(i2c_addr_7bit << 1);
+    ctx->mux_addr_8bit = (uint16_t)(mux_addr_7bit << 1);
+    ctx->mux_mask = (uint8_t)(1u << mux_channel);
 
     dev->intf = BME69X_I2C_INTF;
     dev->read = bme690_i2c_read;
@@ -32,18 +54,45 @@ int8_t bme690_port_init_i2c(struct bme69x_dev *dev, I2C_HandleTypeDef *hi2c, uin
     return BME69X_OK;
 }
 
+// Route the mux to this sensor, or close it for a sensor on the main bus (an open
+// channel would put a second 0x76/0x77 next to it). The mux has a single control
+// register and takes every data byte as the new value, so a "register write" of
+// mask + [mask] sets it.
+static int8_t mux_select(bme690_i2c_ctx_t *ctx)
+{
+    uint16_t addr = ctx->mux_addr_8bit ? ctx->mux_addr_8bit : s_mux_sel_addr;
+    uint8_t mask = ctx->mux_addr_8bit ? ctx->mux_mask : 0u;
+
+    if (addr == 0u) return 0;
+    if (addr == s_mux_sel_addr && mask == s_mux_sel_mask) return 0;
+
+    if (i2c_bus_transfer(addr, mask, I2C_BUS_WRITE, &mask, 1u,
+                         BME690_I2C_TIMEOUT_MS) != HAL_OK)
+    {
+        // Routing unknown: force a rewrite on the next transfer
+        s_mux_sel_addr = addr;
+        s_mux_sel_mask = 0xFFu;
+        return -1;
+    }
+
+    s_mux_sel_addr = mask ? addr : 0u;
+    s_mux_sel_mask = mask;
+    return 0;
+}
+
 BME69X_INTF_RET_TYPE bme690_i2c_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
 {
     bme690_i2c_ctx_t *ctx = (bme690_i2c_ctx_t *)intf_ptr;
     if (!ctx || !ctx->hi2c || !reg_data) return -1;
+    if (mux_select(ctx) != 0) return -1;
 
-    if (HAL_I2C_Mem_Read(ctx->hi2c,
-                         ctx->dev_addr_8bit,
+    // Queued behind any other sensor's traffic; sleeps until the I2C IRQ completes it
+    if (i2c_bus_transfer(ctx->dev_addr_8bit,
                          reg_addr,
-                         I2C_MEMADD_SIZE_8BIT,
+                         I2C_BUS_READ,
                          reg_data,
                          (uint16_t)length,
-                         100) != HAL_OK)
+                         BME690_I2C_TIMEOUT_MS) != HAL_OK)
     {
         return -1;
     }
@@ -54,14 +103,14 @@ BME69X_INTF_RET_TYPE bme690_i2c_write(uint8_t reg_addr, const uint8_t *reg_data,
 {
     bme690_i2c_ctx_t *ctx = (bme690_i2c_ctx_t *)intf_ptr;
     if (!ctx || !ctx->hi2c || !reg_data) return -1;
+    if (mux_select(ctx) != 0) return -1;
 
-    if (HAL_I2C_Mem_Write(ctx->hi2c,
-                          ctx->dev_addr_8bit,
-                          reg_addr,
-                          I2C_MEMADD_SIZE_8BIT,
-                          (uint8_t*)reg_data,
-                          (uint16_t)length,
-                          100) != HAL_OK)
+    if (i2c_bus_transfer(ctx->dev_addr_8bit,
+                         reg_addr,
+                         I2C_BUS_WRITE,
+                         (uint8_t*)reg_data,
+                         (uint16_t)length,
+                         BME690_I2C_TIMEOUT_MS) != HAL_OK)
     {
         return -1;
     }
@@ -71,8 +120,34 @@ BME69X_INTF_RET_TYPE bme690_i2c_write(uint8_t reg_addr, const uint8_t *reg_data,
 void bme690_delay_us(uint32_t period, void *intf_ptr)
 {
     (void)intf_ptr;
-    // crude microsecond delay using HAL_GetTick (ms resolution)
-    // Good enough for many apps; for accurate us use a hardware timer.
-    uint32_t ms = (period + 999) / 1000;
-    HAL_Delay(ms);
+    us_delay(period);
+}
+
+int8_t bme690_port_trigger_forced(struct bme69x_dev *dev,
+                                  struct bme69x_conf *conf,
+                                  uint16_t heatr_dur_ms,
+                                  uint32_t *wait_us)
+{
+    if (!dev || !conf || !wait_us) return BME69X_E_NULL_PTR;
+
+    int8_t rslt = bme69x_set_op_mode(BME69X_FORCED_MODE, dev);
+    if (rslt != BME69X_OK) return rslt;
+
+    // get_meas_dur() is pure arithmetic on conf, no bus traffic
+    *wait_us = bme69x_get_meas_dur(BME69X_FORCED_MODE, conf, dev)
+             + ((uint32_t)heatr_dur_ms * 1000u)
+             + BME690_READY_MARGIN_US;
+
+    return BME69X_OK;
+}
+
+int8_t bme690_port_collect_forced(struct bme69x_dev *dev, struct bme69x_data *out)
+{
+    if (!dev || !out) return BME69X_E_NULL_PTR;
+
+    uint8_t n = 0;
+    int8_t rslt = bme69x_get_data(BME69X_FORCED_MODE, out, &n, dev);
+    if (rslt != BME69X_OK) return rslt;
+
+    return (n == 0) ? BME69X_W_NO_NEW_DATA : BME69X_OK;
 }
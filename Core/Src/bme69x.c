@@ -99,8 +99,34 @@ static int8_t get_mem_page(struct bme69x_dev *dev);
 /* This internal API is used to check the bme69x_dev for null pointers */
 static int8_t null_ptr_check(const struct bme69x_dev *dev);
 
-/* This internal API is used to set heater configurations */
-static int8_t set_conf(const struct bme69x_heatr_conf *conf, uint8_t op_mode, uint8_t *nb_conv, struct bme69x_dev *dev);
+/* This internal API is used to build the heater configuration registers */
+static int8_t set_conf(const struct bme69x_heatr_conf *conf,
+                       uint8_t op_mode,
+                       uint8_t *nb_conv,
+                       uint8_t *reg_addr,
+                       uint8_t *reg_data,
+                       uint8_t *len,
+                       struct bme69x_dev *dev);
+
+/* This internal API is used to record written/read values in the register shadow */
+static void shadow_store(uint8_t reg_addr, uint8_t reg_data, struct bme69x_dev *dev);
+
+/* This internal API is used to check whether a register write would change the sensor */
+static uint8_t shadow_differs(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_t len,
+                              const struct bme69x_dev *dev);
+
+/* This internal API is used to check whether the shadow holds a register range */
+static uint8_t shadow_holds(uint8_t reg_addr, uint32_t len, const struct bme69x_dev *dev);
+
+/* This internal API is used to record a res_heat/gas_wait block read along with the fields */
+static void take_heatr_block(const uint8_t *res_heat, struct bme69x_dev *dev);
+
+/* This internal API is used to read registers, from the shadow when it holds all of them */
+static int8_t get_regs_shadowed(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, struct bme69x_dev *dev);
+
+/* This internal API is used to write only the registers that differ from the shadow */
+static int8_t set_regs_changed(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_t len,
+                               struct bme69x_dev *dev);
 
 /* This internal API is used to limit the max value of a parameter */
 static int8_t boundary_check(uint8_t *value, uint8_t max, struct bme69x_dev *dev);
@@ -205,8 +231,17 @@ int8_t bme69x_set_regs(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_
                 dev->intf_rslt = dev->write(tmp_buff[0], &tmp_buff[1], (2 * len) - 1, dev->intf_ptr);
                 if (dev->intf_rslt != 0)
                 {
+                    /* Unknown how much of the burst landed */
+                    dev->shadow_valid = 0;
                     rslt = BME69X_E_COM_FAIL;
                 }
+                else
+                {
+                    for (index = 0; index < len; index++)
+                    {
+                        shadow_store(reg_addr[index], reg_data[index], dev);
+                    }
+                }
             }
         }
         else
@@ -287,6 +322,10 @@ int8_t bme69x_soft_reset(struct bme69x_dev *dev)
                 /* Wait for 5ms */
                 dev->delay_us(BME69X_PERIOD_RESET, dev->intf_ptr);
 
+                /* Registers are back at their reset values */
+                dev->shadow_valid = 0;
+                dev->meas_dur_key = 0;
+
                 /* After reset get the memory page */
                 if (dev->intf == BME69X_SPI_INTF)
                 {
@@ -312,22 +351,18 @@ int8_t bme69x_set_conf(struct bme69x_conf *conf, struct bme69x_dev *dev)
     uint8_t reg_array[BME69X_LEN_CONFIG] = { 0x71, 0x72, 0x73, 0x74, 0x75 };
     uint8_t data_array[BME69X_LEN_CONFIG] = { 0 };
 
-    rslt = bme69x_get_op_mode(&current_op_mode, dev);
-    if (rslt == BME69X_OK)
-    {
-        /* Configure only in the sleep mode */
-        rslt = bme69x_set_op_mode(BME69X_SLEEP_MODE, dev);
-    }
-
     if (conf == NULL)
     {
         rslt = BME69X_E_NULL_PTR;
     }
-    else if (rslt == BME69X_OK)
+    else
     {
         /* Read the whole configuration and write it back once later */
-        rslt = bme69x_get_regs(reg_array[0], data_array, BME69X_LEN_CONFIG, dev);
+        rslt = get_regs_shadowed(reg_array[0], data_array, BME69X_LEN_CONFIG, dev);
         dev->info_msg = BME69X_OK;
+
+        /* Never write a mode back; it is restored separately below */
+        data_array[3] &= (uint8_t)~BME69X_MODE_MSK;
         if (rslt == BME69X_OK)
         {
             rslt = boundary_check(&conf->filter, BME69X_FILTER_SIZE_127, dev);
@@ -370,14 +405,25 @@ int8_t bme69x_set_conf(struct bme69x_conf *conf, struct bme69x_dev *dev)
         }
     }
 
-    if (rslt == BME69X_OK)
+    /* Leave the sensor alone if it already holds this configuration */
+    if ((rslt == BME69X_OK) && shadow_differs(reg_array, data_array, BME69X_LEN_CONFIG, dev))
     {
-        rslt = bme69x_set_regs(reg_array, data_array, BME69X_LEN_CONFIG, dev);
-    }
+        rslt = bme69x_get_op_mode(&current_op_mode, dev);
+        if (rslt == BME69X_OK)
+        {
+            /* Configure only in the sleep mode */
+            rslt = bme69x_set_op_mode(BME69X_SLEEP_MODE, dev);
+        }
 
-    if ((current_op_mode != BME69X_SLEEP_MODE) && (rslt == BME69X_OK))
-    {
-        rslt = bme69x_set_op_mode(current_op_mode, dev);
+        if (rslt == BME69X_OK)
+        {
+            rslt = set_regs_changed(reg_array, data_array, BME69X_LEN_CONFIG, dev);
+        }
+
+        if ((current_op_mode != BME69X_SLEEP_MODE) && (rslt == BME69X_OK))
+        {
+            rslt = bme69x_set_op_mode(current_op_mode, dev);
+        }
     }
 
     return rslt;
@@ -394,7 +440,7 @@ int8_t bme69x_get_conf(struct bme69x_conf *conf, struct bme69x_dev *dev)
     uint8_t reg_addr = BME69X_REG_CTRL_GAS_1;
     uint8_t data_array[BME69X_LEN_CONFIG];
 
-    rslt = bme69x_get_regs(reg_addr, data_array, 5, dev);
+    rslt = get_regs_shadowed(reg_addr, data_array, 5, dev);
     if (!conf)
     {
         rslt = BME69X_E_NULL_PTR;
@@ -486,6 +532,7 @@ uint32_t bme69x_get_meas_dur(const uint8_t op_mode, struct bme69x_conf *conf, st
     int8_t rslt;
     uint32_t meas_dur = 0; /* Calculate in us */
     uint32_t meas_cycles;
+    uint16_t key;
     uint8_t os_to_meas_cycles[6] = { 0, 1, 2, 4, 8, 16 };
 
     if (conf != NULL)
@@ -507,18 +554,31 @@ uint32_t bme69x_get_meas_dur(const uint8_t op_mode, struct bme69x_conf *conf, st
 
         if (rslt == BME69X_OK)
         {
-            meas_cycles = os_to_meas_cycles[conf->os_temp];
-            meas_cycles += os_to_meas_cycles[conf->os_pres];
-            meas_cycles += os_to_meas_cycles[conf->os_hum];
+            /* Same op mode and oversampling as last time: reuse the result */
+            key = (uint16_t)(0x8000u | ((op_mode == BME69X_PARALLEL_MODE) ? 0x1000u : 0u) |
+                             ((uint16_t)conf->os_temp << 8) | ((uint16_t)conf->os_pres << 4) | conf->os_hum);
+            if (key == dev->meas_dur_key)
+            {
+                meas_dur = dev->meas_dur;
+            }
+            else
+            {
+                meas_cycles = os_to_meas_cycles[conf->os_temp];
+                meas_cycles += os_to_meas_cycles[conf->os_pres];
+                meas_cycles += os_to_meas_cycles[conf->os_hum];
 
-            /* TPH measurement duration */
-            meas_dur = meas_cycles * UINT32_C(1963);
-            meas_dur += UINT32_C(477 * 4); /* TPH switching duration */
-            meas_dur += UINT32_C(477 * 5); /* Gas measurement duration */
+                /* TPH measurement duration */
+                meas_dur = meas_cycles * UINT32_C(1963);
+                meas_dur += UINT32_C(477 * 4); /* TPH switching duration */
+                meas_dur += UINT32_C(477 * 5); /* Gas measurement duration */
 
-            if (op_mode != BME69X_PARALLEL_MODE)
-            {
-                meas_dur += UINT32_C(1000); /* Wake up duration of 1ms */
+                if (op_mode != BME69X_PARALLEL_MODE)
+                {
+                    meas_dur += UINT32_C(1000); /* Wake up duration of 1ms */
+                }
+
+                dev->meas_dur_key = key;
+                dev->meas_dur = meas_dur;
             }
         }
     }
@@ -627,19 +687,19 @@ int8_t bme69x_set_heatr_conf(uint8_t op_mode, const struct bme69x_heatr_conf *co
     uint8_t nb_conv = 0;
     uint8_t hctrl, run_gas = 0;
     uint8_t ctrl_gas_data[2];
-    uint8_t ctrl_gas_addr[2] = { BME69X_REG_CTRL_GAS_0, BME69X_REG_CTRL_GAS_1 };
+
+    /* Shared heater duration, 10 res_heat, 10 gas_wait, CTRL_GAS_0/1 */
+    uint8_t reg_addr[23];
+    uint8_t reg_data[23];
+    uint8_t len = 0;
 
     if (conf != NULL)
     {
-        rslt = bme69x_set_op_mode(BME69X_SLEEP_MODE, dev);
-        if (rslt == BME69X_OK)
-        {
-            rslt = set_conf(conf, op_mode, &nb_conv, dev);
-        }
+        rslt = set_conf(conf, op_mode, &nb_conv, reg_addr, reg_data, &len, dev);
 
         if (rslt == BME69X_OK)
         {
-            rslt = bme69x_get_regs(BME69X_REG_CTRL_GAS_0, ctrl_gas_data, 2, dev);
+            rslt = get_regs_shadowed(BME69X_REG_CTRL_GAS_0, ctrl_gas_data, 2, dev);
             if (rslt == BME69X_OK)
             {
                 if (conf->enable == BME69X_ENABLE)
@@ -658,7 +718,20 @@ int8_t bme69x_set_heatr_conf(uint8_t op_mode, const struct bme69x_heatr_conf *co
                 ctrl_gas_data[1] = BME69X_SET_BITS_POS_0(ctrl_gas_data[1], BME69X_NBCONV, nb_conv);
                 ctrl_gas_data[1] = BME69X_SET_BITS(ctrl_gas_data[1], BME69X_RUN_GAS, run_gas);
 
-                rslt = bme69x_set_regs(ctrl_gas_addr, ctrl_gas_data, 2, dev);
+                reg_addr[len] = BME69X_REG_CTRL_GAS_0;
+                reg_data[len++] = ctrl_gas_data[0];
+                reg_addr[len] = BME69X_REG_CTRL_GAS_1;
+                reg_data[len++] = ctrl_gas_data[1];
+            }
+        }
+
+        /* Only touch the sensor if the heater setup actually changes */
+        if ((rslt == BME69X_OK) && shadow_differs(reg_addr, reg_data, len, dev))
+        {
+            rslt = bme69x_set_op_mode(BME69X_SLEEP_MODE, dev);
+            if (rslt == BME69X_OK)
+            {
+                rslt = set_regs_changed(reg_addr, reg_data, len, dev);
             }
         }
     }
@@ -820,122 +893,112 @@ int8_t bme69x_selftest_check(const struct bme69x_dev *dev)
 /*****************************INTERNAL APIs***********************************************/
 #ifndef BME69X_USE_FPU
 
+/*
+ * The integer compensation below is bit-exact with Bosch's reference formulas as
+ * built for a 32-bit target (long is 32 bits): calibration-only products are
+ * folded in get_calib_data(), chained divisions are merged where truncation
+ * allows, and terms that provably fit are kept in 32 bits.
+ */
+
 /* @brief This internal API is used to calculate the temperature value. */
 static int16_t calc_temperature(uint32_t temp_adc, struct bme69x_dev *dev, uint32_t *t_lin)
 {
-    int64_t partial_data1;
-    int64_t partial_data2;
-    int64_t partial_data3;
-    int64_t partial_data4;
-    int64_t partial_data5;
-    int64_t partial_data6;
-    int64_t tem_comp;
-
-    partial_data1 = (int64_t)(temp_adc - (256U * dev->calib.par_t1));
-    partial_data2 = (int64_t)(partial_data1 * (int64_t)dev->calib.par_t2);
-    partial_data3 = (int64_t)(partial_data1 * partial_data1);
-    partial_data4 = (int64_t)(partial_data3 * (int64_t)dev->calib.par_t3);
-    partial_data5 = (int64_t)((int64_t)(partial_data2 * 262144UL) + partial_data4);
-    partial_data6 = (int64_t)(partial_data5 / 4294967296ULL);
-    *t_lin = (uint32_t)partial_data6;
-    tem_comp = (int64_t)((partial_data6 * 25U) / 16384UL);
-
-    return (int16_t)(tem_comp);
+    uint64_t partial_data1;
+    uint64_t partial_data2;
+
+    /* Below the offset this wraps around, like the reference formula does */
+    partial_data1 = (uint64_t)(uint32_t)(temp_adc - dev->calib.t_adc_off);
+
+    /* (p1 * par_t2 * 2^18 + p1^2 * par_t3) / 2^32, modulo 2^64 */
+    partial_data2 = partial_data1 * (dev->calib.t_gain + (partial_data1 * (uint64_t)(int64_t)dev->calib.par_t3));
+    partial_data2 >>= 32;
+    *t_lin = (uint32_t)partial_data2;
+
+    return (int16_t)((partial_data2 * 25U) >> 14);
 }
 
 /* @brief This internal API is used to calculate the pressure value. */
 static uint32_t calc_pressure(uint32_t pres_adc, uint32_t t_lin, const struct bme69x_dev *dev)
 {
+    int64_t t_lin_64 = (int64_t)t_lin;
+    int64_t adc_64 = (int64_t)pres_adc;
+    int64_t t_sq;
+    int64_t t_cu;
+    int64_t offset;
+    int64_t sensitivity;
     int64_t partial_data1;
     int64_t partial_data2;
     int64_t partial_data3;
     int64_t partial_data4;
-    int64_t partial_data5;
-    int64_t partial_data6;
-    int64_t offset;
-    int64_t sensitivity;
-    int64_t press_comp;
-    int64_t t_lin_64;
-
-    t_lin_64 = (int64_t)t_lin;
 
-    partial_data1 = t_lin_64 * t_lin_64;
-    partial_data2 = partial_data1 / 64;
-    partial_data3 = partial_data2 * t_lin_64 / 256;
-    partial_data4 = dev->calib.par_p4 * partial_data3 / 32;
-    partial_data5 = dev->calib.par_p3 * partial_data1 * 16;
-    partial_data6 = dev->calib.par_p2 * t_lin_64 * (1 << 22);
+    t_sq = t_lin_64 * t_lin_64;
+    t_cu = (t_sq / 64) * t_lin_64 / 256;
 
-    offset = dev->calib.par_p1 * ((int64_t)1 << 47) + partial_data4 + partial_data5 + partial_data6;
-    partial_data2 = (dev->calib.par_p8 * partial_data3) / (1 << 5);
-    partial_data4 = dev->calib.par_p7 * partial_data1 * (1 << 2);
+    offset = dev->calib.p_off + (dev->calib.par_p4 * t_cu) / 32 + (t_sq * dev->calib.p_off_tt) +
+             (t_lin_64 * dev->calib.p_off_t);
+    sensitivity = dev->calib.p_sens + (dev->calib.par_p8 * t_cu) / 32 + (t_sq * dev->calib.p_sens_tt) +
+                  (t_lin_64 * dev->calib.p_sens_t);
+    partial_data1 = sensitivity / (1 << 24) * adc_64;
 
-    partial_data5 = (dev->calib.par_p6 - 16384) * t_lin_64 * (1 << 21);
-    sensitivity = (dev->calib.par_p5 - 16384) * ((int64_t)1 << 46) + partial_data2 + partial_data4 + partial_data5;
-    partial_data1 = sensitivity / (1 << 24) * pres_adc;
+    partial_data2 = (dev->calib.par_p10 * t_lin_64) + dev->calib.p_nl;
+    partial_data2 = partial_data2 * adc_64 / (1 << 13);
 
-    partial_data2 = dev->calib.par_p10 * t_lin_64;
-    partial_data3 = partial_data2 + dev->calib.par_p9 * (1 << 16);
-    partial_data4 = partial_data3 * pres_adc / (1 << 13);
-    partial_data5 = (pres_adc * partial_data4 / 10) / (1 << 9);
-    partial_data5 = partial_data5 * 10;
-    partial_data6 = pres_adc * pres_adc;
+    /* (x / 10) / 2^9 truncates the same as x / 5120 */
+    partial_data3 = ((adc_64 * partial_data2) / 5120) * 10;
 
-    partial_data2 = dev->calib.par_p11 * partial_data6 / (1 << 16);
-    partial_data3 = partial_data2 * pres_adc / (1 << 7);
-    partial_data4 = offset / 4 + partial_data1 + partial_data5 + partial_data3;
+    /* The reference squares the ADC value in 32 bits */
+    partial_data4 = (int64_t)(uint32_t)(pres_adc * pres_adc);
+    partial_data4 = (dev->calib.par_p11 * partial_data4) / (1 << 16);
+    partial_data4 = partial_data4 * adc_64 / (1 << 7);
 
-    press_comp = (partial_data4 / ((int64_t)1 << 40)) * 25;
+    partial_data4 = offset / 4 + partial_data1 + partial_data3 + partial_data4;
 
-    return (uint32_t)(press_comp / 100);
+    /* (x / 2^40) * 25 / 100 is x / 2^42 */
+    return (uint32_t)(partial_data4 / ((int64_t)1 << 42));
 }
 
 /* This internal API is used to calculate the humidity in integer */
 static uint32_t calc_humidity(uint16_t hum_adc, int16_t comp_temperature, const struct bme69x_dev *dev)
 {
-    uint32_t hum_comp;
-    int64_t hum_64 = hum_adc;
-    int64_t t_comp = comp_temperature;
-    int64_t t_fine = (t_comp * 256 - 128) / 5;
-    int64_t var_H = t_fine - 76800UL;
+    /* An int16 temperature keeps var_h within +-2^21, so these fit 32 bits */
+    int32_t t_fine = ((int32_t)comp_temperature * 256 - 128) / 5;
+    int32_t var_h = t_fine - 76800;
+    int32_t lin = (var_h * dev->calib.par_h4) / 1024;
+    int32_t quad = (var_h * dev->calib.par_h3) / 2048 + 32768;
+    int64_t offset;
+    int64_t hum_64;
+    uint64_t gain;
 
-    var_H =
-        (((((hum_64 * 16384UL) - (dev->calib.par_h1 * 1048576UL) - (dev->calib.par_h2 * var_H)) + 16384UL) / 32768UL) *
-         ((((((var_H * dev->calib.par_h4) / 1024UL) * ((var_H * dev->calib.par_h3) / 2048UL + 32768UL)) / 1024UL) +
-           2097152ULL) * dev->calib.par_h5 + 8192UL) / 16384UL);
+    offset = (((int64_t)hum_adc * 16384) + dev->calib.h_off - ((int64_t)dev->calib.par_h2 * var_h)) / 32768;
 
-    var_H = var_H - (((((var_H / 32768UL) * (var_H / 32768UL)) / 128UL) * dev->calib.par_h6) / 16UL);
+    /* The reference switches to unsigned 64-bit arithmetic here (2097152ULL) */
+    gain = (uint64_t)(((int64_t)lin * quad) / 1024 + 2097152);
+    gain = gain * (uint64_t)(int64_t)dev->calib.par_h5 + 8192U;
+    hum_64 = (int64_t)(((uint64_t)offset * gain) / 16384U);
 
-    if (var_H < 0)
+    hum_64 = hum_64 - ((((hum_64 / 32768) * (hum_64 / 32768)) / 128) * dev->calib.par_h6) / 16;
+
+    if (hum_64 < 0)
     {
-        var_H = 0;
+        hum_64 = 0;
     }
 
-    if (var_H > 419430400)
+    if (hum_64 > 419430400)
     {
-        var_H = 419430400;
+        hum_64 = 419430400;
     }
 
-    hum_comp = (uint32_t)(var_H / 4096UL);
-
-    return hum_comp;
+    return (uint32_t)(hum_64 / 4096);
 }
 
 /* This internal API is used to calculate the gas resistance */
 static uint32_t calc_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range)
 {
-    uint32_t calc_gas_res;
-    uint32_t var1 = UINT32_C(262144) >> gas_range;
-    int32_t var2 = (int32_t)gas_res_adc - INT32_C(512);
-
-    var2 *= INT32_C(3);
-    var2 = INT32_C(4096) + var2;
-
-    /* multiplying 10000 then dividing then multiplying by 100 instead of multiplying by 1000000 to prevent overflow */
-    calc_gas_res = (UINT32_C(10000) * var1) / (uint32_t)var2;
-    calc_gas_res = calc_gas_res * 100;
+    /* 10000 * (2^18 >> gas_range) in one shift; the result is in 100 ohm steps times 100 */
+    uint32_t var1 = UINT32_C(2621440000) >> gas_range;
+    uint32_t var2 = (UINT32_C(3) * gas_res_adc) + UINT32_C(2560);
 
-    return calc_gas_res;
+    return (var1 / var2) * 100;
 }
 
 /* This internal API is used to calculate the heater resistance value using integer */
@@ -1146,20 +1209,26 @@ static uint8_t calc_gas_wait(uint16_t dur)
 static int8_t read_field_data(uint8_t index, struct bme69x_data *data, struct bme69x_dev *dev)
 {
     int8_t rslt = BME69X_OK;
-    uint8_t buff[BME69X_LEN_FIELD] = { 0 };
+    uint8_t buff[BME69X_LEN_FIELD_BLOCK] = { 0 };
     uint8_t gas_range;
     uint32_t adc_temp;
     uint32_t adc_pres;
     volatile uint16_t adc_hum;
     uint16_t adc_gas_res;
     uint8_t tries = 5;
+    uint8_t start = (uint8_t)(BME69X_REG_FIELD0 + (index * BME69X_LEN_FIELD_OFFSET));
+    uint8_t len = BME69X_LEN_FIELD;
+
+#ifdef BME69X_FIELD_BURST_READ
+
+    /* Take the heater blocks along; res_heat/gas_wait only if the shadow lacks them */
+    len = (uint8_t)((shadow_holds(BME69X_REG_RES_HEAT0, 20, dev) ? BME69X_REG_RES_HEAT0
+                     : (BME69X_REG_GAS_WAIT0 + 10)) - start);
+#endif
 
     while ((tries) && (rslt == BME69X_OK))
     {
-        rslt = bme69x_get_regs(((uint8_t)(BME69X_REG_FIELD0 + (index * BME69X_LEN_FIELD_OFFSET))),
-                               buff,
-                               (uint16_t)BME69X_LEN_FIELD,
-                               dev);
+        rslt = bme69x_get_regs(start, buff, len, dev);
         if (!data)
         {
             rslt = BME69X_E_NULL_PTR;
@@ -1183,15 +1252,29 @@ static int8_t read_field_data(uint8_t index, struct bme69x_data *data, struct bm
 
         if ((data->status & BME69X_NEW_DATA_MSK) && (rslt == BME69X_OK))
         {
-            rslt = bme69x_get_regs(BME69X_REG_RES_HEAT0 + data->gas_index, &data->res_heat, 1, dev);
-            if (rslt == BME69X_OK)
+            /* Heater settings of this step: from the burst if it covered them, else from the shadow */
+            if (len > (BME69X_REG_RES_HEAT0 - start))
+            {
+                take_heatr_block(&buff[BME69X_REG_RES_HEAT0 - start], dev);
+            }
+
+            if (len > (BME69X_REG_IDAC_HEAT0 + data->gas_index - start))
+            {
+                data->idac = buff[BME69X_REG_IDAC_HEAT0 + data->gas_index - start];
+            }
+            else
             {
                 rslt = bme69x_get_regs(BME69X_REG_IDAC_HEAT0 + data->gas_index, &data->idac, 1, dev);
             }
 
             if (rslt == BME69X_OK)
             {
-                rslt = bme69x_get_regs(BME69X_REG_GAS_WAIT0 + data->gas_index, &data->gas_wait, 1, dev);
+                rslt = get_regs_shadowed(BME69X_REG_RES_HEAT0 + data->gas_index, &data->res_heat, 1, dev);
+            }
+
+            if (rslt == BME69X_OK)
+            {
+                rslt = get_regs_shadowed(BME69X_REG_GAS_WAIT0 + data->gas_index, &data->gas_wait, 1, dev);
             }
 
             if (rslt == BME69X_OK)
@@ -1225,14 +1308,15 @@ static int8_t read_field_data(uint8_t index, struct bme69x_data *data, struct bm
 static int8_t read_all_field_data(struct bme69x_data * const data[], struct bme69x_dev *dev)
 {
     int8_t rslt = BME69X_OK;
-    uint8_t buff[BME69X_LEN_FIELD * 3] = { 0 };
+    uint8_t buff[BME69X_LEN_FIELD_BLOCK] = { 0 };
     uint8_t gas_range;
     uint32_t adc_temp;
     uint32_t adc_pres;
     uint16_t adc_hum;
     uint16_t adc_gas_res;
     uint8_t off;
-    uint8_t set_val[30] = { 0 }; /* idac, res_heat, gas_wait */
+    uint8_t *set_val = &buff[BME69X_REG_IDAC_HEAT0 - BME69X_REG_FIELD0]; /* idac, res_heat, gas_wait */
+    uint8_t len = BME69X_LEN_FIELD_BLOCK;
     uint8_t i;
 
     if (!data[0] && !data[1] && !data[2])
@@ -1240,14 +1324,30 @@ static int8_t read_all_field_data(struct bme69x_data * const data[], struct bme6
         rslt = BME69X_E_NULL_PTR;
     }
 
+    /* Fields and heater blocks are contiguous: one transfer, minus what the shadow holds */
     if (rslt == BME69X_OK)
     {
-        rslt = bme69x_get_regs(BME69X_REG_FIELD0, buff, (uint32_t) BME69X_LEN_FIELD * 3, dev);
+        if (shadow_holds(BME69X_REG_RES_HEAT0, 20, dev))
+        {
+            len = BME69X_REG_RES_HEAT0 - BME69X_REG_FIELD0;
+        }
+
+        rslt = bme69x_get_regs(BME69X_REG_FIELD0, buff, len, dev);
     }
 
     if (rslt == BME69X_OK)
     {
-        rslt = bme69x_get_regs(BME69X_REG_IDAC_HEAT0, set_val, 30, dev);
+        if (len == BME69X_LEN_FIELD_BLOCK)
+        {
+            take_heatr_block(&set_val[10], dev);
+        }
+        else
+        {
+            for (i = 0; i < 20; i++)
+            {
+                set_val[10 + i] = dev->shadow[BME69X_REG_RES_HEAT0 - BME69X_SHADOW_START + i];
+            }
+        }
     }
 
     for (i = 0; ((i < 3) && (rslt == BME69X_OK)); i++)
@@ -1400,13 +1500,18 @@ static int8_t null_ptr_check(const struct bme69x_dev *dev)
 }
 
 /* This internal API is used to set heater configurations */
-static int8_t set_conf(const struct bme69x_heatr_conf *conf, uint8_t op_mode, uint8_t *nb_conv, struct bme69x_dev *dev)
+static int8_t set_conf(const struct bme69x_heatr_conf *conf,
+                       uint8_t op_mode,
+                       uint8_t *nb_conv,
+                       uint8_t *reg_addr,
+                       uint8_t *reg_data,
+                       uint8_t *len,
+                       struct bme69x_dev *dev)
 {
     int8_t rslt = BME69X_OK;
     uint8_t i;
     uint8_t shared_dur;
     uint8_t write_len = 0;
-    uint8_t heater_dur_shared_addr = BME69X_REG_SHD_HEATR_DUR;
     uint8_t rh_reg_addr[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
     uint8_t rh_reg_data[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
     uint8_t gw_reg_addr[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
@@ -1463,24 +1568,155 @@ static int8_t set_conf(const struct bme69x_heatr_conf *conf, uint8_t op_mode, ui
             (*nb_conv) = conf->profile_len;
             write_len = conf->profile_len;
             shared_dur = calc_heatr_dur_shared(conf->shared_heatr_dur);
-            if (rslt == BME69X_OK)
-            {
-                rslt = bme69x_set_regs(&heater_dur_shared_addr, &shared_dur, 1, dev);
-            }
+            reg_addr[*len] = BME69X_REG_SHD_HEATR_DUR;
+            reg_data[(*len)++] = shared_dur;
 
             break;
         default:
             rslt = BME69X_W_DEFINE_OP_MODE;
     }
 
-    if (rslt == BME69X_OK)
+    /* Queued for one write by the caller; res_heat first, then gas_wait */
+    for (i = 0; (i < write_len) && (rslt == BME69X_OK); i++)
     {
-        rslt = bme69x_set_regs(rh_reg_addr, rh_reg_data, write_len, dev);
+        reg_addr[*len] = rh_reg_addr[i];
+        reg_data[(*len)++] = rh_reg_data[i];
     }
 
-    if (rslt == BME69X_OK)
+    for (i = 0; (i < write_len) && (rslt == BME69X_OK); i++)
+    {
+        reg_addr[*len] = gw_reg_addr[i];
+        reg_data[(*len)++] = gw_reg_data[i];
+    }
+
+    return rslt;
+}
+
+/* This internal API is used to record written/read values in the register shadow */
+static void shadow_store(uint8_t reg_addr, uint8_t reg_data, struct bme69x_dev *dev)
+{
+    uint8_t n = (uint8_t)(reg_addr - BME69X_SHADOW_START);
+
+    if (n < BME69X_LEN_SHADOW)
+    {
+        /* The mode bits clear themselves when a forced measurement ends */
+        if (reg_addr == BME69X_REG_CTRL_MEAS)
+        {
+            reg_data &= (uint8_t)~BME69X_MODE_MSK;
+        }
+
+        dev->shadow[n] = reg_data;
+        dev->shadow_valid |= (UINT32_C(1) << n);
+    }
+}
+
+/* This internal API is used to check whether a register write would change the sensor */
+static uint8_t shadow_differs(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_t len,
+                              const struct bme69x_dev *dev)
+{
+    uint32_t i;
+    uint8_t n;
+    uint8_t differs = 0;
+
+    for (i = 0; (i < len) && !differs; i++)
+    {
+        n = (uint8_t)(reg_addr[i] - BME69X_SHADOW_START);
+        if ((n >= BME69X_LEN_SHADOW) || !(dev->shadow_valid & (UINT32_C(1) << n)))
+        {
+            differs = 1;
+        }
+        else if ((reg_addr[i] == BME69X_REG_CTRL_MEAS) && (reg_data[i] & BME69X_MODE_MSK))
+        {
+            /* Writing a mode always has an effect */
+            differs = 1;
+        }
+        else
+        {
+            differs = (dev->shadow[n] != reg_data[i]) ? 1 : 0;
+        }
+    }
+
+    return differs;
+}
+
+/* This internal API is used to check whether the shadow holds a register range */
+static uint8_t shadow_holds(uint8_t reg_addr, uint32_t len, const struct bme69x_dev *dev)
+{
+    uint8_t n = (uint8_t)(reg_addr - BME69X_SHADOW_START);
+    uint32_t mask;
+
+    if ((n >= BME69X_LEN_SHADOW) || (len == 0) || (len > (uint32_t)(BME69X_LEN_SHADOW - n)))
+    {
+        return 0;
+    }
+
+    mask = ((len < 32u) ? ((UINT32_C(1) << len) - 1u) : UINT32_MAX) << n;
+
+    return ((dev->shadow_valid & mask) == mask) ? 1 : 0;
+}
+
+/* This internal API is used to record a res_heat/gas_wait block read along with the fields */
+static void take_heatr_block(const uint8_t *res_heat, struct bme69x_dev *dev)
+{
+    uint8_t i;
+
+    for (i = 0; i < 20; i++)
     {
-        rslt = bme69x_set_regs(gw_reg_addr, gw_reg_data, write_len, dev);
+        shadow_store((uint8_t)(BME69X_REG_RES_HEAT0 + i), res_heat[i], dev);
+    }
+}
+
+/* This internal API is used to read registers, from the shadow when it holds all of them */
+static int8_t get_regs_shadowed(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, struct bme69x_dev *dev)
+{
+    int8_t rslt;
+    uint32_t i;
+    uint8_t n = (uint8_t)(reg_addr - BME69X_SHADOW_START);
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME69X_OK) && reg_data && shadow_holds(reg_addr, len, dev))
+    {
+        for (i = 0; i < len; i++)
+        {
+            reg_data[i] = dev->shadow[n + i];
+        }
+    }
+    else
+    {
+        rslt = bme69x_get_regs(reg_addr, reg_data, len, dev);
+        for (i = 0; (i < len) && (rslt == BME69X_OK); i++)
+        {
+            shadow_store((uint8_t)(reg_addr + i), reg_data[i], dev);
+        }
+    }
+
+    return rslt;
+}
+
+/* This internal API is used to write only the registers that differ from the shadow */
+static int8_t set_regs_changed(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_t len,
+                               struct bme69x_dev *dev)
+{
+    int8_t rslt = BME69X_OK;
+    uint8_t addr[BME69X_LEN_INTERLEAVE_BUFF / 2];
+    uint8_t data[BME69X_LEN_INTERLEAVE_BUFF / 2];
+    uint8_t n = 0;
+    uint32_t i;
+
+    for (i = 0; (i < len) && (rslt == BME69X_OK); i++)
+    {
+        if (shadow_differs(&reg_addr[i], &reg_data[i], 1, dev))
+        {
+            addr[n] = reg_addr[i];
+            data[n++] = reg_data[i];
+        }
+
+        /* Flush a full burst, and what is left at the end */
+        if ((n == (BME69X_LEN_INTERLEAVE_BUFF / 2)) || ((i == (len - 1)) && (n > 0)))
+        {
+            rslt = bme69x_set_regs(addr, data, n, dev);
+            n = 0;
+        }
     }
 
     return rslt;
@@ -1778,6 +2014,23 @@ static int8_t get_calib_data(struct bme69x_dev *dev)
         dev->calib.res_heat_range = ((coeff_array[BME69X_IDX_RES_HEAT_RANGE] & BME69X_RHRANGE_MSK) >> 4);
         dev->calib.res_heat_val = (int8_t)coeff_array[BME69X_IDX_RES_HEAT_VAL];
         dev->calib.range_sw_err = ((int8_t)(coeff_array[BME69X_IDX_RANGE_SW_ERR] & BME69X_RSERROR_MSK)) / 16;
+
+#ifndef BME69X_USE_FPU
+
+        /* Calibration-only products of the integer compensation */
+        dev->calib.t_adc_off = 256U * dev->calib.par_t1;
+        dev->calib.t_gain = (uint64_t)dev->calib.par_t2 << 18;
+
+        dev->calib.p_off = (int64_t)dev->calib.par_p1 * ((int64_t)1 << 47);
+        dev->calib.p_off_t = (int64_t)dev->calib.par_p2 * (1 << 22);
+        dev->calib.p_off_tt = (int32_t)dev->calib.par_p3 * 16;
+        dev->calib.p_sens = (int64_t)(dev->calib.par_p5 - 16384) * ((int64_t)1 << 46);
+        dev->calib.p_sens_t = (int64_t)(dev->calib.par_p6 - 16384) * (1 << 21);
+        dev->calib.p_sens_tt = (int32_t)dev->calib.par_p7 * 4;
+        dev->calib.p_nl = (int32_t)dev->calib.par_p9 * 65536;
+
+        dev->calib.h_off = 16384 - (int64_t)(uint32_t)((uint32_t)dev->calib.par_h1 * 1048576U);
+#endif
     }
 
     return rslt;
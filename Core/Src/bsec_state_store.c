@@ -3,22 +3,53 @@
 #include "bsec_interface.h"
 #include "bsec_datatypes.h"
 
-#include "stm32wb0x_hal_flash.h"
-#include "stm32wb0x_hal_flash_ex.h"
+#include "crc_calc.h"
+#include "flash_manager.h"
 
+#include <stddef.h>
 #include <string.h>
 
 #ifndef BSEC_FLASH_PAGE_SIZE
 #define BSEC_FLASH_PAGE_SIZE (FLASH_PAGE_SIZE) /* 2KB */
 #endif
 
-/* Store in last app page before BT NVM (BT NVM is last 4KB: 0x1006F000..0x1006FFFF) */
-#ifndef BSEC_STORE_ADDR
-#define BSEC_STORE_ADDR (0x1006E800u)
+/*
+ * Append-only record log over BSEC_STORE_NUM_PAGES pages ending right below BT NVM
+ * (BT NVM is last 4KB: 0x1006F000..0x1006FFFF). Saves are appended to the current
+ * page; a page is erased only when the log wraps around onto it. On boot every page
+ * is scanned once and the valid record with the highest sequence number wins.
+ *
+ * Erases and writes go through the Flash Manager, which runs them from its sequencer
+ * task in windows where the radio is idle; a save is an asynchronous erase/write job.
+ *
+ * Keep BSEC_STORE_NUM_PAGES in sync with FLASH_BSEC_DATASIZE in the linker script.
+ */
+#ifndef BSEC_STORE_END_ADDR
+#define BSEC_STORE_END_ADDR  (0x1006F000u)
 #endif
 
-#define BSEC_STATE_MAGIC   (0x42534543u) /* 'BSEC' */
-#define BSEC_STATE_VERSION (1u)
+#define BSEC_STORE_ADDR      (BSEC_STORE_END_ADDR - (BSEC_STORE_NUM_PAGES * BSEC_FLASH_PAGE_SIZE))
+
+#define BSEC_FLASH_BASE      (0x10040000u)
+
+#define BSEC_RECORD_MAGIC    (0x4C534542u) /* 'BESL' */
+#define BSEC_RECORD_VERSION  (2u)
+#define BSEC_ERASED_WORD     (0xFFFFFFFFu)
+
+/* Single-page layout used before the log (last page, version 1), migrated on load */
+#define BSEC_LEGACY_ADDR     (BSEC_STORE_END_ADDR - BSEC_FLASH_PAGE_SIZE)
+#define BSEC_LEGACY_MAGIC    (0x42534543u) /* 'BSEC' */
+#define BSEC_LEGACY_VERSION  (1u)
+
+/* Header is programmed first, so a torn save leaves a header whose CRC fails */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t version;
+    uint16_t length;
+    uint32_t crc32;     /* over seq, version, length and the blob */
+} bsec_record_hdr_t;
 
 typedef struct __attribute__((packed))
 {
@@ -28,101 +59,288 @@ typedef struct __attribute__((packed))
     uint32_t crc32;
     uint32_t save_count;
     uint8_t  reserved[12];
-} bsec_state_hdr_t;
+} bsec_legacy_hdr_t;
+
+#define RECORD_SIZE(len)     ((sizeof(bsec_record_hdr_t) + (uint32_t)(len) + 3u) & ~3u)
+#define RECORD_MAX_WORDS     (RECORD_SIZE(BSEC_MAX_STATE_BLOB_SIZE) / 4u)
+
+/*
+ * New records start on a quad-word boundary, so the Flash Manager programs them
+ * with bursts and only the last 0..3 words one by one (the header is exactly one
+ * quad-word and still lands first). The gap up to the boundary stays erased.
+ * A build with 4 writes the word-packed logs of the earlier layout.
+ */
+#ifndef BSEC_BURST_SIZE
+#define BSEC_BURST_SIZE      (16u)
+#endif
+#define BURST_ALIGN(off)     (((uint32_t)(off) + BSEC_BURST_SIZE - 1u) & ~(BSEC_BURST_SIZE - 1u))
+
+typedef enum
+{
+    JOB_IDLE = 0,
+    JOB_ERASE,          /* erasing s_job_page before appending to it */
+    JOB_WRITE           /* programming s_job_buf at s_job_addr */
+} bsec_job_t;
 
 static uint32_t s_last_save_ms = 0;
-static uint32_t s_save_count_cache = 0;
 
-static uint32_t crc32_sw(const uint8_t *data, uint32_t len)
+/* Log position found by the boot scan, then advanced by every save */
+static uint32_t s_seq = 0;          /* sequence number of the newest valid record */
+static uint32_t s_newest_addr = 0;  /* 0: log is empty */
+static uint8_t  s_page = 0;         /* page being appended to */
+static uint32_t s_offset = 0;       /* next free byte in s_page */
+
+/* Save job; advanced by the Flash Manager callback (sequencer task context) */
+static FM_CallbackNode_t s_fm_node;
+static bsec_job_t s_job = JOB_IDLE;
+static HAL_StatusTypeDef s_job_result = HAL_BUSY; /* finished job not yet reported */
+static uint8_t  s_job_page = 0;
+static uint32_t s_job_addr = 0;
+static uint32_t s_job_size = 0;
+static uint32_t s_job_buf[RECORD_MAX_WORDS]; /* header + blob; read by the Flash Manager */
+
+static uint32_t record_crc(const bsec_record_hdr_t *hdr, const uint8_t *blob)
 {
-    uint32_t crc = 0xFFFFFFFFu;
-    for (uint32_t i = 0; i < len; i++)
-    {
-        crc ^= data[i];
-        for (uint32_t b = 0; b < 8; b++)
-        {
-            uint32_t mask = -(crc & 1u);
-            crc = (crc >> 1) ^ (0xEDB88320u & mask);
-        }
-    }
-    return ~crc;
+    uint32_t crc = CRC32_INIT;
+    crc = crc32_update(crc, &hdr->seq,
+                       (uint32_t)(offsetof(bsec_record_hdr_t, crc32) - offsetof(bsec_record_hdr_t, seq)));
+    crc = crc32_update(crc, blob, hdr->length);
+    return crc32_final(crc);
 }
 
-static const bsec_state_hdr_t* hdr_ptr(void)
+static uint32_t page_addr(uint8_t page)
 {
-    return (const bsec_state_hdr_t*)BSEC_STORE_ADDR;
+    return BSEC_STORE_ADDR + (uint32_t)page * BSEC_FLASH_PAGE_SIZE;
 }
 
-static const uint8_t* blob_ptr(void)
+static uint8_t region_is_erased(uint32_t addr, uint32_t len)
 {
-    return (const uint8_t*)(BSEC_STORE_ADDR + sizeof(bsec_state_hdr_t));
+    const uint32_t *w = (const uint32_t*)addr;
+    for (uint32_t i = 0; i < len / 4u; i++)
+    {
+        if (w[i] != BSEC_ERASED_WORD) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Walk one page's records. Tracks the newest valid record and returns the offset
+ * of the first erased header slot, or the page size when the rest of the page
+ * cannot be trusted (torn header, foreign data).
+ */
+static uint32_t scan_page(uint8_t page)
+{
+    const uint32_t base = page_addr(page);
+    uint32_t off = 0;
+
+    while ((off + sizeof(bsec_record_hdr_t)) <= BSEC_FLASH_PAGE_SIZE)
+    {
+        const bsec_record_hdr_t *hdr = (const bsec_record_hdr_t*)(base + off);
+
+        if (hdr->magic == BSEC_ERASED_WORD)
+        {
+            /* In the gap after a record: the next one, if any, is on the boundary.
+             * Logs written before the alignment pack records on words and never get here. */
+            uint32_t next = BURST_ALIGN(off);
+            if (next == off || (next + sizeof(bsec_record_hdr_t)) > BSEC_FLASH_PAGE_SIZE ||
+                *(const uint32_t*)(base + next) == BSEC_ERASED_WORD)
+            {
+                return off;
+            }
+            off = next;
+            continue;
+        }
+
+        if (hdr->magic != BSEC_RECORD_MAGIC ||
+            hdr->length == 0u || hdr->length > BSEC_MAX_STATE_BLOB_SIZE ||
+            (off + RECORD_SIZE(hdr->length)) > BSEC_FLASH_PAGE_SIZE)
+        {
+            return BSEC_FLASH_PAGE_SIZE;
+        }
+
+        /* Torn or stale blobs only lose this record; the length still lets us skip it */
+        const uint8_t *blob = (const uint8_t*)(base + off + sizeof(bsec_record_hdr_t));
+        if (hdr->version == BSEC_RECORD_VERSION &&
+            record_crc(hdr, blob) == hdr->crc32 &&
+            (s_newest_addr == 0u || (int32_t)(hdr->seq - s_seq) > 0))
+        {
+            s_seq = hdr->seq;
+            s_newest_addr = base + off;
+            s_page = page;
+        }
+
+        off += RECORD_SIZE(hdr->length);
+    }
+
+    return BSEC_FLASH_PAGE_SIZE;
 }
 
 HAL_StatusTypeDef bsec_state_store_init(void)
 {
     if ((BSEC_STORE_ADDR % BSEC_FLASH_PAGE_SIZE) != 0u) return HAL_ERROR;
-    if (sizeof(bsec_state_hdr_t) >= BSEC_FLASH_PAGE_SIZE) return HAL_ERROR;
+    if (BSEC_STORE_NUM_PAGES < 2u || BSEC_STORE_NUM_PAGES > 255u) return HAL_ERROR;
+    if (RECORD_SIZE(BSEC_MAX_STATE_BLOB_SIZE) > BSEC_FLASH_PAGE_SIZE) return HAL_ERROR;
+
+    uint32_t free_off[BSEC_STORE_NUM_PAGES];
+
+    s_seq = 0;
+    s_newest_addr = 0;
+    s_page = 0;
+    for (uint8_t p = 0; p < BSEC_STORE_NUM_PAGES; p++)
+    {
+        free_off[p] = scan_page(p);
+    }
+
+    /* Empty log: start at page 0; a non-blank page 0 rolls over on the first save */
+    s_offset = free_off[s_page];
     return HAL_OK;
 }
 
-static HAL_StatusTypeDef flash_erase_one_page(uint32_t page_start_addr)
+static uint32_t page_index(uint32_t addr)
 {
-    FLASH_EraseInitTypeDef erase = {0};
-    uint32_t page_error = 0;
+    return (addr - BSEC_FLASH_BASE) / BSEC_FLASH_PAGE_SIZE;
+}
 
-    const uint32_t flash_base = 0x10040000u;
-    uint32_t page = (page_start_addr - flash_base) / BSEC_FLASH_PAGE_SIZE;
+static void job_finish(HAL_StatusTypeDef result)
+{
+    s_job = JOB_IDLE;
+    s_job_result = result;
+}
+
+/* Hand the current step to the Flash Manager; if it is busy, fm_callback() retries */
+static void job_issue(void)
+{
+    FM_Cmd_Status_t st;
 
-    erase.TypeErase = FLASH_TYPEERASE_PAGES;
-    erase.Page = page;
-    erase.NbPages = 1;
+    if (s_job == JOB_ERASE)
+    {
+        st = FM_Erase(page_index(page_addr(s_job_page)), 1u, &s_fm_node);
+    }
+    else
+    {
+        st = FM_Write(s_job_buf, (uint32_t*)s_job_addr, (int32_t)(s_job_size / 4u), &s_fm_node);
+    }
 
-    return HAL_FLASHEx_Erase(&erase, &page_error);
+    if (st == FM_ERROR) job_finish(HAL_ERROR);
 }
 
-static HAL_StatusTypeDef flash_program_words(uint32_t dst_addr, const uint8_t *src, uint32_t len)
+static void fm_callback(FM_FlashOp_Status_t status)
 {
-    /* WB0x HAL programs 32-bit words */
-    for (uint32_t i = 0; i < len; i += 4)
+    if (s_job == JOB_IDLE) return;
+
+    if (status == FM_OPERATION_AVAILABLE)
     {
-        uint32_t w = 0xFFFFFFFFu;
-        uint32_t chunk = (len - i) >= 4 ? 4 : (len - i);
-        memcpy(&w, &src[i], chunk);
+        job_issue();
+        return;
+    }
 
-        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, dst_addr + i, w) != HAL_OK)
-        {
-            return HAL_ERROR;
-        }
+    if (s_job == JOB_ERASE)
+    {
+        s_page = s_job_page;
+        s_offset = s_job_size;
+        s_job_addr = page_addr(s_page);
+        s_job = JOB_WRITE;
+        job_issue();
+        return;
     }
-    return HAL_OK;
+
+    /* The Flash Manager retries until the write lands; read back to catch a bad cell */
+    if (memcmp((const void*)s_job_addr, s_job_buf, s_job_size) != 0)
+    {
+        job_finish(HAL_ERROR);
+        return;
+    }
+
+    s_seq = ((const bsec_record_hdr_t*)s_job_buf)->seq;
+    s_newest_addr = s_job_addr;
+    job_finish(HAL_OK);
 }
 
-HAL_StatusTypeDef bsec_state_store_load(void *bsec_inst)
+/*
+ * Pick the slot for the next record. Appends to the current page when it fits;
+ * otherwise the job first erases the following page, which holds the oldest
+ * records (the newest one is never on it).
+ */
+static void job_start(uint32_t rec_size)
 {
-    if (!bsec_inst) return HAL_ERROR;
+    uint32_t off = BURST_ALIGN(s_offset);
+
+    s_job_size = rec_size;
 
-    const bsec_state_hdr_t *hdr = hdr_ptr();
+    if ((off + rec_size) <= BSEC_FLASH_PAGE_SIZE &&
+        region_is_erased(page_addr(s_page) + off, rec_size))
+    {
+        /* A failed save still consumes its slot; the next one appends after it */
+        s_job_addr = page_addr(s_page) + off;
+        s_offset = off + rec_size;
+        s_job = JOB_WRITE;
+    }
+    else
+    {
+        s_job_page = (uint8_t)((s_page + 1u) % BSEC_STORE_NUM_PAGES);
+        s_job = JOB_ERASE;
+    }
+
+    s_fm_node.Callback = fm_callback;
+    job_issue();
+}
+
+static HAL_StatusTypeDef load_legacy(void *bsec_inst, uint8_t *workbuf, uint32_t workbuf_len)
+{
+    const bsec_legacy_hdr_t *hdr = (const bsec_legacy_hdr_t*)BSEC_LEGACY_ADDR;
 
-    if (hdr->magic != BSEC_STATE_MAGIC) return HAL_ERROR;
-    if (hdr->version != BSEC_STATE_VERSION) return HAL_ERROR;
+    if (hdr->magic != BSEC_LEGACY_MAGIC) return HAL_ERROR;
+    if (hdr->version != BSEC_LEGACY_VERSION) return HAL_ERROR;
     if (hdr->length == 0u || hdr->length > BSEC_MAX_STATE_BLOB_SIZE) return HAL_ERROR;
 
-    const uint8_t *blob = blob_ptr();
-    if (crc32_sw(blob, hdr->length) != hdr->crc32) return HAL_ERROR;
+    const uint8_t *blob = (const uint8_t*)(BSEC_LEGACY_ADDR + sizeof(bsec_legacy_hdr_t));
+    if (crc32_calc(blob, hdr->length) != hdr->crc32) return HAL_ERROR;
 
-    static uint8_t workbuf[BSEC_MAX_WORKBUFFER_SIZE];
-    bsec_library_return_t br = bsec_set_state(bsec_inst, blob, hdr->length, workbuf, sizeof(workbuf));
+    if (bsec_set_state(bsec_inst, blob, hdr->length, workbuf, workbuf_len) != BSEC_OK) return HAL_ERROR;
+
+    s_seq = hdr->save_count;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef bsec_state_store_load(void *bsec_inst, uint8_t *workbuf, uint32_t workbuf_len)
+{
+    if (!bsec_inst || !workbuf) return HAL_ERROR;
+
+    if (s_newest_addr == 0u)
+    {
+        return load_legacy(bsec_inst, workbuf, workbuf_len);
+    }
+
+    const bsec_record_hdr_t *hdr = (const bsec_record_hdr_t*)s_newest_addr;
+    const uint8_t *blob = (const uint8_t*)(s_newest_addr + sizeof(bsec_record_hdr_t));
+
+    bsec_library_return_t br = bsec_set_state(bsec_inst, blob, hdr->length, workbuf, workbuf_len);
     if (br != BSEC_OK) return HAL_ERROR;
 
-    s_save_count_cache = hdr->save_count;
     return HAL_OK;
 }
 
 HAL_StatusTypeDef bsec_state_store_maybe_save(void *bsec_inst,
+                                              uint8_t *workbuf,
+                                              uint32_t workbuf_len,
                                               uint32_t now_ms,
                                               uint32_t save_period_ms)
 {
-    if (!bsec_inst) return HAL_ERROR;
+    if (!bsec_inst || !workbuf) return HAL_ERROR;
+
+    if (s_job != JOB_IDLE)
+    {
+        /* Previous save still waiting for a radio-idle window */
+        return HAL_BUSY;
+    }
+
+    if (s_job_result != HAL_BUSY)
+    {
+        /* Report the finished save once */
+        HAL_StatusTypeDef result = s_job_result;
+        s_job_result = HAL_BUSY;
+        return result;
+    }
 
     if (s_last_save_ms == 0u)
     {
@@ -137,36 +355,40 @@ HAL_StatusTypeDef bsec_state_store_maybe_save(void *bsec_inst,
         return HAL_BUSY;
     }
 
-    uint8_t state[BSEC_MAX_STATE_BLOB_SIZE];
+    /* The blob is serialized straight into the record that gets programmed */
+    uint8_t *blob = (uint8_t*)s_job_buf + sizeof(bsec_record_hdr_t);
     uint32_t n_state = 0;
-    static uint8_t workbuf[BSEC_MAX_WORKBUFFER_SIZE];
 
     bsec_library_return_t br = bsec_get_state(bsec_inst,
                                               0,
-                                              state,
-                                              sizeof(state),
+                                              blob,
+                                              BSEC_MAX_STATE_BLOB_SIZE,
                                               workbuf,
-                                              sizeof(workbuf),
+                                              workbuf_len,
                                               &n_state);
     if (br != BSEC_OK) return HAL_ERROR;
     if (n_state == 0u || n_state > BSEC_MAX_STATE_BLOB_SIZE) return HAL_ERROR;
 
-    bsec_state_hdr_t hdr = {0};
-    hdr.magic = BSEC_STATE_MAGIC;
-    hdr.version = BSEC_STATE_VERSION;
+    bsec_record_hdr_t hdr = {0};
+    hdr.magic = BSEC_RECORD_MAGIC;
+    hdr.seq = s_seq + 1u;
+    hdr.version = BSEC_RECORD_VERSION;
     hdr.length = (uint16_t)n_state;
-    hdr.crc32 = crc32_sw(state, n_state);
-    hdr.save_count = ++s_save_count_cache;
+    hdr.crc32 = record_crc(&hdr, blob);
+    memcpy(s_job_buf, &hdr, sizeof(hdr));
 
-    uint8_t page[BSEC_FLASH_PAGE_SIZE];
-    memset(page, 0xFF, sizeof(page));
-    memcpy(page, &hdr, sizeof(hdr));
-    memcpy(page + sizeof(hdr), state, n_state);
+    /* Pad bytes stay erased */
+    uint32_t rec_size = RECORD_SIZE(n_state);
+    memset(blob + n_state, 0xFF, rec_size - sizeof(hdr) - n_state);
 
-    if (flash_erase_one_page(BSEC_STORE_ADDR) != HAL_OK) return HAL_ERROR;
-    if (flash_program_words(BSEC_STORE_ADDR, page, sizeof(page)) != HAL_OK) return HAL_ERROR;
-
-    /* Save completed */
     s_last_save_ms = now_ms;
-    return HAL_OK;
+    job_start(rec_size);
+
+    if (s_job == JOB_IDLE)
+    {
+        /* Rejected by the Flash Manager right away */
+        s_job_result = HAL_BUSY;
+        return HAL_ERROR;
+    }
+    return HAL_BUSY;
 }
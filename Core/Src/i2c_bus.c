@@ -0,0 +1,260 @@
+#include "i2c_bus.h"
+
+#include <string.h>
+
+#include "app_conf.h"
+#include "stm32_seq.h"
+#include "utilities_conf.h"
+
+// Interrupt-driven I2C transaction queue shared by the BME690s and the BMA456.
+// Uses the DMA variants when a DMA channel is linked to the handle, IT otherwise.
+// A timed-out transaction is only flagged from SysTick; the peripheral reset
+// runs in CFG_TASK_I2C_BUS or in the blocking waiter, never in an ISR.
+
+static I2C_HandleTypeDef *s_hi2c = NULL;
+
+static i2c_bus_xfer_t *s_queue[I2C_BUS_QUEUE_LEN];
+static volatile uint8_t s_head = 0;
+static volatile uint8_t s_count = 0;
+static volatile uint8_t s_active = 0; // head transaction is on the wire
+static volatile uint8_t s_timed_out = 0; // head timed out, peripheral reset pending
+
+static uint8_t in_isr(void)
+{
+    return (__get_IPSR() != 0u) ? 1u : 0u;
+}
+
+// Whether SysTick, and so HAL_GetTick(), can advance while the caller runs:
+// not with interrupts masked, nor in an ISR of the same or higher priority
+static uint8_t tick_runs(void)
+{
+    uint32_t ipsr = __get_IPSR();
+
+    if (__get_PRIMASK() != 0u) return 0u;
+    if (ipsr == 0u) return 1u;
+    if (ipsr < 11u) return 0u; // NMI, HardFault
+    return (NVIC_GetPriority(SysTick_IRQn) < NVIC_GetPriority((IRQn_Type)((int32_t)ipsr - 16))) ? 1u : 0u;
+}
+
+static HAL_StatusTypeDef start_hw(i2c_bus_xfer_t *x)
+{
+    if (x->dir == I2C_BUS_READ)
+    {
+        if (s_hi2c->hdmarx)
+        {
+            return HAL_I2C_Mem_Read_DMA(s_hi2c, x->dev_addr_8bit, x->reg_addr,
+                                        I2C_MEMADD_SIZE_8BIT, x->data, x->len);
+        }
+        return HAL_I2C_Mem_Read_IT(s_hi2c, x->dev_addr_8bit, x->reg_addr,
+                                   I2C_MEMADD_SIZE_8BIT, x->data, x->len);
+    }
+
+    if (s_hi2c->hdmatx)
+    {
+        return HAL_I2C_Mem_Write_DMA(s_hi2c, x->dev_addr_8bit, x->reg_addr,
+                                     I2C_MEMADD_SIZE_8BIT, x->data, x->len);
+    }
+    return HAL_I2C_Mem_Write_IT(s_hi2c, x->dev_addr_8bit, x->reg_addr,
+                                I2C_MEMADD_SIZE_8BIT, x->data, x->len);
+}
+
+// Pop the head and report its result. Caller has interrupts masked or is the I2C ISR.
+static void finish_head(HAL_StatusTypeDef status)
+{
+    i2c_bus_xfer_t *x = s_queue[s_head];
+
+    s_queue[s_head] = NULL;
+    s_head = (uint8_t)((s_head + 1u) % I2C_BUS_QUEUE_LEN);
+    s_count--;
+    s_active = 0;
+
+    x->status = status;
+    if (x->done)
+    {
+        x->done(status, x->user);
+    }
+}
+
+// Start the next queued transaction if the bus is free
+static void kick(void)
+{
+    while (!s_active && !s_timed_out && s_count)
+    {
+        i2c_bus_xfer_t *x = s_queue[s_head];
+
+        x->start_ms = HAL_GetTick();
+        s_active = 1;
+        if (start_hw(x) == HAL_OK)
+        {
+            return;
+        }
+        finish_head(HAL_ERROR);
+    }
+}
+
+// Device is holding the bus or never ACKed: reset the peripheral so the
+// transactions queued behind the timed-out one still get their turn.
+// Thread context only; the completion callbacks ignore the dead transfer.
+static void recover(void)
+{
+    if (!s_timed_out) return;
+
+    (void)HAL_I2C_DeInit(s_hi2c);
+    (void)HAL_I2C_Init(s_hi2c);
+
+    UTILS_ENTER_CRITICAL_SECTION();
+    s_timed_out = 0;
+    finish_head(HAL_TIMEOUT);
+    kick();
+    UTILS_EXIT_CRITICAL_SECTION();
+}
+
+static void i2c_bus_task(void)
+{
+    recover();
+}
+
+HAL_StatusTypeDef i2c_bus_init(I2C_HandleTypeDef *hi2c)
+{
+    if (!hi2c) return HAL_ERROR;
+
+    s_hi2c = hi2c;
+    memset(s_queue, 0, sizeof(s_queue));
+    s_head = 0;
+    s_count = 0;
+    s_active = 0;
+    s_timed_out = 0;
+    UTIL_SEQ_RegTask(1U << CFG_TASK_I2C_BUS, UTIL_SEQ_RFU, i2c_bus_task);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef i2c_bus_submit(i2c_bus_xfer_t *x)
+{
+    if (!s_hi2c || !x || !x->data || x->len == 0u) return HAL_ERROR;
+
+    UTILS_ENTER_CRITICAL_SECTION();
+    if (s_count >= I2C_BUS_QUEUE_LEN)
+    {
+        UTILS_EXIT_CRITICAL_SECTION();
+        return HAL_BUSY;
+    }
+
+    x->status = HAL_BUSY;
+    s_queue[(s_head + s_count) % I2C_BUS_QUEUE_LEN] = x;
+    s_count++;
+    kick();
+    UTILS_EXIT_CRITICAL_SECTION();
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef i2c_bus_transfer(uint16_t dev_addr_8bit, uint8_t reg_addr, i2c_bus_dir_t dir,
+                                   uint8_t *data, uint16_t len, uint32_t timeout_ms)
+{
+    if (!s_hi2c) return HAL_ERROR;
+
+    if (in_isr() || __get_PRIMASK() != 0u)
+    {
+        // The I2C IRQ cannot preempt us here, so an IT transfer would never complete.
+        // The polled transfer times out on HAL_GetTick(), so it needs SysTick to
+        // preempt us, and it is only usable when nothing is queued: it then owns the bus.
+        if (!tick_runs()) return HAL_ERROR;
+        if (s_count) return HAL_BUSY;
+
+        if (dir == I2C_BUS_READ)
+        {
+            return HAL_I2C_Mem_Read(s_hi2c, dev_addr_8bit, reg_addr, I2C_MEMADD_SIZE_8BIT,
+                                    data, len, timeout_ms);
+        }
+        return HAL_I2C_Mem_Write(s_hi2c, dev_addr_8bit, reg_addr, I2C_MEMADD_SIZE_8BIT,
+                                 data, len, timeout_ms);
+    }
+
+    i2c_bus_xfer_t x = {0};
+    x.dev_addr_8bit = dev_addr_8bit;
+    x.reg_addr = reg_addr;
+    x.dir = (uint8_t)dir;
+    x.data = data;
+    x.len = len;
+    x.timeout_ms = timeout_ms;
+
+    HAL_StatusTypeDef st = i2c_bus_submit(&x);
+    if (st != HAL_OK) return st;
+
+    // Sleep until the completion IRQ; WFI still wakes with PRIMASK set,
+    // so checking and sleeping under the mask cannot miss the wakeup.
+    // CFG_TASK_I2C_BUS cannot run while we block its task, so a timeout
+    // flagged by SysTick is recovered here.
+    for (;;)
+    {
+        recover();
+        UTILS_ENTER_CRITICAL_SECTION();
+        if (x.status != HAL_BUSY)
+        {
+            UTILS_EXIT_CRITICAL_SECTION();
+            break;
+        }
+        if (!s_timed_out)
+        {
+            __WFI();
+        }
+        UTILS_EXIT_CRITICAL_SECTION();
+    }
+
+    return x.status;
+}
+
+void i2c_bus_tick(void)
+{
+    if (!s_active || s_timed_out) return;
+
+    UTILS_ENTER_CRITICAL_SECTION();
+    if (s_active && !s_timed_out && s_count)
+    {
+        i2c_bus_xfer_t *x = s_queue[s_head];
+        if ((HAL_GetTick() - x->start_ms) > x->timeout_ms)
+        {
+            // HAL_I2C_DeInit/Init do not belong in an ISR: leave the reset to recover()
+            s_timed_out = 1;
+            UTIL_SEQ_SetTask(1U << CFG_TASK_I2C_BUS, CFG_SEQ_PRIO_0);
+        }
+    }
+    UTILS_EXIT_CRITICAL_SECTION();
+}
+
+uint32_t i2c_bus_idle_ms(uint32_t now_ms)
+{
+    uint32_t left = UINT32_MAX;
+
+    UTILS_ENTER_CRITICAL_SECTION();
+    if (s_active && !s_timed_out && s_count)
+    {
+        const i2c_bus_xfer_t *x = s_queue[s_head];
+        uint32_t elapsed = now_ms - x->start_ms;
+        left = (elapsed > x->timeout_ms) ? 0u : (x->timeout_ms - elapsed + 1u);
+    }
+    UTILS_EXIT_CRITICAL_SECTION();
+    return left;
+}
+
+/* HAL completion callbacks (weak in the HAL driver) */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c != s_hi2c || !s_active || s_timed_out) return;
+    finish_head(HAL_OK);
+    kick();
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c != s_hi2c || !s_active || s_timed_out) return;
+    finish_head(HAL_OK);
+    kick();
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c != s_hi2c || !s_active || s_timed_out) return;
+    finish_head(HAL_ERROR);
+    kick();
+}
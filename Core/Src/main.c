@@ -26,6 +26,9 @@
 
 #include "air_app.h"
 #include "bma456_app.h"
+#include "i2c_bus.h"
+#include "telemetry.h"
+#include "us_delay.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -119,15 +122,22 @@ int main(void)
   /* USER CODE BEGIN 2 */
   MX_USART1_UART_Init();
 
+  /* All sensors share I2C1 through the interrupt-driven transaction queue */
+  i2c_bus_init(&hi2c1);
 
+  /* Sensor init times, reported as a TLM_DIAG_BOOT_INIT record once telemetry is up */
+  uint32_t boot_t0 = us_delay_stamp();
   if (air_app_init(&hi2c1, &huart1) != HAL_OK)
     {
       /* simple fault indication */
       HAL_Delay(200);
     }
+  uint32_t boot_air_us = us_delay_stamp() - boot_t0;
 
   /* Initialize BMA456 accelerometer for impact detection */
+  boot_t0 = us_delay_stamp();
   HAL_StatusTypeDef bma_status = bma456_app_init(&hi2c1, &huart1);
+  uint32_t boot_bma_us = us_delay_stamp() - boot_t0;
   if (bma_status != HAL_OK)
     {
       /* BMA456 initialization failed - continue anyway */
@@ -149,10 +159,14 @@ int main(void)
                      HAL_GPIO_ReadPin(LED_YELLO_GPIO_Port, LED_YELLO_Pin));
   HAL_UART_Transmit(&huart1, (uint8_t*)led_msg, (uint16_t)len, 200);
 
+  /* Boot log above is plain text; from here on USART1 carries binary telemetry frames */
+  telemetry_init();
+  (void)telemetry_diag(TLM_DIAG_BOOT_INIT, boot_air_us, boot_bma_us);
+
   /* USER CODE END 2 */
 
   /* Init code for STM32_BLE */
-  //MX_APPE_Init(NULL);
+  MX_APPE_Init(NULL);
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
@@ -160,11 +174,15 @@ int main(void)
   while (1)
   {
     /* USER CODE END WHILE */
-    //MX_APPE_Process();
+    MX_APPE_Process();
 
     /* USER CODE BEGIN 3 */
-	  air_app_process();
-	      HAL_Delay(10); // small idle delay; BSEC scheduling still works
+#if (CFG_LPM_SUPPORTED == 0)
+    /* No low power manager: sleep until the next interrupt, with SysTick stopped
+       and a radio timer wakeup when nothing needs the 1 kHz tick before the
+       next deadline (see APPE_Idle()). */
+    APPE_Idle();
+#endif /* CFG_LPM_SUPPORTED */
   }
   /* USER CODE END 3 */
 }
@@ -26,8 +26,11 @@
 #include "stm32wb0x_ll_usart.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-#include <stdio.h>
 #include "bma456_app.h"
+#include "air_app.h"
+#include "i2c_bus.h"
+#include "telemetry.h"
+#include "app_entry.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -137,6 +140,11 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
+  air_app_tick();
+  i2c_bus_tick();
+  telemetry_tick();
+  bma456_app_tick();
+  APPE_FlashManagerTick();
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -203,11 +211,11 @@ void TIM16_IRQHandler(void)
 void GPIOA_IRQHandler(void)
 {
   /* USER CODE BEGIN GPIOA_IRQn 0 */
-
+  uint32_t isr_start = SysTick->VAL;
   /* USER CODE END GPIOA_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GPIOA,GPIO_PIN_9);
   /* USER CODE BEGIN GPIOA_IRQn 1 */
-
+  bma456_app_isr_record(isr_start, SysTick->VAL);
   /* USER CODE END GPIOA_IRQn 1 */
 }
 
@@ -291,17 +299,9 @@ void RADIO_RRM_IRQHandler(void)
   */
 void HAL_GPIO_EXTI_Callback(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
 {
-  /* Debug: Check which GPIO triggered */
-  extern UART_HandleTypeDef huart1;
-  char msg[60];
-  int len = snprintf(msg, sizeof(msg), "[EXTI] Port=%p Pin=%d\r\n", (void*)GPIOx, GPIO_Pin);
-  HAL_UART_Transmit(&huart1, (uint8_t*)msg, (uint16_t)len, 200);
-  
   if (GPIOx == GPIOA && GPIO_Pin == GPIO_PIN_9) {
-    /* BMA456 INT1 interrupt on PA9 */
-    len = snprintf(msg, sizeof(msg), "[EXTI] Calling BMA456 handler\r\n");
-    HAL_UART_Transmit(&huart1, (uint8_t*)msg, (uint16_t)len, 200);
-    bma456_app_handle_interrupt();
+    /* BMA456 INT1 interrupt on PA9: timestamp and defer to CFG_TASK_BMA456 */
+    bma456_app_irq_notify();
   }
 }
 
@@ -0,0 +1,237 @@
+#include "telemetry.h"
+
+#include <string.h>
+
+#include "stm32_seq.h"
+#include "utilities_conf.h"
+#include "usart_if.h"
+#include "spsc_ring.h"
+#include "crc_calc.h"
+
+#if TELEMETRY_ENABLE
+
+#define FRAME_HDR_LEN   (6u)    // seq + ts_ms
+#define REC_HDR_LEN     (4u)    // type + len + dt_ms
+#define CRC_LEN         (2u)
+// COBS overhead (one code byte per 254 data bytes, plus the first) and the 0x00 delimiter
+#define ENC_MAX         (TELEMETRY_FRAME_MAX + TELEMETRY_FRAME_MAX / 254u + 2u)
+
+// Open frame; only touched from sequencer tasks (telemetry_tick just peeks)
+static uint8_t s_frame[TELEMETRY_FRAME_MAX];
+static volatile uint16_t s_frame_len = 0; // 0 = no open frame
+static volatile uint32_t s_frame_ts = 0;
+static uint16_t s_seq = 0;
+
+// Encoded bytes for the UART: tasks produce, the TX complete interrupt consumes
+static uint8_t s_ring_buf[TELEMETRY_RING_SIZE];
+static spsc_ring_t s_ring;
+static volatile uint16_t s_tx_len = 0; // bytes handed to the UART, 0 = idle
+
+static uint8_t s_ready = 0;
+static telemetry_stats_t s_stats;
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+// Consistent Overhead Byte Stuffing: output has no 0x00, so 0x00 delimits frames
+static uint16_t cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst)
+{
+    uint16_t code_idx = 0;
+    uint16_t out = 1;
+    uint8_t code = 1;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (src[i] == 0u)
+        {
+            dst[code_idx] = code;
+            code_idx = out++;
+            code = 1;
+            continue;
+        }
+
+        dst[out++] = src[i];
+        if (++code == 0xFFu)
+        {
+            dst[code_idx] = code;
+            code_idx = out++;
+            code = 1;
+        }
+    }
+    dst[code_idx] = code;
+    return out;
+}
+
+// Hand the next contiguous chunk of the ring to the UART. Interrupts masked or TX ISR.
+static void kick(void)
+{
+    void *p;
+    uint16_t n;
+
+    if (s_tx_len) return;
+
+    n = spsc_ring_peek(&s_ring, &p);
+    if (n == 0u) return;
+
+    s_tx_len = n;
+    if (UART_TransmitDMA((uint8_t *)p, n) != UTIL_ADV_TRACE_OK)
+    {
+        s_tx_len = 0; // UART busy elsewhere; retried on the next flush
+    }
+}
+
+static void close_frame(void)
+{
+    static uint8_t enc[ENC_MAX];
+    uint16_t len = s_frame_len;
+    uint16_t n;
+    uint16_t crc;
+
+    if (len == 0u) return;
+
+    crc = crc16_ccitt_calc(s_frame, len);
+    put_u16(&s_frame[len], crc);
+    len += CRC_LEN;
+
+    n = cobs_encode(s_frame, len, enc);
+    enc[n++] = 0x00;
+    s_frame_len = 0;
+
+    if (spsc_ring_write(&s_ring, enc, n) == 0u) return; // full: counted in the ring's drops
+
+    s_stats.frames++;
+    s_stats.bytes += n;
+
+    UTILS_ENTER_CRITICAL_SECTION();
+    kick();
+    UTILS_EXIT_CRITICAL_SECTION();
+}
+
+static void telemetry_task(void)
+{
+    telemetry_flush();
+}
+
+HAL_StatusTypeDef telemetry_init(void)
+{
+    static const uint8_t delim = 0x00;
+
+    s_frame_len = 0;
+    s_seq = 0;
+    s_tx_len = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    (void)spsc_ring_init(&s_ring, s_ring_buf, 1u, TELEMETRY_RING_SIZE);
+
+    UTIL_SEQ_RegTask(1U << CFG_TASK_TELEMETRY, UTIL_SEQ_RFU, telemetry_task);
+    s_ready = 1;
+
+    // Leading delimiter separates the ASCII boot log from the first frame
+    (void)spsc_ring_write(&s_ring, &delim, 1u);
+    UTILS_ENTER_CRITICAL_SECTION();
+    kick();
+    UTILS_EXIT_CRITICAL_SECTION();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef telemetry_put(uint8_t type, const void *payload, uint8_t len)
+{
+    uint32_t now;
+    uint32_t dt;
+    uint16_t pos;
+
+    if (!s_ready) return HAL_ERROR;
+    if (len > TELEMETRY_FRAME_MAX - FRAME_HDR_LEN - REC_HDR_LEN - CRC_LEN) return HAL_ERROR;
+
+    if (s_frame_len && (s_frame_len + REC_HDR_LEN + len + CRC_LEN) > TELEMETRY_FRAME_MAX)
+    {
+        close_frame();
+    }
+
+    now = HAL_GetTick();
+    if (s_frame_len == 0u)
+    {
+        put_u16(&s_frame[0], s_seq++);
+        put_u32(&s_frame[2], now);
+        s_frame_ts = now;
+        s_frame_len = FRAME_HDR_LEN;
+    }
+
+    dt = now - s_frame_ts;
+    if (dt > 0xFFFFu) dt = 0xFFFFu;
+
+    pos = s_frame_len;
+    s_frame[pos++] = type;
+    s_frame[pos++] = len;
+    put_u16(&s_frame[pos], (uint16_t)dt);
+    pos += 2u;
+    memcpy(&s_frame[pos], payload, len);
+    s_frame_len = (uint16_t)(pos + len);
+
+    s_stats.records++;
+    return HAL_OK;
+}
+
+void telemetry_flush(void)
+{
+    close_frame();
+}
+
+void telemetry_tick(void)
+{
+    if (s_ready && s_frame_len && (HAL_GetTick() - s_frame_ts) >= TELEMETRY_BATCH_MS)
+    {
+        UTIL_SEQ_SetTask(1U << CFG_TASK_TELEMETRY, CFG_SEQ_PRIO_1);
+    }
+}
+
+uint32_t telemetry_idle_ms(uint32_t now_ms)
+{
+    uint32_t age;
+
+    if (!s_ready || !s_frame_len) return UINT32_MAX;
+    age = now_ms - s_frame_ts;
+    return (age >= TELEMETRY_BATCH_MS) ? 0u : (TELEMETRY_BATCH_MS - age);
+}
+
+void telemetry_tx_cplt(void)
+{
+    spsc_ring_consume(&s_ring, s_tx_len);
+    s_tx_len = 0;
+    kick();
+}
+
+void telemetry_get_stats(telemetry_stats_t *out)
+{
+    if (!out) return;
+
+    UTILS_ENTER_CRITICAL_SECTION();
+    *out = s_stats;
+    out->dropped = s_ring.drops;
+    out->ring_high_water = s_ring.high_water;
+    UTILS_EXIT_CRITICAL_SECTION();
+}
+
+#else /* TELEMETRY_ENABLE */
+
+HAL_StatusTypeDef telemetry_init(void) { return HAL_OK; }
+HAL_StatusTypeDef telemetry_put(uint8_t type, const void *payload, uint8_t len)
+{
+    (void)type; (void)payload; (void)len;
+    return HAL_OK;
+}
+void telemetry_flush(void) {}
+void telemetry_tick(void) {}
+uint32_t telemetry_idle_ms(uint32_t now_ms) { (void)now_ms; return UINT32_MAX; }
+void telemetry_tx_cplt(void) {}
+void telemetry_get_stats(telemetry_stats_t *out) { if (out) memset(out, 0, sizeof(*out)); }
+
+#endif /* TELEMETRY_ENABLE */
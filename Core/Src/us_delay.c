@@ -0,0 +1,79 @@
+#include "us_delay.h"
+
+// SysTick counts down from LOAD to 0 once per HAL tick (1 ms).
+// The cycle and microsecond math below assumes HCLK is a whole number of MHz.
+
+// Longest spin handed to spin_cycles() at once, keeps us * cycles/us in 32 bits
+#define US_DELAY_SPIN_MAX_US (1000000u)
+
+static uint8_t can_sleep(void)
+{
+    if (US_DELAY_SLEEP_MIN_US == 0u) return 0;
+    return (__get_IPSR() == 0u && __get_PRIMASK() == 0u) ? 1u : 0u;
+}
+
+// Count elapsed SysTick cycles between successive reads of the down-counter.
+// Works with interrupts masked as long as nothing stalls the loop for a full tick.
+static void spin_cycles(uint32_t cycles, uint32_t load)
+{
+    uint32_t last = SysTick->VAL;
+
+    while (cycles)
+    {
+        uint32_t now = SysTick->VAL;
+        uint32_t d = (last >= now) ? (last - now) : (last + load + 1u - now);
+
+        last = now;
+        if (d >= cycles) break;
+        cycles -= d;
+    }
+}
+
+uint32_t us_delay_stamp(void)
+{
+    uint32_t load = SysTick->LOAD;
+    uint32_t ms, val, pend;
+
+    // Tick and counter must come from the same millisecond
+    do
+    {
+        ms = HAL_GetTick();
+        val = SysTick->VAL;
+        pend = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+    } while (ms != HAL_GetTick());
+
+    // Counter already reloaded but the tick interrupt cannot run yet (ISR or masked caller)
+    if (pend && val > load / 2u) ms++;
+
+    return ms * 1000u + (load - val) / ((load + 1u) / 1000u);
+}
+
+void us_delay(uint32_t us)
+{
+    uint32_t load = SysTick->LOAD;
+    uint32_t cyc_us = (load + 1u) / 1000u;
+
+    if (us >= US_DELAY_SLEEP_MIN_US && can_sleep())
+    {
+        // Sleep through whole ticks, then spin the last (partial) millisecond
+        uint32_t t0 = us_delay_stamp();
+        for (;;)
+        {
+            uint32_t done = us_delay_stamp() - t0;
+            if (done >= us) return;
+            if (us - done <= 1000u)
+            {
+                us -= done;
+                break;
+            }
+            __WFI();
+        }
+    }
+
+    while (us > US_DELAY_SPIN_MAX_US)
+    {
+        spin_cycles(US_DELAY_SPIN_MAX_US * cyc_us, load);
+        us -= US_DELAY_SPIN_MAX_US;
+    }
+    spin_cycles(us * cyc_us, load);
+}
@@ -61,7 +61,7 @@ typedef struct{
 #define CHARACTERISTIC_DESCRIPTOR_ATTRIBUTE_OFFSET        2
 #define CHARACTERISTIC_VALUE_ATTRIBUTE_OFFSET             1
 #define PWM_C_SIZE        2	/* My PWM Char Characteristic size */
-#define TEMP_C_SIZE        4	/* My Temp Char Characteristic size */
+#define TEMP_C_SIZE        244	/* My Temp Char Characteristic size (ATT_MTU 247 - 3): batched air samples */
 /* USER CODE BEGIN PM */
 
 /* USER CODE END PM */
@@ -281,7 +281,7 @@ static BLEEVT_EvtAckStatus_t P2P_SERVER_EventHandler(aci_blecore_event *p_evt)
       UNUSED(p_exchange_mtu);
 
       /* USER CODE BEGIN ACI_ATT_EXCHANGE_MTU_RESP_VSEVT_CODE */
-
+      P2P_SERVER_APP_SetAttMtu(p_exchange_mtu->Connection_Handle, p_exchange_mtu->MTU);
       /* USER CODE END ACI_ATT_EXCHANGE_MTU_RESP_VSEVT_CODE */
       break;/* ACI_ATT_EXCHANGE_MTU_RESP_VSEVT_CODE */
     }
@@ -29,7 +29,7 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include <string.h>
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -52,14 +52,23 @@ typedef struct
 {
   P2P_SERVER_APP_SendInformation_t     Temp_c_Notification_Status;
   /* USER CODE BEGIN Service1_APP_Context_t */
-
+  uint16_t              AttMtu;
+  uint16_t              BatchSeq;
+  uint16_t              BatchLen;         /* bytes in a_P2P_SERVER_UpdateCharData, 0 = empty */
+  uint8_t               BatchCount;
+  uint32_t              BatchStartMs;
+  air_readings_packed_t LastQueued;
+  uint32_t              LastQueuedMs;
+  uint8_t               HaveLastQueued;
   /* USER CODE END Service1_APP_Context_t */
   uint16_t              ConnectionHandle;
 } P2P_SERVER_APP_Context_t;
 
 /* Private defines -----------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+#define ATT_MTU_DEFAULT         (23U)
+#define AIR_BLE_HDR_LEN         (3U)
+#define AIR_BLE_SAMPLE_LEN      (4U + sizeof(air_readings_packed_t))
 /* USER CODE END PD */
 
 /* External variables --------------------------------------------------------*/
@@ -85,7 +94,9 @@ uint8_t a_P2P_SERVER_UpdateCharData[247];
 static void P2P_SERVER_Temp_c_SendNotification(void);
 
 /* USER CODE BEGIN PFP */
-
+static void AirBatch_Reset(void);
+static uint8_t AirBatch_Capacity(void);
+static uint8_t AirSample_Changed(const air_readings_packed_t *p_Old, const air_readings_packed_t *p_New);
 /* USER CODE END PFP */
 
 /* Functions Definition ------------------------------------------------------*/
@@ -114,13 +125,16 @@ void P2P_SERVER_Notification(P2P_SERVER_NotificationEvt_t *p_Notification)
 
     case P2P_SERVER_TEMP_C_NOTIFY_ENABLED_EVT:
       /* USER CODE BEGIN Service1Char2_NOTIFY_ENABLED_EVT */
-
+      P2P_SERVER_APP_Context.Temp_c_Notification_Status = Temp_c_NOTIFICATION_ON;
+      P2P_SERVER_APP_Context.HaveLastQueued = 0;
+      AirBatch_Reset();
       /* USER CODE END Service1Char2_NOTIFY_ENABLED_EVT */
       break;
 
     case P2P_SERVER_TEMP_C_NOTIFY_DISABLED_EVT:
       /* USER CODE BEGIN Service1Char2_NOTIFY_DISABLED_EVT */
-
+      P2P_SERVER_APP_Context.Temp_c_Notification_Status = Temp_c_NOTIFICATION_OFF;
+      AirBatch_Reset();
       /* USER CODE END Service1Char2_NOTIFY_DISABLED_EVT */
       break;
 
@@ -156,7 +170,9 @@ void P2P_SERVER_APP_EvtRx(P2P_SERVER_APP_ConnHandleNotEvt_t *p_Notification)
     case P2P_SERVER_DISCON_HANDLE_EVT :
       P2P_SERVER_APP_Context.ConnectionHandle = 0xFFFF;
       /* USER CODE BEGIN Service1_APP_DISCON_HANDLE_EVT */
-
+      P2P_SERVER_APP_Context.Temp_c_Notification_Status = Temp_c_NOTIFICATION_OFF;
+      P2P_SERVER_APP_Context.AttMtu = ATT_MTU_DEFAULT;
+      AirBatch_Reset();
       /* USER CODE END Service1_APP_DISCON_HANDLE_EVT */
       break;
 
@@ -180,13 +196,82 @@ void P2P_SERVER_APP_Init(void)
   P2P_SERVER_Init();
 
   /* USER CODE BEGIN Service1_APP_Init */
-
+  P2P_SERVER_APP_Context.Temp_c_Notification_Status = Temp_c_NOTIFICATION_OFF;
+  P2P_SERVER_APP_Context.AttMtu = ATT_MTU_DEFAULT;
+  AirBatch_Reset();
   /* USER CODE END Service1_APP_Init */
   return;
 }
 
 /* USER CODE BEGIN FD */
+/**
+ * @brief  Queue an air sample for the TEMP_C notification (called by air_app)
+ * @param  p_Sample: readings in wire form
+ * @param  TimestampMs: HAL tick of the sample
+ */
+void P2P_SERVER_APP_PushAirSample(const air_readings_packed_t *p_Sample, uint32_t TimestampMs)
+{
+  P2P_SERVER_APP_Context_t *p_ctx = &P2P_SERVER_APP_Context;
+  uint8_t *p_dst;
+
+  if ((p_ctx->Temp_c_Notification_Status == Temp_c_NOTIFICATION_OFF) || (p_ctx->ConnectionHandle == 0xFFFF))
+  {
+    return;
+  }
+
+  /* A partial batch still goes out once it is old enough, even if this sample is dropped */
+  if ((p_ctx->BatchCount != 0U) && ((TimestampMs - p_ctx->BatchStartMs) >= AIR_BLE_BATCH_MAX_MS))
+  {
+    P2P_SERVER_Temp_c_SendNotification();
+  }
+
+  if ((p_ctx->HaveLastQueued != 0U) &&
+      (AirSample_Changed(&p_ctx->LastQueued, p_Sample) == 0U) &&
+      ((TimestampMs - p_ctx->LastQueuedMs) < AIR_BLE_MAX_SILENCE_MS))
+  {
+    return; /* inside the deadband */
+  }
+  p_ctx->LastQueued = *p_Sample;
+  p_ctx->LastQueuedMs = TimestampMs;
+  p_ctx->HaveLastQueued = 1;
+
+  if (p_ctx->BatchCount == 0U)
+  {
+    a_P2P_SERVER_UpdateCharData[0] = (uint8_t)p_ctx->BatchSeq;
+    a_P2P_SERVER_UpdateCharData[1] = (uint8_t)(p_ctx->BatchSeq >> 8);
+    p_ctx->BatchLen = AIR_BLE_HDR_LEN;
+    p_ctx->BatchStartMs = TimestampMs;
+  }
+
+  p_dst = &a_P2P_SERVER_UpdateCharData[p_ctx->BatchLen];
+  p_dst[0] = (uint8_t)TimestampMs;
+  p_dst[1] = (uint8_t)(TimestampMs >> 8);
+  p_dst[2] = (uint8_t)(TimestampMs >> 16);
+  p_dst[3] = (uint8_t)(TimestampMs >> 24);
+  memcpy(&p_dst[4], p_Sample, sizeof(*p_Sample));
+  p_ctx->BatchLen += AIR_BLE_SAMPLE_LEN;
+  p_ctx->BatchCount++;
+  a_P2P_SERVER_UpdateCharData[2] = p_ctx->BatchCount;
+
+  if (p_ctx->BatchCount >= AirBatch_Capacity())
+  {
+    P2P_SERVER_Temp_c_SendNotification();
+  }
+
+  return;
+}
 
+/**
+ * @brief  Record the ATT_MTU negotiated on a connection
+ */
+void P2P_SERVER_APP_SetAttMtu(uint16_t ConnectionHandle, uint16_t Mtu)
+{
+  if (ConnectionHandle == P2P_SERVER_APP_Context.ConnectionHandle)
+  {
+    P2P_SERVER_APP_Context.AttMtu = Mtu;
+  }
+  return;
+}
 /* USER CODE END FD */
 
 /*************************************************************
@@ -203,7 +288,12 @@ __USED void P2P_SERVER_Temp_c_SendNotification(void) /* Property Notification */
   p2p_server_notification_data.Length = 0;
 
   /* USER CODE BEGIN Service1Char2_NS_1*/
-
+  notification_on_off = P2P_SERVER_APP_Context.Temp_c_Notification_Status;
+  p2p_server_notification_data.Length = P2P_SERVER_APP_Context.BatchLen;
+  if (p2p_server_notification_data.Length == 0U)
+  {
+    return;
+  }
   /* USER CODE END Service1Char2_NS_1*/
 
   if (notification_on_off != Temp_c_NOTIFICATION_OFF && P2P_SERVER_APP_Context.ConnectionHandle != 0xFFFF)
@@ -212,12 +302,51 @@ __USED void P2P_SERVER_Temp_c_SendNotification(void) /* Property Notification */
   }
 
   /* USER CODE BEGIN Service1Char2_NS_Last*/
-
+  /* Sent or not, the batch is done; deadband tracking keeps going */
+  P2P_SERVER_APP_Context.BatchSeq++;
+  AirBatch_Reset();
   /* USER CODE END Service1Char2_NS_Last*/
 
   return;
 }
 
 /* USER CODE BEGIN FD_LOCAL_FUNCTIONS*/
+static void AirBatch_Reset(void)
+{
+  P2P_SERVER_APP_Context.BatchLen = 0;
+  P2P_SERVER_APP_Context.BatchCount = 0;
+  return;
+}
 
+/* Samples per notification: bounded by the negotiated MTU and the config */
+static uint8_t AirBatch_Capacity(void)
+{
+  uint16_t payload = (uint16_t)(P2P_SERVER_APP_Context.AttMtu - 3U);
+  uint16_t n;
+
+  if (payload > sizeof(a_P2P_SERVER_UpdateCharData))
+  {
+    payload = sizeof(a_P2P_SERVER_UpdateCharData);
+  }
+  n = (uint16_t)((payload - AIR_BLE_HDR_LEN) / AIR_BLE_SAMPLE_LEN);
+  if (n > AIR_BLE_BATCH_MAX_SAMPLES)
+  {
+    n = AIR_BLE_BATCH_MAX_SAMPLES;
+  }
+  return (n == 0U) ? 1U : (uint8_t)n;
+}
+
+static uint32_t AbsDiff(int32_t a, int32_t b)
+{
+  return (a > b) ? (uint32_t)(a - b) : (uint32_t)(b - a);
+}
+
+static uint8_t AirSample_Changed(const air_readings_packed_t *p_Old, const air_readings_packed_t *p_New)
+{
+  return (uint8_t)((AbsDiff(p_Old->t_cdeg, p_New->t_cdeg) >= AIR_BLE_DEADBAND_T_CDEG) ||
+                   (AbsDiff(p_Old->rh_cpct, p_New->rh_cpct) >= AIR_BLE_DEADBAND_RH_CPCT) ||
+                   (AbsDiff((int32_t)p_Old->p_pa, (int32_t)p_New->p_pa) >= AIR_BLE_DEADBAND_P_PA) ||
+                   (AbsDiff(p_Old->iaq_x10, p_New->iaq_x10) >= AIR_BLE_DEADBAND_IAQ_X10) ||
+                   (p_Old->iaq_accuracy != p_New->iaq_accuracy));
+}
 /* USER CODE END FD_LOCAL_FUNCTIONS*/
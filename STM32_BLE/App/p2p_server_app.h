@@ -28,7 +28,7 @@ extern "C" {
 
 /* Includes ------------------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "air_app.h"
 /* USER CODE END Includes */
 
 /* Exported types ------------------------------------------------------------*/
@@ -59,7 +59,19 @@ typedef struct
 
 /* Exported constants --------------------------------------------------------*/
 /* USER CODE BEGIN EC */
-
+/* Air readings on TEMP_C: a sample is queued only when a field moved by at
+ * least its deadband since the last queued sample (or AIR_BLE_MAX_SILENCE_MS
+ * passed). Queued samples are batched into one notification of up to
+ * ATT_MTU - 3 bytes:
+ *   seq u16 | count u8 | count x { ts_ms u32 | air_readings_packed_t }
+ */
+#define AIR_BLE_DEADBAND_T_CDEG     (10U)     /* 0.10 C */
+#define AIR_BLE_DEADBAND_RH_CPCT    (50U)     /* 0.50 %RH */
+#define AIR_BLE_DEADBAND_P_PA       (10U)     /* 0.10 hPa */
+#define AIR_BLE_DEADBAND_IAQ_X10    (20U)     /* 2.0 IAQ, accuracy changes always count */
+#define AIR_BLE_MAX_SILENCE_MS      (5U * 60U * 1000U)
+#define AIR_BLE_BATCH_MAX_SAMPLES   (16U)     /* 3 + 16 * 15 = 243 bytes at ATT_MTU 247 */
+#define AIR_BLE_BATCH_MAX_MS        (60U * 1000U)
 /* USER CODE END EC */
 
 /* External variables --------------------------------------------------------*/
@@ -76,7 +88,8 @@ typedef struct
 void P2P_SERVER_APP_Init(void);
 void P2P_SERVER_APP_EvtRx(P2P_SERVER_APP_ConnHandleNotEvt_t *p_Notification);
 /* USER CODE BEGIN EF */
-
+void P2P_SERVER_APP_PushAirSample(const air_readings_packed_t *p_Sample, uint32_t TimestampMs);
+void P2P_SERVER_APP_SetAttMtu(uint16_t ConnectionHandle, uint16_t Mtu);
 /* USER CODE END EF */
 
 #ifdef __cplusplus
@@ -25,6 +25,7 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "telemetry.h"
 
 /* USER CODE END Includes */
 
@@ -243,6 +244,21 @@ UTIL_ADV_TRACE_Status_t UART_StartRx(void (*cb)(uint8_t *pdata, uint16_t size, u
 UTIL_ADV_TRACE_Status_t UART_TransmitDMA ( uint8_t *pdata, uint16_t size )
 {
   /* USER CODE BEGIN UART_TransmitDMA 1 */
+#if (TELEMETRY_ENABLE != 0)
+  /* No ADV trace: USART1 carries the binary telemetry stream (telemetry.c) */
+  HAL_StatusTypeDef tx_result;
+
+  if(huart1.hdmatx)
+  {
+    tx_result = HAL_UART_Transmit_DMA(&huart1, pdata, size);
+  }
+  else
+  {
+    tx_result = HAL_UART_Transmit_IT(&huart1, pdata, size);
+  }
+
+  return (tx_result == HAL_OK) ? UTIL_ADV_TRACE_OK : UTIL_ADV_TRACE_HW_ERROR;
+#endif /* (TELEMETRY_ENABLE != 0) */
 
   /* USER CODE END UART_TransmitDMA 1 */
 
@@ -346,6 +362,17 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 1 */
+#if (TELEMETRY_ENABLE != 0)
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  if (huart == &huart1)
+  {
+    telemetry_tx_cplt();
+  }
+}
+
+#endif /* (TELEMETRY_ENABLE != 0) */
 
 /* USER CODE END 1 */
 
@@ -49,27 +49,36 @@ typedef struct FM_FlashOpConfig
   uint32_t eraseNbrSect;
 }FM_FlashOpConfig_t;
 
+/**
+ * @brief Flash request, one entry of the request queue
+ */
+typedef struct FM_Request
+{
+  FM_FlashOp_t flashop;                       /* FM_NO_OP: the entry is free */
+  FM_Priority_t priority;
+  bool started;                               /* Partly executed, nothing is merged into it anymore */
+  uint8_t parent;                             /* Request this one was merged into, FM_NO_PARENT if none */
+  uint32_t seq;                               /* Arrival order */
+  void (*callback)(FM_FlashOp_Status_t);      /* Requester's callback, may be NULL */
+  FM_FlashOpConfig_t parameters;
+}FM_Request_t;
+
 /* Private defines -----------------------------------------------------------*/
 
 #define FLASH_WRITE_BLOCK_SIZE  4U
 #define ALIGNMENT_32   0x00000003
 #define ALIGNMENT_128  0x0000000F
 
-/* Private macros ------------------------------------------------------------*/
-/* Private variables ---------------------------------------------------------*/
+#define FM_NO_REQUEST  0xFFU
+#define FM_NO_PARENT   0xFFU
 
-/**
-  * @brief Semaphore on Flash
-  */
-static bool busy_flash_sem = FALSE;
+#define FM_SECT_SIZE   (FLASH_SIZE / FLASH_PAGE_NUMBER)
 
-/**
-  * @brief Indicates if the flash manager module is available or not
-  */
-static bool flash_manager_busy = FALSE;
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
 
 /**
-  * @brief Callback node list for pending flash operation request
+  * @brief Callback node list for requesters waiting for a free queue entry
   */
 static tListNode fm_cb_pending_list;
 
@@ -79,37 +88,70 @@ static tListNode fm_cb_pending_list;
 static bool fm_cb_pending_list_init = FALSE;
 
 /**
-  * @brief Pointer to current flash operation requester's callback
-  */
-static void (*fm_running_cb)(FM_FlashOp_Status_t);
-
-/**
-  * @brief Type of current flash operation (Write/Erase)
+  * @brief Flash request queue
   */
-static FM_FlashOp_t fm_flashop = FM_NO_OP;
+static FM_Request_t fm_queue[FM_QUEUE_SIZE];
 
 /**
-  * @brief Parameters for Flash operation
+  * @brief Sequence number of the next request
   */
-static FM_FlashOpConfig_t fm_flashop_parameters;
+static uint32_t fm_seq = 0;
 
 /* Private function prototypes -----------------------------------------------*/
 
-static FM_Cmd_Status_t FM_CheckFlashManagerState(FM_CallbackNode_t *CallbackNode);
+static FM_Cmd_Status_t FM_QueueRequest(FM_Request_t *Request, FM_CallbackNode_t *CallbackNode);
+static uint8_t FM_FindMerge(const FM_Request_t *Request);
+static bool FM_OverlapsLater(uint8_t Index, const FM_Request_t *Request);
+static void FM_Area(const FM_Request_t *Request, uint32_t *Start, uint32_t *End);
+static void FM_Merge(uint8_t Index, const FM_Request_t *Request);
+static uint8_t FM_FreeEntry(void);
+static uint8_t FM_NextRequest(void);
 
 /* Functions Definition ------------------------------------------------------*/
 
 /**
   * @brief  Request the Flash Manager module to initiate a Flash Write operation
+  *         with application priority
   * @param  Src: Address of the data to be stored in FLASH. It shall be 32bits aligned
-  * @param  Dest: Address where the data shall be written. It shall be 128bits aligned
+  * @param  Dest: Address where the data shall be written. It shall be 32bits aligned
   * @param  Size: This is the number of words to be written in Flash.
   * @param  CallbackNode: Pointer to the callback node for storage in list
   * @retval FM_Cmd_Status_t: Status of the Flash Manager module
   */
 FM_Cmd_Status_t FM_Write(uint32_t *Src, uint32_t *Dest, int32_t Size, FM_CallbackNode_t *CallbackNode)
 {
-  FM_Cmd_Status_t status;
+  return FM_WritePriority(Src, Dest, Size, FM_PRIORITY_APP, CallbackNode);
+}
+
+/**
+  * @brief  Request the Flash Manager module to initiate a Flash Erase operation
+  *         with application priority
+  * @param  FirstSect: Index of the first sector to erase
+  * @param  NbrSect: Number of sector to erase
+  * @param  CallbackNode: Pointer to the callback node for storage in list
+  * @retval FM_Cmd_Status_t: Status of the Flash Manager module
+  */
+FM_Cmd_Status_t FM_Erase(uint32_t FirstSect, uint32_t NbrSect, FM_CallbackNode_t *CallbackNode)
+{
+  return FM_ErasePriority(FirstSect, NbrSect, FM_PRIORITY_APP, CallbackNode);
+}
+
+/**
+  * @brief  Queue a Flash Write operation. A write that continues a queued one, both in
+  *         Flash and in RAM, is merged into it. The source buffer shall stay untouched
+  *         until the callback reports FM_OPERATION_COMPLETE. Requests of different
+  *         priorities may complete out of order, so they shall not target the same area.
+  * @param  Src: Address of the data to be stored in FLASH. It shall be 32bits aligned
+  * @param  Dest: Address where the data shall be written. It shall be 32bits aligned
+  * @param  Size: This is the number of words to be written in Flash.
+  * @param  Priority: Priority of the request
+  * @param  CallbackNode: Pointer to the callback node for storage in list
+  * @retval FM_Cmd_Status_t: Status of the Flash Manager module
+  */
+FM_Cmd_Status_t FM_WritePriority(uint32_t *Src, uint32_t *Dest, int32_t Size, FM_Priority_t Priority,
+                                 FM_CallbackNode_t *CallbackNode)
+{
+  FM_Request_t request;
 
   if (((uint32_t)Dest < FLASH_START_ADDR) || ((uint32_t)Dest > (FLASH_START_ADDR + FLASH_SIZE))
                                     || (((uint32_t)Dest + Size) > (FLASH_START_ADDR + FLASH_SIZE)))
@@ -122,60 +164,52 @@ FM_Cmd_Status_t FM_Write(uint32_t *Src, uint32_t *Dest, int32_t Size, FM_Callbac
     return FM_ERROR;
   }
 
-  status = FM_CheckFlashManagerState(CallbackNode);
-
-  if (status == FM_OK)
-  { /* Flash manager is available */
-
-    /* Save Write parameters */
-    fm_flashop_parameters.writeSrc = Src;
-    fm_flashop_parameters.writeDest = Dest;
-    fm_flashop_parameters.writeSize = Size;
+  if ((Size <= 0) || (Priority > FM_PRIORITY_SECURITY))
+  { /* Inconsistent request */
+    return FM_ERROR;
+  }
 
-    fm_flashop = FM_WRITE_OP;
+  /* Save Write parameters */
+  request.flashop = FM_WRITE_OP;
+  request.priority = Priority;
+  request.parameters.writeSrc = Src;
+  request.parameters.writeDest = Dest;
+  request.parameters.writeSize = Size;
 
-    /* Window request to be executed in background */
-    FM_ProcessRequest(TRUE);
-  }
-  return status;
+  return FM_QueueRequest(&request, CallbackNode);
 }
 
 /**
-  * @brief  Request the Flash Manager module to initiate a Flash Erase operation
+  * @brief  Queue a Flash Erase operation. An erase that overlaps or touches a queued
+  *         one is merged into it, the sectors are erased once.
   * @param  FirstSect: Index of the first sector to erase
   * @param  NbrSect: Number of sector to erase
+  * @param  Priority: Priority of the request
   * @param  CallbackNode: Pointer to the callback node for storage in list
   * @retval FM_Cmd_Status_t: Status of the Flash Manager module
   */
-FM_Cmd_Status_t FM_Erase(uint32_t FirstSect, uint32_t NbrSect, FM_CallbackNode_t *CallbackNode)
+FM_Cmd_Status_t FM_ErasePriority(uint32_t FirstSect, uint32_t NbrSect, FM_Priority_t Priority,
+                                 FM_CallbackNode_t *CallbackNode)
 {
-  FM_Cmd_Status_t status;
+  FM_Request_t request;
 
   if ((FirstSect > FLASH_PAGE_NUMBER) || ((FirstSect + NbrSect) > FLASH_PAGE_NUMBER))
   { /* Inconsistent request */
     return FM_ERROR;
   }
 
-  if (NbrSect == 0)
+  if ((NbrSect == 0) || (Priority > FM_PRIORITY_SECURITY))
   { /* Inconsistent request */
     return FM_ERROR;
   }
 
-  status = FM_CheckFlashManagerState(CallbackNode);
-
-  if (status == FM_OK)
-  { /* Flash manager is available */
-
-    /* Save Erase parameters */
-    fm_flashop_parameters.eraseFirstSect = FirstSect;
-    fm_flashop_parameters.eraseNbrSect = NbrSect;
+  /* Save Erase parameters */
+  request.flashop = FM_ERASE_OP;
+  request.priority = Priority;
+  request.parameters.eraseFirstSect = FirstSect;
+  request.parameters.eraseNbrSect = NbrSect;
 
-    fm_flashop = FM_ERASE_OP;
-
-    /* Window request to be executed in background */
-    FM_ProcessRequest(TRUE);
-  }
-  return status;
+  return FM_QueueRequest(&request, CallbackNode);
 }
 
 /**
@@ -188,77 +222,100 @@ void FM_BackgroundProcess (void)
   bool flashop_complete = false;
   FD_FlashOp_Status_t fdReturnValue = FD_FLASHOP_SUCCESS;
   FM_CallbackNode_t *pCbNode = NULL;
+  FM_FlashOpConfig_t *fm_flashop_parameters;
+  void (*fm_done_cb[FM_QUEUE_SIZE])(FM_FlashOp_Status_t);
+  uint8_t fm_done_cb_nbr = 0;
+  uint8_t current;
+  uint8_t i;
+
+  UTILS_ENTER_CRITICAL_SECTION();
+
+  /* Highest priority first; a request that lost its window may be overtaken here */
+  current = FM_NextRequest();
+  if (current != FM_NO_REQUEST)
+  {
+    fm_queue[current].started = true;
+  }
+
+  UTILS_EXIT_CRITICAL_SECTION();
+
+  if (current == FM_NO_REQUEST)
+  {
+    return;
+  }
+
+  fm_flashop_parameters = &fm_queue[current].parameters;
 
-  if (fm_flashop == FM_WRITE_OP)
+  if (fm_queue[current].flashop == FM_WRITE_OP)
   {
 
     /* Write first non-aligned bytes */
-    while(fm_flashop_parameters.writeSize > 0 && ((uint32_t)fm_flashop_parameters.writeDest & ALIGNMENT_128) &&
+    while(fm_flashop_parameters->writeSize > 0 && ((uint32_t)fm_flashop_parameters->writeDest & ALIGNMENT_128) &&
           fdReturnValue == FD_FLASHOP_SUCCESS)
     {
       /* Write single words */
-      fdReturnValue = FD_WriteData32((uint32_t) fm_flashop_parameters.writeDest,
-                                      fm_flashop_parameters.writeSrc);
+      fdReturnValue = FD_WriteData32((uint32_t) fm_flashop_parameters->writeDest,
+                                      fm_flashop_parameters->writeSrc);
       if (fdReturnValue == FD_FLASHOP_SUCCESS)
       {
-        fm_flashop_parameters.writeDest += 1;
-        fm_flashop_parameters.writeSrc += 1;
-        fm_flashop_parameters.writeSize -= 1;
+        fm_flashop_parameters->writeDest += 1;
+        fm_flashop_parameters->writeSrc += 1;
+        fm_flashop_parameters->writeSize -= 1;
       }
     }
 
     /* Write aligned block */
-    while((fm_flashop_parameters.writeSize >= 4) &&
+    while((fm_flashop_parameters->writeSize >= 4) &&
           (fdReturnValue == FD_FLASHOP_SUCCESS))
     {
-      fdReturnValue = FD_WriteData128((uint32_t) fm_flashop_parameters.writeDest,
-                                      fm_flashop_parameters.writeSrc);
+      fdReturnValue = FD_WriteData128((uint32_t) fm_flashop_parameters->writeDest,
+                                      fm_flashop_parameters->writeSrc);
 
       if (fdReturnValue == FD_FLASHOP_SUCCESS)
       {
-        fm_flashop_parameters.writeDest += FLASH_WRITE_BLOCK_SIZE;
-        fm_flashop_parameters.writeSrc += FLASH_WRITE_BLOCK_SIZE;
-        fm_flashop_parameters.writeSize -= FLASH_WRITE_BLOCK_SIZE;
+        fm_flashop_parameters->writeDest += FLASH_WRITE_BLOCK_SIZE;
+        fm_flashop_parameters->writeSrc += FLASH_WRITE_BLOCK_SIZE;
+        fm_flashop_parameters->writeSize -= FLASH_WRITE_BLOCK_SIZE;
       }
     }
 
     /* Write remaining words, if any */
-    while(fm_flashop_parameters.writeSize > 0 &&
+    while(fm_flashop_parameters->writeSize > 0 &&
           fdReturnValue == FD_FLASHOP_SUCCESS)
     {
       /* Write single words */
-      fdReturnValue = FD_WriteData32((uint32_t) fm_flashop_parameters.writeDest,
-                                      fm_flashop_parameters.writeSrc);
+      fdReturnValue = FD_WriteData32((uint32_t) fm_flashop_parameters->writeDest,
+                                      fm_flashop_parameters->writeSrc);
       if (fdReturnValue == FD_FLASHOP_SUCCESS)
       {
-        fm_flashop_parameters.writeDest += 1;
-        fm_flashop_parameters.writeSrc += 1;
-        fm_flashop_parameters.writeSize -= 1;
+        fm_flashop_parameters->writeDest += 1;
+        fm_flashop_parameters->writeSrc += 1;
+        fm_flashop_parameters->writeSize -= 1;
       }
     }
 
     /* Is write over ? */
-    if (fm_flashop_parameters.writeSize <= 0)
+    if (fm_flashop_parameters->writeSize <= 0)
     {
       flashop_complete = true;
     }
   }
-  else if (fm_flashop == FM_ERASE_OP)
+  else if (fm_queue[current].flashop == FM_ERASE_OP)
   {
 
-    while((fm_flashop_parameters.eraseNbrSect > 0) &&
+    while((fm_flashop_parameters->eraseNbrSect > 0) &&
           (fdReturnValue == FD_FLASHOP_SUCCESS))
     {
-      fdReturnValue = FD_EraseSectors(fm_flashop_parameters.eraseFirstSect);
+      fdReturnValue = FD_EraseSectors(fm_flashop_parameters->eraseFirstSect);
 
       if (fdReturnValue == FD_FLASHOP_SUCCESS)
       {
-        fm_flashop_parameters.eraseNbrSect--;
-        fm_flashop_parameters.eraseFirstSect++;
+        fm_flashop_parameters->eraseNbrSect--;
+        fm_flashop_parameters->eraseFirstSect++;
       }
     }
 
-    if (fm_flashop_parameters.eraseNbrSect == 0)
+    if (fm_flashop_parameters->eraseNbrSect == 0)
     {
       flashop_complete = true;
     }
@@ -266,31 +323,44 @@ void FM_BackgroundProcess (void)
 
   if (flashop_complete == true)
   {
-    fm_flashop = FM_NO_OP;
-
     UTILS_ENTER_CRITICAL_SECTION();
 
-    /* Release semaphore on flash */
-    busy_flash_sem = false;
-
-    /* Set Flash Manager busy */
-    flash_manager_busy = false;
+    /* Release the request and the ones merged into it before calling back, so that
+       the callbacks can queue new requests */
+    for (i = 0; i < FM_QUEUE_SIZE; i++)
+    {
+      if ((i == current) ||
+          ((fm_queue[i].flashop != FM_NO_OP) && (fm_queue[i].parent == current)))
+      {
+        if (fm_queue[i].callback != NULL)
+        {
+          fm_done_cb[fm_done_cb_nbr++] = fm_queue[i].callback;
+        }
+        fm_queue[i].flashop = FM_NO_OP;
+      }
+    }
 
     UTILS_EXIT_CRITICAL_SECTION();
 
-    /* Invoke the running callback if present */
-    if (fm_running_cb != NULL)
+    /* Invoke the callbacks of the completed requests */
+    for (i = 0; i < fm_done_cb_nbr; i++)
     {
-      fm_running_cb(FM_OPERATION_COMPLETE);
+      fm_done_cb[i](FM_OPERATION_COMPLETE);
     }
 
     /* notify pending requesters */
     while((LST_is_empty (&fm_cb_pending_list) == false) &&
-          (busy_flash_sem == false) && (flash_manager_busy == false))
+          (FM_FreeEntry() != FM_NO_REQUEST))
     {
       LST_remove_head (&fm_cb_pending_list, (tListNode**)&pCbNode);
       pCbNode->Callback(FM_OPERATION_AVAILABLE);
     }
+
+    /* Go on with the next request, if any */
+    if (FM_NextRequest() != FM_NO_REQUEST)
+    {
+      FM_ProcessRequest(TRUE);
+    }
   }
   else
   {
@@ -300,16 +370,26 @@ void FM_BackgroundProcess (void)
 }
 
 /**
-  * @brief  Check if the Flash Manager is busy or available
+  * @brief  Merge a request into a queued one or give it a free queue entry
+  * @param  Request: Request to queue, priority and parameters filled in
   * @param  CallbackNode: Pointer to the callback node for storage in list
   * @retval FM_Cmd_Status_t: Status of the Flash Manager module
   */
-static FM_Cmd_Status_t FM_CheckFlashManagerState(FM_CallbackNode_t *CallbackNode)
+static FM_Cmd_Status_t FM_QueueRequest(FM_Request_t *Request, FM_CallbackNode_t *CallbackNode)
 {
-  bool fm_process_cmd = false;
-  FM_Cmd_Status_t status = FM_ERROR;
+  FM_Cmd_Status_t status = FM_BUSY;
+  uint8_t free_entry;
+  uint8_t parent;
+
+  if ((CallbackNode != NULL) && (CallbackNode->Callback != NULL))
+  {
+    Request->callback = CallbackNode->Callback;
+  }
+  else
+  {
+    Request->callback = NULL;
+  }
 
-  /* Check if semaphore on flash is available */
   UTILS_ENTER_CRITICAL_SECTION();
 
   /* Initialize pending list if not done */
@@ -318,60 +398,222 @@ static FM_Cmd_Status_t FM_CheckFlashManagerState(FM_CallbackNode_t *CallbackNode
     LST_init_head(&fm_cb_pending_list);
     fm_cb_pending_list_init = true;
   }
-  /* Check if semaphore on flash is available */
-  if (busy_flash_sem == false)
-  { /* Check if Flash Manager is already busy */
-    if (flash_manager_busy == false)
+
+  free_entry = FM_FreeEntry();
+  parent = FM_FindMerge(Request);
+
+  if ((parent != FM_NO_REQUEST) && (Request->callback == NULL))
+  { /* Nobody waits for the completion, the merged request needs no entry */
+    FM_Merge(parent, Request);
+    status = FM_OK;
+  }
+  else if (free_entry != FM_NO_REQUEST)
+  {
+    if (parent != FM_NO_REQUEST)
+    { /* Only the callback is kept, the parent request does the work */
+      FM_Merge(parent, Request);
+    }
+    Request->parent = (parent != FM_NO_REQUEST) ? parent : FM_NO_PARENT;
+    Request->started = false;
+    Request->seq = fm_seq++;
+    fm_queue[free_entry] = *Request;
+    status = FM_OK;
+  }
+  else if (Request->callback != NULL)
+  { /* Queue full: append callback to the pending list */
+    LST_insert_tail(&fm_cb_pending_list, &(CallbackNode->NodeList));
+  }
+
+  UTILS_EXIT_CRITICAL_SECTION();
+
+  if (status == FM_OK)
+  {
+    /* Window request to be executed in background */
+    FM_ProcessRequest(TRUE);
+  }
+  return status;
+}
+
+/**
+  * @brief  Look for a queued request that a new one can be merged into: a write that
+  *         it continues, in Flash and in RAM, or an erase that it overlaps or touches.
+  *         Requests already started are left alone, and so are those followed by a
+  *         queued request on the same area: merging would execute the new request
+  *         before that one.
+  * @param  Request: New request
+  * @retval Index of the request to merge into, FM_NO_REQUEST if none
+  */
+static uint8_t FM_FindMerge(const FM_Request_t *Request)
+{
+  const FM_Request_t *entry;
+  uint8_t i;
+
+  for (i = 0; i < FM_QUEUE_SIZE; i++)
+  {
+    entry = &fm_queue[i];
+
+    if ((entry->flashop != Request->flashop) || (entry->started == true) ||
+        (entry->parent != FM_NO_PARENT))
     {
-      busy_flash_sem = true; /* Get semaphore on flash */
-      flash_manager_busy = true; /* Set Flash Manager busy */
-      fm_process_cmd = true;
+      continue;
+    }
+
+    if (Request->flashop == FM_WRITE_OP)
+    {
+      if ((entry->parameters.writeDest + entry->parameters.writeSize == Request->parameters.writeDest) &&
+          (entry->parameters.writeSrc + entry->parameters.writeSize == Request->parameters.writeSrc) &&
+          (FM_OverlapsLater(i, Request) == false))
+      {
+        return i;
+      }
     }
     else
     {
-      fm_process_cmd = false;
+      if ((Request->parameters.eraseFirstSect <= entry->parameters.eraseFirstSect + entry->parameters.eraseNbrSect) &&
+          (entry->parameters.eraseFirstSect <= Request->parameters.eraseFirstSect + Request->parameters.eraseNbrSect) &&
+          (FM_OverlapsLater(i, Request) == false))
+      {
+        return i;
+      }
     }
   }
-  else
+
+  return FM_NO_REQUEST;
+}
+
+/**
+  * @brief  Check if a request queued after a given one touches the area of a new request
+  * @param  Index: Index of the queued request the new one would be merged into
+  * @param  Request: New request
+  * @retval true if a later request writes or erases part of the new request's area
+  */
+static bool FM_OverlapsLater(uint8_t Index, const FM_Request_t *Request)
+{
+  const FM_Request_t *entry;
+  uint32_t start, end;
+  uint32_t entry_start, entry_end;
+  uint8_t i;
+
+  FM_Area(Request, &start, &end);
+
+  for (i = 0; i < FM_QUEUE_SIZE; i++)
   {
-    fm_process_cmd = false;
-  }
-  UTILS_EXIT_CRITICAL_SECTION();
+    entry = &fm_queue[i];
 
-  if (fm_process_cmd == false)
-  { /* Flash manager busy */
+    /* Requests merged into another one are covered by the area of their parent */
+    if ((entry->flashop == FM_NO_OP) || (entry->parent != FM_NO_PARENT) ||
+        ((int32_t)(entry->seq - fm_queue[Index].seq) <= 0))
+    {
+      continue;
+    }
 
-    /* Append callback to the pending list */
-    if ((CallbackNode != NULL) && (CallbackNode->Callback != NULL))
+    FM_Area(entry, &entry_start, &entry_end);
+    if ((start < entry_end) && (entry_start < end))
     {
-      LST_insert_tail(&fm_cb_pending_list, &(CallbackNode->NodeList));
+      return true;
     }
+  }
+
+  return false;
+}
 
-    status = FM_BUSY;
+/**
+  * @brief  Flash area of a request, as a range of addresses
+  * @param  Request: Queued or new request
+  * @param  Start: First address of the area
+  * @param  End: Address following the area
+  * @retval None
+  */
+static void FM_Area(const FM_Request_t *Request, uint32_t *Start, uint32_t *End)
+{
+  if (Request->flashop == FM_WRITE_OP)
+  {
+    *Start = (uint32_t)Request->parameters.writeDest;
+    *End = *Start + (Request->parameters.writeSize * FLASH_WRITE_BLOCK_SIZE);
   }
   else
-  { /* Flash manager is available */
+  {
+    *Start = FLASH_START_ADDR + (Request->parameters.eraseFirstSect * FM_SECT_SIZE);
+    *End = *Start + (Request->parameters.eraseNbrSect * FM_SECT_SIZE);
+  }
+}
 
-    if ((CallbackNode != NULL) && (CallbackNode->Callback != NULL))
-    {
-      UTILS_ENTER_CRITICAL_SECTION();
+/**
+  * @brief  Extend a queued request with a new one found by FM_FindMerge()
+  * @param  Index: Index of the queued request
+  * @param  Request: New request
+  * @retval None
+  */
+static void FM_Merge(uint8_t Index, const FM_Request_t *Request)
+{
+  FM_Request_t *entry = &fm_queue[Index];
+  uint32_t first_sect;
+  uint32_t end_sect;
 
-      fm_running_cb = CallbackNode->Callback;
+  if (Request->flashop == FM_WRITE_OP)
+  {
+    entry->parameters.writeSize += Request->parameters.writeSize;
+  }
+  else
+  {
+    first_sect = MIN(entry->parameters.eraseFirstSect, Request->parameters.eraseFirstSect);
+    end_sect = MAX(entry->parameters.eraseFirstSect + entry->parameters.eraseNbrSect,
+                   Request->parameters.eraseFirstSect + Request->parameters.eraseNbrSect);
+    entry->parameters.eraseFirstSect = first_sect;
+    entry->parameters.eraseNbrSect = end_sect - first_sect;
+  }
 
-      UTILS_EXIT_CRITICAL_SECTION();
-    }
-    else
+  /* The merged request must not wait longer than it would alone */
+  entry->priority = MAX(entry->priority, Request->priority);
+}
+
+/**
+  * @brief  Find a free queue entry
+  * @param  None
+  * @retval Index of the entry, FM_NO_REQUEST if the queue is full
+  */
+static uint8_t FM_FreeEntry(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < FM_QUEUE_SIZE; i++)
+  {
+    if (fm_queue[i].flashop == FM_NO_OP)
     {
-      UTILS_ENTER_CRITICAL_SECTION();
+      return i;
+    }
+  }
 
-      fm_running_cb = NULL;
+  return FM_NO_REQUEST;
+}
 
-      UTILS_EXIT_CRITICAL_SECTION();
+/**
+  * @brief  Select the request to execute: highest priority, then oldest. Requests
+  *         merged into another one are completed with it.
+  * @param  None
+  * @retval Index of the request, FM_NO_REQUEST if there is nothing to do
+  */
+static uint8_t FM_NextRequest(void)
+{
+  uint8_t next = FM_NO_REQUEST;
+  uint8_t i;
+
+  for (i = 0; i < FM_QUEUE_SIZE; i++)
+  {
+    if ((fm_queue[i].flashop == FM_NO_OP) || (fm_queue[i].parent != FM_NO_PARENT))
+    {
+      continue;
     }
 
-    status = FM_OK;
+    if ((next == FM_NO_REQUEST) || (fm_queue[i].priority > fm_queue[next].priority) ||
+        ((fm_queue[i].priority == fm_queue[next].priority) &&
+         ((int32_t)(fm_queue[i].seq - fm_queue[next].seq) < 0)))
+    {
+      next = i;
+    }
   }
-  return status;
+
+  return next;
 }
 
 /**
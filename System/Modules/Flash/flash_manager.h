@@ -35,11 +35,20 @@ extern "C" {
 /* Flash Manager command status */
 typedef enum
 {
-  FM_OK,    /* The Flash Manager is available and a window request is scheduled */
-  FM_BUSY,  /* The Flash Manager is busy and the caller will be called back when it is available */
+  FM_OK,    /* The request is queued and a window request is scheduled */
+  FM_BUSY,  /* The request queue is full and the caller will be called back when a slot is available */
   FM_ERROR  /* An error occurred while processing the command */
 } FM_Cmd_Status_t;
 
+/* Flash request priority. When several requests are queued, the highest priority runs
+   first, requests of the same priority in arrival order. */
+typedef enum
+{
+  FM_PRIORITY_LOG,      /* Logs and other data that can wait */
+  FM_PRIORITY_APP,      /* Application state (FM_Write() and FM_Erase()) */
+  FM_PRIORITY_SECURITY  /* Security and bonding data */
+} FM_Priority_t;
+
 /* Flash operation status */
 typedef enum
 {
@@ -57,11 +66,22 @@ typedef struct FM_CallbackNode
 }FM_CallbackNode_t;
 
 /* Exported constants --------------------------------------------------------*/
+
+/* Number of requests the Flash Manager can hold, including the running one. A request
+   merged into another one still takes a slot for its callback. */
+#ifndef FM_QUEUE_SIZE
+#define FM_QUEUE_SIZE  4U
+#endif
+
 /* Exported variables --------------------------------------------------------*/
 /* Exported macros -----------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
 FM_Cmd_Status_t FM_Write(uint32_t *Src, uint32_t *Dest, int32_t Size, FM_CallbackNode_t *CallbackNode);
 FM_Cmd_Status_t FM_Erase(uint32_t FirstSect, uint32_t NbrSect, FM_CallbackNode_t *CallbackNode);
+FM_Cmd_Status_t FM_WritePriority(uint32_t *Src, uint32_t *Dest, int32_t Size, FM_Priority_t Priority,
+                                 FM_CallbackNode_t *CallbackNode);
+FM_Cmd_Status_t FM_ErasePriority(uint32_t FirstSect, uint32_t NbrSect, FM_Priority_t Priority,
+                                 FM_CallbackNode_t *CallbackNode);
 void FM_BackgroundProcess (void);
 void FM_ProcessRequest(uint8_t immediate);
 
@@ -34,6 +34,52 @@ extern "C" {
 #define AUTO_CLEAN 1
 #endif
 
+/* Optional RAM index for NVMDB_FindNextRecord(). Each database keeps up to
+   NVMDB_INDEX_ENTRIES entries (6 bytes each: record offset, record type and a
+   hash of the NVMDB_INDEX_KEY_LEN bytes at NVMDB_INDEX_KEY_OFFSET). Searches whose
+   pattern starts at NVMDB_INDEX_KEY_OFFSET and covers the key only visit records
+   with a matching hash. Other searches, and a database holding more records than
+   entries, scan the Flash as before. Set to 0 to disable the index. */
+#ifndef NVMDB_INDEX_ENTRIES
+#define NVMDB_INDEX_ENTRIES     0
+#endif
+
+#ifndef NVMDB_INDEX_KEY_OFFSET
+#define NVMDB_INDEX_KEY_OFFSET  0
+#endif
+
+#ifndef NVMDB_INDEX_KEY_LEN
+#define NVMDB_INDEX_KEY_LEN     4
+#endif
+
+/* Clean of large databases when the cache is disabled. The clean is split in steps:
+   erase one page, or program up to NVMDB_CLEAN_STEP_WORDS words, halved down to one
+   word until the step fits the time NVMDB_TimeCheck() grants before the next radio
+   activity (WORD_WRITE_TIME_SYS per word, PAGE_ERASE_TIME_SYS per page). Once the first
+   page has been erased, a clean that does not fit keeps the database locked and goes on
+   at the next NVMDB_Tick(); before that, it is dropped and tried again later.
+   A step refused NVMDB_CLEAN_MAX_WAITS times in a row runs anyway: a page erase (22 ms)
+   never fits between events at a connection interval below about 25 ms, and the lock
+   must not last until the interval widens. A forced erase delays the radio by one erase,
+   where the one-shot clean stalls it for the whole clean.
+   NVMDB_CLEAN_STEP_WORDS 0 restores the one-shot clean, ignoring radio activity.
+   Costs of the sliced clean:
+   - RAM: the page being rewritten is kept in a static buffer, about 2.1 KB of .bss
+     (PAGE_SIZE bytes plus the clean state), instead of a PAGE_SIZE stack buffer.
+   - Duration: an 8-page clean takes 0.38-0.47 s over 12-18 ticks with a 25-30 ms
+     connection interval (0.3 s at once, stalling the radio all along). With a 7.5-15 ms
+     interval it takes 0.9-1.3 s and forces its 8 page erases, each after
+     NVMDB_CLEAN_MAX_WAITS ticks. The database is locked all along, and each page's
+     records exist only in RAM from its erase to the end of its programming. A reset in
+     that window loses them, as with the one-shot clean. */
+#ifndef NVMDB_CLEAN_STEP_WORDS
+#define NVMDB_CLEAN_STEP_WORDS  64
+#endif
+
+#ifndef NVMDB_CLEAN_MAX_WAITS
+#define NVMDB_CLEAN_MAX_WAITS   8
+#endif
+
 /** @addtogroup NVM_Manager_Peripheral  NVM Manager
  * @{
  */
@@ -76,7 +122,9 @@ typedef struct
  * @{
  */
 
+#ifndef PAGE_SIZE
 #define PAGE_SIZE _MEMORY_BYTES_PER_PAGE_ // It specifies the minimum size that can be erased. It must be multiple of 2.
+#endif
 
 /* Change the following macros in order to match the desired database set. */
 
@@ -117,7 +165,30 @@ typedef struct
 #define PAGE_WRITE_TIME_MS     ((PAGE_SIZE / 4 * WORD_WRITE_TIME_US) / 1000 + 1)
 #define MARGIN_TIME_SYS        10                                               // In system time units
 
+/* Flash access. All Flash operations of the NVM manager go through the following
+   macros, so a build may redefine them, together with PAGE_SIZE, to run the databases
+   on another driver or on a RAM model of the Flash. NVMDB_FLASH_WRITE() programs a
+   word (bits can only be cleared), NVMDB_FLASH_WRITE_BURST() programs four words from
+   a word-aligned buffer at a 16-byte aligned address, NVMDB_FLASH_ERASE_PAGE() sets
+   whole pages to 0xFF. Page numbers count from NVMDB_FLASH_BASE. NVMDB_FLASH_END is the last byte
+   of the Flash; the databases are placed below it in nvm_db_conf.c. */
+#ifndef NVMDB_FLASH_BASE
+#define NVMDB_FLASH_BASE  _MEMORY_FLASH_BEGIN_
+#endif
+
+#ifndef NVMDB_FLASH_END
+#define NVMDB_FLASH_END   _MEMORY_FLASH_END_
+#endif
+
+#ifndef NVMDB_FLASH_WRITE
 #define NVMDB_FLASH_WRITE(address, word)  HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address, word)
+#endif
+
+#ifndef NVMDB_FLASH_WRITE_BURST
+#define NVMDB_FLASH_WRITE_BURST(address, data_p)  HAL_FLASH_Program(FLASH_TYPEPROGRAM_BURST, address, (uint32_t)(data_p))
+#endif
+
+#ifndef NVMDB_FLASH_ERASE_PAGE
 #define NVMDB_FLASH_ERASE_PAGE(page_num, num_pages)   do {                                              \
                                                         FLASH_EraseInitTypeDef EraseInit = {            \
                                                           .TypeErase = FLASH_TYPEERASE_PAGES,          \
@@ -127,6 +198,7 @@ typedef struct
                                                         uint32_t PageError;                             \
                                                         HAL_FLASHEx_Erase(&EraseInit, &PageError);       \
                                                       }while(0)
+#endif
 
 /**
  * @}
@@ -30,6 +30,20 @@
 #define PROCESS_CACHE_AT_ONCE   1
 #define NVM_CACHE               0
 
+/* Records waiting in cache are not indexed, so the index is only available without cache. */
+#if (NVMDB_INDEX_ENTRIES > 0) && !NVM_CACHE
+#define NVMDB_INDEX             1
+#else
+#define NVMDB_INDEX             0
+#endif
+
+/* With the cache, the clean of large databases is scheduled in cache instead. */
+#if (NVMDB_CLEAN_STEP_WORDS > 0) && !NVM_CACHE
+#define NVMDB_SLICED_CLEAN      1
+#else
+#define NVMDB_SLICED_CLEAN      0
+#endif
+
 /** @defgroup NVM_Manager  NVM Manager
  * @{
  */
@@ -47,12 +61,23 @@ typedef struct
 
 #define RECORD_HEADER_SIZE  4
 
+#define BURST_SIZE          16  // Bytes programmed by NVMDB_FLASH_WRITE_BURST().
+
 typedef struct
 {
   NVMDB_RecordHeaderType header;
   uint8_t data[];
 } NVMDB_RecordType, *NVMDB_RecordType_ptr;
 
+#if NVMDB_INDEX
+typedef struct
+{
+  uint16_t offset;      // Offset of the record from the start of the database.
+  uint16_t hash;        // Hash of the record key.
+  uint8_t record_id;
+} NVMDB_IndexEntryType;
+#endif
+
 typedef struct
 {
   uint32_t start_address;
@@ -62,6 +87,11 @@ typedef struct
   uint16_t free_space;  // Free space at the end of last record. It is a real free space, not virtual. After a clean, the free space may increase. It takes also into account all the records in cache.
   uint8_t locked;
   uint16_t clean_threshold;
+#if NVMDB_INDEX
+  uint8_t index_valid;  // FALSE if a record did not fit in the index. Searches scan the Flash until the next rebuild.
+  uint16_t index_count;
+  NVMDB_IndexEntryType index[NVMDB_INDEX_ENTRIES];  // Valid records sorted by offset.
+#endif
 } NVMDB_info;
 
 typedef struct
@@ -71,6 +101,22 @@ typedef struct
   NVMDB_RecordSizeType record_length;
 }ReadStateType;
 
+#if NVMDB_SLICED_CLEAN
+typedef struct
+{
+  uint8_t step;
+  uint8_t started;              // FALSE until the first page is erased.
+  uint8_t waits;                // Consecutive attempts refused by NVMDB_TimeCheck().
+  uint8_t last_page;            // TRUE if no records follow the ones in buffer.
+  uint16_t num_bytes;           // Bytes of buffer to be written at flash_address.
+  uint16_t written_bytes;       // Bytes of buffer already written.
+  uint32_t flash_address;       // Start of the page being rewritten.
+  NVMDB_HandleType handle;      // Next record to be read.
+  ReadStateType read_state;
+  uint32_t buffer[PAGE_SIZE / 4];  // New content of the page. Once the page is erased, this is the only copy.
+}CleanLargeStateType;
+#endif
+
 // Generic structure
 typedef struct
 {
@@ -158,6 +204,12 @@ typedef struct
 #define SMALL_DB 1
 #define LARGE_DB 2
 
+#define CLEAN_IDLE              0
+#define CLEAN_LOAD              1
+#define CLEAN_ERASE             2
+#define CLEAN_PROGRAM           3
+#define CLEAN_ERASE_TAIL        4
+
 #ifdef DEBUG
 #include <stdio.h>
 #define PRINTF(...) printf(__VA_ARGS__)
@@ -209,6 +261,9 @@ typedef struct
 static uint8_t NVM_buffer[PAGE_SIZE];
 #endif
 static NVMDB_info DBInfo[NUM_DB];
+#if NVMDB_SLICED_CLEAN
+static CleanLargeStateType clean_state;
+#endif
 #if NVM_CACHE
 static uint8_t NVM_cache[NVM_CACHE_SIZE];
 static uint16_t cache_head = 0, cache_tail = 0;
@@ -252,6 +307,13 @@ static int8_t NVMDB_CleanCheck(void);
  * @{
  */
 
+#if NVM_CACHE || NVMDB_SLICED_CLEAN
+static int32_t CalculateFlashTimeOperation(uint16_t write_length, uint8_t num_pages_to_be_erased)
+{
+  return PAGE_ERASE_TIME_SYS * num_pages_to_be_erased + (write_length / 4 + 1) * WORD_WRITE_TIME_SYS + MARGIN_TIME_SYS;
+}
+#endif
+
 #if NVM_CACHE
 
 static void CacheAdvanceHead(uint16_t length)
@@ -349,11 +411,6 @@ static void RemoveCacheOp(NVMDB_IdType NVMDB_id)
   }
 }
 
-static int32_t CalculateFlashTimeOperation(uint16_t write_length, uint8_t num_pages_to_be_erased)
-{
-  return PAGE_ERASE_TIME_SYS * num_pages_to_be_erased + (write_length / 4 + 1) * WORD_WRITE_TIME_SYS + MARGIN_TIME_SYS;
-}
-
 static NVMDB_status_t EraseWithTimeCheck(uint8_t *page_num_start, uint8_t *num_pages_p)
 {
   int32_t needed_time;
@@ -385,6 +442,161 @@ static NVMDB_status_t EraseWithTimeCheck(uint8_t *page_num_start, uint8_t *num_p
 
 #endif
 
+#if NVMDB_INDEX
+
+static uint16_t IndexHash(const uint8_t *key)
+{
+  uint32_t hash = 2166136261u;  // FNV-1a, folded to 16 bits
+
+  for(int i = 0; i < NVMDB_INDEX_KEY_LEN; i++)
+  {
+    hash = (hash ^ key[i]) * 16777619u;
+  }
+
+  return (uint16_t)(hash ^ (hash >> 16));
+}
+
+/* Records are always appended after the last one, so adding at the end keeps the index sorted. */
+static void IndexAdd(NVMDB_info *info, uint32_t address)
+{
+  NVMDB_RecordType_ptr record_p = (NVMDB_RecordType_ptr)address;
+  NVMDB_IndexEntryType *entry_p;
+
+  if(record_p->header.length < NVMDB_INDEX_KEY_OFFSET + NVMDB_INDEX_KEY_LEN)
+  {
+    // Too short to match an indexed search.
+    return;
+  }
+
+  if(info->index_count == NVMDB_INDEX_ENTRIES)
+  {
+    info->index_valid = FALSE;
+    return;
+  }
+
+  entry_p = &info->index[info->index_count++];
+  entry_p->offset = address - info->start_address;
+  entry_p->hash = IndexHash(record_p->data + NVMDB_INDEX_KEY_OFFSET);
+  entry_p->record_id = record_p->header.record_id;
+}
+
+/* Position of the first entry whose offset is not lower than the given one. */
+static uint16_t IndexLowerBound(const NVMDB_info *info, uint32_t offset)
+{
+  uint16_t low = 0, high = info->index_count;
+
+  while(low < high)
+  {
+    uint16_t mid = (low + high) / 2;
+
+    if(info->index[mid].offset < offset)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+static void IndexRemove(NVMDB_info *info, uint32_t address)
+{
+  uint32_t offset = address - info->start_address;
+  uint16_t i = IndexLowerBound(info, offset);
+
+  if(i < info->index_count && info->index[i].offset == offset)
+  {
+    memmove(&info->index[i], &info->index[i + 1], (info->index_count - i - 1) * sizeof(info->index[0]));
+    info->index_count--;
+  }
+}
+
+/* Same result as the Flash scan in FindNextRecordScan(), for a pattern starting at
+   NVMDB_INDEX_KEY_OFFSET and at least NVMDB_INDEX_KEY_LEN bytes long. */
+static NVMDB_status_t IndexFindNextRecord(NVMDB_HandleType *handle_p, uint8_t type, const uint8_t *pattern_p, NVMDB_RecordSizeType pattern_length, uint8_t **data_p, NVMDB_RecordSizeType *data_len)
+{
+  const NVMDB_info *info = &DBInfo[handle_p->id];
+  NVMDB_RecordType_ptr record_p;
+  uint16_t hash = IndexHash(pattern_p);
+  uint32_t offset = handle_p->address - info->start_address;
+  uint16_t i;
+
+  if(handle_p->address >= handle_p->end_address)
+  {
+    return NVMDB_STATUS_END_OF_DB;
+  }
+
+  // If it is not the first read, the search starts after the current record.
+  for(i = IndexLowerBound(info, handle_p->first_read ? offset : offset + 1); i < info->index_count; i++)
+  {
+    if(info->index[i].hash != hash || (type != ALL_TYPES && info->index[i].record_id != type))
+    {
+      continue;
+    }
+
+    record_p = (NVMDB_RecordType_ptr)(info->start_address + info->index[i].offset);
+
+    if(pattern_length > record_p->header.length - NVMDB_INDEX_KEY_OFFSET)
+    {
+      continue;
+    }
+
+    if(memcmp(record_p->data + NVMDB_INDEX_KEY_OFFSET, pattern_p, pattern_length) == 0)
+    {
+      handle_p->address = (uint32_t)record_p;
+      handle_p->first_read = FALSE;
+      *data_p = record_p->data;
+      *data_len = record_p->header.length;
+      return NVMDB_STATUS_OK;
+    }
+  }
+
+  // Leave the handle on the last valid record, as a scan would have moved past it.
+  if(info->index_count && info->index[info->index_count - 1].offset >= offset)
+  {
+    handle_p->address = info->start_address + info->index[info->index_count - 1].offset;
+    handle_p->first_read = FALSE;
+  }
+
+  return NVMDB_STATUS_END_OF_DB;
+}
+
+#endif /* NVMDB_INDEX */
+
+/* Completes the Flash operations interrupted by a reset, so that the other functions only
+   see NO_RECORD, VALID_RECORD and INVALID_RECORD flags:
+   - a header with id or length programmed but no flag is an append that did not commit.
+     It is invalidated. A torn length can only have more bits set than the real one, so
+     the next header is still found after it, in erased Flash.
+   - any other flag is a torn invalidation, which is completed.
+   Called only from NVMDB_Init(), before the radio is active. */
+static void RepairDB(const NVMDB_info *info)
+{
+  uint32_t address = info->start_address;
+  NVMDB_RecordType_ptr record_p;
+
+  while(address + MIN_RECORD_SIZE < info->end_address)
+  {
+    record_p = (NVMDB_RecordType_ptr)address;
+
+    if(record_p->header.valid_flag == NO_RECORD && *(uint32_t *)address == 0xFFFFFFFF)
+    {
+      return;
+    }
+
+    if(record_p->header.valid_flag != VALID_RECORD && record_p->header.valid_flag != INVALID_RECORD)
+    {
+      NVMDB_FLASH_WRITE(address, 0xFFFFFF00);
+    }
+
+    address += ROUND4_R(record_p->header.length + RECORD_HEADER_SIZE);
+  }
+}
+
+/* Also rebuilds the RAM index, if enabled. */
 static NVMDB_status_t NVMDB_get_info(NVMDB_info *info)
 {
   uint32_t address = info->start_address;
@@ -394,6 +606,10 @@ static NVMDB_status_t NVMDB_get_info(NVMDB_info *info)
   info->invalid_records = 0;
   info->free_space = 0;
   info->locked = FALSE;
+#if NVMDB_INDEX
+  info->index_count = 0;
+  info->index_valid = TRUE;
+#endif
 
   while(1)
   {
@@ -408,6 +624,9 @@ static NVMDB_status_t NVMDB_get_info(NVMDB_info *info)
     else if(record_p->header.valid_flag == VALID_RECORD)
     {
       info->valid_records++;
+#if NVMDB_INDEX
+      IndexAdd(info, address);
+#endif
     }
     else if(record_p->header.valid_flag == INVALID_RECORD)
     {
@@ -416,6 +635,9 @@ static NVMDB_status_t NVMDB_get_info(NVMDB_info *info)
     else
     {
       // Wrong flag
+#if NVMDB_INDEX
+      info->index_valid = FALSE;
+#endif
       return NVMDB_STATUS_CORRUPTED_DB;
     }
 
@@ -578,6 +800,32 @@ static NVMDB_status_t ReadNextRecordNoLock(NVMDB_HandleType *handle_p, uint8_t r
   return NVMDB_STATUS_OK;
 }
 
+static NVMDB_status_t FindNextRecordScan(NVMDB_HandleType *handle_p, uint8_t type, NVMDB_RecordSizeType pattern_offset, const uint8_t *pattern_p, NVMDB_RecordSizeType pattern_length, uint8_t **data_p, NVMDB_RecordSizeType *data_len)
+{
+  NVMDB_status_t status;
+
+  while(1)
+  {
+
+    status = NextRecordNoLock(handle_p, type, data_p, data_len, 0, NULL);
+
+    if(status != NVMDB_STATUS_OK)
+    {
+      return status;
+    }
+
+    if(pattern_offset >= *data_len || pattern_length > *data_len - pattern_offset)
+    {
+      continue;
+    }
+
+    if(memcmp(*data_p + pattern_offset, pattern_p, pattern_length) == 0)
+    {
+      return NVMDB_STATUS_OK;
+    }
+  }
+}
+
 /**
  * @brief      Estimate if there is time to perform operations on DBs.
  *
@@ -593,6 +841,40 @@ __weak uint8_t NVMDB_TimeCheck(int32_t time)
   return TRUE;
 }
 
+/* Programs size bytes (multiple of 4) into erased Flash at a word-aligned address. Aligned
+   blocks of BURST_SIZE bytes are programmed in one burst, the rest one word at a time.
+   Erased values (0xFFFFFFFF) are not programmed. data does not need to be aligned. */
+static void ProgramWords(uint32_t flash_address, const uint8_t *data, uint32_t size)
+{
+  uint32_t burst[BURST_SIZE / 4];
+
+  while(size)
+  {
+    if((flash_address & (BURST_SIZE - 1)) == 0 && size >= BURST_SIZE)
+    {
+      memcpy(burst, data, BURST_SIZE);
+      if((burst[0] & burst[1] & burst[2] & burst[3]) != 0xFFFFFFFF)
+      {
+        NVMDB_FLASH_WRITE_BURST(flash_address, burst);
+      }
+      flash_address += BURST_SIZE;
+      data += BURST_SIZE;
+      size -= BURST_SIZE;
+    }
+    else
+    {
+      memcpy(burst, data, 4);
+      if(burst[0] != 0xFFFFFFFF)
+      {
+        NVMDB_FLASH_WRITE(flash_address, burst[0]);
+      }
+      flash_address += 4;
+      data += 4;
+      size -= 4;
+    }
+  }
+}
+
 /* flash_address must be word aligned. */
 static void write_data(uint32_t flash_address, uint16_t data_length, const void *data)
 {
@@ -604,32 +886,32 @@ static void write_data(uint32_t flash_address, uint16_t data_length, const void
   length_word = (data_length >> 2) << 2;
   rest = data_length - length_word;
 
-  for(int i = 0; i < length_word; i += 4)
+  ProgramWords(flash_address, data_8, length_word);
+
+  if(rest)
   {
-    memcpy(&word, data_8 + i, sizeof(word));
-    NVMDB_FLASH_WRITE(flash_address + i, word);
+    word = 0xFFFFFFFF;
+    memcpy(&word, data_8 + length_word, rest);
+    NVMDB_FLASH_WRITE(flash_address + length_word, word);
   }
-  word = 0xFFFFFFFF;
-  memcpy(&word, data_8 + length_word, rest);
-  NVMDB_FLASH_WRITE(flash_address + length_word, word);
 }
 
 static NVMDB_status_t WriteRecord(uint32_t flash_address, uint8_t record_id, uint16_t data1_length, const void *data1, uint16_t data2_length, const void *data2)
 {
   uint32_t word;
-  NVMDB_RecordHeaderType *header_p = (NVMDB_RecordHeaderType *)&word;
+  NVMDB_RecordHeaderType header;
 #if NVM_CACHE
   int32_t needed_time;
 #endif
 
   data1_length = ROUND4_R(data1_length); // Make sure data1_length is multiple of 4.
 
-  header_p->valid_flag = VALID_RECORD;
-  header_p->record_id = record_id;
-  header_p->length = data1_length + data2_length;
+  header.valid_flag = NO_RECORD;  // Set to VALID_RECORD once the data is in Flash.
+  header.record_id = record_id;
+  header.length = data1_length + data2_length;
 
 #if NVM_CACHE
-  needed_time = CalculateFlashTimeOperation(data1_length + data2_length + 4, 0);
+  needed_time = CalculateFlashTimeOperation(data1_length + data2_length + 8, 0);
 
   // Disable interrupts, to be sure that there are no additional delays while writing, which can cause writes to happen during
   // radio activity.
@@ -644,11 +926,18 @@ static NVMDB_status_t WriteRecord(uint32_t flash_address, uint8_t record_id, uin
 
   DEBUG_GPIO_HIGH();
 
+  memcpy(&word, &header, sizeof(word));
   NVMDB_FLASH_WRITE(flash_address, word);
 
   write_data(flash_address + 4, data1_length, data1);
   write_data(flash_address + 4 + data1_length, data2_length, data2);
 
+  // Programming the flag commits the record. If a reset interrupts the append before
+  // this point, NVMDB_Init() finds a header without flag and invalidates the record.
+  header.valid_flag = VALID_RECORD;
+  memcpy(&word, &header, sizeof(word));
+  NVMDB_FLASH_WRITE(flash_address, word);
+
   DEBUG_GPIO_LOW();
 #if NVM_CACHE
   ATOMIC_SECTION_END();
@@ -860,6 +1149,9 @@ static NVMDB_status_t NVMDB_DeleteRecordNoCache(const NVMDB_HandleType *handle_p
 
     DBInfo[handle_p->id].valid_records--;
     DBInfo[handle_p->id].invalid_records++;
+#if NVMDB_INDEX
+    IndexRemove(&DBInfo[handle_p->id], handle_p->address);
+#endif
 
     return NVMDB_STATUS_OK;
   }
@@ -871,7 +1163,7 @@ static NVMDB_status_t NVMDB_DeleteRecordNoCache(const NVMDB_HandleType *handle_p
 
 static void ErasePage(uint32_t address, uint8_t num_pages)
 {
-  int page_num = (address - _MEMORY_FLASH_BEGIN_) / PAGE_SIZE;
+  int page_num = (address - NVMDB_FLASH_BASE) / PAGE_SIZE;
 
   DEBUG_GPIO_HIGH();
   NVMDB_FLASH_ERASE_PAGE(page_num, num_pages);
@@ -891,10 +1183,7 @@ static void WriteBufferToFlash(uint32_t address, uint32_t *data, uint32_t size)
   ErasePage(address, ROUNDPAGE_R(size) / PAGE_SIZE);
 
   DEBUG_GPIO_HIGH();
-  for(int i = 0; i < size; i += 4)
-  {
-    NVMDB_FLASH_WRITE(address + i, data[i / 4]);
-  }
+  ProgramWords(address, (const uint8_t *)data, size);
   DEBUG_GPIO_LOW();
 }
 
@@ -985,6 +1274,11 @@ static NVMDB_status_t LoadDBToRAM(NVMDB_HandleType *handle_p, uint8_t *buff, uin
     }
   }
 }
+/* Known limitation: a clean rewrites each page in place. The page is erased, then the records
+   kept in RAM are programmed back, so a reset in between loses those records. The power-cut
+   fuzzer in Tests/host/nvmdb reports these cases separately. A fix needs a spare page where
+   the records are copied before the erase. */
+#if !NVMDB_SLICED_CLEAN
 // No inline to avoid allocating NVM_buffer multiple times at the same time.
 __NOINLINE static NVMDB_status_t CleanLargeDB(NVMDB_IdType NVMDB_id)
 {
@@ -1020,6 +1314,10 @@ __NOINLINE static NVMDB_status_t CleanLargeDB(NVMDB_IdType NVMDB_id)
 #endif
 
   status = NVMDB_HandleInit(NVMDB_id, &handle);
+  if(status != NVMDB_STATUS_OK)
+  {
+    return status;
+  }
   flash_write_address = (uint32_t)handle.address;
 
   InitReadState(&state);
@@ -1086,7 +1384,7 @@ __NOINLINE static NVMDB_status_t CleanLargeDB(NVMDB_IdType NVMDB_id)
   }
   // Erase remaining pages. A possible optimization could be to erase the page only if it is not already erased.
   uint8_t num_pages = (ROUNDPAGE_R(handle.end_address) - flash_write_address) / PAGE_SIZE;
-  uint8_t page_num_start = (flash_write_address - _MEMORY_FLASH_BEGIN_) / PAGE_SIZE;
+  uint8_t page_num_start = (flash_write_address - NVMDB_FLASH_BASE) / PAGE_SIZE;
 
 #if NVM_CACHE
 
@@ -1102,6 +1400,227 @@ __NOINLINE static NVMDB_status_t CleanLargeDB(NVMDB_IdType NVMDB_id)
   return NVMDB_get_info(&DBInfo[NVMDB_id]);
 }
 
+#else /* !NVMDB_SLICED_CLEAN */
+
+static uint8_t PageIsErased(uint32_t address)
+{
+  const uint32_t *word_p = (const uint32_t *)address;
+
+  for(uint32_t i = 0; i < PAGE_SIZE / 4; i++)
+  {
+    if(word_p[i] != 0xFFFFFFFF)
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* With force set, the erase runs even if it overlaps the next radio activity. */
+static uint8_t ErasePageWithTimeCheck(uint32_t address, uint8_t force)
+{
+  ATOMIC_SECTION_BEGIN();
+  if(!force && !NVMDB_TimeCheck(CalculateFlashTimeOperation(0, 1)))
+  {
+    ATOMIC_SECTION_END();
+    return FALSE;
+  }
+  ErasePage(address, 1);
+  ATOMIC_SECTION_END();
+
+  return TRUE;
+}
+
+/* Programs up to *size_p bytes, halving the size until it fits before the next radio
+   activity. *size_p returns the bytes programmed. With force set, a single word is
+   programmed even if there is no time for it. */
+static uint8_t ProgramWithTimeCheck(uint32_t address, const uint32_t *data, uint16_t *size_p, uint8_t force)
+{
+  uint16_t size = *size_p;
+
+  ATOMIC_SECTION_BEGIN();
+  while(!NVMDB_TimeCheck(CalculateFlashTimeOperation(size, 0)))
+  {
+    if(size > 4)
+    {
+      size = ROUND4_L(size / 2);
+    }
+    else if(force)
+    {
+      break;
+    }
+    else
+    {
+      ATOMIC_SECTION_END();
+      return FALSE;
+    }
+  }
+  DEBUG_GPIO_HIGH();
+  ProgramWords(address, (const uint8_t *)data, size);
+  DEBUG_GPIO_LOW();
+  ATOMIC_SECTION_END();
+
+  *size_p = size;
+
+  return TRUE;
+}
+
+/* Executes the steps of the clean in progress until it ends or there is no time for the next step.
+   Each page is loaded in RAM with the records that will be moved into it, then erased and written
+   up to NVMDB_CLEAN_STEP_WORDS words at a time, as many as fit before the next radio activity.
+   The records are only moved backwards, so the ones that are still to be read are never in the
+   page being rewritten. A step refused NVMDB_CLEAN_MAX_WAITS times in a row runs anyway, so the
+   database is never locked for long when the gaps between radio events are too short. */
+static NVMDB_status_t CleanLargeDBSteps(void)
+{
+  CleanLargeStateType *op = &clean_state;
+  NVMDB_status_t status;
+  uint16_t size;
+  uint8_t force;
+
+  while(1)
+  {
+    switch(op->step)
+    {
+      case CLEAN_LOAD:
+        status = LoadDBToRAM(&op->handle, (uint8_t *)op->buffer, sizeof(op->buffer), &op->num_bytes, &op->read_state);
+        if(status != NVMDB_STATUS_END_OF_DB && status != NVMDB_STATUS_OK) // This should not happen.
+        {
+          op->step = CLEAN_IDLE;
+          NVMDB_get_info(&DBInfo[op->handle.id]);
+          return status;
+        }
+        op->last_page = (status == NVMDB_STATUS_END_OF_DB);
+        op->written_bytes = 0;
+
+        if(op->num_bytes == 0)
+        {
+          op->step = CLEAN_ERASE_TAIL;
+        }
+        else if(op->num_bytes == PAGE_SIZE && memcmp((uint8_t *)op->flash_address, op->buffer, PAGE_SIZE) == 0)
+        {
+          // Content of the page does not change.
+          op->flash_address += PAGE_SIZE;
+          op->step = op->last_page ? CLEAN_ERASE_TAIL : CLEAN_LOAD;
+        }
+        else
+        {
+          op->step = CLEAN_ERASE;
+        }
+        break;
+
+      case CLEAN_ERASE:
+        force = (op->waits >= NVMDB_CLEAN_MAX_WAITS);
+        if(!ErasePageWithTimeCheck(op->flash_address, force))
+        {
+          op->waits++;
+          if(!op->started)
+          {
+            /* Nothing has been written yet. Give up instead of keeping the database locked
+               until there is time for an erase: the clean will be tried again later, and
+               forced once it has been refused NVMDB_CLEAN_MAX_WAITS times. */
+            op->step = CLEAN_IDLE;
+            DBInfo[op->handle.id].locked = FALSE;
+          }
+          return NVMDB_STATUS_NOT_ENOUGH_TIME;
+        }
+        op->waits = 0;
+        op->started = TRUE;
+        op->step = CLEAN_PROGRAM;
+        if(force)
+        {
+          // The radio activity is already late: go on at the next tick.
+          return NVMDB_STATUS_NOT_ENOUGH_TIME;
+        }
+        break;
+
+      case CLEAN_PROGRAM:
+        force = (op->waits >= NVMDB_CLEAN_MAX_WAITS);
+        size = MIN(op->num_bytes - op->written_bytes, NVMDB_CLEAN_STEP_WORDS * 4);
+        if(!ProgramWithTimeCheck(op->flash_address + op->written_bytes, op->buffer + op->written_bytes / 4, &size, force))
+        {
+          op->waits++;
+          return NVMDB_STATUS_NOT_ENOUGH_TIME;
+        }
+        op->waits = 0;
+        op->written_bytes += size;
+        if(op->written_bytes == op->num_bytes)
+        {
+          op->flash_address += PAGE_SIZE;
+          op->step = op->last_page ? CLEAN_ERASE_TAIL : CLEAN_LOAD;
+        }
+        if(force)
+        {
+          return NVMDB_STATUS_NOT_ENOUGH_TIME;
+        }
+        break;
+
+      case CLEAN_ERASE_TAIL:
+        if(op->flash_address >= ROUNDPAGE_R(op->handle.end_address))
+        {
+          // Update free space and unlock the database.
+          op->step = CLEAN_IDLE;
+          op->waits = 0;
+          return NVMDB_get_info(&DBInfo[op->handle.id]);
+        }
+        force = (op->waits >= NVMDB_CLEAN_MAX_WAITS);
+        if(!PageIsErased(op->flash_address) && !ErasePageWithTimeCheck(op->flash_address, force))
+        {
+          op->waits++;
+          return NVMDB_STATUS_NOT_ENOUGH_TIME;
+        }
+        op->waits = 0;
+        op->flash_address += PAGE_SIZE;
+        if(force)
+        {
+          return NVMDB_STATUS_NOT_ENOUGH_TIME;
+        }
+        break;
+
+      default:
+        return NVMDB_STATUS_OK;
+    }
+  }
+}
+
+/* Starts the clean, or continues the one in progress. Only one large database at a time
+   is cleaned: a clean in progress on another database is completed first. */
+static NVMDB_status_t CleanLargeDB(NVMDB_IdType NVMDB_id)
+{
+  NVMDB_status_t status;
+
+  if(clean_state.step != CLEAN_IDLE && clean_state.handle.id != NVMDB_id)
+  {
+    status = CleanLargeDBSteps();
+    if(status != NVMDB_STATUS_OK)
+    {
+      return status;
+    }
+  }
+
+  if(clean_state.step == CLEAN_IDLE)
+  {
+    if(!DBInfo[NVMDB_id].invalid_records)
+    {
+      return NVMDB_STATUS_OK;
+    }
+
+    NVMDB_HandleInit(NVMDB_id, &clean_state.handle);
+    clean_state.flash_address = clean_state.handle.address;
+    InitReadState(&clean_state.read_state);
+    clean_state.step = CLEAN_LOAD;
+    clean_state.started = FALSE;
+
+    // Records are moving: no other operations on this database until the end of the clean.
+    DBInfo[NVMDB_id].locked = TRUE;
+  }
+
+  return CleanLargeDBSteps();
+}
+
+#endif /* !NVMDB_SLICED_CLEAN */
+
 #if NVM_CACHE
 __NOINLINE static NVMDB_status_t ContinueCleanLargeDB(CacheCleanLargeOperationType *op)
 {
@@ -1157,7 +1676,7 @@ __NOINLINE static NVMDB_status_t ContinueCleanLargeDB(CacheCleanLargeOperationTy
 
   // Erase remaining pages. A possible optimization could be to erase the page only if it is not already erased.
   uint8_t num_pages = (ROUNDPAGE_R(op->handle.end_address) - op->flash_address) / PAGE_SIZE;
-  uint8_t page_num_start = (op->flash_address - _MEMORY_FLASH_BEGIN_) / PAGE_SIZE;
+  uint8_t page_num_start = (op->flash_address - NVMDB_FLASH_BASE) / PAGE_SIZE;
 
   if(EraseWithTimeCheck(&page_num_start, &num_pages) == NVMDB_STATUS_NOT_ENOUGH_TIME)
   {
@@ -1573,6 +2092,9 @@ static NVMDB_status_t NVMDB_AppendRecordNoCache(NVMDB_HandleType *handle_p, uint
   }
 
   DBInfo[handle_p->id].valid_records++;
+#if NVMDB_INDEX
+  IndexAdd(&DBInfo[handle_p->id], handle_p->address);
+#endif
 
   return NVMDB_STATUS_OK;
 }
@@ -1634,6 +2156,7 @@ NVMDB_status_t NVMDB_Init(void)
       }
       DBInfo[id].clean_threshold = clean_threshold;
 
+      RepairDB(&DBInfo[id]);
       status = NVMDB_get_info(&DBInfo[id]);
       if(status)
       {
@@ -1660,6 +2183,7 @@ NVMDB_status_t NVMDB_Init(void)
     DBInfo[id].clean_threshold = NVM_LARGE_DB_STATIC_INFO[i].clean_threshold;
 #endif
 
+    RepairDB(&DBInfo[id]);
     status = NVMDB_get_info(&DBInfo[id]);
     if(status)
     {
@@ -1791,37 +2315,34 @@ NVMDB_status_t NVMDB_FindNextRecord(NVMDB_HandleType *handle_p, uint8_t record_t
     return NVMDB_STATUS_CACHE_OP_PENDING;
   }
 
-  while(1)
+#if NVMDB_INDEX
+  if(DBInfo[handle_p->id].index_valid && pattern_offset == NVMDB_INDEX_KEY_OFFSET && pattern_length >= NVMDB_INDEX_KEY_LEN)
   {
+    status = IndexFindNextRecord(handle_p, record_type, pattern_p, pattern_length, &data, &record_len);
+  }
+  else
+#endif
+  {
+    status = FindNextRecordScan(handle_p, record_type, pattern_offset, pattern_p, pattern_length, &data, &record_len);
+  }
 
-    status = NextRecordNoLock(handle_p, record_type, &data, &record_len, 0, NULL);
-
-    if(status != NVMDB_STATUS_OK)
-    {
-      return status;
-    }
-
-    if(pattern_offset >= record_len || pattern_length > record_len - pattern_offset)
-    {
-      continue;
-    }
+  if(status != NVMDB_STATUS_OK)
+  {
+    return status;
+  }
 
-    if(memcmp(data + pattern_offset, pattern_p, pattern_length) == 0)
+  // Record has been found
+  if(data_p != NULL)
+  {
+    *size_p = record_len;
+    if(data_offset >= record_len)
     {
-      // Record has been found
-      if(data_p != NULL)
-      {
-        *size_p = record_len;
-        if(data_offset >= record_len)
-        {
-          return NVMDB_STATUS_INVALID_OFFSET;
-        }
-        memcpy(data_p, data + data_offset, MIN(record_len - data_offset, max_size));
-      }
-
-      return NVMDB_STATUS_OK;
+      return NVMDB_STATUS_INVALID_OFFSET;
     }
+    memcpy(data_p, data + data_offset, MIN(record_len - data_offset, max_size));
   }
+
+  return NVMDB_STATUS_OK;
 }
 
 /**
@@ -1919,6 +2440,11 @@ NVMDB_status_t NVMDB_AppendRecord(NVMDB_HandleType *handle_p, uint8_t record_typ
 success:
 
 #else /* NVM_CACHE */
+  if(DBInfo[handle_p->id].locked)
+  {
+    return NVMDB_STATUS_LOCKED;
+  }
+
   status = NVMDB_AppendRecordNoCache(handle_p, record_type, header_length, header, data_length, data);
 
   if(status != NVMDB_STATUS_OK)
@@ -1995,6 +2521,11 @@ NVMDB_status_t NVMDB_DeleteRecord(const NVMDB_HandleType *handle_p)
 
 #else /* NVM_CACHE */
 
+  if(DBInfo[handle_p->id].locked)
+  {
+    return NVMDB_STATUS_LOCKED;
+  }
+
   return NVMDB_DeleteRecordNoCache(handle_p);
 
 #endif
@@ -2040,7 +2571,7 @@ NVMDB_status_t NVMDB_Erase(NVMDB_IdType NVMDB_id)
     uint32_t start_address = DBInfo[NVMDB_id].start_address;
     uint32_t end_address = DBInfo[NVMDB_id].end_address;
 
-    page_num_start = (start_address - _MEMORY_FLASH_BEGIN_) / PAGE_SIZE;
+    page_num_start = (start_address - NVMDB_FLASH_BASE) / PAGE_SIZE;
     num_pages = (ROUNDPAGE_R(end_address) - start_address) / PAGE_SIZE;
 
 #if NVM_CACHE
@@ -2054,6 +2585,15 @@ NVMDB_status_t NVMDB_Erase(NVMDB_IdType NVMDB_id)
 
 #else
 
+#if NVMDB_SLICED_CLEAN
+    if(clean_state.step != CLEAN_IDLE && clean_state.handle.id == NVMDB_id)
+    {
+      // Records are erased anyway.
+      clean_state.step = CLEAN_IDLE;
+      clean_state.waits = 0;
+    }
+#endif
+
     NVMDB_FLASH_ERASE_PAGE(page_num_start, num_pages);
 
 #endif
@@ -2111,6 +2651,11 @@ NVMDB_status_t NVMDB_Erase(NVMDB_IdType NVMDB_id)
  *             page, the other write an erase operations are scheduled. Scheduled
  *             operations are temporarily stored in cache. While a clean operation
  *             is scheduled in cache, no other operations are allowed.
+ *             Without cache, the clean of a large DB is done in steps (see
+ *             NVMDB_CLEAN_STEP_WORDS). If there is no time for the next step,
+ *             NVMDB_STATUS_NOT_ENOUGH_TIME is returned, the DB stays locked and
+ *             NVMDB_Tick() continues the clean. A step refused NVMDB_CLEAN_MAX_WAITS
+ *             times in a row is executed anyway.
  *
  * @param      NVMDB_id The ID of the record to be cleaned.
  * @retval     Indicates if the function executed successfully.
@@ -2150,6 +2695,18 @@ NVMDB_status_t NVMDB_Tick(void)
   int8_t dirty_db_id;
 #endif
 
+#if NVMDB_SLICED_CLEAN
+  if(clean_state.step != CLEAN_IDLE)
+  {
+    NVMDB_status_t status = CleanLargeDBSteps();
+
+    if(status != NVMDB_STATUS_OK)
+    {
+      return status;
+    }
+  }
+#endif
+
 #if NVM_CACHE
 
   NVMDB_status_t status;
@@ -49,7 +49,7 @@
 #if PRESET1
 
 #define FLASH_NVM_DATASIZE  (2 * PAGE_SIZE)  // Make sure this space is reserved in the linker script.
-#define NVM_START_ADDRESS   (_MEMORY_FLASH_END_ - FLASH_NVM_DATASIZE + 1)
+#define NVM_START_ADDRESS   (NVMDB_FLASH_END - FLASH_NVM_DATASIZE + 1)
 
 #define DB0_SIZE  (PAGE_SIZE)
 #define DB1_SIZE  (PAGE_SIZE - 8) // Last 8 bytes in Flash are reserved for the lock/unlock word.
@@ -57,7 +57,7 @@
 #elif PRESET2
 
 #define FLASH_NVM_DATASIZE  (1 * PAGE_SIZE)  // Make sure this space is reserved in the linker script.
-#define NVM_START_ADDRESS   (_MEMORY_FLASH_END_ - FLASH_NVM_DATASIZE + 1)
+#define NVM_START_ADDRESS   (NVMDB_FLASH_END - FLASH_NVM_DATASIZE + 1)
 
 #define DB0_SIZE  (PAGE_SIZE - 8 - 64) // Last 8 bytes in Flash are reserved for the lock/unlock word.
 #define DB1_SIZE  (64)
@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file    crc_calc.h
+  * @brief   Software CRC-32 and CRC-16/CCITT-FALSE with selectable kernels.
+  ******************************************************************************
+  * CRC_CALC_IMPL picks the kernel at build time:
+  *  - CRC_CALC_BITWISE : no tables, one bit per iteration (smallest, slowest)
+  *  - CRC_CALC_NIBBLE  : 16-entry tables, 4 bits per lookup (96 bytes of flash)
+  *  - CRC_CALC_SLICE4  : slicing-by-4 for CRC-32 (4 KB) and a byte table for
+  *                       CRC-16 (512 bytes); one word per step on aligned data
+  * All kernels give identical results. The functions are reentrant and keep
+  * no state, so ISRs and tasks may share them.
+  ******************************************************************************
+  */
+
+#ifndef CRC_CALC_H
+#define CRC_CALC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRC_CALC_BITWISE        (0)
+#define CRC_CALC_NIBBLE         (1)
+#define CRC_CALC_SLICE4         (2)
+
+#ifndef CRC_CALC_IMPL
+#define CRC_CALC_IMPL           CRC_CALC_SLICE4
+#endif
+
+/* CRC-32 (IEEE 802.3, reflected 0xEDB88320): same result as zlib crc32() */
+#define CRC32_INIT              (0xFFFFFFFFu)
+
+/* CRC-16/CCITT-FALSE (0x1021, init 0xFFFF, not reflected, no final xor) */
+#define CRC16_CCITT_INIT        (0xFFFFu)
+
+/**
+ * @brief  Feed len bytes into a running CRC-32 (start from CRC32_INIT).
+ * @retval Updated running value; pass it to crc32_final() when done.
+ */
+uint32_t crc32_update(uint32_t crc, const void *data, uint32_t len);
+
+/** @brief Final xor of a running CRC-32. */
+static inline uint32_t crc32_final(uint32_t crc)
+{
+  return ~crc;
+}
+
+/** @brief One-shot CRC-32 of a buffer. */
+static inline uint32_t crc32_calc(const void *data, uint32_t len)
+{
+  return crc32_final(crc32_update(CRC32_INIT, data, len));
+}
+
+/**
+ * @brief  Feed len bytes into a running CRC-16/CCITT-FALSE (start from CRC16_CCITT_INIT).
+ * @retval Updated value; it is already final (no output xor).
+ */
+uint16_t crc16_ccitt_update(uint16_t crc, const void *data, uint32_t len);
+
+/** @brief One-shot CRC-16/CCITT-FALSE of a buffer. */
+static inline uint16_t crc16_ccitt_calc(const void *data, uint32_t len)
+{
+  return crc16_ccitt_update(CRC16_CCITT_INIT, data, len);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC_CALC_H */
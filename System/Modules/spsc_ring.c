@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file    spsc_ring.c
+  * @brief   Lock-free single-producer / single-consumer ring buffer.
+  ******************************************************************************
+  */
+
+#include "spsc_ring.h"
+#include <string.h>
+
+int spsc_ring_init(spsc_ring_t *r, void *buf, uint16_t item_size, uint16_t capacity)
+{
+  if ((r == NULL) || (buf == NULL) || (item_size == 0u) ||
+      (capacity == 0u) || (capacity > 32768u) || ((capacity & (capacity - 1u)) != 0u))
+  {
+    return -1;
+  }
+
+  r->buf = (uint8_t *)buf;
+  r->item_size = item_size;
+  r->mask = (uint16_t)(capacity - 1u);
+  r->head = 0;
+  r->tail = 0;
+  r->high_water = 0;
+  r->drops = 0;
+  return 0;
+}
+
+uint16_t spsc_ring_write(spsc_ring_t *r, const void *items, uint16_t n)
+{
+  uint16_t head = r->head;
+  uint16_t used = (uint16_t)(head - r->tail);
+  uint16_t idx = (uint16_t)(head & r->mask);
+  uint16_t first;
+
+  if ((uint16_t)(r->mask + 1u - used) < n)
+  {
+    r->drops++;
+    return 0;
+  }
+
+  first = (uint16_t)(r->mask + 1u - idx);
+  if (first > n)
+  {
+    first = n;
+  }
+  memcpy(&r->buf[(uint32_t)idx * r->item_size], items, (uint32_t)first * r->item_size);
+  memcpy(r->buf, (const uint8_t *)items + (uint32_t)first * r->item_size,
+         (uint32_t)(n - first) * r->item_size);
+
+  /* Items must be visible before the consumer sees the new head */
+  SPSC_RING_BARRIER();
+  r->head = (uint16_t)(head + n);
+
+  used = (uint16_t)(used + n);
+  if (used > r->high_water)
+  {
+    r->high_water = used;
+  }
+  return n;
+}
+
+uint16_t spsc_ring_read(spsc_ring_t *r, void *items, uint16_t n)
+{
+  uint16_t tail = r->tail;
+  uint16_t avail = (uint16_t)(r->head - tail);
+  uint16_t idx = (uint16_t)(tail & r->mask);
+  uint16_t first;
+
+  if (n > avail)
+  {
+    n = avail;
+  }
+  if (n == 0u)
+  {
+    return 0;
+  }
+
+  /* Head read above must not be reordered after the item reads */
+  SPSC_RING_BARRIER();
+
+  first = (uint16_t)(r->mask + 1u - idx);
+  if (first > n)
+  {
+    first = n;
+  }
+  memcpy(items, &r->buf[(uint32_t)idx * r->item_size], (uint32_t)first * r->item_size);
+  memcpy((uint8_t *)items + (uint32_t)first * r->item_size, r->buf,
+         (uint32_t)(n - first) * r->item_size);
+
+  /* Slots are free for the producer only after we are done reading them */
+  SPSC_RING_BARRIER();
+  r->tail = (uint16_t)(tail + n);
+  return n;
+}
+
+uint16_t spsc_ring_peek(spsc_ring_t *r, void **items)
+{
+  uint16_t tail = r->tail;
+  uint16_t avail = (uint16_t)(r->head - tail);
+  uint16_t idx = (uint16_t)(tail & r->mask);
+  uint16_t contig = (uint16_t)(r->mask + 1u - idx);
+
+  SPSC_RING_BARRIER();
+  *items = &r->buf[(uint32_t)idx * r->item_size];
+  return (avail < contig) ? avail : contig;
+}
+
+void spsc_ring_consume(spsc_ring_t *r, uint16_t n)
+{
+  SPSC_RING_BARRIER();
+  r->tail = (uint16_t)(r->tail + n);
+}
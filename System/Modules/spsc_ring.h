@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    spsc_ring.h
+  * @brief   Lock-free single-producer / single-consumer ring buffer.
+  ******************************************************************************
+  * One side (e.g. an ISR) only pushes, the other (e.g. a sequencer task) only
+  * pops. Each index is written by exactly one side and read with a single
+  * aligned 16-bit access, so no LDREX/STREX or critical section is needed on
+  * Cortex-M0+. Indices run freely and wrap at 2^16, so the capacity must be a
+  * power of two no larger than 32768 items.
+  ******************************************************************************
+  */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include "cmsis_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Orders the item copy against the index update (host builds may override) */
+#ifndef SPSC_RING_BARRIER
+#define SPSC_RING_BARRIER()     __DMB()
+#endif
+
+typedef struct
+{
+  uint8_t *buf;
+  uint16_t item_size;           /* bytes per item */
+  uint16_t mask;                /* capacity - 1 */
+  volatile uint16_t head;       /* written by the producer only */
+  volatile uint16_t tail;       /* written by the consumer only */
+  volatile uint16_t high_water; /* max items ever queued (producer) */
+  volatile uint32_t drops;      /* writes rejected because the ring was full (producer) */
+} spsc_ring_t;
+
+/**
+ * @brief  Bind a ring to caller-provided storage of capacity * item_size bytes.
+ * @retval 0 on success, -1 if capacity is not a power of two in [1, 32768].
+ */
+int spsc_ring_init(spsc_ring_t *r, void *buf, uint16_t item_size, uint16_t capacity);
+
+/** @brief Items currently queued (either side). */
+static inline uint16_t spsc_ring_count(const spsc_ring_t *r)
+{
+  return (uint16_t)(r->head - r->tail);
+}
+
+/** @brief Free slots (exact for the producer, a lower bound for anyone else). */
+static inline uint16_t spsc_ring_space(const spsc_ring_t *r)
+{
+  return (uint16_t)(r->mask + 1u - spsc_ring_count(r));
+}
+
+/**
+ * @brief  Producer: copy n items in, all or nothing.
+ * @retval n, or 0 if they do not fit (counted in drops).
+ */
+uint16_t spsc_ring_write(spsc_ring_t *r, const void *items, uint16_t n);
+
+/**
+ * @brief  Consumer: copy up to n items out.
+ * @retval Items read.
+ */
+uint16_t spsc_ring_read(spsc_ring_t *r, void *items, uint16_t n);
+
+/**
+ * @brief  Consumer: longest run of queued items that is contiguous in memory,
+ *         for handing straight to a DMA. Release it with spsc_ring_consume().
+ * @retval Items available at *items.
+ */
+uint16_t spsc_ring_peek(spsc_ring_t *r, void **items);
+
+/** @brief Consumer: drop n items previously returned by spsc_ring_peek(). */
+void spsc_ring_consume(spsc_ring_t *r, uint16_t n);
+
+static inline uint8_t spsc_ring_push(spsc_ring_t *r, const void *item)
+{
+  return (uint8_t)spsc_ring_write(r, item, 1u);
+}
+
+static inline uint8_t spsc_ring_pop(spsc_ring_t *r, void *item)
+{
+  return (uint8_t)spsc_ring_read(r, item, 1u);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPSC_RING_H */
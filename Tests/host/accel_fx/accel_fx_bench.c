@@ -0,0 +1,334 @@
+#include "accel_fx.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Integer magnitude and impact features of Core/Src/accel_fx.c against the
+// float path of the BMA456 handler they replaced, copied below. SAMPLES
+// synthetic samples at the 16g capture range, in windows of one FIFO capture:
+// a 1g resting level with noise in a random orientation, and in most windows
+// an impact pulse of random length, peak and direction, some up to full scale.
+// Checked: accel_fx_isqrt() is the floor of the square root at every square
+// boundary and for random values; every magnitude, peak, minimum, RMS and the
+// time above threshold match the exact (double) result; energy within 0.5%.
+// Reported: the largest difference to the float path and the time per sample
+// of both on the host. The host has an FPU, the Cortex-M0+ does not: there
+// sqrtf() and every float operation are software calls.
+//
+// Usage: accel_fx_bench <samples>
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+// As in bma456_app.h
+#define LSB_PER_G        2048
+#define ODR_HZ           1600
+#define THRESHOLD_MG     1500
+#define THRESHOLD_G      1.5f
+#define WINDOW           170     // samples in one FIFO capture
+
+static uint32_t rng_state = 1;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// Uniform in [-1, 1]
+static double urnd(void)
+{
+    return (double)(rnd() & 0xFFFFFF) / 0x7FFFFF - 1.0;
+}
+
+static int16_t clamp16(double v)
+{
+    if (v > 32767.0) return 32767;
+    if (v < -32768.0) return -32768;
+    return (int16_t)lrint(v);
+}
+
+// Random unit vector
+static void direction(double d[3])
+{
+    double n;
+
+    do {
+        d[0] = urnd();
+        d[1] = urnd();
+        d[2] = urnd();
+        n = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    } while (n < 0.1 || n > 1.0);
+    for (int i = 0; i < 3; i++)
+        d[i] /= n;
+}
+
+// One capture: gravity plus noise, and usually a half-sine pulse on top
+static void window(struct bma4_accel *s, int n)
+{
+    double g[3], p[3];
+    double peak = 1.5 + (rnd() % 1000) * 0.0145;        // 1.5 .. 16 g
+    int len = 1 + (int)(rnd() % 40);
+    int start = (int)(rnd() % (n - len));
+    int pulse = rnd() % 8 != 0;
+
+    direction(g);
+    direction(p);
+    for (int i = 0; i < n; i++) {
+        double a[3];
+
+        for (int k = 0; k < 3; k++)
+            a[k] = g[k] * LSB_PER_G + urnd() * 60.0;
+        if (pulse && i >= start && i < start + len) {
+            double f = peak * LSB_PER_G * sin(M_PI * (i - start + 0.5) / len);
+
+            for (int k = 0; k < 3; k++)
+                a[k] += p[k] * f;
+        }
+        s[i].x = clamp16(a[0]);
+        s[i].y = clamp16(a[1]);
+        s[i].z = clamp16(a[2]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Reference: the float path of bma456_app.c before accel_fx
+
+typedef struct
+{
+    float peak_g;
+    float duration_ms;
+    float energy;
+} ref_impact_t;
+
+static void ref_capture(const struct bma4_accel *chunk, uint16_t n, ref_impact_t *impact)
+{
+    const float dt_ms = 1000.0f / (float)ODR_HZ;
+    int32_t first_above = -1;
+    int32_t last_above = -1;
+
+    memset(impact, 0, sizeof(*impact));
+    for (uint16_t i = 0; i < n; i++) {
+        float x = chunk[i].x / (float)LSB_PER_G;
+        float y = chunk[i].y / (float)LSB_PER_G;
+        float z = chunk[i].z / (float)LSB_PER_G;
+        float mag = sqrtf(x * x + y * y + z * z);
+        float dyn = mag - 1.0f;
+
+        if (mag > impact->peak_g) {
+            impact->peak_g = mag;
+        }
+        if (mag > THRESHOLD_G) {
+            if (first_above < 0) {
+                first_above = i;
+            }
+            last_above = i;
+        }
+        impact->energy += dyn * dyn * dt_ms;
+    }
+    if (first_above >= 0) {
+        impact->duration_ms = (float)(last_above - first_above + 1) * dt_ms;
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+static void check_isqrt(long n)
+{
+    // Around every square that fits, then at random
+    for (uint32_t k = 1; k <= 65535u; k++) {
+        uint32_t sq = k * k;
+
+        CHECK(accel_fx_isqrt(sq) == k);
+        CHECK(accel_fx_isqrt(sq - 1u) == k - 1u);
+        if (k < 65535u)
+            CHECK(accel_fx_isqrt(sq + 2u * k) == k);
+    }
+    CHECK(accel_fx_isqrt(0) == 0);
+    CHECK(accel_fx_isqrt(UINT32_MAX) == 65535u);
+    for (long i = 0; i < n; i++) {
+        uint32_t v = (rnd() << 8) ^ rnd();
+        uint64_t r = accel_fx_isqrt(v);
+
+        CHECK(r * r <= v && (r + 1) * (r + 1) > v);
+    }
+}
+
+static double max_count_err, max_peak_err_mg, max_energy_err;
+static long float_span_diff, float_peak_diff;
+
+static void check_window(const struct bma4_accel *s, int n)
+{
+    accel_fx_window_t w;
+    ref_impact_t ref;
+    double sum_sq = 0, sum_dyn_sq = 0, min_mag = 1e9, max_mag = 0, e_exact, e_fx;
+    long first = -1, last = -1;
+    uint16_t span;
+
+    accel_fx_window_init(&w, LSB_PER_G, (uint16_t)((THRESHOLD_MG * (uint32_t)LSB_PER_G) / 1000u));
+    // Fed in odd chunks, as the FIFO path does
+    for (int i = 0; i < n; i += 32)
+        accel_fx_window_add(&w, &s[i], (uint16_t)(n - i < 32 ? n - i : 32));
+    ref_capture(s, (uint16_t)n, &ref);
+
+    for (int i = 0; i < n; i++) {
+        double x = s[i].x, y = s[i].y, z = s[i].z;
+        double sq = x * x + y * y + z * z;
+        double mag = sqrt(sq);
+        double fl = floor(mag);
+        float fx = s[i].x / (float)LSB_PER_G, fy = s[i].y / (float)LSB_PER_G, fz = s[i].z / (float)LSB_PER_G;
+        double err = fabs(accel_fx_mag(&s[i]) - sqrtf(fx * fx + fy * fy + fz * fz) * LSB_PER_G);
+
+        CHECK(accel_fx_mag_sq(&s[i]) == (uint32_t)sq);
+        CHECK(accel_fx_mag(&s[i]) == (uint16_t)fl);
+        if (err > max_count_err)
+            max_count_err = err;
+        if (fl < min_mag) min_mag = fl;
+        if (fl > max_mag) max_mag = fl;
+        if (mag > THRESHOLD_MG * LSB_PER_G / 1000.0) {
+            if (first < 0) first = i;
+            last = i;
+        }
+        sum_sq += sq;
+        sum_dyn_sq += (mag - LSB_PER_G) * (mag - LSB_PER_G);
+    }
+
+    // Exact features, magnitudes in whole counts
+    CHECK(w.n == n);
+    CHECK(w.max_mag == max_mag && w.min_mag == min_mag);
+    CHECK(accel_fx_window_rms(&w) == (uint16_t)floor(sqrt(floor(sum_sq / n))));
+    span = accel_fx_window_span(&w);
+    CHECK(span == (first < 0 ? 0 : last - first + 1));
+
+    // Energy from floored magnitudes, in milli-g^2*ms
+    e_exact = sum_dyn_sq / ((double)LSB_PER_G * LSB_PER_G) * 1000.0 / ODR_HZ * 1000.0;
+    e_fx = accel_fx_window_energy(&w, ODR_HZ);
+    CHECK(fabs(e_fx - e_exact) <= 1.0 + 0.005 * e_exact);
+    if (e_exact > 1000.0 && fabs(e_fx - e_exact) / e_exact > max_energy_err)
+        max_energy_err = fabs(e_fx - e_exact) / e_exact;
+
+    // Against the float path: under a count of floor (0.49 mg) plus the mg truncation
+    {
+        double d = fabs(accel_fx_counts_to_mg(w.max_mag, LSB_PER_G) - ref.peak_g * 1000.0);
+
+        CHECK(d < 1.0 + 1000.0 / LSB_PER_G);
+        if (d > max_peak_err_mg)
+            max_peak_err_mg = d;
+        if (accel_fx_counts_to_mg(w.max_mag, LSB_PER_G) != (int32_t)(ref.peak_g * 1000.0f))
+            float_peak_diff++;
+        if (lrintf(ref.duration_ms * ODR_HZ / 1000.0f) != span)
+            float_span_diff++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Time per sample over one buffer, repeated
+
+#define BENCH_N 4096
+
+static volatile uint32_t sink;
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void bench(long n)
+{
+    static struct bma4_accel buf[BENCH_N];
+    long reps = n / BENCH_N + 1;
+    double t0, ref_mag_ns, fx_mag_ns, ref_win_ns, fx_win_ns;
+    float facc = 0;
+    uint32_t acc = 0;
+
+    for (int i = 0; i + WINDOW <= BENCH_N; i += WINDOW)
+        window(&buf[i], WINDOW);
+
+    t0 = now_ns();
+    for (long r = 0; r < reps; r++)
+        for (int i = 0; i < BENCH_N; i++) {
+            float x = buf[i].x / (float)LSB_PER_G;
+            float y = buf[i].y / (float)LSB_PER_G;
+            float z = buf[i].z / (float)LSB_PER_G;
+
+            facc += sqrtf(x * x + y * y + z * z);
+        }
+    ref_mag_ns = (now_ns() - t0) / ((double)reps * BENCH_N);
+
+    t0 = now_ns();
+    for (long r = 0; r < reps; r++)
+        for (int i = 0; i < BENCH_N; i++)
+            acc += accel_fx_mag(&buf[i]);
+    fx_mag_ns = (now_ns() - t0) / ((double)reps * BENCH_N);
+
+    t0 = now_ns();
+    for (long r = 0; r < reps; r++) {
+        ref_impact_t impact;
+
+        ref_capture(buf, BENCH_N, &impact);
+        facc += impact.energy;
+    }
+    ref_win_ns = (now_ns() - t0) / ((double)reps * BENCH_N);
+
+    t0 = now_ns();
+    for (long r = 0; r < reps; r++) {
+        accel_fx_window_t w;
+
+        accel_fx_window_init(&w, LSB_PER_G, (uint16_t)((THRESHOLD_MG * (uint32_t)LSB_PER_G) / 1000u));
+        accel_fx_window_add(&w, buf, BENCH_N);
+        acc += accel_fx_window_energy(&w, ODR_HZ);
+    }
+    fx_win_ns = (now_ns() - t0) / ((double)reps * BENCH_N);
+    sink = acc + (uint32_t)facc;
+
+    printf("ns per sample (host, %ld samples), float -> integer:\n", reps * BENCH_N);
+    printf("  magnitude        %6.2f -> %6.2f\n", ref_mag_ns, fx_mag_ns);
+    printf("  window features  %6.2f -> %6.2f\n", ref_win_ns, fx_win_ns);
+}
+
+int main(int argc, char **argv)
+{
+    static struct bma4_accel s[WINDOW];
+    long n, windows;
+
+    CHECK(argc == 2);
+    n = atol(argv[1]);
+    CHECK(n >= WINDOW);
+
+    check_isqrt(n);
+
+    // Full scale on every axis, including -32768
+    for (int i = 0; i < WINDOW; i++) {
+        s[i].x = (int16_t)(i & 1 ? 32767 : -32768);
+        s[i].y = (int16_t)(i & 2 ? 32767 : -32768);
+        s[i].z = (int16_t)(i & 4 ? 32767 : -32768);
+    }
+    check_window(s, WINDOW);
+
+    windows = n / WINDOW;
+    for (long k = 0; k < windows; k++) {
+        window(s, WINDOW);
+        check_window(s, WINDOW);
+    }
+
+    printf("%ld windows of %d samples, isqrt at all square boundaries and %ld random values:\n",
+           windows, WINDOW, n);
+    printf("  magnitude, min, peak, RMS and time above %d mg exact; energy within %.3f%% (above 1 g^2*ms)\n",
+           THRESHOLD_MG, 100.0 * max_energy_err);
+    printf("  against float: magnitude within %.3f counts, peak within %.3f mg; %ld peaks a mg apart, "
+           "%ld durations a sample apart\n",
+           max_count_err, max_peak_err_mg, float_peak_diff, float_span_diff);
+    bench(n);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,439 @@
+#include "sensor_model.h"
+#include "air_app.h"
+#include "bme690_port.h"
+#include "bsec_interface.h"
+#include "bsec_state_store.h"
+#include "p2p_server_app.h"
+#include "stm32_seq.h"
+#include "telemetry.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Time the air task is blocked per BSEC cycle, on the sensor model of
+// ../bme690_array (both BME690s on the bus, 100 kHz wire times, virtual
+// clock). BSEC is a stub that asks for a forced measurement every 3 s (LP:
+// 2x/16x/1x oversampling, 320 C for 197 ms) and checks the timestamps it is
+// fed. For MINUTES simulated minutes, each in its own process:
+//   blocking  the loop before the split, copied below: configure, trigger,
+//             delay_us() for conversion + heater + 20 ms, then read, for the
+//             BSEC sensor and every 10 s the raw one
+//   split     air_app.c on the sequencer, woken by air_app_tick() at the
+//             deadlines it arms; the heater time passes between two passes
+// Blocked time is the virtual time spent inside the air task: busy-wait
+// delays plus transfers the task waits for. The split task must not delay at
+// all after init and must feed BSEC the same measurements.
+//
+// Usage: air_app_blocked <minutes>
+
+#define LP_PERIOD_NS 3000000000LL
+
+typedef struct
+{
+    long passes, bsec_samples;
+    uint64_t blocked_us, delay_us, wire_us, max_pass_us;
+} result_t;
+
+static result_t *res;
+static int64_t next_control_ns, trigger_ns;
+static long triggers;
+
+// ---------------------------------------------------------------------------
+// BSEC stub
+
+size_t bsec_get_instance_size(void)
+{
+    return 1000;
+}
+
+bsec_library_return_t bsec_init(void *inst)
+{
+    (void)inst;
+    next_control_ns = 0;
+    return BSEC_OK;
+}
+
+bsec_library_return_t bsec_set_configuration(void *inst, const uint8_t *const serialized_settings,
+                                             const uint32_t n_serialized_settings, uint8_t *work_buffer,
+                                             const uint32_t n_work_buffer_size)
+{
+    (void)inst;
+    (void)serialized_settings;
+    (void)n_serialized_settings;
+    (void)work_buffer;
+    (void)n_work_buffer_size;
+    return BSEC_OK;
+}
+
+bsec_library_return_t bsec_update_subscription(void *inst, const bsec_sensor_configuration_t *const requested_virtual_sensors,
+                                               const uint8_t n_requested_virtual_sensors,
+                                               bsec_sensor_configuration_t *required_sensor_settings,
+                                               uint8_t *n_required_sensor_settings)
+{
+    (void)inst;
+    (void)requested_virtual_sensors;
+    (void)n_requested_virtual_sensors;
+    (void)required_sensor_settings;
+    *n_required_sensor_settings = 0;
+    return BSEC_OK;
+}
+
+bsec_library_return_t bsec_sensor_control(void *inst, const int64_t time_stamp, bsec_bme_settings_t *sensor_settings)
+{
+    (void)inst;
+    memset(sensor_settings, 0, sizeof *sensor_settings);
+    if (time_stamp >= next_control_ns) {
+        sensor_settings->trigger_measurement = 1;
+        sensor_settings->run_gas = 1;
+        sensor_settings->heater_temperature = 320;
+        sensor_settings->heater_duration = 197;
+        sensor_settings->temperature_oversampling = BME69X_OS_2X;
+        sensor_settings->pressure_oversampling = BME69X_OS_16X;
+        sensor_settings->humidity_oversampling = BME69X_OS_1X;
+        sensor_settings->process_data = BSEC_PROCESS_TEMPERATURE | BSEC_PROCESS_HUMIDITY |
+                                        BSEC_PROCESS_PRESSURE | BSEC_PROCESS_GAS;
+        trigger_ns = time_stamp;
+        triggers++;
+        next_control_ns += LP_PERIOD_NS;
+    }
+    sensor_settings->next_call = next_control_ns;
+    return BSEC_OK;
+}
+
+bsec_library_return_t bsec_do_steps(void *inst, const bsec_input_t *const inputs, const uint8_t n_inputs,
+                                    bsec_output_t *outputs, uint8_t *n_outputs)
+{
+    (void)inst;
+    (void)outputs;
+    CHECK(n_inputs == 4);
+    for (uint8_t i = 0; i < n_inputs; i++)
+        CHECK(inputs[i].time_stamp == trigger_ns);
+    CHECK(inputs[3].sensor_id == BSEC_INPUT_GASRESISTOR && inputs[3].signal > 0);
+    *n_outputs = 0;
+    res->bsec_samples++;
+    return BSEC_OK;
+}
+
+// No state in Flash and no IAQ accuracy: the store is never asked to save
+HAL_StatusTypeDef bsec_state_store_init(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef bsec_state_store_load(void *bsec_inst, uint8_t *workbuf, uint32_t workbuf_len)
+{
+    (void)bsec_inst;
+    (void)workbuf;
+    (void)workbuf_len;
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef bsec_state_store_maybe_save(void *bsec_inst, uint8_t *workbuf, uint32_t workbuf_len,
+                                              uint32_t now_ms, uint32_t save_period_ms)
+{
+    (void)bsec_inst;
+    (void)workbuf;
+    (void)workbuf_len;
+    (void)now_ms;
+    (void)save_period_ms;
+    CHECK(0);
+    return HAL_ERROR;
+}
+
+// ---------------------------------------------------------------------------
+// Sequencer, telemetry, BLE and UART stand-ins
+
+static void (*task)(void);
+static int posted;
+
+void UTIL_SEQ_RegTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Flags, void (*Task)(void))
+{
+    (void)Flags;
+    CHECK(TaskId_bm == 1U << CFG_TASK_AIR_APP);
+    task = Task;
+}
+
+void UTIL_SEQ_SetTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Task_Prio)
+{
+    (void)Task_Prio;
+    CHECK(TaskId_bm == 1U << CFG_TASK_AIR_APP);
+    posted = 1;
+}
+
+HAL_StatusTypeDef telemetry_put(uint8_t type, const void *payload, uint8_t len)
+{
+    (void)type;
+    (void)payload;
+    (void)len;
+    return HAL_OK;
+}
+
+void P2P_SERVER_APP_PushAirSample(const air_readings_packed_t *p_Sample, uint32_t TimestampMs)
+{
+    (void)p_Sample;
+    (void)TimestampMs;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size,
+                                    uint32_t Timeout)
+{
+    (void)huart;
+    (void)pData;
+    (void)Size;
+    (void)Timeout;
+    return HAL_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Reference: the BSEC and raw sensor steps before the split
+
+#define PRINT_PERIOD_MS (10000)
+
+static struct bme69x_dev s_bme_raw;
+static struct bme69x_dev s_bme_bsec;
+
+static int8_t config_bme_tph(struct bme69x_dev *dev)
+{
+    struct bme69x_conf conf = {0};
+    conf.os_temp = BME69X_OS_2X;
+    conf.os_pres = BME69X_OS_16X;
+    conf.os_hum  = BME69X_OS_1X;
+    conf.filter  = BME69X_FILTER_SIZE_3;
+    conf.odr     = BME69X_ODR_NONE;
+
+    return bme69x_set_conf(&conf, dev);
+}
+
+static int8_t read_raw_sensor(struct bme69x_data *data)
+{
+    int8_t rslt;
+    uint8_t n = 0;
+
+    rslt = bme69x_set_op_mode(BME69X_FORCED_MODE, &s_bme_raw);
+    if (rslt != BME69X_OK) return rslt;
+
+    /* Wait for measurement completion */
+    struct bme69x_conf conf;
+    rslt = bme69x_get_conf(&conf, &s_bme_raw);
+    if (rslt != BME69X_OK) return rslt;
+
+    uint32_t dur_us = bme69x_get_meas_dur(BME69X_FORCED_MODE, &conf, &s_bme_raw);
+    s_bme_raw.delay_us(dur_us + 20000, s_bme_raw.intf_ptr); /* +20ms margin */
+
+    rslt = bme69x_get_data(BME69X_FORCED_MODE, data, &n, &s_bme_raw);
+    if (rslt != BME69X_OK || n == 0) return rslt;
+    return BME69X_OK;
+}
+
+static int8_t bsec_apply_settings_and_measure(const bsec_bme_settings_t *s, struct bme69x_data *out)
+{
+    int8_t rslt;
+
+    if (!s->trigger_measurement)
+    {
+        return BME69X_W_NO_NEW_DATA;
+    }
+
+    /* Configure oversampling and filter for BSEC sensor */
+    struct bme69x_conf conf = {0};
+    conf.os_temp = s->temperature_oversampling;
+    conf.os_hum  = s->humidity_oversampling;
+    conf.os_pres = s->pressure_oversampling;
+    conf.filter  = BME69X_FILTER_SIZE_3;
+    conf.odr     = BME69X_ODR_NONE;
+
+    rslt = bme69x_set_conf(&conf, &s_bme_bsec);
+    if (rslt != BME69X_OK) return rslt;
+
+    /* Configure heater if requested */
+    struct bme69x_heatr_conf h = {0};
+    if (s->run_gas)
+    {
+        h.enable = BME69X_ENABLE;
+        h.heatr_temp = s->heater_temperature;
+        h.heatr_dur  = s->heater_duration;
+    }
+    else
+    {
+        h.enable = BME69X_DISABLE;
+        h.heatr_temp = 0;
+        h.heatr_dur  = 0;
+    }
+
+    rslt = bme69x_set_heatr_conf(BME69X_FORCED_MODE, &h, &s_bme_bsec);
+    if (rslt != BME69X_OK) return rslt;
+
+    /* Trigger measurement */
+    rslt = bme69x_set_op_mode(BME69X_FORCED_MODE, &s_bme_bsec);
+    if (rslt != BME69X_OK) return rslt;
+
+    /* Wait until measurement should be done */
+    uint32_t dur_us = bme69x_get_meas_dur(BME69X_FORCED_MODE, &conf, &s_bme_bsec);
+    s_bme_bsec.delay_us(dur_us + ((uint32_t)s->heater_duration * 1000U) + 20000U, s_bme_bsec.intf_ptr);
+
+    /* Read data */
+    uint8_t n = 0;
+    rslt = bme69x_get_data(BME69X_FORCED_MODE, out, &n, &s_bme_bsec);
+    if (rslt != BME69X_OK || n == 0) return rslt;
+
+    return BME69X_OK;
+}
+
+// The sensor part of the old air_app_process(): raw sensor every 10 s, BSEC when due
+static void ref_process(uint32_t *last_raw_ms, uint32_t *next_bsec_ms)
+{
+    uint32_t now_ms = HAL_GetTick();
+    struct bme69x_data d;
+
+    if ((now_ms - *last_raw_ms) >= PRINT_PERIOD_MS)
+    {
+        CHECK(read_raw_sensor(&d) == BME69X_OK);
+        *last_raw_ms = now_ms;
+    }
+
+    if ((int32_t)(now_ms - *next_bsec_ms) >= 0)
+    {
+        bsec_bme_settings_t s;
+
+        CHECK(bsec_sensor_control(NULL, (int64_t)now_ms * 1000000LL, &s) == BSEC_OK);
+        *next_bsec_ms = (uint32_t)(s.next_call / 1000000LL);
+        if (s.trigger_measurement)
+        {
+            bsec_input_t in[4];
+            bsec_output_t out[8];
+            uint8_t n_out = 8;
+            int64_t ts = (int64_t)now_ms * 1000000LL;
+
+            CHECK(bsec_apply_settings_and_measure(&s, &d) == BME69X_OK);
+            in[0] = (bsec_input_t){ .time_stamp = ts, .signal = d.temperature / 100.0f, .sensor_id = BSEC_INPUT_TEMPERATURE };
+            in[1] = (bsec_input_t){ .time_stamp = ts, .signal = d.humidity / 1000.0f, .sensor_id = BSEC_INPUT_HUMIDITY };
+            in[2] = (bsec_input_t){ .time_stamp = ts, .signal = (float)d.pressure, .sensor_id = BSEC_INPUT_PRESSURE };
+            in[3] = (bsec_input_t){ .time_stamp = ts, .signal = (float)d.gas_resistance, .sensor_id = BSEC_INPUT_GASRESISTOR };
+            (void)bsec_do_steps(NULL, in, 4, out, &n_out);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+static void pass_begin(uint64_t *t, uint64_t *delay, uint64_t *wire)
+{
+    *t = model.now_us;
+    *delay = model.delay_us;
+    *wire = model.wire_us;
+}
+
+static void pass_end(result_t *r, uint64_t t, uint64_t delay, uint64_t wire)
+{
+    uint64_t us = model.now_us - t;
+
+    r->passes++;
+    r->blocked_us += us;
+    r->delay_us += model.delay_us - delay;
+    r->wire_us += model.wire_us - wire;
+    if (us > r->max_pass_us)
+        r->max_pass_us = us;
+}
+
+static void run(int split, uint64_t end_us, result_t *r)
+{
+    static I2C_HandleTypeDef hi2c;
+    static UART_HandleTypeDef huart;
+    uint64_t t, delay, wire;
+
+    res = r;
+    model_reset();
+    model_add(0x77, MODEL_DIRECT, 1u);
+    model_add(0x76, MODEL_DIRECT, 2u);
+
+    if (!split) {
+        uint32_t last_raw_ms, next_bsec_ms;
+
+        CHECK(bme690_port_init_i2c(&s_bme_raw, &hi2c, 0x77) == BME69X_OK);
+        CHECK(bme690_port_init_i2c(&s_bme_bsec, &hi2c, 0x76) == BME69X_OK);
+        CHECK(bme69x_init(&s_bme_raw) == BME69X_OK);
+        CHECK(bme69x_init(&s_bme_bsec) == BME69X_OK);
+        CHECK(config_bme_tph(&s_bme_raw) == BME69X_OK);
+        CHECK(bsec_init(NULL) == BSEC_OK);
+        last_raw_ms = HAL_GetTick() - PRINT_PERIOD_MS;
+        next_bsec_ms = HAL_GetTick();
+        next_control_ns = (int64_t)next_bsec_ms * 1000000LL;
+
+        // Each pass runs at the earliest deadline
+        while (model.now_us < end_us) {
+            uint32_t next_ms = last_raw_ms + PRINT_PERIOD_MS;
+
+            if ((int32_t)(next_bsec_ms - next_ms) < 0)
+                next_ms = next_bsec_ms;
+            model_sleep_until((uint64_t)next_ms * 1000u);
+            pass_begin(&t, &delay, &wire);
+            ref_process(&last_raw_ms, &next_bsec_ms);
+            pass_end(r, t, delay, wire);
+        }
+        return;
+    }
+
+    CHECK(air_app_init(&hi2c, &huart) == HAL_OK);
+    CHECK(task != NULL && posted);
+    while (model.now_us < end_us) {
+        if (!posted) {
+            uint32_t idle = air_app_idle_ms(HAL_GetTick());
+
+            // Asleep until SysTick sees the deadline
+            CHECK(idle != UINT32_MAX);
+            model_sleep_until(((uint64_t)HAL_GetTick() + idle) * 1000u);
+            air_app_tick();
+            CHECK(posted);
+        }
+        posted = 0;
+        pass_begin(&t, &delay, &wire);
+        task();
+        pass_end(r, t, delay, wire);
+    }
+}
+
+static void report(const char *what, const result_t *r)
+{
+    printf("  %-8s %5ld BSEC samples %6ld passes: blocked %7.2f ms per BSEC cycle "
+           "(delays %7.2f ms, I2C %5.2f ms), longest pass %6.1f ms\n",
+           what, r->bsec_samples, r->passes, r->blocked_us / 1000.0 / r->bsec_samples,
+           r->delay_us / 1000.0 / r->bsec_samples, r->wire_us / 1000.0 / r->bsec_samples,
+           r->max_pass_us / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    result_t *results;
+    int minutes;
+
+    CHECK(argc == 2);
+    minutes = atoi(argv[1]);
+    CHECK(minutes > 0);
+
+    // One process per loop: the port keeps its contexts in statics
+    results = mmap(NULL, 2 * sizeof *results, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    CHECK(results != MAP_FAILED);
+    for (int k = 0; k < 2; k++) {
+        pid_t pid = fork();
+        int status;
+
+        CHECK(pid >= 0);
+        if (pid == 0) {
+            run(k, (uint64_t)minutes * 60000000u, &results[k]);
+            exit(0);
+        }
+        CHECK(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    printf("%d min simulated, BSEC LP (320 C / 197 ms every 3 s), raw sensor every 10 s:\n", minutes);
+    report("blocking", &results[0]);
+    report("split", &results[1]);
+    CHECK(results[1].bsec_samples >= results[0].bsec_samples - 1);
+    CHECK(results[1].delay_us == 0);
+    CHECK(results[1].blocked_us * 20 < results[0].blocked_us);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,361 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Air task scheduling over virtual time: the old main loop (air_app_process()
+// then HAL_Delay(10), forever) against the sequencer task that air_app_tick()
+// posts from SysTick when its next deadline comes. The deadline logic mirrors
+// air_app_process(): the array collects and re-triggers the raw sensor every
+// PRINT_PERIOD_MS, BSEC is called at its next_call (LP: every 3 s) and triggers
+// one measurement, a fresh raw sample is sent once per print period.
+//
+// Costs are assumptions for a 64 MHz Cortex-M0+ and can be changed with -D.
+// Reported per run: core wakeups (exits from WFE), task passes, BSEC calls and
+// CPU-active time. The task runs twice: with SysTick waking the core every ms,
+// and with the idle of the firmware (APPE_Idle()), which stops SysTick and arms
+// a one-shot radio timer for the earliest air task or telemetry deadline when
+// that is at least TICKLESS_MIN_MS away. Each sent sample opens a telemetry
+// frame that SysTick flushes TELEMETRY_BATCH_MS later.
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#define PRINT_PERIOD_MS   10000u   // raw sensor period and print period (air_app.c)
+#define BSEC_PERIOD_MS    3000u    // BSEC_SAMPLE_RATE_LP next_call spacing
+#define OLD_LOOP_MS       11u      // HAL_Delay(10) waits 10 to 11 ticks
+#define TELEMETRY_BATCH_MS 250u    // telemetry.h
+#define TICKLESS_MIN_MS   2u       // APPE_TICKLESS_MIN_MS (app_entry.c)
+
+#ifndef TICK_US
+#define TICK_US     3u      // SysTick ISR with wake from WFE: HAL tick and the four tick hooks
+#endif
+#ifndef PASS_US
+#define PASS_US     20u     // air_app_process() with nothing due
+#endif
+#ifndef CTRL_US
+#define CTRL_US     150u    // bsec_sensor_control()
+#endif
+#ifndef TRIG_US
+#define TRIG_US     300u    // forced-mode trigger on I2C at 400 kHz
+#endif
+#ifndef COLLECT_US
+#define COLLECT_US  600u    // field data read on I2C
+#endif
+#ifndef STEPS_US
+#define STEPS_US    3000u   // bsec_do_steps() for one sample
+#endif
+#ifndef SEND_US
+#define SEND_US     100u    // telemetry_put() and the P2P notification
+#endif
+#ifndef FLUSH_US
+#define FLUSH_US    50u     // telemetry task: close the frame, start the DMA
+#endif
+#ifndef IDLE_US
+#define IDLE_US     10u     // APPE_Idle(): deadlines, radio timer, tick catch-up
+#endif
+#ifndef RAW_MEAS_MS
+#define RAW_MEAS_MS 40u     // T/H/P only, pressure 16x
+#endif
+#ifndef BSEC_MEAS_MS
+#define BSEC_MEAS_MS 120u   // TPH plus the LP heater step
+#endif
+
+typedef struct
+{
+    const char *name;
+    uint64_t wakeups;       // exits from sleep
+    uint64_t passes;        // air_app_process() runs
+    uint64_t idle_passes;   // runs that found nothing due
+    uint64_t bsec_calls;    // bsec_sensor_control() calls
+    uint64_t samples;       // BSEC samples processed
+    uint64_t sends;         // raw samples sent
+    uint64_t flushes;       // telemetry frames flushed by age
+    uint64_t active_us;     // CPU busy time
+    uint32_t bsec_late_max; // worst delay past next_call (ms)
+} run_t;
+
+static uint8_t reached(uint32_t now_ms, uint32_t deadline_ms)
+{
+    return ((int32_t)(now_ms - deadline_ms) >= 0) ? 1u : 0u;
+}
+
+static uint32_t earliest(uint32_t now_ms, uint32_t a_ms, uint32_t b_ms)
+{
+    return ((int32_t)(a_ms - now_ms) <= (int32_t)(b_ms - now_ms)) ? a_ms : b_ms;
+}
+
+// ---------------------------------------------------------------------------
+// Old loop: every pass polls the raw period and calls bsec_sensor_control();
+// a triggered BSEC measurement blocks for its duration. The core never sleeps.
+
+static void run_old(run_t *r, uint64_t total_ms)
+{
+    uint32_t last_raw = (uint32_t)-PRINT_PERIOD_MS;
+    uint32_t next_call = 0;
+    uint64_t now = 0;
+
+    while (now < total_ms)
+    {
+        uint32_t t = (uint32_t)now;
+        uint64_t cost = PASS_US;
+        uint32_t block_ms = 0;
+
+        r->passes++;
+        if (t - last_raw >= PRINT_PERIOD_MS)
+        {
+            // read_raw_sensor() triggers and waits for the sample
+            cost += TRIG_US + COLLECT_US + SEND_US;
+            block_ms += RAW_MEAS_MS;
+            last_raw = t;
+            r->sends++;
+        }
+
+        cost += CTRL_US;
+        r->bsec_calls++;
+        if (reached(t, next_call))
+        {
+            uint32_t late = t - next_call;
+            if (late > r->bsec_late_max) r->bsec_late_max = late;
+            cost += TRIG_US + COLLECT_US + STEPS_US;
+            block_ms += BSEC_MEAS_MS;
+            next_call += BSEC_PERIOD_MS;
+            r->samples++;
+        }
+        else
+        {
+            r->idle_passes++;
+        }
+
+        // Busy in the pass, in the blocking waits and in HAL_Delay()
+        now += (cost + 999u) / 1000u + block_ms + OLD_LOOP_MS;
+    }
+    r->active_us = total_ms * 1000u;
+}
+
+// ---------------------------------------------------------------------------
+// Sequencer task: the same state air_app_process() keeps
+
+typedef struct
+{
+    uint8_t raw_busy, bsec_busy, raw_fresh, armed;
+    uint32_t raw_done, bsec_done, raw_next_trig;
+    uint32_t next_bsec, last_print, wake;
+    uint8_t frame_open;         // telemetry frame waiting for its flush
+    uint32_t frame_ts;
+} air_t;
+
+// One air_app_process() pass; returns 1 when it re-posted itself
+static uint8_t air_pass(run_t *r, air_t *a, uint32_t now)
+{
+    uint64_t cost = PASS_US;
+    uint8_t work = 0;
+
+    a->armed = 0;
+    r->passes++;
+
+    // bme690_array_process(): collect, then start the periodic sensors that are due
+    if (a->raw_busy && reached(now, a->raw_done))
+    {
+        a->raw_busy = 0;
+        a->raw_fresh = 1;
+        cost += COLLECT_US;
+        work = 1;
+    }
+    if (a->bsec_busy && reached(now, a->bsec_done))
+    {
+        a->bsec_busy = 0;
+        cost += COLLECT_US + STEPS_US;
+        r->samples++;
+        work = 1;
+    }
+    if (!a->raw_busy && reached(now, a->raw_next_trig))
+    {
+        a->raw_next_trig += PRINT_PERIOD_MS;
+        if (reached(now, a->raw_next_trig)) a->raw_next_trig = now + PRINT_PERIOD_MS;
+        a->raw_busy = 1;
+        a->raw_done = now + RAW_MEAS_MS;
+        cost += TRIG_US;
+        work = 1;
+    }
+    uint32_t array_next = a->raw_busy ? earliest(now, a->raw_done, a->raw_next_trig)
+                                      : a->raw_next_trig;
+    if (a->bsec_busy) array_next = earliest(now, array_next, a->bsec_done);
+
+    // BSEC only when its next_call has passed
+    if (!a->bsec_busy && reached(now, a->next_bsec))
+    {
+        uint32_t late = now - a->next_bsec;
+        if (late > r->bsec_late_max) r->bsec_late_max = late;
+        r->bsec_calls++;
+        a->next_bsec += BSEC_PERIOD_MS;
+        a->bsec_busy = 1;
+        a->bsec_done = now + BSEC_MEAS_MS;
+        array_next = earliest(now, array_next, a->bsec_done);
+        cost += CTRL_US + TRIG_US;
+        work = 1;
+    }
+
+    if (a->raw_fresh && (now - a->last_print) >= PRINT_PERIOD_MS)
+    {
+        a->last_print = now;
+        a->raw_fresh = 0;
+        cost += SEND_US;
+        r->sends++;
+        work = 1;
+        if (!a->frame_open)
+        {
+            a->frame_open = 1;
+            a->frame_ts = now;
+        }
+    }
+
+    uint32_t next = a->next_bsec;
+    if (a->bsec_busy)
+        next = array_next;
+    else
+        next = earliest(now, next, array_next);
+    if (a->raw_fresh)
+        next = earliest(now, next, a->last_print + PRINT_PERIOD_MS);
+
+    r->active_us += cost;
+    if (!work) r->idle_passes++;
+
+    a->wake = next;
+    a->armed = 1;
+    if (reached(now, next))
+    {
+        a->armed = 0;
+        return 1;
+    }
+    return 0;
+}
+
+// ms until the next air task or telemetry deadline, as APPE_Idle() sees it
+static uint32_t idle_ms(const air_t *a, uint32_t now)
+{
+    uint32_t left = UINT32_MAX;
+
+    if (a->armed)
+        left = reached(now, a->wake) ? 0u : a->wake - now;
+    if (a->frame_open)
+    {
+        uint32_t flush = a->frame_ts + TELEMETRY_BATCH_MS;
+        uint32_t f = reached(now, flush) ? 0u : flush - now;
+        if (f < left) left = f;
+    }
+    return left;
+}
+
+// tick_wakes: 1 = SysTick wakes the core every ms,
+//             0 = tickless idle: a radio timer wakes it at the next deadline (firmware)
+static void run_seq(run_t *r, uint64_t total_ms, uint8_t tick_wakes)
+{
+    air_t a = {0};
+    a.last_print = (uint32_t)-PRINT_PERIOD_MS;
+    a.armed = 0;
+
+    // air_app_init() posts the first pass right away
+    uint64_t now = 0;
+    while (air_pass(r, &a, 0)) {}
+
+    while (now < total_ms)
+    {
+        uint32_t left = idle_ms(&a, (uint32_t)now);
+
+        CHECK(a.armed);
+        if (tick_wakes || left < TICKLESS_MIN_MS)
+        {
+            now++;
+        }
+        else
+        {
+            // SysTick stopped, sleep straight to the deadline
+            now += left;
+            r->active_us += IDLE_US;
+        }
+        if (now >= total_ms) break;
+
+        uint32_t t = (uint32_t)now;
+        r->wakeups++;
+        r->active_us += TICK_US;
+
+        // telemetry_tick(): flush an aged frame
+        if (a.frame_open && reached(t, a.frame_ts + TELEMETRY_BATCH_MS))
+        {
+            a.frame_open = 0;
+            r->flushes++;
+            r->active_us += FLUSH_US;
+        }
+
+        // air_app_tick()
+        if (a.armed && reached(t, a.wake))
+        {
+            a.armed = 0;
+            while (air_pass(r, &a, t)) {}
+        }
+    }
+}
+
+static void report(const run_t *r, uint64_t total_ms)
+{
+    printf("%-22s %12llu %10llu %8llu %10llu %8llu %7llu %11.1f %7.3f%%\n",
+           r->name,
+           (unsigned long long)r->wakeups, (unsigned long long)r->passes,
+           (unsigned long long)r->idle_passes, (unsigned long long)r->bsec_calls,
+           (unsigned long long)r->samples, (unsigned long long)r->sends,
+           (double)r->active_us / 1e6,
+           100.0 * (double)r->active_us / ((double)total_ms * 1000.0));
+}
+
+int main(int argc, char **argv)
+{
+    double hours = argc > 1 ? atof(argv[1]) : 24.0;
+    uint64_t total_ms = (uint64_t)(hours * 3600.0 * 1000.0);
+    run_t old_loop = { .name = "main loop + HAL_Delay" };
+    run_t seq = { .name = "task + SysTick" };
+    run_t timer = { .name = "task + tickless idle" };
+
+    CHECK(total_ms >= 2u * PRINT_PERIOD_MS);
+
+    run_old(&old_loop, total_ms);
+    run_seq(&seq, total_ms, 1);
+    run_seq(&timer, total_ms, 0);
+
+    printf("%.1f h of virtual time\n", hours);
+    printf("%-22s %12s %10s %8s %10s %8s %7s %11s %8s\n", "", "wakeups", "passes",
+           "idle", "bsec_ctrl", "samples", "sends", "active (s)", "active");
+    report(&old_loop, total_ms);
+    report(&seq, total_ms);
+    report(&timer, total_ms);
+
+    uint64_t samples = total_ms / BSEC_PERIOD_MS;
+    uint64_t sends = total_ms / PRINT_PERIOD_MS;
+
+    // The task does the same work as the loop it replaced, on time
+    CHECK(seq.samples + 1 >= samples && seq.samples <= samples + 1);
+    CHECK(seq.sends + 1 >= sends && seq.sends <= sends + 1);
+    CHECK(seq.bsec_late_max == 0);
+    CHECK(timer.samples == seq.samples && timer.sends == seq.sends);
+    CHECK(timer.bsec_late_max == 0);
+
+    // It never runs for nothing, and calls BSEC only when asked to
+    CHECK(seq.idle_passes == 0 && timer.idle_passes == 0);
+    CHECK(seq.bsec_calls <= samples + 1);
+
+    // SysTick wakes the core once per ms; the tickless idle once per deadline
+    CHECK(seq.wakeups == total_ms - 1);
+    CHECK(timer.passes == seq.passes);
+    CHECK(timer.flushes == seq.flushes && timer.flushes + 1 >= sends);
+    CHECK(timer.wakeups <= timer.passes + timer.flushes);
+    CHECK(timer.wakeups * 1000u < seq.wakeups);
+    CHECK(seq.active_us < old_loop.active_us / 10u);
+    CHECK(timer.active_us < seq.active_us);
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "sensor_model.h"
+#include "bme690_array.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Aggregate sample rate of Core/Src/bme690_array.c against the number of
+// sensors, on the sensor model over a 100 kHz bus. The sensors sit in pairs,
+// at 0x76 and 0x77, on the channels of a mux: a sensor directly on the bus
+// would answer next to the one at its address behind an open channel. Every
+// sensor runs forced measurements (2x/1x/1x oversampling, 300 C for 100 ms)
+// as fast as it can, for SECONDS simulated seconds, two ways:
+//   pipelined  periodic sensors, triggered back to back by bme690_array_process()
+//   serial     owner-triggered sensors, one measurement at a time
+// Each count runs in its own process: the port keeps its contexts in statics.
+// Reported: samples per second in total and per sensor, the most measurements
+// running at once, bus load and mux writes. The pipelined rate must grow with
+// the sensor count, the serial one must not.
+//
+// Usage: bme690_array_scaling <seconds>
+
+#define RUNS 4
+
+static const int counts[RUNS] = { 1, 2, 4, 8 };
+
+typedef struct
+{
+    double rate;            // samples/s, all sensors
+    long min_samples, max_samples;
+    int max_running;
+    double bus_load;
+    double mux_writes;      // per second
+} result_t;
+
+static long samples[MODEL_MAX_SENSORS];
+
+static void on_sample(uint8_t idx, const struct bme69x_data *data, uint32_t trig_ms)
+{
+    CHECK(idx < MODEL_MAX_SENSORS);
+    CHECK(data->status & BME69X_NEW_DATA_MSK);
+    CHECK(data->status & BME69X_GASM_VALID_MSK);
+    CHECK(trig_ms <= HAL_GetTick());
+    samples[idx]++;
+}
+
+static void wire(bme690_sensor_cfg_t *cfg, int i, uint32_t period_ms)
+{
+    memset(cfg, 0, sizeof *cfg);
+    cfg->i2c_addr = (uint8_t)(0x76 + (i & 1));
+    cfg->mux_addr = MODEL_MUX_ADDR;
+    cfg->mux_channel = (uint8_t)(i / 2);
+    cfg->period_ms = period_ms;
+    cfg->os_temp = BME69X_OS_2X;
+    cfg->os_pres = BME69X_OS_1X;
+    cfg->os_hum = BME69X_OS_1X;
+    cfg->filter = BME69X_FILTER_OFF;
+    cfg->heatr_temp = 300;
+    cfg->heatr_dur_ms = 100;
+}
+
+static void run(int n, int pipelined, int seconds, result_t *out)
+{
+    static bme690_sensor_cfg_t cfg[MODEL_MAX_SENSORS];
+    const uint64_t end_us = (uint64_t)seconds * 1000000u;
+    bme690_array_stats_t stats;
+    uint64_t start_us;
+
+    model_reset();
+    bme690_array_init(on_sample);
+    for (int i = 0; i < n; i++) {
+        uint8_t idx;
+
+        wire(&cfg[i], i, pipelined ? 1u : 0u);
+        model_add(cfg[i].i2c_addr, cfg[i].mux_channel, (uint32_t)i + 1u);
+        CHECK(bme690_array_add(&model_hi2c, &cfg[i], &idx) == BME69X_OK);
+        CHECK(idx == i);
+    }
+    memset(samples, 0, sizeof samples);
+    start_us = model.now_us;
+    model.transfers = 0;
+    model.mux_writes = 0;
+    model.wire_us = 0;
+
+    if (pipelined) {
+        for (long guard = 0; model.now_us < start_us + end_us; guard++) {
+            uint32_t next;
+
+            CHECK(guard < 100L * seconds * 1000L);
+            CHECK(bme690_array_process(HAL_GetTick(), &next) == 1);
+            model_sleep_until((uint64_t)next * 1000u);
+        }
+    } else {
+        struct bme69x_heatr_conf heatr = { .enable = BME69X_ENABLE, .heatr_temp = 300, .heatr_dur = 100 };
+
+        for (int i = 0; model.now_us < start_us + end_us; i = (i + 1) % n) {
+            struct bme69x_conf conf = { .os_temp = BME69X_OS_2X, .os_pres = BME69X_OS_1X,
+                                        .os_hum = BME69X_OS_1X, .filter = BME69X_FILTER_OFF,
+                                        .odr = BME69X_ODR_NONE };
+
+            CHECK(bme690_array_trigger((uint8_t)i, &conf, &heatr, HAL_GetTick()) == BME69X_OK);
+            while (bme690_array_busy((uint8_t)i)) {
+                uint32_t next;
+
+                // Idle once the sample is collected
+                if (bme690_array_process(HAL_GetTick(), &next))
+                    model_sleep_until((uint64_t)next * 1000u);
+            }
+        }
+    }
+
+    out->min_samples = out->max_samples = samples[0];
+    out->rate = 0;
+    for (int i = 0; i < n; i++) {
+        CHECK(bme690_array_get_stats((uint8_t)i, &stats) == HAL_OK);
+        CHECK(stats.errors == 0);
+        CHECK(stats.samples == (uint32_t)samples[i]);
+        CHECK(model.s[i].measurements >= samples[i]);
+        out->rate += samples[i];
+        if (samples[i] < out->min_samples) out->min_samples = samples[i];
+        if (samples[i] > out->max_samples) out->max_samples = samples[i];
+    }
+    out->rate /= (double)(model.now_us - start_us) / 1e6;
+    out->max_running = model.max_running;
+    out->bus_load = (double)model.wire_us / (double)(model.now_us - start_us);
+    out->mux_writes = (double)model.mux_writes / ((double)(model.now_us - start_us) / 1e6);
+}
+
+static void report(const char *what, int n, const result_t *r)
+{
+    printf("  %-9s %d sensor%s %6.2f samples/s (%5.2f per sensor) %d running  bus %4.1f%%  mux %5.1f writes/s\n",
+           what, n, n == 1 ? " " : "s", r->rate, r->rate / n, r->max_running,
+           100.0 * r->bus_load, r->mux_writes);
+}
+
+int main(int argc, char **argv)
+{
+    result_t *res;
+    int seconds;
+
+    CHECK(argc == 2);
+    seconds = atoi(argv[1]);
+    CHECK(seconds > 0);
+
+    // One process per run, results back through shared memory
+    res = mmap(NULL, 2 * RUNS * sizeof *res, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    CHECK(res != MAP_FAILED);
+    for (int k = 0; k < 2 * RUNS; k++) {
+        pid_t pid = fork();
+        int status;
+
+        CHECK(pid >= 0);
+        if (pid == 0) {
+            run(counts[k % RUNS], k < RUNS, seconds, &res[k]);
+            exit(0);
+        }
+        CHECK(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    printf("%d s simulated, forced 300 C / 100 ms at %u kHz:\n", seconds, MODEL_I2C_HZ / 1000u);
+    for (int k = 0; k < RUNS; k++) {
+        const result_t *p = &res[k], *s = &res[RUNS + k];
+
+        report("pipelined", counts[k], p);
+        report("serial", counts[k], s);
+
+        // Every sensor gets its share, within one sample of the others
+        CHECK(p->max_samples - p->min_samples <= 1);
+        CHECK(p->max_running == counts[k]);
+        CHECK(s->max_running == 1);
+        CHECK(s->rate < 1.05 * res[RUNS].rate);
+        CHECK(p->rate > 0.9 * counts[k] * res[0].rate);
+    }
+    printf("PASS\n");
+    return 0;
+}
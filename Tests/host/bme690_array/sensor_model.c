@@ -0,0 +1,260 @@
+#include "sensor_model.h"
+#include "bme69x_defs.h"
+#include "i2c_bus.h"
+#include "us_delay.h"
+
+#include <string.h>
+
+model_t model;
+I2C_HandleTypeDef model_hi2c;
+uint32_t (*model_delay_policy)(uint32_t us);
+void (*model_other_dev)(uint8_t addr, uint8_t reg_addr, int read, uint8_t *data, uint16_t len);
+
+static uint32_t rng_state = 1;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+void model_reset(void)
+{
+    memset(&model, 0, sizeof model);
+}
+
+int model_add(uint8_t addr, int mux_channel, uint32_t seed)
+{
+    model_sensor_t *s;
+
+    CHECK(model.n < MODEL_MAX_SENSORS);
+    s = &model.s[model.n];
+    memset(s, 0, sizeof *s);
+    s->addr = addr;
+    s->mux_channel = mux_channel;
+
+    rng_state = seed;
+    for (int i = 0; i < 256; i++)
+        s->regs[i] = (uint8_t)rnd();
+    memset(&s->regs[BME69X_REG_FIELD0], 0, BME69X_REG_CTRL_MEAS + 2 - BME69X_REG_FIELD0);
+    s->regs[BME69X_REG_CHIP_ID] = BME69X_CHIP_ID;
+    return model.n++;
+}
+
+void model_sleep_until(uint64_t t_us)
+{
+    if (t_us > model.now_us)
+        model.now_us = t_us;
+}
+
+// Same wire time as the I2C mock of ../i2c_bus: 9 bits a byte, start and stop
+static uint64_t wire_us(uint16_t len, int read)
+{
+    uint64_t bits = 9u * (2u + len + (read ? 1u : 0u)) + 2u;
+
+    return (bits * 1000000u + MODEL_I2C_HZ - 1u) / MODEL_I2C_HZ;
+}
+
+// ---------------------------------------------------------------------------
+// Sensor
+
+static const uint8_t os_cycles[8] = {0, 1, 2, 4, 8, 16, 16, 16};
+
+// T/P/H conversion of the oversampling in the control registers
+static uint64_t tph_us(const uint8_t *r)
+{
+    uint32_t cycles = os_cycles[(r[BME69X_REG_CTRL_MEAS] & BME69X_OST_MSK) >> 5] +
+                      os_cycles[(r[BME69X_REG_CTRL_MEAS] & BME69X_OSP_MSK) >> 2] +
+                      os_cycles[r[BME69X_REG_CTRL_HUM] & BME69X_OSH_MSK];
+
+    return cycles * 1963u + 477u * 9u;
+}
+
+// Heater time of a forced measurement: gas_wait0, 1 ms steps times 1, 4, 16 or 64
+static uint64_t heater_us(const uint8_t *r)
+{
+    uint8_t w = r[BME69X_REG_GAS_WAIT0];
+
+    if (!(r[BME69X_REG_CTRL_GAS_1] & BME69X_RUN_GAS_MSK))
+        return 0;
+    return (uint64_t)(w & 0x3Fu) * (1u << (2u * (w >> 6))) * 1000u;
+}
+
+// One parallel-mode unit: T/P/H conversion plus the shared heater time, steps of
+// 477 us times 1, 4, 16 or 64
+static uint64_t unit_us(const uint8_t *r)
+{
+    uint8_t w = r[BME69X_REG_SHD_HEATR_DUR];
+
+    return tph_us(r) + (uint64_t)(w & 0x3Fu) * (1u << (2u * (w >> 6))) * 477u;
+}
+
+// Writes a field with new data, the heater step given and random ADC values
+static void new_field(model_sensor_t *s, int field, uint8_t gas_index)
+{
+    uint8_t *f = &s->regs[BME69X_REG_FIELD0 + field * BME69X_LEN_FIELD_OFFSET];
+
+    for (int i = 2; i < BME69X_LEN_FIELD; i++)
+        f[i] = (uint8_t)rnd();
+    f[0] = (uint8_t)(BME69X_NEW_DATA_MSK | gas_index);
+    f[1] = ++s->meas_index;
+    s->gas_log[s->meas_index] = gas_index;
+    f[16] = (uint8_t)((f[16] & ~(BME69X_GASM_VALID_MSK | BME69X_HEAT_STAB_MSK)) |
+                      ((s->regs[BME69X_REG_CTRL_GAS_1] & BME69X_RUN_GAS_MSK) ?
+                       (BME69X_GASM_VALID_MSK | BME69X_HEAT_STAB_MSK) : 0u));
+    s->measurements++;
+}
+
+// Runs the sensor up to the current time
+static void update(model_sensor_t *s)
+{
+    if (s->done_us && s->done_us <= model.now_us) {
+        new_field(s, 0, 0);
+        s->regs[BME69X_REG_CTRL_MEAS] &= (uint8_t)~BME69X_MODE_MSK;
+        s->done_us = 0;
+    }
+
+    // Parallel mode: each unit that ended fills the next field
+    while (s->unit_us && s->next_us <= model.now_us) {
+        uint8_t nb_conv = s->regs[BME69X_REG_CTRL_GAS_1] & BME69X_NBCONV_MSK;
+
+        new_field(s, (int)(s->measurements % 3), s->step);
+        s->next_us += s->unit_us;
+        if (++s->step_units >= s->regs[BME69X_REG_GAS_WAIT0 + s->step]) {
+            s->step_units = 0;
+            s->step = (uint8_t)((s->step + 1u) % nb_conv);
+        }
+    }
+}
+
+static void start_parallel(model_sensor_t *s)
+{
+    uint8_t nb_conv = s->regs[BME69X_REG_CTRL_GAS_1] & BME69X_NBCONV_MSK;
+
+    CHECK(nb_conv >= 1 && nb_conv <= 10);
+    for (int i = 0; i < nb_conv; i++)
+        CHECK(s->regs[BME69X_REG_GAS_WAIT0 + i] > 0);
+    s->unit_us = unit_us(s->regs);
+    s->next_us = model.now_us + s->unit_us;
+    s->step = 0;
+    s->step_units = 0;
+}
+
+static void start_forced(model_sensor_t *s)
+{
+    int running = 0;
+
+    s->regs[BME69X_REG_FIELD0] &= (uint8_t)~BME69X_NEW_DATA_MSK;
+    s->done_us = model.now_us + tph_us(s->regs) + heater_us(s->regs);
+    for (int i = 0; i < model.n; i++)
+        running += model.s[i].done_us > model.now_us;
+    if (running > model.max_running)
+        model.max_running = running;
+}
+
+static void write_reg(model_sensor_t *s, uint8_t reg, uint8_t val)
+{
+    s->regs[reg] = val;
+    if (reg == BME69X_REG_SOFT_RESET && val == BME69X_SOFT_RESET_CMD) {
+        s->regs[BME69X_REG_CTRL_MEAS] &= (uint8_t)~BME69X_MODE_MSK;
+        s->done_us = 0;
+        s->unit_us = 0;
+    } else if (reg == BME69X_REG_CTRL_MEAS) {
+        uint8_t mode = val & BME69X_MODE_MSK;
+
+        s->done_us = 0;
+        s->unit_us = 0;
+        if (mode == BME69X_FORCED_MODE)
+            start_forced(s);
+        else if (mode == BME69X_PARALLEL_MODE)
+            start_parallel(s);
+    }
+}
+
+static int has_sensor(uint8_t addr)
+{
+    for (int i = 0; i < model.n; i++)
+        if (model.s[i].addr == addr)
+            return 1;
+    return 0;
+}
+
+// The one sensor that answers at addr with the mux as it is now
+static model_sensor_t *route(uint8_t addr)
+{
+    model_sensor_t *found = NULL;
+
+    for (int i = 0; i < model.n; i++) {
+        model_sensor_t *s = &model.s[i];
+
+        if (s->addr != addr)
+            continue;
+        if (s->mux_channel != MODEL_DIRECT && !(model.mux_mask & (1u << s->mux_channel)))
+            continue;
+        CHECK(found == NULL);  // two sensors answer
+        found = s;
+    }
+    CHECK(found != NULL);
+    return found;
+}
+
+// ---------------------------------------------------------------------------
+// Calls of the port
+
+HAL_StatusTypeDef i2c_bus_transfer(uint16_t dev_addr_8bit, uint8_t reg_addr, i2c_bus_dir_t dir,
+                                   uint8_t *data, uint16_t len, uint32_t timeout_ms)
+{
+    uint8_t addr = (uint8_t)(dev_addr_8bit >> 1);
+    model_sensor_t *s;
+
+    (void)timeout_ms;
+    CHECK(data != NULL && len > 0);
+    model.transfers++;
+    model.wire_us += wire_us(len, dir == I2C_BUS_READ);
+    model.now_us += wire_us(len, dir == I2C_BUS_READ);
+
+    if (addr == MODEL_MUX_ADDR) {
+        // One control register; every byte written becomes its value
+        CHECK(dir == I2C_BUS_WRITE && len == 1 && reg_addr == data[0]);
+        model.mux_mask = data[0];
+        model.mux_writes++;
+        return HAL_OK;
+    }
+
+    if (model_other_dev && !has_sensor(addr)) {
+        model_other_dev(addr, reg_addr, dir == I2C_BUS_READ, data, len);
+        return HAL_OK;
+    }
+
+    s = route(addr);
+    update(s);
+    if (dir == I2C_BUS_READ) {
+        CHECK(reg_addr + len <= 256);
+        memcpy(data, &s->regs[reg_addr], len);
+    } else {
+        // The driver interleaves register and data after the first register
+        CHECK(len % 2 == 1);
+        write_reg(s, reg_addr, data[0]);
+        for (uint16_t i = 1; i < len; i += 2)
+            write_reg(s, data[i], data[i + 1]);
+    }
+    return HAL_OK;
+}
+
+void us_delay(uint32_t us)
+{
+    if (model_delay_policy)
+        us = model_delay_policy(us);
+    model.delay_us += us;
+    model.now_us += us;
+}
+
+uint32_t us_delay_stamp(void)
+{
+    return (uint32_t)model.now_us;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(model.now_us / 1000u);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "stm32wb0x_hal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// BME690s on one I2C bus for the host, behind i2c_bus_transfer(): sensors
+// wired directly on the bus, or on the channels of a TCA9548A-style mux at
+// MODEL_MUX_ADDR. Each sensor is a register file with a random calibration
+// that runs forced measurements on a virtual microsecond clock: written to
+// forced mode, it clears the new-data flag of field 0 and sets it, with a new
+// sub-measurement index and random ADC values, once its T/P/H conversion and
+// heater time are up. In parallel mode it runs the heater profile of its
+// registers on its own: one heater unit is a T/P/H conversion plus the shared
+// heater time, step i lasts gas_wait i units, and every unit fills the next of
+// the three fields in turn, tagged with the step. A field keeps its new-data
+// flag until it is overwritten. Transfers take their wire time at MODEL_I2C_HZ and block
+// the caller, as the air task waits on the queue; us_delay() and HAL_GetTick()
+// run on the same clock. A transfer that reaches no sensor or two fails the
+// test, unless no sensor has the address and model_other_dev takes it.
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#ifndef MODEL_I2C_HZ
+#define MODEL_I2C_HZ 100000u  // hi2c1 timing in main.c
+#endif
+
+#define MODEL_MAX_SENSORS 8
+#define MODEL_MUX_ADDR    0x70u
+#define MODEL_DIRECT      (-1)
+
+typedef struct
+{
+    uint8_t regs[256];
+    uint8_t addr;           // 7-bit
+    int mux_channel;        // MODEL_DIRECT: on the bus itself
+    uint8_t meas_index;     // sub-measurement index of the last field
+    uint64_t done_us;       // forced measurement in progress until then (0: none)
+    long measurements;
+
+    // Parallel mode
+    uint64_t unit_us;       // 0: not running
+    uint64_t next_us;       // end of the unit in progress
+    uint8_t step;           // heater step of that unit
+    uint8_t step_units;     // units of the step done
+    uint8_t gas_log[256];   // heater step by sub-measurement index
+} model_sensor_t;
+
+typedef struct
+{
+    uint64_t now_us;
+    uint8_t mux_mask;       // channels the mux connects
+    int n;
+    model_sensor_t s[MODEL_MAX_SENSORS];
+
+    // Counters
+    long transfers;
+    long mux_writes;
+    uint64_t wire_us;
+    uint64_t delay_us;      // spent in us_delay()
+    int max_running;        // most measurements in progress at the same time
+} model_t;
+
+extern model_t model;
+extern I2C_HandleTypeDef model_hi2c;
+
+// Both kept across model_reset():
+// The wait us_delay() gives for us, as the delay service under test would;
+// NULL: exactly us
+extern uint32_t (*model_delay_policy)(uint32_t us);
+
+// Another device on the bus, for addresses no sensor has (a BMA456, say); it
+// runs after the wire time and may let the clock run on
+extern void (*model_other_dev)(uint8_t addr, uint8_t reg_addr, int read, uint8_t *data, uint16_t len);
+
+// Empty bus, clock at 0, counters cleared
+void model_reset(void);
+
+// Adds a sensor at the 7-bit address, on a mux channel or MODEL_DIRECT;
+// its calibration comes from seed. Returns its index.
+int model_add(uint8_t addr, int mux_channel, uint32_t seed);
+
+// Lets the clock run to t_us (never back), as the core sleeping until then
+void model_sleep_until(uint64_t t_us);
@@ -0,0 +1,291 @@
+// The driver is included to reach its static compensation functions
+#include "bme69x.c"
+#include "regfile.h"
+
+#include <string.h>
+#include <time.h>
+
+// Integer compensation of bme69x.c against the functions it replaced, copied
+// below from the original driver with unsigned long taken as 32 bits, as on
+// the Cortex-M0+. The calibration comes from a random coefficient register
+// image read through get_calib_data(), which also folds it. Compared: every
+// temperature ADC value, the pressure ADC range at 4 temperatures plus random
+// pairs, the humidity range at 1024 temperatures and all gas ADC values and
+// ranges; then the time per call of each version.
+//
+// Usage: bme69x_calc <calibrations> <ADC step> <random pressure pairs>
+
+static uint32_t rng_state;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// ---------------------------------------------------------------------------
+// Reference: the original integer compensation (UL literals written as U)
+
+static int16_t ref_temperature(uint32_t temp_adc, struct bme69x_dev *dev, uint32_t *t_lin)
+{
+    int64_t partial_data1;
+    int64_t partial_data2;
+    int64_t partial_data3;
+    int64_t partial_data4;
+    int64_t partial_data5;
+    int64_t partial_data6;
+    int64_t tem_comp;
+
+    partial_data1 = (int64_t)(temp_adc - (256U * dev->calib.par_t1));
+    partial_data2 = (int64_t)(partial_data1 * (int64_t)dev->calib.par_t2);
+    partial_data3 = (int64_t)(partial_data1 * partial_data1);
+    partial_data4 = (int64_t)(partial_data3 * (int64_t)dev->calib.par_t3);
+    partial_data5 = (int64_t)((int64_t)(partial_data2 * 262144U) + partial_data4);
+    partial_data6 = (int64_t)(partial_data5 / 4294967296ULL);
+    *t_lin = (uint32_t)partial_data6;
+    tem_comp = (int64_t)((partial_data6 * 25U) / 16384U);
+
+    return (int16_t)(tem_comp);
+}
+
+static uint32_t ref_pressure(uint32_t pres_adc, uint32_t t_lin, const struct bme69x_dev *dev)
+{
+    int64_t partial_data1;
+    int64_t partial_data2;
+    int64_t partial_data3;
+    int64_t partial_data4;
+    int64_t partial_data5;
+    int64_t partial_data6;
+    int64_t offset;
+    int64_t sensitivity;
+    int64_t press_comp;
+    int64_t t_lin_64;
+
+    t_lin_64 = (int64_t)t_lin;
+
+    partial_data1 = t_lin_64 * t_lin_64;
+    partial_data2 = partial_data1 / 64;
+    partial_data3 = partial_data2 * t_lin_64 / 256;
+    partial_data4 = dev->calib.par_p4 * partial_data3 / 32;
+    partial_data5 = dev->calib.par_p3 * partial_data1 * 16;
+    partial_data6 = dev->calib.par_p2 * t_lin_64 * (1 << 22);
+
+    offset = dev->calib.par_p1 * ((int64_t)1 << 47) + partial_data4 + partial_data5 + partial_data6;
+    partial_data2 = (dev->calib.par_p8 * partial_data3) / (1 << 5);
+    partial_data4 = dev->calib.par_p7 * partial_data1 * (1 << 2);
+
+    partial_data5 = (dev->calib.par_p6 - 16384) * t_lin_64 * (1 << 21);
+    sensitivity = (dev->calib.par_p5 - 16384) * ((int64_t)1 << 46) + partial_data2 + partial_data4 + partial_data5;
+    partial_data1 = sensitivity / (1 << 24) * pres_adc;
+
+    partial_data2 = dev->calib.par_p10 * t_lin_64;
+    partial_data3 = partial_data2 + dev->calib.par_p9 * (1 << 16);
+    partial_data4 = partial_data3 * pres_adc / (1 << 13);
+    partial_data5 = (pres_adc * partial_data4 / 10) / (1 << 9);
+    partial_data5 = partial_data5 * 10;
+    partial_data6 = pres_adc * pres_adc;
+
+    partial_data2 = dev->calib.par_p11 * partial_data6 / (1 << 16);
+    partial_data3 = partial_data2 * pres_adc / (1 << 7);
+    partial_data4 = offset / 4 + partial_data1 + partial_data5 + partial_data3;
+
+    press_comp = (partial_data4 / ((int64_t)1 << 40)) * 25;
+
+    return (uint32_t)(press_comp / 100);
+}
+
+static uint32_t ref_humidity(uint16_t hum_adc, int16_t comp_temperature, const struct bme69x_dev *dev)
+{
+    uint32_t hum_comp;
+    int64_t hum_64 = hum_adc;
+    int64_t t_comp = comp_temperature;
+    int64_t t_fine = (t_comp * 256 - 128) / 5;
+    int64_t var_H = t_fine - 76800U;
+
+    var_H =
+        (((((hum_64 * 16384U) - (dev->calib.par_h1 * 1048576U) - (dev->calib.par_h2 * var_H)) + 16384U) / 32768U) *
+         ((((((var_H * dev->calib.par_h4) / 1024U) * ((var_H * dev->calib.par_h3) / 2048U + 32768U)) / 1024U) +
+           2097152ULL) * dev->calib.par_h5 + 8192U) / 16384U);
+
+    var_H = var_H - (((((var_H / 32768U) * (var_H / 32768U)) / 128U) * dev->calib.par_h6) / 16U);
+
+    if (var_H < 0)
+    {
+        var_H = 0;
+    }
+
+    if (var_H > 419430400)
+    {
+        var_H = 419430400;
+    }
+
+    hum_comp = (uint32_t)(var_H / 4096U);
+
+    return hum_comp;
+}
+
+static uint32_t ref_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range)
+{
+    uint32_t calc_gas_res;
+    uint32_t var1 = UINT32_C(262144) >> gas_range;
+    int32_t var2 = (int32_t)gas_res_adc - INT32_C(512);
+
+    var2 *= INT32_C(3);
+    var2 = INT32_C(4096) + var2;
+
+    calc_gas_res = (UINT32_C(10000) * var1) / (uint32_t)var2;
+    calc_gas_res = calc_gas_res * 100;
+
+    return calc_gas_res;
+}
+
+// ---------------------------------------------------------------------------
+
+static long compared;
+
+static void calibrate(struct bme69x_dev *dev, uint32_t seed)
+{
+    regfile_attach(dev);
+    rng_state = seed;
+    for (int i = 0; i < 256; i++)
+        regfile.regs[i] = (uint8_t)rnd();
+    CHECK(get_calib_data(dev) == BME69X_OK);
+}
+
+// t_lin of an evenly spread temperature ADC value
+static uint32_t t_lin_at(struct bme69x_dev *dev, uint32_t i, uint32_t n)
+{
+    uint32_t t_lin;
+
+    (void)ref_temperature((uint32_t)(((uint64_t)i << 24) / n), dev, &t_lin);
+    return t_lin;
+}
+
+static void check_temperature(struct bme69x_dev *dev)
+{
+    for (uint32_t adc = 0; adc < (1u << 24); adc++) {
+        uint32_t t_ref, t_new;
+        CHECK(calc_temperature(adc, dev, &t_new) == ref_temperature(adc, dev, &t_ref));
+        CHECK(t_new == t_ref);
+    }
+    compared += 1 << 24;
+}
+
+static void check_pressure(struct bme69x_dev *dev, uint32_t step, long pairs)
+{
+    for (uint32_t t = 0; t < 4; t++) {
+        uint32_t t_lin = t_lin_at(dev, t, 4);
+        for (uint32_t adc = 0; adc < (1u << 24); adc += step)
+            CHECK(calc_pressure(adc, t_lin, dev) == ref_pressure(adc, t_lin, dev));
+        compared += (1 << 24) / step;
+    }
+    for (long i = 0; i < pairs; i++) {
+        uint32_t adc = rnd() & 0xFFFFFF, t_lin;
+        (void)ref_temperature(rnd() & 0xFFFFFF, dev, &t_lin);
+        CHECK(calc_pressure(adc, t_lin, dev) == ref_pressure(adc, t_lin, dev));
+    }
+    compared += pairs;
+}
+
+static void check_humidity(struct bme69x_dev *dev, uint32_t step)
+{
+    for (int32_t t = -32768; t < 32768; t += 64) {
+        for (uint32_t adc = 0; adc < 65536; adc += step)
+            CHECK(calc_humidity((uint16_t)adc, (int16_t)t, dev) == ref_humidity((uint16_t)adc, (int16_t)t, dev));
+        compared += 65536 / step;
+    }
+}
+
+static void check_gas(void)
+{
+    for (uint32_t range = 0; range < 16; range++) {
+        for (uint32_t adc = 0; adc < 65536; adc++)
+            CHECK(calc_gas_resistance((uint16_t)adc, (uint8_t)range) ==
+                  ref_gas_resistance((uint16_t)adc, (uint8_t)range));
+    }
+    compared += 16 * 65536;
+}
+
+// ---------------------------------------------------------------------------
+// Time per call over realistic inputs: ADC values near mid-scale, 25 degC
+
+#define BENCH_N 4096
+#define BENCH_REPEAT 2000
+
+static volatile uint32_t sink;
+
+static double ns_per_call(struct timespec a, struct timespec b)
+{
+    return ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec)) / ((double)BENCH_N * BENCH_REPEAT);
+}
+
+#define BENCH(name, expr)                                                   \
+    do {                                                                    \
+        struct timespec a, b;                                               \
+        uint32_t acc = 0;                                                   \
+        clock_gettime(CLOCK_MONOTONIC, &a);                                 \
+        for (int r = 0; r < BENCH_REPEAT; r++)                              \
+            for (int i = 0; i < BENCH_N; i++)                               \
+                acc += (uint32_t)(expr);                                    \
+        clock_gettime(CLOCK_MONOTONIC, &b);                                 \
+        sink = acc;                                                         \
+        name = ns_per_call(a, b);                                           \
+    } while (0)
+
+static void bench(struct bme69x_dev *dev)
+{
+    static uint32_t adc[BENCH_N], t_lin[BENCH_N];
+    static int16_t temp[BENCH_N];
+    static uint8_t range[BENCH_N];
+    double ref_t, new_t, ref_p, new_p, ref_h, new_h, ref_g, new_g;
+    uint32_t tl;
+
+    for (int i = 0; i < BENCH_N; i++) {
+        adc[i] = 0x7F0000u + (rnd() & 0x1FFFF);
+        temp[i] = ref_temperature(adc[i], dev, &t_lin[i]);
+        range[i] = (uint8_t)(rnd() % 16);
+    }
+
+    BENCH(ref_t, ref_temperature(adc[i], dev, &tl) + tl);
+    BENCH(new_t, calc_temperature(adc[i], dev, &tl) + tl);
+    BENCH(ref_p, ref_pressure(adc[i], t_lin[i], dev));
+    BENCH(new_p, calc_pressure(adc[i], t_lin[i], dev));
+    BENCH(ref_h, ref_humidity((uint16_t)adc[i], temp[i], dev));
+    BENCH(new_h, calc_humidity((uint16_t)adc[i], temp[i], dev));
+    BENCH(ref_g, ref_gas_resistance((uint16_t)(adc[i] & 0x3FF), range[i]));
+    BENCH(new_g, calc_gas_resistance((uint16_t)(adc[i] & 0x3FF), range[i]));
+
+    printf("ns per call (host), original -> folded:\n");
+    printf("  temperature %6.2f -> %6.2f\n", ref_t, new_t);
+    printf("  pressure    %6.2f -> %6.2f\n", ref_p, new_p);
+    printf("  humidity    %6.2f -> %6.2f\n", ref_h, new_h);
+    printf("  gas         %6.2f -> %6.2f\n", ref_g, new_g);
+}
+
+int main(int argc, char **argv)
+{
+    struct bme69x_dev dev;
+    int calibrations;
+    uint32_t step;
+    long pairs;
+
+    CHECK(argc == 4);
+    calibrations = atoi(argv[1]);
+    step = (uint32_t)atoi(argv[2]);
+    pairs = atol(argv[3]);
+    CHECK(step > 0);
+
+    for (int c = 1; c <= calibrations; c++) {
+        calibrate(&dev, (uint32_t)c);
+        check_temperature(&dev);
+        check_pressure(&dev, step, pairs);
+        check_humidity(&dev, step);
+        check_gas();
+    }
+    printf("%d calibrations, ADC step %u: %ld comparisons, 0 mismatches\n", calibrations, step, compared);
+
+    calibrate(&dev, 1);
+    bench(&dev);
+    printf("PASS\n");
+    return 0;
+}
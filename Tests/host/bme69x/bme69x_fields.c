@@ -0,0 +1,294 @@
+// The driver is included to reach its static field read functions
+#include "bme69x.c"
+#include "regfile.h"
+
+#include <string.h>
+
+// Field data reads of bme69x.c against the functions they replaced, copied
+// below from the original driver. After a random calibration and a heater
+// configuration written through bme69x_set_heatr_conf() (forced: one step;
+// parallel: a random 10-step profile), SAMPLES random field register images
+// with new data are decoded by both versions: the data must be identical.
+// Reported: transfers and bytes on the bus per sample, with the shadow warm
+// and, every 16th sample, cleared as after a reset. Built twice, the second
+// time with BME69X_FIELD_BURST_READ.
+//
+// Usage: bme69x_fields <samples>
+
+static uint32_t rng_state;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// ---------------------------------------------------------------------------
+// Reference: the original field reads
+
+static int8_t ref_read_field_data(uint8_t index, struct bme69x_data *data, struct bme69x_dev *dev)
+{
+    int8_t rslt = BME69X_OK;
+    uint8_t buff[BME69X_LEN_FIELD] = { 0 };
+    uint8_t gas_range;
+    uint32_t adc_temp;
+    uint32_t adc_pres;
+    volatile uint16_t adc_hum;
+    uint16_t adc_gas_res;
+    uint8_t tries = 5;
+
+    while ((tries) && (rslt == BME69X_OK))
+    {
+        rslt = bme69x_get_regs(((uint8_t)(BME69X_REG_FIELD0 + (index * BME69X_LEN_FIELD_OFFSET))),
+                               buff,
+                               (uint16_t)BME69X_LEN_FIELD,
+                               dev);
+        if (!data)
+        {
+            rslt = BME69X_E_NULL_PTR;
+            break;
+        }
+
+        data->status = buff[0] & BME69X_NEW_DATA_MSK;
+        data->gas_index = buff[0] & BME69X_GAS_INDEX_MSK;
+        data->meas_index = buff[1];
+
+        /* read the raw data from the sensor */
+        adc_pres = (uint32_t)(((uint32_t)buff[2] << 16) | ((uint32_t)buff[3] << 8) | ((uint32_t)buff[4]));
+        adc_temp = (uint32_t)(((uint32_t)buff[5] << 16) | ((uint32_t)buff[6] << 8) | ((uint32_t)buff[7]));
+        adc_hum = (uint16_t)(((uint32_t)buff[8] << 8) | (uint32_t)buff[9]);
+        adc_gas_res = ((uint16_t)buff[15] << 2) | ((uint16_t)buff[16] >> 6);
+
+        gas_range = buff[16] & BME69X_GAS_RANGE_MSK;
+
+        data->status |= buff[16] & BME69X_GASM_VALID_MSK;
+        data->status |= buff[16] & BME69X_HEAT_STAB_MSK;
+
+        if ((data->status & BME69X_NEW_DATA_MSK) && (rslt == BME69X_OK))
+        {
+            rslt = bme69x_get_regs(BME69X_REG_RES_HEAT0 + data->gas_index, &data->res_heat, 1, dev);
+            if (rslt == BME69X_OK)
+            {
+                rslt = bme69x_get_regs(BME69X_REG_IDAC_HEAT0 + data->gas_index, &data->idac, 1, dev);
+            }
+
+            if (rslt == BME69X_OK)
+            {
+                rslt = bme69x_get_regs(BME69X_REG_GAS_WAIT0 + data->gas_index, &data->gas_wait, 1, dev);
+            }
+
+            if (rslt == BME69X_OK)
+            {
+                data->temperature = calc_temperature(adc_temp, dev, &data->t_lin);
+                data->pressure = calc_pressure(adc_pres, data->t_lin, dev);
+                data->humidity = calc_humidity(adc_hum, data->temperature, dev);
+                data->gas_resistance = calc_gas_resistance(adc_gas_res, gas_range);
+
+                break;
+            }
+        }
+
+        if (rslt == BME69X_OK)
+        {
+            dev->delay_us(BME69X_PERIOD_POLL, dev->intf_ptr);
+        }
+
+        tries--;
+    }
+
+    return rslt;
+}
+
+static int8_t ref_read_all_field_data(struct bme69x_data * const data[], struct bme69x_dev *dev)
+{
+    int8_t rslt = BME69X_OK;
+    uint8_t buff[BME69X_LEN_FIELD * 3] = { 0 };
+    uint8_t gas_range;
+    uint32_t adc_temp;
+    uint32_t adc_pres;
+    uint16_t adc_hum;
+    uint16_t adc_gas_res;
+    uint8_t off;
+    uint8_t set_val[30] = { 0 }; /* idac, res_heat, gas_wait */
+    uint8_t i;
+
+    if (!data[0] && !data[1] && !data[2])
+    {
+        rslt = BME69X_E_NULL_PTR;
+    }
+
+    if (rslt == BME69X_OK)
+    {
+        rslt = bme69x_get_regs(BME69X_REG_FIELD0, buff, (uint32_t) BME69X_LEN_FIELD * 3, dev);
+    }
+
+    if (rslt == BME69X_OK)
+    {
+        rslt = bme69x_get_regs(BME69X_REG_IDAC_HEAT0, set_val, 30, dev);
+    }
+
+    for (i = 0; ((i < 3) && (rslt == BME69X_OK)); i++)
+    {
+        off = (uint8_t)(i * BME69X_LEN_FIELD);
+        data[i]->status = buff[off] & BME69X_NEW_DATA_MSK;
+        data[i]->gas_index = buff[off] & BME69X_GAS_INDEX_MSK;
+        data[i]->meas_index = buff[off + 1];
+
+        /* read the raw data from the sensor */
+        adc_pres =
+            (uint32_t)(((uint32_t) buff[off + 2] << 16) | ((uint32_t) buff[off + 3] << 8) | ((uint32_t) buff[off + 4]));
+        adc_temp =
+            (uint32_t)(((uint32_t) buff[off + 5] << 16) | ((uint32_t) buff[off + 6] << 8) | ((uint32_t) buff[off + 7]));
+        adc_hum = (uint16_t) (((uint32_t) buff[off + 8] * 256) | (uint32_t) buff[off + 9]);
+        adc_gas_res = ((uint16_t)buff[off + 15] << 2) | ((uint16_t)buff[off + 16] >> 6);
+        gas_range = buff[off + 16] & BME69X_GAS_RANGE_MSK;
+
+        data[i]->status |= buff[off + 16] & BME69X_GASM_VALID_MSK;
+        data[i]->status |= buff[off + 16] & BME69X_HEAT_STAB_MSK;
+
+        data[i]->idac = set_val[data[i]->gas_index];
+        data[i]->res_heat = set_val[10 + data[i]->gas_index];
+        data[i]->gas_wait = set_val[20 + data[i]->gas_index];
+
+        data[i]->temperature = calc_temperature(adc_temp, dev, &data[i]->t_lin);
+        data[i]->pressure = calc_pressure(adc_pres, data[i]->t_lin, dev);
+        data[i]->humidity = calc_humidity(adc_hum, data[i]->temperature, dev);
+        data[i]->gas_resistance = calc_gas_resistance(adc_gas_res, gas_range);
+    }
+
+    return rslt;
+}
+
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    long samples, transfers, bytes;
+} count_t;
+
+static void add(count_t *c)
+{
+    c->samples++;
+    c->transfers += regfile.transactions;
+    c->bytes += regfile.bytes;
+}
+
+static void report(const char *what, const count_t *ref, const count_t *nw)
+{
+    printf("  %-16s %5.2f transfers %5.1f bytes -> %5.2f transfers %5.1f bytes\n", what,
+           (double)ref->transfers / ref->samples, (double)ref->bytes / ref->samples,
+           (double)nw->transfers / nw->samples, (double)nw->bytes / nw->samples);
+}
+
+static void calibrate(struct bme69x_dev *dev, uint32_t seed)
+{
+    regfile_attach(dev);
+    rng_state = seed;
+    for (int i = 0; i < 256; i++)
+        regfile.regs[i] = (uint8_t)rnd();
+    CHECK(get_calib_data(dev) == BME69X_OK);
+}
+
+// Random field registers with new data; forced mode reports heater step 0
+static void fields(int n, int forced)
+{
+    for (int i = 0; i < n; i++) {
+        uint8_t *f = &regfile.regs[BME69X_REG_FIELD0 + i * BME69X_LEN_FIELD_OFFSET];
+
+        for (int j = 0; j < BME69X_LEN_FIELD; j++)
+            f[j] = (uint8_t)rnd();
+        f[0] = (uint8_t)(BME69X_NEW_DATA_MSK | (forced ? 0u : rnd() % 10u));
+    }
+}
+
+static void forced(struct bme69x_dev *dev, int samples)
+{
+    struct bme69x_heatr_conf heatr = { .enable = BME69X_ENABLE, .heatr_temp = 300, .heatr_dur = 100 };
+    count_t ref_warm = { 0 }, new_warm = { 0 }, ref_cold = { 0 }, new_cold = { 0 };
+    struct bme69x_data a, b;
+
+    calibrate(dev, 1);
+    CHECK(bme69x_set_heatr_conf(BME69X_FORCED_MODE, &heatr, dev) == BME69X_OK);
+    for (int s = 0; s < samples; s++) {
+        int cold = s % 16 == 15;
+
+        fields(1, 1);
+        if (cold)
+            dev->shadow_valid = 0;
+        memset(&a, 0, sizeof a);
+        memset(&b, 0, sizeof b);
+        regfile_clear_counts();
+        CHECK(read_field_data(0, &a, dev) == BME69X_OK);
+        add(cold ? &new_cold : &new_warm);
+        regfile_clear_counts();
+        CHECK(ref_read_field_data(0, &b, dev) == BME69X_OK);
+        add(cold ? &ref_cold : &ref_warm);
+        CHECK(memcmp(&a, &b, sizeof a) == 0);
+    }
+    printf("forced mode, %d samples, identical data, original -> now per sample:\n", samples);
+    report("shadow warm", &ref_warm, &new_warm);
+    report("shadow cleared", &ref_cold, &new_cold);
+    CHECK(ref_warm.transfers == 4 * ref_warm.samples);
+#ifdef BME69X_FIELD_BURST_READ
+    CHECK(new_warm.transfers == new_warm.samples && new_cold.transfers == new_cold.samples);
+#else
+    CHECK(new_warm.transfers == 2 * new_warm.samples);
+#endif
+}
+
+static void parallel(struct bme69x_dev *dev, int samples)
+{
+    uint16_t temp[10], dur[10];
+    struct bme69x_heatr_conf heatr = { .enable = BME69X_ENABLE, .heatr_temp_prof = temp, .heatr_dur_prof = dur,
+                                       .profile_len = 10, .shared_heatr_dur = 140 };
+    count_t ref_warm = { 0 }, new_warm = { 0 }, ref_cold = { 0 }, new_cold = { 0 };
+    struct bme69x_data a[3], b[3];
+    struct bme69x_data * const pa[3] = { &a[0], &a[1], &a[2] };
+    struct bme69x_data * const pb[3] = { &b[0], &b[1], &b[2] };
+
+    calibrate(dev, 2);
+    for (int i = 0; i < 10; i++) {
+        temp[i] = (uint16_t)(200 + rnd() % 200);
+        dur[i] = (uint16_t)(1 + rnd() % 20);
+    }
+    CHECK(bme69x_set_heatr_conf(BME69X_PARALLEL_MODE, &heatr, dev) == BME69X_OK);
+    for (int s = 0; s < samples; s++) {
+        int cold = s % 16 == 15;
+
+        fields(3, 0);
+        if (cold)
+            dev->shadow_valid = 0;
+        memset(a, 0, sizeof a);
+        memset(b, 0, sizeof b);
+        regfile_clear_counts();
+        CHECK(read_all_field_data(pa, dev) == BME69X_OK);
+        add(cold ? &new_cold : &new_warm);
+        regfile_clear_counts();
+        CHECK(ref_read_all_field_data(pb, dev) == BME69X_OK);
+        add(cold ? &ref_cold : &ref_warm);
+        CHECK(memcmp(a, b, sizeof a) == 0);
+    }
+    printf("parallel mode, %d samples of 3 fields, identical data, original -> now per sample:\n", samples);
+    report("shadow warm", &ref_warm, &new_warm);
+    report("shadow cleared", &ref_cold, &new_cold);
+    CHECK(ref_warm.transfers == 2 * ref_warm.samples && ref_warm.bytes == 87 * ref_warm.samples);
+    CHECK(new_warm.transfers == new_warm.samples && new_warm.bytes == 64 * new_warm.samples);
+    CHECK(new_cold.transfers == new_cold.samples);
+}
+
+int main(int argc, char **argv)
+{
+    struct bme69x_dev dev;
+    int samples;
+
+    CHECK(argc == 2);
+    samples = atoi(argv[1]);
+    CHECK(samples >= 16);
+
+#ifdef BME69X_FIELD_BURST_READ
+    printf("BME69X_FIELD_BURST_READ\n");
+#endif
+    forced(&dev, samples);
+    parallel(&dev, samples);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,276 @@
+// The driver is included to reach its static heater configuration functions
+#include "bme69x.c"
+#include "regfile.h"
+
+#include <string.h>
+
+// Register shadow of bme69x.c against the configuration functions it changed,
+// copied below from the original driver. A BSEC-style forced cycle, as
+// bme690_array_trigger() runs it (bme69x_set_conf, bme69x_set_heatr_conf,
+// bme69x_set_op_mode), runs CYCLES times on two devices over one register
+// file: the original first, then the register image before it is restored
+// and the shadowed driver runs. The register images after both must be
+// identical. One cycle in 8 changes an oversampling, filter, ODR or heater
+// setting. Reported: transactions and bytes per cycle, settings unchanged and
+// changed.
+//
+// Usage: bme69x_shadow <cycles>
+
+static uint32_t rng_state;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// ---------------------------------------------------------------------------
+// Reference: the original configuration functions
+
+static int8_t ref_set_conf(struct bme69x_conf *conf, struct bme69x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t odr20 = 0, odr3 = 1;
+    uint8_t current_op_mode;
+
+    /* Register data starting from BME69X_REG_CTRL_GAS_1(0x71) up to BME69X_REG_CONFIG(0x75) */
+    uint8_t reg_array[BME69X_LEN_CONFIG] = { 0x71, 0x72, 0x73, 0x74, 0x75 };
+    uint8_t data_array[BME69X_LEN_CONFIG] = { 0 };
+
+    rslt = bme69x_get_op_mode(&current_op_mode, dev);
+    if (rslt == BME69X_OK)
+    {
+        /* Configure only in the sleep mode */
+        rslt = bme69x_set_op_mode(BME69X_SLEEP_MODE, dev);
+    }
+
+    if (conf == NULL)
+    {
+        rslt = BME69X_E_NULL_PTR;
+    }
+    else if (rslt == BME69X_OK)
+    {
+        /* Read the whole configuration and write it back once later */
+        rslt = bme69x_get_regs(reg_array[0], data_array, BME69X_LEN_CONFIG, dev);
+        dev->info_msg = BME69X_OK;
+        if (rslt == BME69X_OK)
+        {
+            rslt = boundary_check(&conf->filter, BME69X_FILTER_SIZE_127, dev);
+        }
+
+        if (rslt == BME69X_OK)
+        {
+            rslt = boundary_check(&conf->os_temp, BME69X_OS_16X, dev);
+        }
+
+        if (rslt == BME69X_OK)
+        {
+            rslt = boundary_check(&conf->os_pres, BME69X_OS_16X, dev);
+        }
+
+        if (rslt == BME69X_OK)
+        {
+            rslt = boundary_check(&conf->os_hum, BME69X_OS_16X, dev);
+        }
+
+        if (rslt == BME69X_OK)
+        {
+            rslt = boundary_check(&conf->odr, BME69X_ODR_NONE, dev);
+        }
+
+        if (rslt == BME69X_OK)
+        {
+            data_array[4] = BME69X_SET_BITS(data_array[4], BME69X_FILTER, conf->filter);
+            data_array[3] = BME69X_SET_BITS(data_array[3], BME69X_OST, conf->os_temp);
+            data_array[3] = BME69X_SET_BITS(data_array[3], BME69X_OSP, conf->os_pres);
+            data_array[1] = BME69X_SET_BITS_POS_0(data_array[1], BME69X_OSH, conf->os_hum);
+            if (conf->odr != BME69X_ODR_NONE)
+            {
+                odr20 = conf->odr;
+                odr3 = 0;
+            }
+
+            data_array[4] = BME69X_SET_BITS(data_array[4], BME69X_ODR20, odr20);
+            data_array[0] = BME69X_SET_BITS(data_array[0], BME69X_ODR3, odr3);
+        }
+    }
+
+    if (rslt == BME69X_OK)
+    {
+        rslt = bme69x_set_regs(reg_array, data_array, BME69X_LEN_CONFIG, dev);
+    }
+
+    if ((current_op_mode != BME69X_SLEEP_MODE) && (rslt == BME69X_OK))
+    {
+        rslt = bme69x_set_op_mode(current_op_mode, dev);
+    }
+
+    return rslt;
+}
+
+/* Forced mode only: the cycle below never configures a profile */
+static int8_t ref_heatr_set_conf(const struct bme69x_heatr_conf *conf, uint8_t *nb_conv, struct bme69x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t rh_reg_addr = BME69X_REG_RES_HEAT0;
+    uint8_t rh_reg_data = calc_res_heat(conf->heatr_temp, dev);
+    uint8_t gw_reg_addr = BME69X_REG_GAS_WAIT0;
+    uint8_t gw_reg_data = calc_gas_wait(conf->heatr_dur);
+
+    (*nb_conv) = 0;
+    rslt = bme69x_set_regs(&rh_reg_addr, &rh_reg_data, 1, dev);
+    if (rslt == BME69X_OK)
+    {
+        rslt = bme69x_set_regs(&gw_reg_addr, &gw_reg_data, 1, dev);
+    }
+
+    return rslt;
+}
+
+static int8_t ref_set_heatr_conf(const struct bme69x_heatr_conf *conf, struct bme69x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t nb_conv = 0;
+    uint8_t hctrl, run_gas = 0;
+    uint8_t ctrl_gas_data[2];
+    uint8_t ctrl_gas_addr[2] = { BME69X_REG_CTRL_GAS_0, BME69X_REG_CTRL_GAS_1 };
+
+    rslt = bme69x_set_op_mode(BME69X_SLEEP_MODE, dev);
+    if (rslt == BME69X_OK)
+    {
+        rslt = ref_heatr_set_conf(conf, &nb_conv, dev);
+    }
+
+    if (rslt == BME69X_OK)
+    {
+        rslt = bme69x_get_regs(BME69X_REG_CTRL_GAS_0, ctrl_gas_data, 2, dev);
+        if (rslt == BME69X_OK)
+        {
+            if (conf->enable == BME69X_ENABLE)
+            {
+                hctrl = BME69X_ENABLE_HEATER;
+                run_gas = BME69X_ENABLE_GAS_MEAS;
+            }
+            else
+            {
+                hctrl = BME69X_DISABLE_HEATER;
+                run_gas = BME69X_DISABLE_GAS_MEAS;
+            }
+
+            ctrl_gas_data[0] = BME69X_SET_BITS(ctrl_gas_data[0], BME69X_HCTRL, hctrl);
+            ctrl_gas_data[1] = BME69X_SET_BITS_POS_0(ctrl_gas_data[1], BME69X_NBCONV, nb_conv);
+            ctrl_gas_data[1] = BME69X_SET_BITS(ctrl_gas_data[1], BME69X_RUN_GAS, run_gas);
+
+            rslt = bme69x_set_regs(ctrl_gas_addr, ctrl_gas_data, 2, dev);
+        }
+    }
+
+    return rslt;
+}
+
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    long cycles, transactions, bytes;
+} count_t;
+
+static void add(count_t *c)
+{
+    c->cycles++;
+    c->transactions += regfile.transactions;
+    c->bytes += regfile.bytes;
+}
+
+static void report(const char *what, const count_t *ref, const count_t *nw)
+{
+    printf("  %-18s %6ld cycles: %5.2f transactions %5.1f bytes -> %5.2f transactions %5.1f bytes\n",
+           what, nw->cycles, (double)ref->transactions / ref->cycles, (double)ref->bytes / ref->cycles,
+           (double)nw->transactions / nw->cycles, (double)nw->bytes / nw->cycles);
+}
+
+// One setting at a time, as BSEC changes them between samples
+static void change(struct bme69x_conf *conf, struct bme69x_heatr_conf *heatr)
+{
+    static const uint16_t temps[] = { 200, 240, 280, 320, 360 };
+    static const uint16_t durs[] = { 50, 100, 140, 200 };
+    struct bme69x_conf c = *conf;
+    struct bme69x_heatr_conf h = *heatr;
+
+    while (memcmp(&c, conf, sizeof c) == 0 && h.enable == heatr->enable &&
+           h.heatr_temp == heatr->heatr_temp && h.heatr_dur == heatr->heatr_dur) {
+        switch (rnd() % 7)
+        {
+            case 0: conf->os_temp = (uint8_t)(rnd() % 6); break;
+            case 1: conf->os_pres = (uint8_t)(rnd() % 6); break;
+            case 2: conf->os_hum = (uint8_t)(rnd() % 6); break;
+            case 3: conf->filter = (uint8_t)(rnd() % 8); break;
+            case 4: conf->odr = (uint8_t)(rnd() % 9); break;
+            case 5: heatr->enable = heatr->enable ? BME69X_DISABLE : BME69X_ENABLE; break;
+            default:
+                heatr->heatr_temp = temps[rnd() % 5];
+                heatr->heatr_dur = durs[rnd() % 4];
+                break;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct bme69x_dev ref, dev;
+    struct bme69x_conf conf = { .os_hum = BME69X_OS_1X, .os_temp = BME69X_OS_2X, .os_pres = BME69X_OS_16X,
+                                .filter = BME69X_FILTER_OFF, .odr = BME69X_ODR_NONE };
+    struct bme69x_heatr_conf heatr = { .enable = BME69X_ENABLE, .heatr_temp = 320, .heatr_dur = 140 };
+    count_t ref_same = { 0 }, new_same = { 0 }, ref_changed = { 0 }, new_changed = { 0 };
+    uint8_t before[256], after[256];
+    int cycles;
+
+    CHECK(argc == 2);
+    cycles = atoi(argv[1]);
+    CHECK(cycles >= 8);
+
+    rng_state = 1;
+    for (int i = 0; i < 256; i++)
+        regfile.regs[i] = (uint8_t)rnd();
+    regfile.regs[BME69X_REG_CTRL_MEAS] &= (uint8_t)~BME69X_MODE_MSK;
+    regfile_attach(&ref);
+    regfile_attach(&dev);
+    CHECK(get_calib_data(&ref) == BME69X_OK);
+    CHECK(get_calib_data(&dev) == BME69X_OK);
+
+    for (int c = 0; c < cycles; c++) {
+        struct bme69x_conf ref_conf, new_conf;
+        int changed = c == 0 || rnd() % 8 == 0;
+
+        if (changed && c > 0)
+            change(&conf, &heatr);
+        ref_conf = conf;
+        new_conf = conf;
+
+        memcpy(before, regfile.regs, sizeof before);
+        regfile_clear_counts();
+        CHECK(ref_set_conf(&ref_conf, &ref) == BME69X_OK);
+        CHECK(ref_set_heatr_conf(&heatr, &ref) == BME69X_OK);
+        CHECK(bme69x_set_op_mode(BME69X_FORCED_MODE, &ref) == BME69X_OK);
+        add(changed ? &ref_changed : &ref_same);
+        memcpy(after, regfile.regs, sizeof after);
+
+        memcpy(regfile.regs, before, sizeof before);
+        regfile_clear_counts();
+        CHECK(bme69x_set_conf(&new_conf, &dev) == BME69X_OK);
+        CHECK(bme69x_set_heatr_conf(BME69X_FORCED_MODE, &heatr, &dev) == BME69X_OK);
+        CHECK(bme69x_set_op_mode(BME69X_FORCED_MODE, &dev) == BME69X_OK);
+        add(changed ? &new_changed : &new_same);
+        CHECK(memcmp(after, regfile.regs, sizeof after) == 0);
+
+        // The measurement ends and the sensor returns to sleep
+        regfile.regs[BME69X_REG_CTRL_MEAS] &= (uint8_t)~BME69X_MODE_MSK;
+    }
+
+    printf("%d forced cycles, identical register images, original -> shadowed per cycle:\n", cycles);
+    report("settings unchanged", &ref_same, &new_same);
+    report("settings changed", &ref_changed, &new_changed);
+    CHECK(new_same.transactions == 2 * new_same.cycles);
+    CHECK(new_changed.transactions < ref_changed.transactions);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "bme69x.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Register-file fake of a BME69x on I2C: 256 registers behind the driver's
+// read and write callbacks, counting bus transactions and the bytes on the
+// bus (device address, register address and data, no ACKs).
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+typedef struct {
+    uint8_t regs[256];
+    long transactions;  // one per read or write callback
+    long reads;
+    long writes;
+    long bytes;         // bytes on the bus
+} regfile_t;
+
+extern regfile_t regfile;
+
+// Sets up dev for the fake (I2C, callbacks, no delay)
+void regfile_attach(struct bme69x_dev *dev);
+
+// Clears the counters, keeps the registers
+void regfile_clear_counts(void);
@@ -0,0 +1,292 @@
+#include "sensor_model.h"
+#include "bme690_array.h"
+#include "bma456mm.h"
+#include "i2c_bus.h"
+#include "us_delay.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Boot-time trace of the sensor init, on the sensor model of ../bme690_array
+// (100 kHz wire times, virtual clock) with a BMA456 register model next to the
+// two BME690s. Replayed, step by step: the BME690 part of air_app_init()
+// (bme690_array_add() of the raw and the BSEC sensor) and the Bosch calls of
+// bma456_app_init() with its HAL_Delay()s, UART text left out. Each run in its
+// own process, with the driver waits of
+//   ms ticks  the delay callbacks before us_delay(): HAL_Delay() of the wait
+//             rounded up to ms (BME690) or cut to ms with a 1 ms floor (BMA456)
+//   us_delay  the wait asked for
+// HAL_Delay(n) runs until the tick has moved on by n + 1, as the HAL's does.
+// The BMA456 model checks the config stream it receives against the blob
+// before it reports the ASIC initialized. Reported: the time of each step,
+// driver waits and the totals per sensor. us_delay() must wait exactly what
+// the drivers ask and shorten the boot.
+//
+// Usage: boot_trace
+
+#define BMA_ADDR     0x18u   // BMA456_I2C_ADDR
+#define MAX_STEPS    24
+
+typedef struct
+{
+    const char *name;
+    uint64_t us;
+    long waits;
+} step_t;
+
+typedef struct
+{
+    int n;
+    step_t step[MAX_STEPS];
+    uint64_t asked_us, waited_us;
+} trace_t;
+
+static trace_t *trace;
+static int waits;
+
+// ---------------------------------------------------------------------------
+// BMA456: a register file; 0x5E streams to and from the feature memory at the
+// word address in 0x5B/0x5C, INIT_CTRL = 1 loads the config from it
+
+static uint8_t bma_regs[256];
+static uint8_t bma_mem[8192];
+static struct bma4_dev bma;
+
+static void bma_dev(uint8_t addr, uint8_t reg_addr, int read, uint8_t *data, uint16_t len)
+{
+    uint32_t mem = 2u * ((uint32_t)bma_regs[BMA4_RESERVED_REG_5C_ADDR] << 4 |
+                         (bma_regs[BMA4_RESERVED_REG_5B_ADDR] & 0x0Fu));
+
+    CHECK(addr == BMA_ADDR);
+    if (reg_addr == BMA4_FEATURE_CONFIG_ADDR) {
+        CHECK(mem + len <= sizeof bma_mem);
+        if (read)
+            memcpy(data, &bma_mem[mem], len);
+        else
+            memcpy(&bma_mem[mem], data, len);
+        return;
+    }
+    CHECK(reg_addr + len <= 256);
+    if (read) {
+        memcpy(data, &bma_regs[reg_addr], len);
+        return;
+    }
+    memcpy(&bma_regs[reg_addr], data, len);
+    if (reg_addr == BMA4_INIT_CTRL_ADDR && data[0] == 0x01) {
+        CHECK(bma.config_size > 0 && bma.config_size <= sizeof bma_mem);
+        CHECK(memcmp(bma_mem, bma.config_file_ptr, bma.config_size) == 0);
+        bma_regs[BMA4_INTERNAL_STAT] = BMA4_ASIC_INITIALIZED;
+        bma_regs[BMA4_RESERVED_REG_5B_ADDR] = 0;
+        bma_regs[BMA4_RESERVED_REG_5C_ADDR] = 0;
+    }
+}
+
+static BMA4_INTF_RET_TYPE bma_read(uint8_t reg_addr, uint8_t *read_data, uint32_t len, void *intf_ptr)
+{
+    (void)intf_ptr;
+    return i2c_bus_transfer(BMA_ADDR << 1, reg_addr, I2C_BUS_READ, read_data, (uint16_t)len, 100) == HAL_OK ? 0 : -1;
+}
+
+static BMA4_INTF_RET_TYPE bma_write(uint8_t reg_addr, const uint8_t *write_data, uint32_t len, void *intf_ptr)
+{
+    (void)intf_ptr;
+    return i2c_bus_transfer(BMA_ADDR << 1, reg_addr, I2C_BUS_WRITE, (uint8_t *)write_data, (uint16_t)len, 100) == HAL_OK ? 0 : -1;
+}
+
+static void bma_delay_us(uint32_t period, void *intf_ptr)
+{
+    (void)intf_ptr;
+    us_delay(period);
+}
+
+// ---------------------------------------------------------------------------
+// Delays
+
+// Until the tick has moved on by ms + 1 (HAL_Delay adds uwTickFreq)
+static uint32_t hal_delay_wait(uint32_t ms)
+{
+    return (uint32_t)(((uint64_t)HAL_GetTick() + ms + 1u) * 1000u - model.now_us);
+}
+
+static void HAL_Delay(uint32_t ms)
+{
+    model_sleep_until(model.now_us + hal_delay_wait(ms));
+}
+
+// The callbacks before us_delay(): bme690_delay_us and bma456_delay_us
+static uint32_t old_bme_delay(uint32_t us)
+{
+    waits++;
+    trace->asked_us += us;
+    return hal_delay_wait((us + 999u) / 1000u);
+}
+
+static uint32_t old_bma_delay(uint32_t us)
+{
+    uint32_t ms = us / 1000u;
+
+    waits++;
+    trace->asked_us += us;
+    if (ms == 0 && us > 0)
+        ms = 1;
+    return ms ? hal_delay_wait(ms) : 0u;
+}
+
+static uint32_t exact_delay(uint32_t us)
+{
+    waits++;
+    trace->asked_us += us;
+    return us;
+}
+
+// ---------------------------------------------------------------------------
+
+#define STEP(label, call)                                                   \
+    do {                                                                    \
+        uint64_t t0 = model.now_us;                                         \
+        long w0 = waits;                                                \
+        CHECK(trace->n < MAX_STEPS);                                        \
+        CHECK((call) == 0);                                                 \
+        trace->step[trace->n].name = label;                                 \
+        trace->step[trace->n].us = model.now_us - t0;                       \
+        trace->step[trace->n].waits = waits - w0;                       \
+        trace->n++;                                                         \
+    } while (0)
+
+static int hal_delay_step(uint32_t ms)
+{
+    HAL_Delay(ms);
+    return 0;
+}
+
+static void on_sample(uint8_t idx, const struct bme69x_data *data, uint32_t trig_ms)
+{
+    (void)idx;
+    (void)data;
+    (void)trig_ms;
+}
+
+static void run(int exact, trace_t *t)
+{
+    // As in air_app.c
+    static const bme690_sensor_cfg_t cfg[2] = {
+        {
+            .i2c_addr = 0x77, .mux_addr = BME690_PORT_NO_MUX, .period_ms = 10000,
+            .os_temp = BME69X_OS_2X, .os_pres = BME69X_OS_16X, .os_hum = BME69X_OS_1X,
+            .filter = BME69X_FILTER_SIZE_3,
+        },
+        { .i2c_addr = 0x76, .mux_addr = BME690_PORT_NO_MUX, .period_ms = 0 },
+    };
+    struct bma4_accel_config accel = {
+        .odr = BMA4_OUTPUT_DATA_RATE_1600HZ, .range = BMA4_ACCEL_RANGE_16G,
+        .bandwidth = BMA4_ACCEL_NORMAL_AVG4, .perf_mode = BMA4_CONTINUOUS_MODE,
+    };
+    struct bma456mm_high_g_config high_g = {
+        .threshold = 256, .duration = 10, .hysteresis = 2770, .axes_en = BMA456MM_HIGH_G_EN_ALL_AXIS,
+    };
+    struct bma456mm_any_no_mot_config any_mot = {
+        .threshold = 20, .duration = 5, .axes_en = BMA456MM_EN_ALL_AXIS,
+    };
+    struct bma4_int_pin_config pin = {
+        .edge_ctrl = BMA4_LEVEL_TRIGGER, .lvl = BMA4_ACTIVE_HIGH, .od = BMA4_PUSH_PULL,
+        .output_en = BMA4_OUTPUT_ENABLE, .input_en = BMA4_INPUT_DISABLE,
+    };
+    struct bma4_accel xyz;
+    uint16_t int_status;
+    uint8_t idx, reg;
+
+    trace = t;
+    model_reset();
+    model_add(0x77, MODEL_DIRECT, 1u);
+    model_add(0x76, MODEL_DIRECT, 2u);
+    model_other_dev = bma_dev;
+    memset(bma_regs, 0, sizeof bma_regs);
+    bma_regs[BMA4_CHIP_ID_ADDR] = BMA456MM_CHIP_ID;
+
+    // air_app_init()
+    model_delay_policy = exact ? exact_delay : old_bme_delay;
+    bme690_array_init(on_sample);
+    STEP("bme690 0x77 (raw)", bme690_array_add(&model_hi2c, &cfg[0], &idx));
+    STEP("bme690 0x76 (BSEC)", bme690_array_add(&model_hi2c, &cfg[1], &idx));
+
+    // bma456_app_init()
+    model_delay_policy = exact ? exact_delay : old_bma_delay;
+    memset(&bma, 0, sizeof bma);
+    bma.intf = BMA4_I2C_INTF;
+    bma.bus_read = bma_read;
+    bma.bus_write = bma_write;
+    bma.delay_us = bma_delay_us;
+    bma.intf_ptr = &model_hi2c;
+    bma.variant = BMA42X_VARIANT;
+    STEP("bma456mm_init", bma456mm_init(&bma));
+    bma.read_write_len = bma.config_size;   // BMA456_CONFIG_BURST_LEN 0: one burst
+    STEP("config upload", bma456mm_write_config_file(&bma));
+    STEP("HAL_Delay(10)", hal_delay_step(10));
+    STEP("accel config", bma4_set_accel_config(&accel, &bma));
+    STEP("accel enable", bma4_set_accel_enable(BMA4_ENABLE, &bma));
+    STEP("power save off", bma4_set_advance_power_save(BMA4_DISABLE, &bma));
+    STEP("HAL_Delay(5)", hal_delay_step(5));
+    STEP("FIFO off", bma4_set_fifo_config(BMA4_FIFO_ALL, BMA4_DISABLE, &bma));
+    STEP("FIFO accel", bma4_set_fifo_config(BMA4_FIFO_ACCEL, BMA4_ENABLE, &bma));
+    STEP("high-g config", bma456mm_set_high_g_config(&high_g, &bma));
+    STEP("any-motion config", bma456mm_set_any_mot_config(&any_mot, &bma));
+    STEP("INT1 pin", bma4_set_int_pin_config(&pin, BMA4_INTR1_MAP, &bma));
+    STEP("INT1 read back", bma4_read_regs(0x53, &reg, 1, &bma));
+    STEP("latched mode", bma4_set_interrupt_mode(BMA4_LATCH_MODE, &bma));
+    STEP("high-g enable", bma456mm_feature_enable(BMA456MM_HIGH_G, BMA4_ENABLE, &bma));
+    STEP("HAL_Delay(10)", hal_delay_step(10));
+    STEP("map high-g", bma456mm_map_interrupt(BMA4_INTR1_MAP, BMA456MM_HIGH_G_INT, BMA4_ENABLE, &bma));
+    STEP("map any-motion", bma456mm_map_interrupt(BMA4_INTR1_MAP, BMA456MM_ANY_MOT_INT, BMA4_ENABLE, &bma));
+    STEP("read backs", bma4_read_regs(0x58, &reg, 1, &bma) | bma4_read_accel_xyz(&xyz, &bma) |
+                       bma456mm_read_int_status(&int_status, &bma));
+    CHECK(reg == bma_regs[0x58] && bma_regs[BMA4_INTERNAL_STAT] == BMA4_ASIC_INITIALIZED);
+    t->waited_us = model.delay_us;
+}
+
+int main(int argc, char **argv)
+{
+    trace_t *res;
+
+    (void)argv;
+    CHECK(argc == 1);
+
+    // One process per run: the port keeps its contexts in statics
+    res = mmap(NULL, 2 * sizeof *res, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    CHECK(res != MAP_FAILED);
+    for (int k = 0; k < 2; k++) {
+        pid_t pid = fork();
+        int status;
+
+        CHECK(pid >= 0);
+        if (pid == 0) {
+            run(k, &res[k]);
+            exit(0);
+        }
+        CHECK(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    printf("sensor init at %u kHz, ms ticks -> us_delay:\n", MODEL_I2C_HZ / 1000u);
+    CHECK(res[0].n == res[1].n);
+    {
+        double bme[2] = {0, 0}, bma[2] = {0, 0};
+
+        for (int i = 0; i < res[0].n; i++) {
+            const step_t *o = &res[0].step[i], *n = &res[1].step[i];
+
+            CHECK(strcmp(o->name, n->name) == 0 && o->waits == n->waits);
+            printf("  %-20s %4ld waits %8.2f -> %8.2f ms\n", o->name, o->waits, o->us / 1000.0, n->us / 1000.0);
+            for (int k = 0; k < 2; k++)
+                (i < 2 ? bme : bma)[k] += res[k].step[i].us / 1000.0;
+        }
+        printf("  2x BME690 %8.2f -> %8.2f ms, BMA456 %8.2f -> %8.2f ms\n", bme[0], bme[1], bma[0], bma[1]);
+        printf("  driver waits: %.2f ms asked, %.2f ms waited with ms ticks, %.2f ms with us_delay\n",
+               res[1].asked_us / 1000.0, res[0].waited_us / 1000.0, res[1].waited_us / 1000.0);
+        CHECK(res[1].waited_us == res[1].asked_us && res[0].asked_us == res[1].asked_us);
+        CHECK(bme[1] < bme[0] && bma[1] < bma[0]);
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "store_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// BSEC state log on the Flash model. First the wear: SAVES saves of random
+// length spread their erases over the four pages, where the single-page store
+// erased one page per save; then the boot scan time on a full log and on one
+// whose newest record is torn. Then power cuts: a workload of saves, started on
+// a blank log and on the single-page layout it migrates from, is replayed once
+// per Flash operation with power cut in the middle of that operation. After
+// each cut the newest committed state, or the one being saved, must be
+// restored, and the next saves must land and load.
+//
+// Usage: bsec_store_cut <saves> <cut workload saves> <seeds>
+
+#define LEGACY_STATE 0x4C4547u
+
+typedef struct {
+    uint32_t committed;  // newest state whose save reported HAL_OK
+    uint32_t pending;    // state being saved
+} model_t;
+
+enum { OK, LOST, WRONG, NO_PROGRESS, NUM_RESULTS };
+static const char *result_name[NUM_RESULTS] = {
+    "ok", "committed state lost", "other state restored", "later saves fail",
+};
+
+static model_t *model;
+static uint32_t rng_state;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+static uint16_t rnd_len(void)
+{
+    return (uint16_t)(8 + rnd() % (BSEC_MAX_STATE_BLOB_SIZE - 7));
+}
+
+static double host_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double boot_us(uint32_t *state)
+{
+    double t = host_us();
+    for (int i = 0; i < 1000; i++)
+        *state = store_boot();
+    return (host_us() - t) / 1000;
+}
+
+static void wear(int saves)
+{
+    long max = 0, total = 0;
+    uint32_t state;
+
+    flash_model_reset();
+    CHECK(store_boot() == 0);
+    for (int i = 1; i <= saves; i++)
+        CHECK(store_save((uint32_t)i, rnd_len()) == HAL_OK);
+    for (uint32_t p = 0; p < STORE_PAGES; p++) {
+        long n = flash_model->page_erases[STORE_PAGE0 + p];
+        total += n;
+        if (n > max)
+            max = n;
+    }
+    printf("wear: %d saves, %ld erases, at most %ld per page (single page: %d on one page), "
+           "%ld words + %ld bursts\n",
+           saves, total, max, saves, flash_model->words, flash_model->bursts);
+    CHECK(max * 8 < saves);
+
+    double full = boot_us(&state);
+    CHECK(state == (uint32_t)saves);
+
+    // Tear the newest record: a cut in the middle of its last program
+    flash_model->cut_at = flash_model->ops + 2;
+    pid_t pid = fork();
+    if (pid == 0) {
+        store_save((uint32_t)saves + 1, BSEC_MAX_STATE_BLOB_SIZE);
+        _exit(3);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    flash_model->cut_at = 0;
+    double torn = boot_us(&state);
+    CHECK(state == (uint32_t)saves);
+    printf("boot scan: full log %.2f us, torn newest record %.2f us (host)\n", full, torn);
+}
+
+// Saves with random lengths; the model tracks what must survive a cut
+static void workload(int saves, uint32_t first)
+{
+    uint32_t loaded = store_boot();
+
+    if (loaded != model->committed)
+        _exit(2);
+    for (int i = 0; i < saves; i++) {
+        model->pending = first + (uint32_t)i;
+        if (store_save(model->pending, rnd_len()) == HAL_OK)
+            model->committed = model->pending;
+    }
+    model->pending = 0;
+}
+
+// After a cut: the right state loads, and the log takes new saves
+static int check(void)
+{
+    uint32_t state = store_boot();
+
+    if (state != model->committed && (state != model->pending || state == 0))
+        return state == 0 ? LOST : WRONG;
+    for (uint32_t i = 1; i <= 3; i++) {
+        if (store_save(0x100000u + i, rnd_len()) != HAL_OK || store_boot() != 0x100000u + i)
+            return NO_PROGRESS;
+    }
+    return OK;
+}
+
+static void run_child(void (*fn)(void))
+{
+    int status;
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        fn();
+        fflush(stdout);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+static int wear_saves, cut_saves, legacy;
+static uint32_t seed;
+
+static void run_wear(void)
+{
+    wear(wear_saves);
+}
+
+static void setup(void)
+{
+    flash_model_reset();
+    model->committed = 0;
+    model->pending = 0;
+    if (legacy) {
+        store_write_legacy(LEGACY_STATE, 120, 41);
+        model->committed = LEGACY_STATE;
+    }
+}
+
+static void run_workload(void)
+{
+    rng_state = seed;
+    workload(cut_saves, 1);
+}
+
+static void run_check(void)
+{
+    _exit(check());
+}
+
+int main(int argc, char **argv)
+{
+    long results[NUM_RESULTS] = {0};
+    long cuts = 0;
+    int seeds;
+
+    CHECK(argc == 4);
+    // Children inherit stdout: nothing may sit in its buffer across a fork
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    cut_saves = atoi(argv[2]);
+    seeds = atoi(argv[3]);
+    CHECK(flash_model_init() == 0);
+    model = mmap(NULL, sizeof *model, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    CHECK(model != MAP_FAILED);
+
+    rng_state = 1;
+    wear_saves = atoi(argv[1]);
+    run_child(run_wear);
+
+    for (legacy = 0; legacy <= 1; legacy++) {
+        for (seed = 1; seed <= (uint32_t)seeds; seed++) {
+            long ops, erases;
+
+            // Dry run for the number of operations
+            setup();
+            run_child(run_workload);
+            ops = flash_model->ops;
+            erases = flash_model->erases;
+            CHECK(model->committed == (uint32_t)cut_saves);
+
+            for (long cut = 1; cut <= ops; cut++) {
+                int status;
+                pid_t pid;
+
+                setup();
+                flash_model->cut_at = cut;
+                run_child(run_workload);
+                flash_model->cut_at = 0;
+                pid = fork();
+                if (pid == 0)
+                    run_check();
+                waitpid(pid, &status, 0);
+                CHECK(WIFEXITED(status) && WEXITSTATUS(status) < NUM_RESULTS);
+                results[WEXITSTATUS(status)]++;
+                cuts++;
+            }
+            printf("%s log, seed %u: %ld Flash operations cut, %ld erases\n",
+                   legacy ? "single-page" : "blank", seed, ops, erases);
+        }
+    }
+
+    printf("%ld cut points\n", cuts);
+    for (int r = 1; r < NUM_RESULTS; r++)
+        printf("  %-22s %ld\n", result_name[r], results[r]);
+    CHECK(results[OK] == cuts);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "store_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Quad-word programming of the BSEC state log. SAVES saves of random length
+// run once with every Flash manager burst programmed as four words and once
+// with bursts: the images must be identical, every save must load back, and
+// the program operations are reported. Built twice, with records packed on
+// words (BSEC_BURST_SIZE 4, the layout before quad-word alignment) and aligned
+// on quad-words: the packed build writes its log to a file, the aligned build
+// loads it, restores its newest state and keeps saving across the old records.
+//
+// Usage: bsec_store_image <saves> write|continue <image file>
+
+#define FIRST_CONTINUED 0x10000u
+
+static uint32_t rng_state;
+static uint8_t *image;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+static void saves(uint32_t first, int n)
+{
+    rng_state = first;
+    for (uint32_t state = first; state < first + (uint32_t)n; state++) {
+        CHECK(store_save(state, (uint16_t)(8 + rnd() % (BSEC_MAX_STATE_BLOB_SIZE - 7))) == HAL_OK);
+        CHECK(store_boot() == state);
+    }
+}
+
+static void run(uint32_t first, int n, int bursts_as_words)
+{
+    int status;
+    pid_t pid;
+
+    flash_model_bursts_as_words = bursts_as_words;
+    pid = fork();
+    if (pid == 0) {
+        saves(first, n);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char **argv)
+{
+    long words, burst_words, bursts;
+    int n;
+
+    CHECK(argc == 4);
+    n = atoi(argv[1]);
+    CHECK(flash_model_init() == 0);
+    image = mmap(NULL, FLASH_MODEL_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(image != MAP_FAILED);
+
+    run(1, n, 1);
+    words = flash_model->words;
+    memcpy(image, (void *)(uintptr_t)FLASH_MODEL_BASE, FLASH_MODEL_SIZE);
+    flash_model_reset();
+    run(1, n, 0);
+    burst_words = flash_model->words;
+    bursts = flash_model->bursts;
+    CHECK(memcmp(image, (void *)(uintptr_t)FLASH_MODEL_BASE, FLASH_MODEL_SIZE) == 0);
+    printf("%s records, %d saves, identical images: words only %ld program ops, "
+           "with bursts %ld (%ld words + %ld bursts)\n",
+           BSEC_BURST_SIZE == 4 ? "word-packed" : "quad-word aligned", n, words,
+           burst_words + bursts, burst_words, bursts);
+
+    if (strcmp(argv[2], "write") == 0) {
+        CHECK(flash_model_save(argv[3]) == 0);
+    } else {
+        CHECK(strcmp(argv[2], "continue") == 0);
+        flash_model_reset();
+        CHECK(flash_model_load(argv[3]) == 0);
+        CHECK(store_boot() == (uint32_t)n);
+        run(FIRST_CONTINUED, n, 0);
+        printf("word-packed log continued with %d saves\n", n);
+    }
+    printf("PASS\n");
+    return 0;
+}
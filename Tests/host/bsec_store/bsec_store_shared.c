@@ -0,0 +1,59 @@
+#include "store_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// The shared BSEC work buffer against the store that kept its own (owned/,
+// the store before load and save borrowed the caller's buffer). Built once
+// with each store, with records packed on words as the owned store writes
+// them. Both run the same workload: a single-page record of the layout before
+// the log is migrated, then SAVES saves of random length, each loaded back by
+// a boot. The owned build writes the Flash image to a file, the shared build
+// compares its own image with it byte for byte. The Makefile then prints the
+// RAM of both from the objects.
+//
+// Usage: bsec_store_shared <saves> write|compare <image file>
+
+static uint32_t rng_state;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *image;
+    int n;
+
+    CHECK(argc == 4);
+    n = atoi(argv[1]);
+    CHECK(flash_model_init() == 0);
+    flash_model_reset();
+
+    store_write_legacy(1, 120, 7);
+    CHECK(store_boot() == 1);
+    rng_state = 1;
+    for (uint32_t state = 2; state < 2 + (uint32_t)n; state++) {
+        CHECK(store_save(state, (uint16_t)(8 + rnd() % (BSEC_MAX_STATE_BLOB_SIZE - 7))) == HAL_OK);
+        CHECK(store_boot() == state);
+    }
+
+    if (strcmp(argv[2], "write") == 0) {
+        CHECK(flash_model_save(argv[3]) == 0);
+        printf("work buffers owned by the store: %d saves after a migration, image written\n", n);
+    } else {
+        CHECK(strcmp(argv[2], "compare") == 0);
+        image = mmap(NULL, FLASH_MODEL_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        CHECK(image != MAP_FAILED);
+        memcpy(image, (void *)(uintptr_t)FLASH_MODEL_BASE, FLASH_MODEL_SIZE);
+        CHECK(flash_model_load(argv[3]) == 0);
+        CHECK(memcmp(image, (void *)(uintptr_t)FLASH_MODEL_BASE, FLASH_MODEL_SIZE) == 0);
+        printf("shared work buffer: %d saves after a migration, Flash image identical\n", n);
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,374 @@
+/*
+ * Core/Src/bsec_state_store.c as it was before load and save borrowed the caller's
+ * work buffer: each keeps its own. Reference of bsec_store_shared, unchanged.
+ */
+
+#include "bsec_state_store.h"
+
+#include "bsec_interface.h"
+#include "bsec_datatypes.h"
+
+#include "crc_calc.h"
+#include "flash_manager.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#ifndef BSEC_FLASH_PAGE_SIZE
+#define BSEC_FLASH_PAGE_SIZE (FLASH_PAGE_SIZE) /* 2KB */
+#endif
+
+/*
+ * Append-only record log over BSEC_STORE_NUM_PAGES pages ending right below BT NVM
+ * (BT NVM is last 4KB: 0x1006F000..0x1006FFFF). Saves are appended to the current
+ * page; a page is erased only when the log wraps around onto it. On boot every page
+ * is scanned once and the valid record with the highest sequence number wins.
+ *
+ * Erases and writes go through the Flash Manager, which runs them from its sequencer
+ * task in windows where the radio is idle; a save is an asynchronous erase/write job.
+ *
+ * Keep BSEC_STORE_NUM_PAGES in sync with FLASH_BSEC_DATASIZE in the linker script.
+ */
+#ifndef BSEC_STORE_END_ADDR
+#define BSEC_STORE_END_ADDR  (0x1006F000u)
+#endif
+
+#define BSEC_STORE_ADDR      (BSEC_STORE_END_ADDR - (BSEC_STORE_NUM_PAGES * BSEC_FLASH_PAGE_SIZE))
+
+#define BSEC_FLASH_BASE      (0x10040000u)
+
+#define BSEC_RECORD_MAGIC    (0x4C534542u) /* 'BESL' */
+#define BSEC_RECORD_VERSION  (2u)
+#define BSEC_ERASED_WORD     (0xFFFFFFFFu)
+
+/* Single-page layout used before the log (last page, version 1), migrated on load */
+#define BSEC_LEGACY_ADDR     (BSEC_STORE_END_ADDR - BSEC_FLASH_PAGE_SIZE)
+#define BSEC_LEGACY_MAGIC    (0x42534543u) /* 'BSEC' */
+#define BSEC_LEGACY_VERSION  (1u)
+
+/* Header is programmed first, so a torn save leaves a header whose CRC fails */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t version;
+    uint16_t length;
+    uint32_t crc32;     /* over seq, version, length and the blob */
+} bsec_record_hdr_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t crc32;
+    uint32_t save_count;
+    uint8_t  reserved[12];
+} bsec_legacy_hdr_t;
+
+#define RECORD_SIZE(len)     ((sizeof(bsec_record_hdr_t) + (uint32_t)(len) + 3u) & ~3u)
+#define RECORD_MAX_WORDS     (RECORD_SIZE(BSEC_MAX_STATE_BLOB_SIZE) / 4u)
+
+typedef enum
+{
+    JOB_IDLE = 0,
+    JOB_ERASE,          /* erasing s_job_page before appending to it */
+    JOB_WRITE           /* programming s_job_buf at s_job_addr */
+} bsec_job_t;
+
+static uint32_t s_last_save_ms = 0;
+
+/* Log position found by the boot scan, then advanced by every save */
+static uint32_t s_seq = 0;          /* sequence number of the newest valid record */
+static uint32_t s_newest_addr = 0;  /* 0: log is empty */
+static uint8_t  s_page = 0;         /* page being appended to */
+static uint32_t s_offset = 0;       /* next free byte in s_page */
+
+/* Save job; advanced by the Flash Manager callback (sequencer task context) */
+static FM_CallbackNode_t s_fm_node;
+static bsec_job_t s_job = JOB_IDLE;
+static HAL_StatusTypeDef s_job_result = HAL_BUSY; /* finished job not yet reported */
+static uint8_t  s_job_page = 0;
+static uint32_t s_job_addr = 0;
+static uint32_t s_job_size = 0;
+static uint32_t s_job_buf[RECORD_MAX_WORDS]; /* header + blob; read by the Flash Manager */
+
+static uint32_t record_crc(const bsec_record_hdr_t *hdr, const uint8_t *blob)
+{
+    uint32_t crc = CRC32_INIT;
+    crc = crc32_update(crc, &hdr->seq,
+                       (uint32_t)(offsetof(bsec_record_hdr_t, crc32) - offsetof(bsec_record_hdr_t, seq)));
+    crc = crc32_update(crc, blob, hdr->length);
+    return crc32_final(crc);
+}
+
+static uint32_t page_addr(uint8_t page)
+{
+    return BSEC_STORE_ADDR + (uint32_t)page * BSEC_FLASH_PAGE_SIZE;
+}
+
+static uint8_t region_is_erased(uint32_t addr, uint32_t len)
+{
+    const uint32_t *w = (const uint32_t*)addr;
+    for (uint32_t i = 0; i < len / 4u; i++)
+    {
+        if (w[i] != BSEC_ERASED_WORD) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Walk one page's records. Tracks the newest valid record and returns the offset
+ * of the first erased header slot, or the page size when the rest of the page
+ * cannot be trusted (torn header, foreign data).
+ */
+static uint32_t scan_page(uint8_t page)
+{
+    const uint32_t base = page_addr(page);
+    uint32_t off = 0;
+
+    while ((off + sizeof(bsec_record_hdr_t)) <= BSEC_FLASH_PAGE_SIZE)
+    {
+        const bsec_record_hdr_t *hdr = (const bsec_record_hdr_t*)(base + off);
+
+        if (hdr->magic == BSEC_ERASED_WORD) return off;
+
+        if (hdr->magic != BSEC_RECORD_MAGIC ||
+            hdr->length == 0u || hdr->length > BSEC_MAX_STATE_BLOB_SIZE ||
+            (off + RECORD_SIZE(hdr->length)) > BSEC_FLASH_PAGE_SIZE)
+        {
+            return BSEC_FLASH_PAGE_SIZE;
+        }
+
+        /* Torn or stale blobs only lose this record; the length still lets us skip it */
+        const uint8_t *blob = (const uint8_t*)(base + off + sizeof(bsec_record_hdr_t));
+        if (hdr->version == BSEC_RECORD_VERSION &&
+            record_crc(hdr, blob) == hdr->crc32 &&
+            (s_newest_addr == 0u || (int32_t)(hdr->seq - s_seq) > 0))
+        {
+            s_seq = hdr->seq;
+            s_newest_addr = base + off;
+            s_page = page;
+        }
+
+        off += RECORD_SIZE(hdr->length);
+    }
+
+    return BSEC_FLASH_PAGE_SIZE;
+}
+
+HAL_StatusTypeDef bsec_state_store_init(void)
+{
+    if ((BSEC_STORE_ADDR % BSEC_FLASH_PAGE_SIZE) != 0u) return HAL_ERROR;
+    if (BSEC_STORE_NUM_PAGES < 2u || BSEC_STORE_NUM_PAGES > 255u) return HAL_ERROR;
+    if (RECORD_SIZE(BSEC_MAX_STATE_BLOB_SIZE) > BSEC_FLASH_PAGE_SIZE) return HAL_ERROR;
+
+    uint32_t free_off[BSEC_STORE_NUM_PAGES];
+
+    s_seq = 0;
+    s_newest_addr = 0;
+    s_page = 0;
+    for (uint8_t p = 0; p < BSEC_STORE_NUM_PAGES; p++)
+    {
+        free_off[p] = scan_page(p);
+    }
+
+    /* Empty log: start at page 0; a non-blank page 0 rolls over on the first save */
+    s_offset = free_off[s_page];
+    return HAL_OK;
+}
+
+static uint32_t page_index(uint32_t addr)
+{
+    return (addr - BSEC_FLASH_BASE) / BSEC_FLASH_PAGE_SIZE;
+}
+
+static void job_finish(HAL_StatusTypeDef result)
+{
+    s_job = JOB_IDLE;
+    s_job_result = result;
+}
+
+/* Hand the current step to the Flash Manager; if it is busy, fm_callback() retries */
+static void job_issue(void)
+{
+    FM_Cmd_Status_t st;
+
+    if (s_job == JOB_ERASE)
+    {
+        st = FM_Erase(page_index(page_addr(s_job_page)), 1u, &s_fm_node);
+    }
+    else
+    {
+        st = FM_Write(s_job_buf, (uint32_t*)s_job_addr, (int32_t)(s_job_size / 4u), &s_fm_node);
+    }
+
+    if (st == FM_ERROR) job_finish(HAL_ERROR);
+}
+
+static void fm_callback(FM_FlashOp_Status_t status)
+{
+    if (s_job == JOB_IDLE) return;
+
+    if (status == FM_OPERATION_AVAILABLE)
+    {
+        job_issue();
+        return;
+    }
+
+    if (s_job == JOB_ERASE)
+    {
+        s_page = s_job_page;
+        s_offset = s_job_size;
+        s_job_addr = page_addr(s_page);
+        s_job = JOB_WRITE;
+        job_issue();
+        return;
+    }
+
+    /* The Flash Manager retries until the write lands; read back to catch a bad cell */
+    if (memcmp((const void*)s_job_addr, s_job_buf, s_job_size) != 0)
+    {
+        job_finish(HAL_ERROR);
+        return;
+    }
+
+    s_seq = ((const bsec_record_hdr_t*)s_job_buf)->seq;
+    s_newest_addr = s_job_addr;
+    job_finish(HAL_OK);
+}
+
+/*
+ * Pick the slot for the next record. Appends to the current page when it fits;
+ * otherwise the job first erases the following page, which holds the oldest
+ * records (the newest one is never on it).
+ */
+static void job_start(uint32_t rec_size)
+{
+    s_job_size = rec_size;
+
+    if ((s_offset + rec_size) <= BSEC_FLASH_PAGE_SIZE &&
+        region_is_erased(page_addr(s_page) + s_offset, rec_size))
+    {
+        /* A failed save still consumes its slot; the next one appends after it */
+        s_job_addr = page_addr(s_page) + s_offset;
+        s_offset += rec_size;
+        s_job = JOB_WRITE;
+    }
+    else
+    {
+        s_job_page = (uint8_t)((s_page + 1u) % BSEC_STORE_NUM_PAGES);
+        s_job = JOB_ERASE;
+    }
+
+    s_fm_node.Callback = fm_callback;
+    job_issue();
+}
+
+static HAL_StatusTypeDef load_legacy(void *bsec_inst, uint8_t *workbuf, uint32_t workbuf_len)
+{
+    const bsec_legacy_hdr_t *hdr = (const bsec_legacy_hdr_t*)BSEC_LEGACY_ADDR;
+
+    if (hdr->magic != BSEC_LEGACY_MAGIC) return HAL_ERROR;
+    if (hdr->version != BSEC_LEGACY_VERSION) return HAL_ERROR;
+    if (hdr->length == 0u || hdr->length > BSEC_MAX_STATE_BLOB_SIZE) return HAL_ERROR;
+
+    const uint8_t *blob = (const uint8_t*)(BSEC_LEGACY_ADDR + sizeof(bsec_legacy_hdr_t));
+    if (crc32_calc(blob, hdr->length) != hdr->crc32) return HAL_ERROR;
+
+    if (bsec_set_state(bsec_inst, blob, hdr->length, workbuf, workbuf_len) != BSEC_OK) return HAL_ERROR;
+
+    s_seq = hdr->save_count;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef bsec_state_store_load(void *bsec_inst)
+{
+    if (!bsec_inst) return HAL_ERROR;
+
+    static uint8_t workbuf[BSEC_MAX_WORKBUFFER_SIZE];
+
+    if (s_newest_addr == 0u)
+    {
+        return load_legacy(bsec_inst, workbuf, sizeof(workbuf));
+    }
+
+    const bsec_record_hdr_t *hdr = (const bsec_record_hdr_t*)s_newest_addr;
+    const uint8_t *blob = (const uint8_t*)(s_newest_addr + sizeof(bsec_record_hdr_t));
+
+    bsec_library_return_t br = bsec_set_state(bsec_inst, blob, hdr->length, workbuf, sizeof(workbuf));
+    if (br != BSEC_OK) return HAL_ERROR;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef bsec_state_store_maybe_save(void *bsec_inst,
+                                              uint32_t now_ms,
+                                              uint32_t save_period_ms)
+{
+    if (!bsec_inst) return HAL_ERROR;
+
+    if (s_job != JOB_IDLE)
+    {
+        /* Previous save still waiting for a radio-idle window */
+        return HAL_BUSY;
+    }
+
+    if (s_job_result != HAL_BUSY)
+    {
+        /* Report the finished save once */
+        HAL_StatusTypeDef result = s_job_result;
+        s_job_result = HAL_BUSY;
+        return result;
+    }
+
+    if (s_last_save_ms == 0u)
+    {
+        /* First call: start the timer, but do not save yet */
+        s_last_save_ms = now_ms;
+        return HAL_BUSY;
+    }
+
+    if ((now_ms - s_last_save_ms) < save_period_ms)
+    {
+        /* Not time yet; no save performed */
+        return HAL_BUSY;
+    }
+
+    uint8_t *blob = (uint8_t*)s_job_buf + sizeof(bsec_record_hdr_t);
+    uint32_t n_state = 0;
+    static uint8_t workbuf[BSEC_MAX_WORKBUFFER_SIZE];
+
+    bsec_library_return_t br = bsec_get_state(bsec_inst,
+                                              0,
+                                              blob,
+                                              BSEC_MAX_STATE_BLOB_SIZE,
+                                              workbuf,
+                                              sizeof(workbuf),
+                                              &n_state);
+    if (br != BSEC_OK) return HAL_ERROR;
+    if (n_state == 0u || n_state > BSEC_MAX_STATE_BLOB_SIZE) return HAL_ERROR;
+
+    bsec_record_hdr_t hdr = {0};
+    hdr.magic = BSEC_RECORD_MAGIC;
+    hdr.seq = s_seq + 1u;
+    hdr.version = BSEC_RECORD_VERSION;
+    hdr.length = (uint16_t)n_state;
+    hdr.crc32 = record_crc(&hdr, blob);
+    memcpy(s_job_buf, &hdr, sizeof(hdr));
+
+    /* Pad bytes stay erased */
+    uint32_t rec_size = RECORD_SIZE(n_state);
+    memset(blob + n_state, 0xFF, rec_size - sizeof(hdr) - n_state);
+
+    s_last_save_ms = now_ms;
+    job_start(rec_size);
+
+    if (s_job == JOB_IDLE)
+    {
+        /* Rejected by the Flash Manager right away */
+        s_job_result = HAL_BUSY;
+        return HAL_ERROR;
+    }
+    return HAL_BUSY;
+}
@@ -0,0 +1,43 @@
+/* Core/Inc/bsec_state_store.h of the reference store in this directory */
+
+#pragma once
+
+#include "stm32wb0x_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Flash pages holding the state log (2KB each), placed right below BT NVM.
+ * Must match FLASH_BSEC_DATASIZE in the linker script.
+ */
+#ifndef BSEC_STORE_NUM_PAGES
+#define BSEC_STORE_NUM_PAGES (4u)
+#endif
+
+/* Scans the log once to find the newest record and the append position */
+HAL_StatusTypeDef bsec_state_store_init(void);
+
+/* Call after bsec_init() and bsec_set_configuration(); restores the newest valid record */
+HAL_StatusTypeDef bsec_state_store_load(void *bsec_inst);
+
+/**
+ * Call often; it starts a save at most once per interval. Each save appends one record;
+ * a page is erased only when the log moves on to it. The erase/write runs later from
+ * the Flash Manager task in radio-idle windows, and its outcome is returned by the
+ * next call after it finishes.
+ *
+ * Return codes:
+ *  - HAL_OK   : the last save completed (flash updated)
+ *  - HAL_BUSY : not time to save yet, or a save is still in progress
+ *  - HAL_ERROR: the last save (or starting this one) failed
+ */
+HAL_StatusTypeDef bsec_state_store_maybe_save(void *bsec_inst,
+                                              uint32_t now_ms,
+                                              uint32_t save_period_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,161 @@
+#include "store_harness.h"
+#include "bsec_interface.h"
+#include "crc_calc.h"
+#include "flash_driver.h"
+#include "flash_manager.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t store_next_state;
+uint16_t store_next_len;
+uint32_t store_loaded_state;
+int (*store_refuse)(double us);
+int store_pumping;
+long store_fm_passes;
+
+static uint8_t instance[64];
+#ifdef STORE_OWNS_WORKBUF
+// The store of owned/ keeps its own work buffers
+#define WORKBUF
+#else
+static uint8_t workbuf[BSEC_MAX_WORKBUFFER_SIZE];
+#define WORKBUF , workbuf, sizeof workbuf
+#endif
+static int fm_pending;
+static uint32_t now_ms = 1;
+
+void store_fill(uint8_t *blob, uint32_t state, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+        blob[i] = (uint8_t)(state * 7u + i);
+    memcpy(blob, &state, len < 4 ? len : 4);
+}
+
+// ---------------------------------------------------------------------------
+// BSEC stubs. Like the library, both calls use the whole work buffer.
+
+bsec_library_return_t bsec_get_state(void *inst, uint8_t state_set_id, uint8_t *serialized_state,
+                                     uint32_t n_serialized_state_max, uint8_t *work_buffer,
+                                     uint32_t n_work_buffer, uint32_t *n_serialized_state)
+{
+    (void)inst;
+    (void)state_set_id;
+    if (n_work_buffer < BSEC_MAX_WORKBUFFER_SIZE || store_next_len > n_serialized_state_max)
+        return BSEC_E_PARSE_SECTIONEXCEEDSWORKBUFFER;
+    memset(work_buffer, 0xA5, n_work_buffer);
+    store_fill(serialized_state, store_next_state, store_next_len);
+    *n_serialized_state = store_next_len;
+    return BSEC_OK;
+}
+
+bsec_library_return_t bsec_set_state(void *inst, const uint8_t *serialized_state,
+                                     uint32_t n_serialized_state, uint8_t *work_buffer,
+                                     uint32_t n_work_buffer)
+{
+    uint8_t expect[BSEC_MAX_STATE_BLOB_SIZE];
+    uint32_t state = 0;
+
+    (void)inst;
+    if (n_work_buffer < BSEC_MAX_WORKBUFFER_SIZE || n_serialized_state < 4 ||
+        n_serialized_state > BSEC_MAX_STATE_BLOB_SIZE)
+        return BSEC_E_CONFIG_FAIL;
+    memset(work_buffer, 0x5A, n_work_buffer);
+    memcpy(&state, serialized_state, 4);
+    store_fill(expect, state, (uint16_t)n_serialized_state);
+    if (memcmp(expect, serialized_state, n_serialized_state) != 0)
+        return BSEC_E_CONFIG_FAIL;
+    store_loaded_state = state;
+    return BSEC_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Flash driver on the Flash model
+
+FD_FlashOp_Status_t FD_WriteData32(uint32_t Dest, uint32_t *Payload)
+{
+    if (store_refuse && store_refuse(FLASH_MODEL_WORD_US))
+        return FD_FLASHOP_FAILURE;
+    flash_model_write(Dest, *Payload);
+    return FD_FLASHOP_SUCCESS;
+}
+
+FD_FlashOp_Status_t FD_WriteData128(uint32_t Dest, uint32_t *Payload)
+{
+    if ((Dest & 15) || (store_refuse && store_refuse(FLASH_MODEL_BURST_US)))
+        return FD_FLASHOP_FAILURE;
+    flash_model_write_burst(Dest, Payload);
+    return FD_FLASHOP_SUCCESS;
+}
+
+FD_FlashOp_Status_t FD_EraseSectors(uint32_t Sect)
+{
+    if (store_refuse && store_refuse(FLASH_MODEL_ERASE_US))
+        return FD_FLASHOP_FAILURE;
+    flash_model_erase(Sect, 1);
+    return FD_FLASHOP_SUCCESS;
+}
+
+void FM_ProcessRequest(uint8_t immediate)
+{
+    (void)immediate;
+    fm_pending = 1;
+}
+
+void store_pump(void)
+{
+    for (int i = 0; fm_pending; i++) {
+        CHECK(i < 1000000);
+        fm_pending = 0;
+        store_fm_passes++;
+        store_pumping = 1;
+        FM_BackgroundProcess();
+        store_pumping = 0;
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+HAL_StatusTypeDef store_save(uint32_t state, uint16_t len)
+{
+    HAL_StatusTypeDef st;
+
+    // The store only starts a save once its period has run since the first call
+    if (bsec_state_store_maybe_save(instance WORKBUF, now_ms, 1) != HAL_BUSY)
+        return HAL_ERROR;
+    now_ms += 1;
+    store_next_state = state;
+    store_next_len = len;
+    st = bsec_state_store_maybe_save(instance WORKBUF, now_ms, 1);
+    if (st != HAL_BUSY)
+        return st;
+    store_pump();
+    return bsec_state_store_maybe_save(instance WORKBUF, now_ms, 1);
+}
+
+uint32_t store_boot(void)
+{
+    store_loaded_state = 0;
+    CHECK(bsec_state_store_init() == HAL_OK);
+    if (bsec_state_store_load(instance WORKBUF) != HAL_OK)
+        return 0;
+    return store_loaded_state;
+}
+
+void store_write_legacy(uint32_t state, uint16_t len, uint32_t save_count)
+{
+    uint8_t *page = (uint8_t *)(uintptr_t)(STORE_END - FLASH_MODEL_PAGE_SIZE);
+    struct __attribute__((packed)) {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t length;
+        uint32_t crc32;
+        uint32_t save_count;
+        uint8_t reserved[12];
+    } hdr = {0x42534543u, 1, len, 0, save_count, {0}};
+
+    store_fill(page + sizeof hdr, state, len);
+    hdr.crc32 = crc32_calc(page + sizeof hdr, len);
+    memcpy(page, &hdr, sizeof hdr);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "bsec_state_store.h"
+#include "bsec_datatypes.h"
+#include "flash_model.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// BSEC state store on the host: the real Flash manager runs on the Flash model
+// of ../nvmdb through the FD_* driver below, and the BSEC library is replaced
+// by stubs that serialize a numbered test state.
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#define STORE_END       0x1006F000u
+#define STORE_PAGES     4u
+#define STORE_BASE      (STORE_END - STORE_PAGES * FLASH_MODEL_PAGE_SIZE)
+#define STORE_PAGE0     ((STORE_BASE - FLASH_MODEL_BASE) / FLASH_MODEL_PAGE_SIZE)
+
+// State serialized by the next bsec_get_state(): number and blob length
+extern uint32_t store_next_state;
+extern uint16_t store_next_len;
+
+// Last state restored by bsec_set_state() (0: none)
+extern uint32_t store_loaded_state;
+
+// When set, the driver refuses the operation (the Flash manager retries it)
+extern int (*store_refuse)(double us);
+
+// Blob of a numbered state: the number, then bytes that depend on it
+void store_fill(uint8_t *blob, uint32_t state, uint16_t len);
+
+// Runs the Flash manager until it has nothing left to do or to retry
+void store_pump(void);
+
+// Set while store_pump() is in FM_BackgroundProcess(); its passes so far
+extern int store_pumping;
+extern long store_fm_passes;
+
+// One save through bsec_state_store_maybe_save() with the state and length given,
+// pumped to completion. Returns what the store reported for it.
+HAL_StatusTypeDef store_save(uint32_t state, uint16_t len);
+
+// bsec_state_store_init() and _load(); returns the restored state (0: none)
+uint32_t store_boot(void);
+
+// Writes the single-page record of the layout before the log (version 1)
+void store_write_legacy(uint32_t state, uint16_t len, uint32_t save_count);
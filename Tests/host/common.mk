@@ -0,0 +1,18 @@
+# Shared settings for the host builds under Tests/host. Each test directory sets
+# its sources and includes this file; `make` builds, `make test` builds and runs.
+ROOT   := $(abspath $(dir $(lastword $(MAKEFILE_LIST)))/../..)
+HOST   := $(ROOT)/Tests/host
+BUILD  := build
+
+CFLAGS ?= -O2 -g
+CFLAGS += -std=gnu11 -Wall -Wextra -I$(HOST)/shim -I$(ROOT)/System/Modules
+LDLIBS += -lpthread
+
+.PHONY: all test clean
+all: $(addprefix $(BUILD)/,$(PROGS))
+
+$(BUILD):
+	mkdir -p $@
+
+clean:
+	rm -rf $(BUILD)
@@ -0,0 +1,113 @@
+#include "store_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// BSEC state saves against a radio schedule: the store of Core/Src and the real
+// Flash manager on the Flash model of ../nvmdb, through the driver of
+// ../bsec_store. A radio event of 1.5-3 ms starts every connection interval.
+// The driver refuses an operation unless the next event is further away than
+// its duration, as FD_TimeCheck() does (a quad-word time at least, as for word
+// writes), and the manager retries at the next SysTick. Each of SAVES saves of
+// random length starts at a random radio phase and must land. Every operation
+// the Flash model sees must run in a Flash manager pass, never in the air
+// task's call, and must end before the next radio event. Reported: operations,
+// refusals, save latency and the longest Flash time of one manager pass.
+//
+// Usage: fm_bsec_radio <saves> <connection interval ms>
+
+#define EVENT_MIN_US  1500
+#define EVENT_MAX_US  3000
+#define CHECK_US      180    // QUAD_WORD_WRITE_TIME_US of flash_driver.c
+
+static int64_t now, ci;  // us
+static long ops, refused, pass = -1;
+static double pass_us, max_pass_us;
+
+static uint32_t rng_state = 1;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// Length of radio event k, which starts at k * ci
+static int64_t event_us(int64_t k)
+{
+    uint32_t h = (uint32_t)k * 2654435761u;
+
+    return EVENT_MIN_US + (h >> 8) % (EVENT_MAX_US - EVENT_MIN_US + 1);
+}
+
+// No radio event now, and none before need us have run
+static int window(double need)
+{
+    int64_t k = now / ci;
+
+    return now - k * ci >= event_us(k) && (k + 1) * ci - now > need;
+}
+
+static int refuse(double us)
+{
+    if (window(us < CHECK_US ? CHECK_US : us))
+        return 0;
+    refused++;
+    now = (now / 1000 + 1) * 1000;
+    return 1;
+}
+
+static void on_op(double us)
+{
+    int64_t k = now / ci;
+
+    CHECK(store_pumping);
+    CHECK(now - k * ci >= event_us(k));
+    CHECK(now + (int64_t)us <= (k + 1) * ci);
+    if (pass != store_fm_passes) {
+        pass = store_fm_passes;
+        pass_us = 0;
+    }
+    pass_us += us;
+    if (pass_us > max_pass_us)
+        max_pass_us = pass_us;
+    now += (int64_t)us;
+    ops++;
+}
+
+int main(int argc, char **argv)
+{
+    int64_t lat, lat_sum = 0, lat_max = 0;
+    int n;
+
+    CHECK(argc == 3);
+    n = atoi(argv[1]);
+    ci = atoi(argv[2]) * 1000;
+    CHECK(n > 0 && ci > EVENT_MAX_US);
+    CHECK(flash_model_init() == 0);
+    flash_model_reset();
+    flash_model_hook = on_op;
+    store_refuse = refuse;
+
+    CHECK(store_boot() == 0);
+    for (uint32_t state = 1; state <= (uint32_t)n; state++) {
+        now += rnd() % ci;
+        lat = now;
+        CHECK(store_save(state, (uint16_t)(8 + rnd() % (BSEC_MAX_STATE_BLOB_SIZE - 7))) == HAL_OK);
+        lat = now - lat;
+        lat_sum += lat;
+        if (lat > lat_max)
+            lat_max = lat;
+        if (state % 64 == 0)
+            CHECK(store_boot() == state);
+    }
+    CHECK(store_boot() == (uint32_t)n);
+
+    printf("CI %d ms, radio events of %.1f-%.1f ms: %d saves, %ld Flash operations (%ld erases), %ld refused\n",
+           (int)(ci / 1000), EVENT_MIN_US / 1000.0, EVENT_MAX_US / 1000.0, n, ops, flash_model->erases, refused);
+    printf("  none during a radio event or in the air task; save latency mean %.1f ms, max %.1f ms; "
+           "longest manager pass %.1f ms of Flash time\n",
+           lat_sum / 1000.0 / n, lat_max / 1000.0, max_pass_us / 1000);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,255 @@
+#include "flash_manager.h"
+#include "flash_driver.h"
+#include "stm32wb0x_hal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Flash manager queue on a RAM model of the Flash: request merging, the
+// pending list when the queue is full, priority order, then random batches of
+// same-priority writes and erases compared with their execution in arrival
+// order. The driver always succeeds; FM_BackgroundProcess() runs only once a
+// whole batch is queued, so that merging has the most to work with.
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#define PAGE      2048u
+#define RAM_BASE  0x20000000u  // sources, below 4 GB as on the target
+#define RAM_SIZE  0x10000u
+#define SECT0     100          // first page used by the tests
+#define NSECT     4
+
+static uint32_t *ram = (uint32_t *)(uintptr_t)RAM_BASE;
+static uint8_t reference[NSECT * PAGE];
+static int pending_run, words, bursts, erases;
+static int complete[FM_QUEUE_SIZE + 2], available[FM_QUEUE_SIZE + 2];
+
+static uint32_t *flash_at(uint32_t sect, uint32_t word)
+{
+    return (uint32_t *)(uintptr_t)(FLASH_START_ADDR + sect * PAGE + word * 4);
+}
+
+FD_FlashOp_Status_t FD_WriteData32(uint32_t Dest, uint32_t *Payload)
+{
+    *(uint32_t *)(uintptr_t)Dest &= *Payload;
+    words++;
+    return FD_FLASHOP_SUCCESS;
+}
+
+FD_FlashOp_Status_t FD_WriteData128(uint32_t Dest, uint32_t *Payload)
+{
+    CHECK((Dest & 15) == 0);
+    for (int i = 0; i < 4; i++)
+        ((uint32_t *)(uintptr_t)Dest)[i] &= Payload[i];
+    bursts++;
+    return FD_FLASHOP_SUCCESS;
+}
+
+FD_FlashOp_Status_t FD_EraseSectors(uint32_t Sect)
+{
+    memset(flash_at(Sect, 0), 0xFF, PAGE);
+    erases++;
+    return FD_FLASHOP_SUCCESS;
+}
+
+void FM_ProcessRequest(uint8_t immediate)
+{
+    (void)immediate;
+    pending_run = 1;
+}
+
+#define CB(n)                                                               \
+    static void cb##n(FM_FlashOp_Status_t s)                                \
+    {                                                                       \
+        if (s == FM_OPERATION_COMPLETE)                                     \
+            complete[n]++;                                                  \
+        else                                                                \
+            available[n]++;                                                 \
+    }
+CB(0) CB(1) CB(2) CB(3) CB(4) CB(5)
+static FM_CallbackNode_t node[FM_QUEUE_SIZE + 2] = {
+    {.Callback = cb0}, {.Callback = cb1}, {.Callback = cb2},
+    {.Callback = cb3}, {.Callback = cb4}, {.Callback = cb5},
+};
+
+static void run(void)
+{
+    while (pending_run) {
+        pending_run = 0;
+        FM_BackgroundProcess();
+    }
+}
+
+static void reset_counts(void)
+{
+    words = bursts = erases = 0;
+    memset(complete, 0, sizeof complete);
+    memset(available, 0, sizeof available);
+}
+
+static void test_merge(void)
+{
+    uint32_t *src = ram;
+    uint32_t *dst = flash_at(SECT0, 1);
+
+    for (int i = 0; i < 64; i++)
+        src[i] = 0x1000 + i;
+
+    // Overlapping and touching erases merge; the queue holds FM_QUEUE_SIZE callbacks
+    reset_counts();
+    CHECK(FM_ErasePriority(SECT0, 1, FM_PRIORITY_APP, &node[0]) == FM_OK);
+    CHECK(FM_ErasePriority(SECT0, 2, FM_PRIORITY_APP, &node[1]) == FM_OK);
+    CHECK(FM_ErasePriority(SECT0 + 1, 2, FM_PRIORITY_APP, &node[2]) == FM_OK);
+    CHECK(FM_ErasePriority(SECT0 + 3, 1, FM_PRIORITY_APP, &node[3]) == FM_OK);
+    CHECK(FM_WritePriority(src, dst, 3, FM_PRIORITY_APP, &node[4]) == FM_BUSY);
+    run();
+    CHECK(erases == 4);
+    CHECK(complete[0] == 1 && complete[1] == 1 && complete[2] == 1 && complete[3] == 1);
+    CHECK(available[4] == 1);
+
+    // Writes continuing each other in Flash and in RAM merge, with or without callback
+    reset_counts();
+    CHECK(FM_WritePriority(src, dst, 3, FM_PRIORITY_APP, &node[0]) == FM_OK);
+    CHECK(FM_WritePriority(src + 3, dst + 3, 3, FM_PRIORITY_APP, NULL) == FM_OK);
+    CHECK(FM_WritePriority(src + 6, dst + 6, 9, FM_PRIORITY_APP, &node[1]) == FM_OK);
+    run();
+    CHECK(complete[0] == 1 && complete[1] == 1);
+    CHECK(memcmp(dst, src, 15 * 4) == 0);
+    CHECK(words + 4 * bursts == 15 && bursts == 3);
+}
+
+static void test_priority(void)
+{
+    uint32_t *dst = flash_at(SECT0 + 1, 0);
+
+    reset_counts();
+    FM_WritePriority(ram, dst, 2, FM_PRIORITY_LOG, &node[0]);
+    FM_WritePriority(ram + 2, dst + 8, 2, FM_PRIORITY_APP, &node[1]);
+    FM_WritePriority(ram + 4, dst + 16, 2, FM_PRIORITY_SECURITY, &node[2]);
+    pending_run = 0;
+    FM_BackgroundProcess();
+    CHECK(complete[2] == 1 && complete[1] == 0 && complete[0] == 0);
+    FM_BackgroundProcess();
+    CHECK(complete[1] == 1 && complete[0] == 0);
+    run();
+    CHECK(complete[0] == 1);
+}
+
+// Requests that share an area must execute in arrival order, merged or not
+static void test_order_examples(void)
+{
+    uint32_t *src = ram + 256;
+
+    for (int i = 0; i < 64; i++)
+        src[i] = 0xA5000000u + i;
+
+    // Erase 5, write into 6, erase 6: page 6 ends erased
+    FD_EraseSectors(SECT0 + 1);
+    reset_counts();
+    CHECK(FM_ErasePriority(SECT0, 1, FM_PRIORITY_APP, &node[0]) == FM_OK);
+    CHECK(FM_WritePriority(src, flash_at(SECT0 + 1, 8), 4, FM_PRIORITY_APP, &node[1]) == FM_OK);
+    CHECK(FM_ErasePriority(SECT0 + 1, 1, FM_PRIORITY_APP, &node[2]) == FM_OK);
+    run();
+    CHECK(*flash_at(SECT0 + 1, 8) == 0xFFFFFFFFu);
+
+    // Write up to the end of page 5, erase 6, write the start of page 6: both writes stay
+    FD_EraseSectors(SECT0);
+    reset_counts();
+    CHECK(FM_WritePriority(src, flash_at(SECT0, PAGE / 4 - 4), 4, FM_PRIORITY_APP, &node[0]) == FM_OK);
+    CHECK(FM_ErasePriority(SECT0 + 1, 1, FM_PRIORITY_APP, &node[1]) == FM_OK);
+    CHECK(FM_WritePriority(src + 4, flash_at(SECT0 + 1, 0), 4, FM_PRIORITY_APP, NULL) == FM_OK);
+    run();
+    CHECK(memcmp(flash_at(SECT0, PAGE / 4 - 4), src, 8 * 4) == 0);
+}
+
+static uint32_t rng_state = 1;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// Batches of writes and erases on NSECT pages, some writes continuing the
+// previous one so that they can merge, applied to a reference in arrival order.
+static void test_random(int batches)
+{
+    uint32_t *area = flash_at(SECT0, 0);
+    long merged_words = 0;
+
+    for (int b = 0; b < batches; b++) {
+        uint32_t *last_src = NULL, *last_dst = NULL;
+        uint32_t src_next = 0;
+        int last_size = 0;
+
+        memcpy(reference, area, sizeof reference);
+        reset_counts();
+        for (int r = 0; r < (int)FM_QUEUE_SIZE + 2; r++) {
+            FM_CallbackNode_t *cb = (rnd() % 3) ? &node[r] : NULL;
+            FM_Cmd_Status_t st;
+
+            if (rnd() % 4 == 0) {
+                uint32_t first = rnd() % NSECT, n = 1 + rnd() % (NSECT - first);
+                st = FM_ErasePriority(SECT0 + first, n, FM_PRIORITY_APP, cb);
+                if (st == FM_OK)
+                    memset(reference + first * PAGE, 0xFF, n * PAGE);
+            } else {
+                uint32_t *src, *dst;
+                int size = 1 + rnd() % 40;
+
+                // Sources are not reused within a batch: they must stay untouched until done
+                src = ram + src_next;
+                if (last_src && rnd() % 2 && last_dst + last_size + size <= area + NSECT * PAGE / 4)
+                    dst = last_dst + last_size;
+                else
+                    dst = area + rnd() % (NSECT * PAGE / 4 - size);
+                src_next += size;
+                for (int i = 0; i < size; i++)
+                    src[i] = rnd() | rnd() << 16;
+                st = FM_WritePriority(src, dst, size, FM_PRIORITY_APP, cb);
+                if (st == FM_OK) {
+                    uint32_t *ref = (uint32_t *)(reference + (dst - area) * 4);
+                    for (int i = 0; i < size; i++)
+                        ref[i] &= src[i];
+                    last_src = src;
+                    last_dst = dst;
+                    last_size = size;
+                }
+            }
+            CHECK(st == FM_OK || st == FM_BUSY);
+            if (st == FM_BUSY)
+                break;
+        }
+        run();
+        merged_words += words + 4 * bursts;
+        if (memcmp(area, reference, sizeof reference) != 0) {
+            printf("FAIL batch %d: Flash differs from arrival order\n", b);
+            exit(1);
+        }
+    }
+    printf("fm_order: %d random batches in arrival order, %ld words programmed\n", batches, merged_words);
+}
+
+int main(int argc, char **argv)
+{
+    int batches = argc > 1 ? atoi(argv[1]) : 100000;
+
+    CHECK(mmap((void *)(uintptr_t)FLASH_START_ADDR, FLASH_SIZE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED);
+    CHECK(mmap(ram, RAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED);
+    memset((void *)(uintptr_t)FLASH_START_ADDR, 0xFF, FLASH_SIZE);
+
+    test_merge();
+    test_priority();
+    test_order_examples();
+    test_random(batches);
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include "flash_manager.h"
+#include "flash_driver.h"
+#include "stm32wb0x_hal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Replays two minutes of mixed Flash traffic through the Flash manager against
+// a radio model: security writes every 2-4 s, a 224-byte application record
+// every second, and 16-byte log chunks every LOG_PERIOD ms. Each requester
+// erases a page before writing into it. The driver refuses an operation that
+// would not end before the next radio event, as FD_TimeCheck() does, and the
+// manager then retries at the next SysTick. Every write is checked in Flash on
+// completion; the latency per requester is reported.
+//
+// Usage: fm_replay <log period ms> <connection interval ms> <one in flight: 0|1>
+// With 1, each requester waits for its previous request to complete before
+// submitting the next one, as callers of the old single-request manager did.
+
+#define RAM_BASE   0x20000000u  // sources, below 4 GB as on the target
+#define PAGE       2048u
+#define MAXJ       65536
+#define RADIO_US   3000
+#define END_US     120000000
+
+enum { SEC, APP, LOG, NREQ };
+static const char *name[NREQ] = {"security", "app", "log"};
+static const FM_Priority_t priority[NREQ] = {FM_PRIORITY_SECURITY, FM_PRIORITY_APP, FM_PRIORITY_LOG};
+
+typedef struct {
+    int erase_page;  // -1: write only
+    uint32_t *src, *dst;
+    int words;
+    int64_t arrival;
+    int step;        // 0: erase pending, 1: erase done, 2: write submitted
+} job_t;
+
+typedef struct {
+    FM_CallbackNode_t node;
+    job_t jobs[MAXJ];
+    int head, tail;   // jobs not yet complete
+    int next_submit;  // first job not yet handed over
+    int inflight;     // submitted, not completed
+    int waiting;      // in the pending list
+    int done;
+    int64_t lat[MAXJ];
+} requester_t;
+
+static requester_t rq[NREQ];
+static int64_t now, run_at = -1;  // us
+static int ci, one_in_flight, retry;
+static long fd_words, fd_bursts, fd_erases, fd_refused;
+
+static int window(int need)
+{
+    int64_t next_radio = (now / ci + 1) * ci;
+    return now % ci >= RADIO_US && next_radio - now > need;
+}
+
+FD_FlashOp_Status_t FD_WriteData32(uint32_t Dest, uint32_t *Payload)
+{
+    if (!window(180)) {
+        fd_refused++;
+        return FD_FLASHOP_FAILURE;
+    }
+    *(uint32_t *)(uintptr_t)Dest &= *Payload;
+    now += 60;
+    fd_words++;
+    return FD_FLASHOP_SUCCESS;
+}
+
+FD_FlashOp_Status_t FD_WriteData128(uint32_t Dest, uint32_t *Payload)
+{
+    if (!window(180) || (Dest & 15)) {
+        fd_refused++;
+        return FD_FLASHOP_FAILURE;
+    }
+    for (int i = 0; i < 4; i++)
+        ((uint32_t *)(uintptr_t)Dest)[i] &= Payload[i];
+    now += 180;
+    fd_bursts++;
+    return FD_FLASHOP_SUCCESS;
+}
+
+FD_FlashOp_Status_t FD_EraseSectors(uint32_t Sect)
+{
+    if (!window(22000)) {
+        fd_refused++;
+        return FD_FLASHOP_FAILURE;
+    }
+    memset((void *)(uintptr_t)(FLASH_START_ADDR + Sect * PAGE), 0xFF, PAGE);
+    now += 22000;
+    fd_erases++;
+    return FD_FLASHOP_SUCCESS;
+}
+
+void FM_ProcessRequest(uint8_t immediate)
+{
+    if (immediate)
+        run_at = now;
+    else
+        retry = 1;
+}
+
+static void submit(int r)
+{
+    requester_t *q = &rq[r];
+
+    while (!q->waiting && q->next_submit < q->tail) {
+        job_t *j = &q->jobs[q->next_submit % MAXJ];
+        int is_erase = j->erase_page >= 0 && j->step == 0;
+        FM_Cmd_Status_t st;
+
+        // A job's write waits for its erase; an erase waits for the jobs before it
+        if (is_erase && q->inflight)
+            return;
+        if (q->inflight && (one_in_flight || (j->erase_page >= 0 && j->step == 1 && q->next_submit != q->head)))
+            return;
+        st = is_erase ? FM_ErasePriority(j->erase_page, 1, priority[r], &q->node)
+                      : FM_WritePriority(j->src, j->dst, j->words, priority[r], &q->node);
+        if (st == FM_BUSY) {
+            q->waiting = 1;
+            return;
+        }
+        if (st != FM_OK) {
+            printf("%s: request refused\n", name[r]);
+            exit(1);
+        }
+        q->inflight++;
+        if (is_erase)
+            return;
+        q->next_submit++;
+        if (j->erase_page >= 0)
+            j->step = 2;
+    }
+}
+
+static void complete(int r, FM_FlashOp_Status_t status)
+{
+    requester_t *q = &rq[r];
+    job_t *j = &q->jobs[q->head % MAXJ];
+
+    if (status == FM_OPERATION_AVAILABLE) {
+        q->waiting = 0;
+        submit(r);
+        return;
+    }
+    q->inflight--;
+    if (j->erase_page >= 0 && j->step == 0)
+        j->step = 1;
+    else {
+        if (memcmp((void *)(uintptr_t)j->dst, j->src, j->words * 4)) {
+            printf("FAIL %s: data mismatch\n", name[r]);
+            exit(1);
+        }
+        q->lat[q->done++] = now - j->arrival;
+        q->head++;
+    }
+    submit(r);
+}
+
+static void cb_sec(FM_FlashOp_Status_t s) { complete(SEC, s); }
+static void cb_app(FM_FlashOp_Status_t s) { complete(APP, s); }
+static void cb_log(FM_FlashOp_Status_t s) { complete(LOG, s); }
+
+static uint32_t rng_state = 7;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// Each requester owns a ring of pages and fills it in order
+static uint32_t *ram = (uint32_t *)(uintptr_t)RAM_BASE;
+static const uint32_t ram_off[NREQ] = {0, 4096, 16384};
+static const uint32_t page0[NREQ] = {100, 104, 108};
+static const uint32_t npages[NREQ] = {2, 4, 16};
+static uint32_t flash_off[NREQ];
+
+static void add_job(int r, int words, int align16)
+{
+    requester_t *q = &rq[r];
+    job_t *j = &q->jobs[q->tail % MAXJ];
+    uint32_t page, src_off;
+
+    if (align16)
+        flash_off[r] = (flash_off[r] + 15) & ~15u;
+    j->erase_page = -1;
+    page = flash_off[r] / PAGE;
+    if (flash_off[r] % PAGE == 0 || (flash_off[r] + words * 4 - 1) / PAGE != page) {
+        if (flash_off[r] % PAGE)
+            flash_off[r] = (page + 1) * PAGE;
+        if (flash_off[r] >= npages[r] * PAGE)
+            flash_off[r] = 0;
+        j->erase_page = page0[r] + flash_off[r] / PAGE;
+    }
+    // Log chunks come from a RAM ring that follows the Flash layout, so they can merge
+    src_off = (r == LOG) ? ram_off[r] + flash_off[r] / 4 : ram_off[r] + (q->tail % 8) * 64;
+    j->src = ram + src_off;
+    j->dst = (uint32_t *)(uintptr_t)(FLASH_START_ADDR + page0[r] * PAGE + flash_off[r]);
+    for (int i = 0; i < words; i++)
+        j->src[i] = rnd() | 1;
+    j->words = words;
+    j->arrival = now;
+    j->step = 0;
+    flash_off[r] += words * 4;
+    q->tail++;
+    submit(r);
+}
+
+static int cmp(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+    int64_t t_sec = 500000, t_app = 1000000, t_log = 0;
+    int log_period;
+
+    if (argc != 4) {
+        puts("usage: fm_replay <log period ms> <connection interval ms> <one in flight: 0|1>");
+        return 1;
+    }
+    log_period = atoi(argv[1]) * 1000;
+    ci = atoi(argv[2]) * 1000;
+    one_in_flight = atoi(argv[3]);
+    if (mmap((void *)(uintptr_t)FLASH_START_ADDR, FLASH_SIZE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED ||
+        mmap(ram, 0x40000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+        return 1;
+    rq[SEC].node.Callback = cb_sec;
+    rq[APP].node.Callback = cb_app;
+    rq[LOG].node.Callback = cb_log;
+
+    while (now < END_US) {
+        // The Flash manager task runs first when due, then requester events, else SysTick retries
+        int64_t t_next = t_sec < t_app ? t_sec : t_app;
+        if (t_log < t_next)
+            t_next = t_log;
+        if (run_at >= 0 && run_at <= t_next) {
+            if (run_at > now)
+                now = run_at;
+            run_at = -1;
+            FM_BackgroundProcess();
+            continue;
+        }
+        if (retry) {
+            int64_t tick = (now / 1000 + 1) * 1000;
+            if (tick < t_next) {
+                now = tick;
+                retry = 0;
+                run_at = now;
+                continue;
+            }
+        }
+        now = t_next;
+        if (now == t_sec) {
+            add_job(SEC, 8 + rnd() % 9, 0);
+            t_sec += 2000000 + rnd() % 2000000;
+        } else if (now == t_app) {
+            add_job(APP, 56, 1);
+            t_app += 1000000;
+        } else {
+            add_job(LOG, 4, 0);
+            t_log += log_period;
+        }
+    }
+
+    printf("%-13s log every %3d ms, CI %d ms: %ld words, %ld bursts, %ld erases, %ld refused\n",
+           one_in_flight ? "one in flight" : "queued", log_period / 1000, ci / 1000,
+           fd_words, fd_bursts, fd_erases, fd_refused);
+    for (int r = 0; r < NREQ; r++) {
+        requester_t *q = &rq[r];
+        double sum = 0;
+
+        qsort(q->lat, q->done, sizeof q->lat[0], cmp);
+        for (int i = 0; i < q->done; i++)
+            sum += q->lat[i];
+        printf("  %-8s %5d/%5d jobs  mean %8.1f ms  p95 %8.1f ms  max %8.1f ms\n", name[r], q->done, q->tail,
+               q->done ? sum / q->done / 1000 : 0, q->done ? q->lat[q->done * 95 / 100] / 1000.0 : 0,
+               q->done ? q->lat[q->done - 1] / 1000.0 : 0);
+    }
+    return 0;
+}
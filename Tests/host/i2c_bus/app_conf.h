@@ -0,0 +1,15 @@
+#pragma once
+
+// Host stand-in for app_conf.h: the sequencer ids i2c_bus.c uses.
+
+typedef enum
+{
+    CFG_TASK_I2C_BUS,
+    CFG_TASK_NBR,
+} CFG_Task_Id_t;
+
+typedef enum
+{
+    CFG_SEQ_PRIO_0,
+    CFG_SEQ_PRIO_NBR,
+} CFG_SEQ_Prio_Id_t;
@@ -0,0 +1,260 @@
+#include "hal_i2c_mock.h"
+#include "i2c_bus.h"
+#include "stm32_seq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+mock_t mock;
+I2C_HandleTypeDef mock_hi2c;
+
+static DMA_HandleTypeDef dma_tx, dma_rx;
+static uint32_t tick;          // HAL tick, advanced by SysTick
+static uint16_t active_len;
+static uint64_t active_wire_us;
+static void (*tasks[32])(void);
+static uint32_t task_bits;
+
+static void fatal(const char *what)
+{
+    printf("FAIL %s (IPSR %u, tick %u)\n", what, mock.ipsr, tick);
+    exit(1);
+}
+
+void mock_reset(int dma)
+{
+    memset(&mock, 0, sizeof mock);
+    mock.dma = dma;
+    // As configured by the firmware: SysTick at TICK_INT_PRIORITY, I2C1 and GPIOA at 1
+    mock.prio[MOCK_IPSR_SYSTICK] = 3;
+    mock.prio[MOCK_IPSR_I2C] = 1;
+    mock.prio[16u + MOCK_EXTI_IRQN] = 1;
+    mock_hi2c.hdmatx = dma ? &dma_tx : NULL;
+    mock_hi2c.hdmarx = dma ? &dma_rx : NULL;
+    tick = 0;
+    task_bits = 0;
+    memset(tasks, 0, sizeof tasks);
+    if (i2c_bus_init(&mock_hi2c) != HAL_OK)
+        fatal("i2c_bus_init");
+}
+
+uint64_t mock_wire_us(uint16_t len, int read)
+{
+    uint64_t bits = 9u * (2u + len + (read ? 1u : 0u)) + 2u;  // + start and stop
+
+    return (bits * 1000000u + MOCK_I2C_HZ - 1u) / MOCK_I2C_HZ;
+}
+
+// Whether the exception with this IPSR preempts the code running now
+static int preempts(uint32_t ipsr)
+{
+    return mock.ipsr == 0u || mock.prio[ipsr] < mock.prio[mock.ipsr];
+}
+
+static uint64_t next_systick_us(void)
+{
+    return ((uint64_t)tick + 1u) * 1000u;
+}
+
+static int completion_due(uint64_t t_us)
+{
+    return mock.active && !mock.stuck && mock.done_us <= t_us && preempts(MOCK_IPSR_I2C);
+}
+
+// Time of the next interrupt the code running now can take (UINT64_MAX: none)
+static uint64_t next_irq_us(void)
+{
+    uint64_t t = preempts(MOCK_IPSR_SYSTICK) ? next_systick_us() : UINT64_MAX;
+
+    if (mock.active && !mock.stuck && preempts(MOCK_IPSR_I2C) && mock.done_us < t)
+        t = mock.done_us;
+    return t;
+}
+
+// Takes the next interrupt, the I2C completion first when both are due
+static void take_irq(void)
+{
+    uint32_t saved = mock.ipsr;
+    uint64_t t = next_irq_us();
+
+    if (t == UINT64_MAX)
+        fatal("no interrupt can wake the core");
+    if (t > mock.now_us)
+        mock.now_us = t;
+    if (completion_due(mock.now_us)) {
+        mock.active = 0;
+        mock.wire_us += active_wire_us;
+        mock.irqs += mock.dma ? 1 : active_len;
+        mock.ipsr = MOCK_IPSR_I2C;
+        if (mock.active_read)
+            HAL_I2C_MemRxCpltCallback(&mock_hi2c);
+        else
+            HAL_I2C_MemTxCpltCallback(&mock_hi2c);
+    } else {
+        tick++;
+        mock.ipsr = MOCK_IPSR_SYSTICK;
+        i2c_bus_tick();
+    }
+    mock.ipsr = saved;
+}
+
+void mock_run_until(uint64_t t_us)
+{
+    while (next_irq_us() <= t_us)
+        take_irq();
+    if (t_us > mock.now_us)
+        mock.now_us = t_us;
+}
+
+void mock_run_tasks(void)
+{
+    while (task_bits) {
+        int id = __builtin_ctz(task_bits);
+
+        task_bits &= ~(1u << id);
+        if (!tasks[id])
+            fatal("task posted but not registered");
+        mock.tasks++;
+        tasks[id]();
+    }
+}
+
+uint32_t mock_tasks_pending(void)
+{
+    return task_bits;
+}
+
+// ---------------------------------------------------------------------------
+// CMSIS, HAL and sequencer calls
+
+uint32_t __get_IPSR(void)
+{
+    return mock.ipsr;
+}
+
+void __WFI(void)
+{
+    take_irq();
+}
+
+uint32_t NVIC_GetPriority(IRQn_Type IRQn)
+{
+    return mock.prio[(int32_t)IRQn + 16];
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return tick;
+}
+
+void UTIL_SEQ_RegTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Flags, void (*Task)(void))
+{
+    (void)Flags;
+    tasks[__builtin_ctz(TaskId_bm)] = Task;
+}
+
+void UTIL_SEQ_SetTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Task_Prio)
+{
+    (void)Task_Prio;
+    task_bits |= TaskId_bm;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+    (void)hi2c;
+    mock.resets++;
+    if (mock.ipsr != 0u)
+        mock.isr_resets++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+    (void)hi2c;
+    mock.active = 0;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef start(uint16_t len, int read, int dma)
+{
+    if (dma != mock.dma)
+        fatal("DMA call without a linked channel, or IT call with one");
+    if (mock.active) {
+        mock.overlapped++;
+        return HAL_BUSY;
+    }
+    mock.active = 1;
+    mock.active_read = read;
+    active_len = len;
+    active_wire_us = mock_wire_us(len, read);
+    mock.done_us = mock.now_us + active_wire_us;
+    mock.started++;
+    return HAL_OK;
+}
+
+// Spins on HAL_GetTick() like the HAL: time only passes through the wire and
+// the interrupts that preempt the caller
+static HAL_StatusTypeDef polled(uint16_t len, int read, uint32_t timeout)
+{
+    uint32_t start_tick = tick;
+    uint64_t done_us = mock.now_us + mock_wire_us(len, read);
+
+    if (mock.active)
+        return HAL_BUSY;
+    mock.polled++;
+    for (;;) {
+        if (!mock.stuck && done_us <= next_irq_us()) {
+            mock.now_us = done_us;
+            mock.wire_us += mock_wire_us(len, read);
+            return HAL_OK;
+        }
+        if (tick - start_tick > timeout)
+            return HAL_TIMEOUT;
+        if (!preempts(MOCK_IPSR_SYSTICK))
+            fatal("polled transfer on a stuck bus never times out");
+        take_irq();
+    }
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)hi2c; (void)DevAddress; (void)MemAddress; (void)MemAddSize; (void)pData;
+    return polled(Size, 1, Timeout);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)hi2c; (void)DevAddress; (void)MemAddress; (void)MemAddSize; (void)pData;
+    return polled(Size, 0, Timeout);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    (void)hi2c; (void)DevAddress; (void)MemAddress; (void)MemAddSize; (void)pData;
+    return start(Size, 1, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    (void)hi2c; (void)DevAddress; (void)MemAddress; (void)MemAddSize; (void)pData;
+    return start(Size, 0, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    (void)hi2c; (void)DevAddress; (void)MemAddress; (void)MemAddSize; (void)pData;
+    return start(Size, 1, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                        uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    (void)hi2c; (void)DevAddress; (void)MemAddress; (void)MemAddSize; (void)pData;
+    return start(Size, 0, 1);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "stm32wb0x_hal.h"
+
+#include <stdint.h>
+
+// HAL I2C on the host: one bus at MOCK_I2C_HZ on a virtual microsecond clock.
+// A transfer started with the IT or DMA calls completes after its wire time
+// unless the device is stuck. Interrupts are only taken where the core would
+// take them: in __WFI() and in mock_run_until(), which run the next one (I2C
+// completion or SysTick, whichever comes first) with IPSR set to it. SysTick
+// advances HAL_GetTick() and calls i2c_bus_tick(). The polled calls spin on
+// HAL_GetTick() as the HAL does, so they only time out if SysTick can preempt
+// the caller; one that could never return fails the test.
+
+#ifndef MOCK_I2C_HZ
+#define MOCK_I2C_HZ 100000u
+#endif
+
+#define MOCK_IPSR_SYSTICK  15u
+#define MOCK_IPSR_I2C      (16u + MOCK_I2C_IRQN)
+#define MOCK_I2C_IRQN      12u
+#define MOCK_EXTI_IRQN     15u  // GPIOA, where the BMA456 interrupt comes in
+
+typedef struct
+{
+    uint64_t now_us;
+    uint32_t ipsr;          // exception running, 0 in thread mode
+    uint32_t prio[64];      // NVIC priority by IPSR
+    int dma;                // DMA channels linked to the handle
+    int stuck;              // the device holds the bus: transfers never complete
+
+    // Transfer on the wire
+    int active;
+    int active_read;
+    uint64_t done_us;
+
+    // Counters
+    long started;           // IT/DMA transfers started
+    long overlapped;        // started while one was on the wire
+    long polled;            // polled transfers
+    long irqs;              // I2C interrupts: one per transfer on DMA, one per byte on IT
+    long resets;            // HAL_I2C_DeInit/Init pairs
+    long isr_resets;        // of which from an exception
+    long tasks;             // sequencer task runs
+    uint64_t wire_us;       // bus time of the completed transfers
+} mock_t;
+
+extern mock_t mock;
+extern I2C_HandleTypeDef mock_hi2c;
+
+// Clears the clock, the counters and the sequencer; i2c_bus_init() on the mock handle
+void mock_reset(int dma);
+
+// Wire time of one register transfer of len bytes: address, register, data
+// (and the repeated start and address of a read), 9 bits a byte
+uint64_t mock_wire_us(uint16_t len, int read);
+
+// Runs the interrupts due up to t_us and leaves the clock there
+void mock_run_until(uint64_t t_us);
+
+// Runs the sequencer tasks posted so far, in thread mode
+void mock_run_tasks(void);
+
+// Posted sequencer tasks not run yet (bitmap)
+uint32_t mock_tasks_pending(void);
@@ -0,0 +1,277 @@
+#include "hal_i2c_mock.h"
+#include "i2c_bus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The I2C transaction queue on the HAL mock. First the contention run: the two
+// BME690s (trigger write, then field data read) and the BMA456 (status, then
+// the whole FIFO) submit bursts at random times for the simulated seconds
+// given, on DMA and on IT. Reported: transfers, bus load, latency from submit
+// to completion per device, and the CPU time against the blocking polled
+// transfers the queue replaced. Completions must come in submit order per
+// device and never start on a busy bus. Then the timeout paths: the peripheral
+// reset must run in thread context (the I2C task or the blocking waiter), not
+// in SysTick, and a transfer from an ISR must not poll a bus that can never
+// time out.
+//
+// Usage: i2c_bus_bench <simulated seconds>
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#ifndef IRQ_US
+#define IRQ_US  4u  // one I2C interrupt with its HAL handler at 64 MHz (assumption)
+#endif
+
+#define MAX_BURST  2
+
+// As the sensor ports set it: 100 ms, plus ~0.1 ms per byte for long bursts
+#define TIMEOUT_MS(len)  (100u + (uint32_t)(len) / 8u)
+
+typedef struct client client_t;
+
+typedef struct
+{
+    i2c_bus_xfer_t x;
+    client_t *c;
+    uint32_t seq;
+    uint64_t submit_us;
+} slot_t;
+
+struct client
+{
+    const char *name;
+    uint16_t addr;
+    uint32_t period_us;    // mean spacing of the bursts (uniform 0 to twice this)
+    int n;                 // transfers per burst
+    uint16_t len[MAX_BURST];
+    uint8_t dir[MAX_BURST];
+
+    slot_t slot[MAX_BURST];
+    uint8_t buf[MAX_BURST][1024];
+    int outstanding;
+    uint64_t next_us;
+    uint32_t submitted, completed;
+    uint64_t wire_us, lat_sum, lat_max;
+};
+
+// Faster than the firmware runs them (BSEC at 3 s, impacts now and then)
+static client_t clients[] = {
+    {.name = "bme690 #0", .addr = 0x76u << 1, .period_us = 20000u, .n = 2,
+     .len = {1, 17}, .dir = {I2C_BUS_WRITE, I2C_BUS_READ}},
+    {.name = "bme690 #1", .addr = 0x77u << 1, .period_us = 20000u, .n = 2,
+     .len = {1, 17}, .dir = {I2C_BUS_WRITE, I2C_BUS_READ}},
+    {.name = "bma456", .addr = 0x18u << 1, .period_us = 500000u, .n = 2,
+     .len = {2, 1024}, .dir = {I2C_BUS_READ, I2C_BUS_READ}},
+};
+#define NCLIENTS ((int)(sizeof clients / sizeof clients[0]))
+
+static uint32_t rng_state;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// Completion, in I2C interrupt context
+static void done(HAL_StatusTypeDef status, void *user)
+{
+    slot_t *s = user;
+    client_t *c = s->c;
+    uint64_t lat = mock.now_us - s->submit_us;
+
+    CHECK(status == HAL_OK);
+    CHECK(s->seq == c->completed + 1u);
+    c->completed = s->seq;
+    c->outstanding--;
+    c->lat_sum += lat;
+    if (lat > c->lat_max)
+        c->lat_max = lat;
+}
+
+static void submit_burst(client_t *c)
+{
+    for (int i = 0; i < c->n; i++) {
+        slot_t *s = &c->slot[i];
+
+        memset(&s->x, 0, sizeof s->x);
+        s->x.dev_addr_8bit = c->addr;
+        s->x.reg_addr = 0;
+        s->x.dir = c->dir[i];
+        s->x.data = c->buf[i];
+        s->x.len = c->len[i];
+        s->x.timeout_ms = TIMEOUT_MS(c->len[i]);
+        s->x.done = done;
+        s->x.user = s;
+        s->c = c;
+        s->seq = ++c->submitted;
+        s->submit_us = mock.now_us;
+        CHECK(i2c_bus_submit(&s->x) == HAL_OK);
+        c->outstanding++;
+        c->wire_us += mock_wire_us(c->len[i], c->dir[i] == I2C_BUS_READ);
+    }
+}
+
+static void contention(int dma, uint32_t seconds)
+{
+    uint64_t end = (uint64_t)seconds * 1000000u;
+    uint64_t burst_wire = 0, blocking_us = 0;
+    long xfers = 0;
+
+    mock_reset(dma);
+    rng_state = 1;
+    for (int i = 0; i < NCLIENTS; i++) {
+        client_t *c = &clients[i];
+
+        c->outstanding = 0;
+        c->submitted = c->completed = 0;
+        c->wire_us = c->lat_sum = c->lat_max = 0;
+        c->next_us = rnd() % c->period_us;
+        for (int j = 0; j < c->n; j++)
+            burst_wire += mock_wire_us(c->len[j], c->dir[j] == I2C_BUS_READ);
+    }
+
+    // The driver tasks look for due bursts at least once a ms
+    while (mock.now_us < end) {
+        uint64_t t = mock.now_us + 1000u;
+
+        for (int i = 0; i < NCLIENTS; i++) {
+            if (!clients[i].outstanding && clients[i].next_us < t)
+                t = clients[i].next_us;
+        }
+        mock_run_until(t);
+        mock_run_tasks();
+        for (int i = 0; i < NCLIENTS; i++) {
+            client_t *c = &clients[i];
+
+            if (!c->outstanding && c->next_us <= mock.now_us) {
+                submit_burst(c);
+                c->next_us = mock.now_us + rnd() % (2u * c->period_us);
+            }
+        }
+    }
+    mock_run_until(end + 1000000u);
+
+    printf("%u s at %u kHz on %s:\n", seconds, MOCK_I2C_HZ / 1000u, dma ? "DMA" : "IT");
+    printf("  %-10s %8s %12s %12s %12s\n", "device", "transfers", "wire us", "mean lat us", "max lat us");
+    for (int i = 0; i < NCLIENTS; i++) {
+        client_t *c = &clients[i];
+
+        CHECK(c->outstanding == 0 && c->completed == c->submitted);
+        // Nothing waits longer than one burst of every device ahead of it
+        CHECK(c->lat_max <= burst_wire + 1000u);
+        printf("  %-10s %8u %12.1f %12.1f %12llu\n", c->name, c->submitted,
+               (double)c->wire_us / c->submitted, (double)c->lat_sum / c->submitted,
+               (unsigned long long)c->lat_max);
+        xfers += c->submitted;
+        blocking_us += c->wire_us;
+    }
+    CHECK(mock.started == xfers);
+    CHECK(mock.overlapped == 0 && mock.polled == 0 && mock.resets == 0 && mock.tasks == 0);
+    printf("  bus busy %.1f%%, %.0f transfers/s; CPU: blocking polled %.1f%%, "
+           "queue %ld interrupts = %.2f%% at %u us each\n",
+           100.0 * mock.wire_us / end, xfers * 1e6 / end, 100.0 * blocking_us / end,
+           mock.irqs, 100.0 * mock.irqs * IRQ_US / end, IRQ_US);
+}
+
+static i2c_bus_xfer_t make_xfer(uint8_t *buf, uint16_t len, uint32_t timeout_ms)
+{
+    i2c_bus_xfer_t x = {0};
+
+    x.dev_addr_8bit = 0x76u << 1;
+    x.dir = I2C_BUS_READ;
+    x.data = buf;
+    x.len = len;
+    x.timeout_ms = timeout_ms;
+    return x;
+}
+
+// A stuck device under queued transfers: SysTick flags it, the I2C task resets
+static void timeout_queued(void)
+{
+    static uint8_t buf[3][17];
+    i2c_bus_xfer_t x[3];
+
+    mock_reset(1);
+    mock.stuck = 1;
+    for (int i = 0; i < 3; i++) {
+        x[i] = make_xfer(buf[i], 17, 5u);
+        CHECK(i2c_bus_submit(&x[i]) == HAL_OK);
+    }
+    mock_run_until(20000u);
+    CHECK(x[0].status == HAL_BUSY && mock.resets == 0);
+    CHECK(mock_tasks_pending() != 0u);
+    CHECK(i2c_bus_idle_ms(20u) == UINT32_MAX);
+
+    mock.stuck = 0;  // the device lets go
+    mock_run_tasks();
+    CHECK(mock.resets == 1 && mock.isr_resets == 0);
+    CHECK(x[0].status == HAL_TIMEOUT);
+    mock_run_until(40000u);
+    CHECK(x[1].status == HAL_OK && x[2].status == HAL_OK);
+    printf("timeout behind a queue: flagged by SysTick, reset by the I2C task, next transfers OK\n");
+}
+
+// The blocking waiter blocks the I2C task, so it resets the bus itself
+static void timeout_blocking(void)
+{
+    uint8_t buf[17];
+
+    mock_reset(1);
+    CHECK(i2c_bus_transfer(0x76u << 1, 0, I2C_BUS_READ, buf, sizeof buf, 5u) == HAL_OK);
+    CHECK(mock.now_us == mock_wire_us(sizeof buf, 1) && mock.irqs == 1);
+
+    mock.stuck = 1;
+    CHECK(i2c_bus_transfer(0x76u << 1, 0, I2C_BUS_READ, buf, sizeof buf, 5u) == HAL_TIMEOUT);
+    CHECK(mock.resets == 1 && mock.isr_resets == 0);
+    CHECK(HAL_GetTick() <= 7u);
+    mock_run_tasks();
+    CHECK(mock.resets == 1);
+    printf("blocking transfer: OK in %llu us, stuck bus reset by the waiter after %u ms\n",
+           (unsigned long long)mock_wire_us(sizeof buf, 1), HAL_GetTick());
+}
+
+// From an ISR: no polled transfer unless SysTick can preempt it
+static void from_isr(void)
+{
+    uint8_t buf[17];
+
+    mock_reset(1);
+    mock.stuck = 1;
+    mock.ipsr = 16u + MOCK_EXTI_IRQN;
+    CHECK(i2c_bus_transfer(0x76u << 1, 0, I2C_BUS_READ, buf, sizeof buf, 5u) == HAL_ERROR);
+    CHECK(mock.polled == 0);
+
+    mock.prio[MOCK_IPSR_SYSTICK] = 0;
+    CHECK(i2c_bus_transfer(0x76u << 1, 0, I2C_BUS_READ, buf, sizeof buf, 5u) == HAL_TIMEOUT);
+    mock.stuck = 0;
+    CHECK(i2c_bus_transfer(0x76u << 1, 0, I2C_BUS_READ, buf, sizeof buf, 5u) == HAL_OK);
+    CHECK(mock.polled == 2 && mock.resets == 0);
+    mock.ipsr = 0;
+    printf("from an ISR: refused below SysTick priority, polled with a working timeout above it\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds;
+
+    CHECK(argc == 2);
+    seconds = (uint32_t)atoi(argv[1]);
+    CHECK(seconds > 0);
+
+    contention(1, seconds);
+    contention(0, seconds);
+    timeout_queued();
+    timeout_blocking();
+    from_isr();
+    printf("PASS\n");
+    return 0;
+}
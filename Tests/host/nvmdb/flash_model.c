@@ -0,0 +1,130 @@
+#include "flash_model.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+flash_model_t *flash_model;
+void (*flash_model_hook)(double us);
+int flash_model_bursts_as_words;
+
+static uint32_t torn_seed;
+
+// Bits that a cut operation still managed to program
+static uint32_t torn_bits(void)
+{
+    torn_seed = torn_seed * 1103515245u + 12345u;
+    uint32_t hi = torn_seed >> 16;
+    torn_seed = torn_seed * 1103515245u + 12345u;
+    return hi << 16 | torn_seed >> 16;
+}
+
+// Counts the operation; on the cut point, applies the torn part and stops the process.
+static int begin_op(double us)
+{
+    if (flash_model_hook)
+        flash_model_hook(us);
+    flash_model->busy_us += us;
+    if (++flash_model->ops != flash_model->cut_at)
+        return 0;
+    torn_seed = (uint32_t)flash_model->cut_at;
+    return 1;
+}
+
+static void program(uint32_t address, uint32_t word)
+{
+    volatile uint32_t *p = (volatile uint32_t *)(uintptr_t)address;
+
+    if (*p != 0xFFFFFFFFu)
+        flash_model->reprograms++;
+    *p &= word;
+}
+
+int flash_model_init(void)
+{
+    if (mmap((void *)(uintptr_t)FLASH_MODEL_BASE, FLASH_MODEL_SIZE, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+        return -1;
+    flash_model = mmap(NULL, sizeof *flash_model, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (flash_model == MAP_FAILED)
+        return -1;
+    flash_model_reset();
+    return 0;
+}
+
+void flash_model_reset(void)
+{
+    memset((void *)(uintptr_t)FLASH_MODEL_BASE, 0xFF, FLASH_MODEL_SIZE);
+    memset(flash_model, 0, sizeof *flash_model);
+}
+
+void flash_model_write(uint32_t address, uint32_t word)
+{
+    if (begin_op(FLASH_MODEL_WORD_US)) {
+        program(address, word | torn_bits());
+        _exit(0);
+    }
+    program(address, word);
+    flash_model->words++;
+}
+
+void flash_model_write_burst(uint32_t address, const uint32_t *data)
+{
+    if (flash_model_bursts_as_words) {
+        for (uint32_t i = 0; i < 4; i++)
+            flash_model_write(address + 4 * i, data[i]);
+        return;
+    }
+    if (begin_op(FLASH_MODEL_BURST_US)) {
+        // The words before the cut are complete, the one being programmed is torn
+        uint32_t n = torn_bits() % 4;
+        for (uint32_t i = 0; i < n; i++)
+            program(address + 4 * i, data[i]);
+        program(address + 4 * n, data[n] | torn_bits());
+        _exit(0);
+    }
+    for (uint32_t i = 0; i < 4; i++)
+        program(address + 4 * i, data[i]);
+    flash_model->bursts++;
+}
+
+void flash_model_erase(uint32_t page_num, uint32_t num_pages)
+{
+    for (uint32_t i = 0; i < num_pages; i++) {
+        uint8_t *page = (uint8_t *)(uintptr_t)(FLASH_MODEL_BASE + (page_num + i) * FLASH_MODEL_PAGE_SIZE);
+        if (begin_op(FLASH_MODEL_ERASE_US)) {
+            // An interrupted erase leaves the page partly erased
+            memset(page, 0xFF, torn_bits() % FLASH_MODEL_PAGE_SIZE);
+            _exit(0);
+        }
+        memset(page, 0xFF, FLASH_MODEL_PAGE_SIZE);
+        flash_model->erases++;
+        flash_model->page_erases[page_num + i]++;
+    }
+}
+
+static int transfer(const char *path, const char *mode)
+{
+    FILE *f = fopen(path, mode);
+    size_t n;
+
+    if (!f)
+        return -1;
+    if (mode[0] == 'w')
+        n = fwrite((void *)(uintptr_t)FLASH_MODEL_BASE, 1, FLASH_MODEL_SIZE, f);
+    else
+        n = fread((void *)(uintptr_t)FLASH_MODEL_BASE, 1, FLASH_MODEL_SIZE, f);
+    return (fclose(f) == 0 && n == FLASH_MODEL_SIZE) ? 0 : -1;
+}
+
+int flash_model_save(const char *path)
+{
+    return transfer(path, "wb");
+}
+
+int flash_model_load(const char *path)
+{
+    return transfer(path, "rb");
+}
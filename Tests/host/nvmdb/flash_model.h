@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// RAM model of the STM32WB05 Flash, mapped at the device address so that the
+// NVMDB sources run unchanged on the host. Programming can only clear bits,
+// an erase sets the page to 0xFF. The counters and the cut point live in
+// shared memory: a forked child runs the workload and the parent reads them.
+
+#define FLASH_MODEL_BASE       0x10040000u
+#define FLASH_MODEL_SIZE       0x40000u
+#define FLASH_MODEL_PAGE_SIZE  2048u
+
+// Device timings (us): word program, quad-word burst, page erase
+#define FLASH_MODEL_WORD_US    65
+#define FLASH_MODEL_BURST_US   180
+#define FLASH_MODEL_ERASE_US   22000
+
+typedef struct {
+    long ops;         // word programs + bursts + page erases
+    long words;
+    long bursts;
+    long erases;
+    long reprograms;  // words programmed again after their first program
+    long page_erases[FLASH_MODEL_SIZE / FLASH_MODEL_PAGE_SIZE];  // completed erases per page
+    double busy_us;   // device time of all operations
+    long cut_at;      // power is cut in the middle of this operation (0: never)
+} flash_model_t;
+
+extern flash_model_t *flash_model;
+
+// When set, a burst is programmed as four word programs (the writers before
+// quad-word programming), each counted and cut as one operation.
+extern int flash_model_bursts_as_words;
+
+// Called with the duration of each operation before it starts (may be NULL)
+extern void (*flash_model_hook)(double us);
+
+// Maps the Flash and the counters. Returns 0 on success.
+int flash_model_init(void);
+
+// Erases the whole Flash and clears the counters and the cut point.
+void flash_model_reset(void);
+
+void flash_model_write(uint32_t address, uint32_t word);
+void flash_model_write_burst(uint32_t address, const uint32_t *data);
+void flash_model_erase(uint32_t page_num, uint32_t num_pages);
+
+// Writes the Flash content to a file, or reads it back. Return 0 on success.
+int flash_model_save(const char *path);
+int flash_model_load(const char *path);
@@ -0,0 +1,161 @@
+#include "nvm_db.h"
+#include "nvm_db_conf.h"
+#include "flash_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Clean of an 8-page database with one record in three deleted, while a radio
+// event of EVENT ms repeats every CI ms. The NVM task runs right after each
+// event: it starts the clean, or continues it with NVMDB_Tick().
+// NVMDB_TimeCheck() grants a Flash operation only if it ends before the next
+// event. Reported: clean duration, Flash busy time per tick, operations
+// overlapping an event, the longest run of ticks without Flash progress, and
+// the longest window between the erase of a page and the end of its
+// reprogramming, when RAM holds the only copy of its records. A sliced clean
+// must not overlap an event when a page erase fits between two, and otherwise
+// forces at most one operation per page after NVMDB_CLEAN_MAX_WAITS ticks.
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#define DB_PAGES  8
+#define REC_SIZE  60
+#define MAX_TICKS 2000
+
+const NVMDB_SmallDBContainerType *NVM_SMALL_DB_STATIC_INFO = NULL;
+const NVMDB_StaticInfoType NVM_LARGE_DB_STATIC_INFO[NUM_LARGE_DBS] = {
+    {.address = FLASH_MODEL_BASE, .size = DB_PAGES * FLASH_MODEL_PAGE_SIZE - 4, .id = 0},
+    {.address = FLASH_MODEL_BASE + DB_PAGES * FLASH_MODEL_PAGE_SIZE, .size = FLASH_MODEL_PAGE_SIZE, .id = 1},
+};
+
+// Virtual time (us)
+static double now, ci, event;
+static int radio_on;
+static double tick_busy, worst_tick;
+static long overlaps, erases, stall, worst_stall;
+static double erase_start = -1, last_program_end, worst_window;
+
+static double next_event(void)
+{
+    return ((long)(now / ci) + 1) * ci;
+}
+
+static int in_event(void)
+{
+    return now - (long)(now / ci) * ci < event;
+}
+
+static void close_window(void)
+{
+    if (erase_start >= 0 && last_program_end - erase_start > worst_window)
+        worst_window = last_program_end - erase_start;
+    erase_start = -1;
+}
+
+static void on_flash_op(double us)
+{
+    if (radio_on && (now + us > next_event() || in_event()))
+        overlaps++;
+    if (us >= FLASH_MODEL_ERASE_US) {
+        erases++;
+        close_window();
+        erase_start = now;
+    } else
+        last_program_end = now + us;
+    now += us;
+    tick_busy += us;
+}
+
+uint8_t NVMDB_TimeCheck(int32_t time)
+{
+    // time is in units of 625/256 us; nothing is granted while an event runs
+    return !radio_on || (!in_event() && next_event() - now > time * 625.0 / 256);
+}
+
+static int locked(void)
+{
+    NVMDB_HandleType h;
+    NVMDB_RecordSizeType sz;
+
+    NVMDB_HandleInit(0, &h);
+    return NVMDB_ReadNextRecord(&h, ALL_TYPES, 0, NULL, 0, &sz) == NVMDB_STATUS_LOCKED;
+}
+
+int main(int argc, char **argv)
+{
+    NVMDB_HandleType h;
+    NVMDB_RecordSizeType sz;
+    uint8_t rec[REC_SIZE];
+    int n = 0, kept = 0;
+    long ticks = 0;
+    double start;
+
+    CHECK(argc == 3);
+    ci = atof(argv[1]) * 1000;
+    event = atof(argv[2]) * 1000;
+    CHECK(flash_model_init() == 0);
+    CHECK(NVMDB_Init() == NVMDB_STATUS_OK);
+
+    for (;; n++) {
+        memset(rec, n, sizeof rec);
+        memcpy(rec, &n, 4);
+        NVMDB_HandleInit(0, &h);
+        if (NVMDB_AppendRecord(&h, 1, sizeof rec, rec, 0, NULL) != NVMDB_STATUS_OK)
+            break;
+    }
+    for (int i = 0; i < n; i += 3) {
+        NVMDB_HandleInit(0, &h);
+        CHECK(NVMDB_FindNextRecord(&h, ALL_TYPES, 0, (uint8_t *)&i, 4, 0, NULL, 0, NULL) == NVMDB_STATUS_OK);
+        CHECK(NVMDB_DeleteRecord(&h) == NVMDB_STATUS_OK);
+    }
+
+    // Start right after a radio event
+    flash_model_hook = on_flash_op;
+    radio_on = 1;
+    now = start = event;
+    NVMDB_CleanDB(0);
+    worst_tick = tick_busy;
+    while (locked() || NVMDB_CleanDB(0) != NVMDB_STATUS_OK) {
+        CHECK(++ticks < MAX_TICKS);
+        now = next_event() + event;
+        tick_busy = 0;
+        if (locked())
+            NVMDB_Tick();
+        if (tick_busy > worst_tick)
+            worst_tick = tick_busy;
+        stall = tick_busy > 0 ? 0 : stall + 1;
+        if (stall > worst_stall)
+            worst_stall = stall;
+    }
+    close_window();
+
+    NVMDB_HandleInit(0, &h);
+    while (NVMDB_ReadNextRecord(&h, ALL_TYPES, 0, rec, sizeof rec, &sz) == NVMDB_STATUS_OK) {
+        int i;
+        memcpy(&i, rec, 4);
+        CHECK(i % 3 != 0 && sz == REC_SIZE && rec[REC_SIZE - 1] == (uint8_t)i);
+        kept++;
+    }
+    CHECK(kept == n - (n + 2) / 3);
+#if NVMDB_CLEAN_STEP_WORDS
+    if (ci - event > FLASH_MODEL_ERASE_US + 100)
+        CHECK(overlaps == 0);
+    else
+        CHECK(overlaps <= erases);
+    CHECK(worst_stall <= NVMDB_CLEAN_MAX_WAITS);
+#endif
+
+    printf("CI %5.1f ms, event %.1f ms: %d/%d records kept, clean %6.1f ms over %3ld ticks, "
+           "Flash busy per tick %5.1f ms, RAM-only window %5.1f ms, %ld ops overlapping events, "
+           "up to %ld ticks without progress\n",
+           ci / 1000, event / 1000, kept, n, (now - start) / 1000, ticks, worst_tick / 1000,
+           worst_window / 1000, overlaps, worst_stall);
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "nvm_db.h"
+#include "nvm_db_conf.h"
+#include "flash_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Quad-word programming against word programming: the same random workload of
+// appends (odd lengths, unaligned sources, one or two data parts), deletes,
+// ticks, cleans and erases on database 0, with some Flash requests refused as
+// during radio activity, runs once with every burst programmed
+// as four words, as NVMDB did before, and once with bursts. The Flash images
+// must be identical; the program operations and the device time are reported.
+//
+// Usage: nvmdb_image <operations> <seeds>
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#define MAX_TRIES 64
+#define MAX_LIVE  20  // valid records kept in the 2 KB database
+
+typedef struct {
+    long words, bursts, erases;
+    double busy_us;
+} run_t;
+
+static uint32_t rng_state;
+static uint32_t live;
+static uint8_t *image;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// Radio activity refuses some Flash requests, so a sliced clean spans ticks
+uint8_t NVMDB_TimeCheck(int32_t time)
+{
+    (void)time;
+    return rnd() % 4 != 0;
+}
+
+static void append(uint32_t key)
+{
+    uint8_t buf[1 + 2 * 64];
+    uint16_t len1 = (uint16_t)(1 + rnd() % 61);
+    uint16_t len2 = (rnd() % 3 == 0) ? (uint16_t)(1 + rnd() % 40) : 0;
+    uint8_t *src = buf + 1 + rnd() % 3;  // unaligned
+    NVMDB_HandleType h;
+
+    for (int i = 0; i < len1 + len2; i++)
+        src[i] = (uint8_t)(key * 13u + i);
+    for (int tries = 0; tries < MAX_TRIES; tries++) {
+        NVMDB_status_t s;
+
+        NVMDB_HandleInit(0, &h);
+        s = NVMDB_AppendRecord(&h, (uint8_t)(1 + key % 3), len1, src, len2, len2 ? src + len1 : NULL);
+        if (s == NVMDB_STATUS_OK) {
+            live++;
+            return;
+        }
+        if (s == NVMDB_STATUS_FULL_DB || s == NVMDB_STATUS_CLEAN_NEEDED)
+            NVMDB_CleanDB(0);
+        else
+            NVMDB_Tick();
+    }
+    printf("append %u does not land\n", key);
+    _exit(2);
+}
+
+// Deletes the n-th valid record, if there are that many
+static void delete(uint32_t n)
+{
+    NVMDB_HandleType h;
+    NVMDB_RecordSizeType sz;
+    uint8_t buf[4];
+
+    for (int tries = 0; tries < MAX_TRIES; tries++) {
+        NVMDB_status_t s;
+        uint32_t i = 0;
+
+        NVMDB_HandleInit(0, &h);
+        while ((s = NVMDB_ReadNextRecord(&h, ALL_TYPES, 0, buf, sizeof buf, &sz)) == NVMDB_STATUS_OK && i < n)
+            i++;
+        if (s == NVMDB_STATUS_END_OF_DB)
+            return;
+        if (s == NVMDB_STATUS_OK && NVMDB_DeleteRecord(&h) == NVMDB_STATUS_OK) {
+            live--;
+            return;
+        }
+        NVMDB_Tick();
+    }
+    printf("delete %u does not land\n", n);
+    _exit(2);
+}
+
+static void workload(uint32_t seed, int nops)
+{
+    uint32_t key = 1;
+
+    rng_state = seed;
+    CHECK(NVMDB_Init() == NVMDB_STATUS_OK);
+    for (int op = 0; op < nops; op++) {
+        uint32_t r = rnd() % 100;
+
+        if (r < 55 && live < MAX_LIVE)
+            append(key++);
+        else if (r < 90)
+            delete(rnd() % MAX_LIVE);
+        else if (r < 96)
+            NVMDB_Tick();
+        else if (r < 99)
+            NVMDB_CleanDB(0);
+        else if (NVMDB_Erase(0) == NVMDB_STATUS_OK)
+            live = 0;
+    }
+    // Finish a clean in progress
+    for (int i = 0; i < 10000; i++)
+        NVMDB_Tick();
+}
+
+static void run(run_t *r, uint32_t seed, int nops, int bursts_as_words)
+{
+    int status;
+    pid_t pid;
+
+    flash_model_reset();
+    flash_model_bursts_as_words = bursts_as_words;
+    pid = fork();
+    if (pid == 0) {
+        workload(seed, nops);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    *r = (run_t){flash_model->words, flash_model->bursts, flash_model->erases, flash_model->busy_us};
+}
+
+int main(int argc, char **argv)
+{
+    run_t word = {0}, burst = {0}, w, b;
+
+    CHECK(argc == 3);
+    setvbuf(stdout, NULL, _IONBF, 0);
+    CHECK(flash_model_init() == 0);
+    image = mmap(NULL, FLASH_MODEL_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(image != MAP_FAILED);
+
+    for (uint32_t seed = 1; seed <= (uint32_t)atoi(argv[2]); seed++) {
+        run(&w, seed, atoi(argv[1]), 1);
+        memcpy(image, (void *)(uintptr_t)FLASH_MODEL_BASE, FLASH_MODEL_SIZE);
+        run(&b, seed, atoi(argv[1]), 0);
+        CHECK(memcmp(image, (void *)(uintptr_t)FLASH_MODEL_BASE, FLASH_MODEL_SIZE) == 0);
+        CHECK(w.erases == b.erases);
+        word.words += w.words;
+        word.busy_us += w.busy_us;
+        burst.words += b.words;
+        burst.bursts += b.bursts;
+        burst.busy_us += b.busy_us;
+        word.erases += w.erases;
+    }
+
+    printf("%s ops x %s seeds, identical images, %ld page erases\n", argv[1], argv[2], word.erases);
+    printf("  words only:  %8ld program ops, device %.1f s\n", word.words, word.busy_us / 1e6);
+    printf("  with bursts: %8ld program ops (%ld words + %ld bursts), device %.1f s\n",
+           burst.words + burst.bursts, burst.words, burst.bursts, burst.busy_us / 1e6);
+    CHECK(burst.words + burst.bursts < word.words / 2);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "nvm_db.h"
+#include "nvm_db_conf.h"
+#include "flash_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// NVMDB_FindNextRecord() by key on a 30-page database holding N records of two
+// types, every tenth one deleted. Each lookup must find the live record with
+// the right content and nothing after it, and miss the deleted ones. The same
+// source builds with and without the RAM index (NVMDB_INDEX_ENTRIES); the
+// lookups are timed once on the index built by the appends and once after a
+// reboot, on the index rebuilt by NVMDB_Init(). NVMDB_Init() runs once per
+// process, so a child fills the database and the parent plays the reboot.
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#define DB_SIZE  (30 * FLASH_MODEL_PAGE_SIZE)
+#define REC_SIZE 36
+
+const NVMDB_SmallDBContainerType *NVM_SMALL_DB_STATIC_INFO = NULL;
+const NVMDB_StaticInfoType NVM_LARGE_DB_STATIC_INFO[NUM_LARGE_DBS] = {
+    {.address = FLASH_MODEL_BASE, .size = DB_SIZE, .id = 0},
+    {.address = FLASH_MODEL_BASE + DB_SIZE, .size = FLASH_MODEL_PAGE_SIZE, .id = 1},
+};
+
+static uint32_t key_of(int i)
+{
+    return i * 2654435761u;
+}
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static double lookups(int n)
+{
+    NVMDB_HandleType h;
+    NVMDB_RecordSizeType sz;
+    uint8_t out[REC_SIZE];
+    int step = n > 100 ? n / 100 : 1;
+    int iters = 200000 / n + 100;
+    long count = 0;
+    double t0 = now_ns();
+
+    for (int it = 0; it < iters; it++) {
+        for (int i = 0; i < n; i += step) {
+            uint32_t key = key_of(i);
+            NVMDB_HandleInit(0, &h);
+            NVMDB_status_t s = NVMDB_FindNextRecord(&h, ALL_TYPES, 0, (uint8_t *)&key, 4, 0, out, sizeof out, &sz);
+            count++;
+            if (i % 10 == 0) {
+                CHECK(s == NVMDB_STATUS_END_OF_DB);
+                continue;
+            }
+            CHECK(s == NVMDB_STATUS_OK && sz == REC_SIZE && out[4] == (uint8_t)i);
+            CHECK(NVMDB_FindNextRecord(&h, ALL_TYPES, 0, (uint8_t *)&key, 4, 0, NULL, 0, NULL) == NVMDB_STATUS_END_OF_DB);
+        }
+    }
+    return (now_ns() - t0) / count;
+}
+
+int main(int argc, char **argv)
+{
+    NVMDB_HandleType h;
+    uint8_t rec[REC_SIZE];
+    int n = argc > 1 ? atoi(argv[1]) : 1000;
+    int st;
+    double *live;
+
+    CHECK(n > 0 && n * (REC_SIZE + 4) <= (int)DB_SIZE);
+    CHECK(flash_model_init() == 0);
+    live = mmap(NULL, sizeof *live, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    CHECK(live != MAP_FAILED);
+    if (fork()) {
+        wait(&st);
+        CHECK(WIFEXITED(st) && WEXITSTATUS(st) == 0);
+        CHECK(NVMDB_Init() == NVMDB_STATUS_OK);
+        printf("index %4d entries, %4d records: %7.0f ns/find, %7.0f ns/find after NVMDB_Init()\n",
+               NVMDB_INDEX_ENTRIES, n, *live, lookups(n));
+        return 0;
+    }
+
+    CHECK(NVMDB_Init() == NVMDB_STATUS_OK);
+
+    for (int i = 0; i < n; i++) {
+        uint32_t key = key_of(i);
+        memset(rec, i, sizeof rec);
+        memcpy(rec, &key, 4);
+        NVMDB_HandleInit(0, &h);
+        CHECK(NVMDB_AppendRecord(&h, 1 + (i & 1), sizeof rec, rec, 0, NULL) == NVMDB_STATUS_OK);
+    }
+    for (int i = 0; i < n; i += 10) {
+        uint32_t key = key_of(i);
+        NVMDB_HandleInit(0, &h);
+        CHECK(NVMDB_FindNextRecord(&h, 1 + (i & 1), 0, (uint8_t *)&key, 4, 0, NULL, 0, NULL) == NVMDB_STATUS_OK);
+        CHECK(NVMDB_DeleteRecord(&h) == NVMDB_STATUS_OK);
+    }
+    *live = lookups(n);
+    return 0;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in for the CMSIS compiler header: only what the portable modules use.
+
+#define __DMB()  __atomic_thread_fence(__ATOMIC_SEQ_CST)
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for the advanced trace utility: the status type of usart_if.h.
+
+typedef enum
+{
+    UTIL_ADV_TRACE_OK            = 0,
+    UTIL_ADV_TRACE_INVALID_PARAM = -1,
+    UTIL_ADV_TRACE_HW_ERROR      = -2,
+    UTIL_ADV_TRACE_MEM_FULL      = -3,
+    UTIL_ADV_TRACE_UNKNOWN_ERROR = -4,
+} UTIL_ADV_TRACE_Status_t;
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for the sequencer API: the test runs the posted tasks itself.
+
+#include <stdint.h>
+
+typedef uint32_t UTIL_SEQ_bm_t;
+
+#define UTIL_SEQ_RFU  0
+
+void UTIL_SEQ_RegTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Flags, void (*Task)(void));
+void UTIL_SEQ_SetTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Task_Prio);
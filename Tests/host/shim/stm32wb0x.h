@@ -0,0 +1,38 @@
+#pragma once
+
+// Host stand-in for the device header: only what the NVMDB, Flash manager and
+// I2C bus sources use. The Flash itself is provided by the test (see
+// nvmdb/flash_model.h), the exception state and WFI by the I2C mock (see
+// i2c_bus/hal_i2c_mock.h).
+
+#include <stdint.h>
+#include <string.h>
+
+#define _MEMORY_BYTES_PER_PAGE_  2048u
+#define _MEMORY_FLASH_BEGIN_     0x10040000u
+#define _MEMORY_FLASH_END_       0x1007FFFFu
+
+#ifndef TRUE
+#define TRUE   1
+#define FALSE  0
+#endif
+
+#ifndef __weak
+#define __weak       __attribute__((weak))
+#endif
+#define __NOINLINE   __attribute__((noinline))
+#define __PACKED_STRUCT  struct __attribute__((packed))
+
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+
+typedef enum
+{
+    SysTick_IRQn = -1
+} IRQn_Type;
+
+uint32_t __get_IPSR(void);
+void __WFI(void);
+uint32_t NVIC_GetPriority(IRQn_Type IRQn);
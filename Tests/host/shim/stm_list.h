@@ -0,0 +1,36 @@
+#pragma once
+
+// Host stand-in for the STM32 doubly linked list, the functions the Flash manager uses.
+
+#include <stdint.h>
+
+typedef struct _tListNode {
+    struct _tListNode *next;
+    struct _tListNode *prev;
+} tListNode;
+
+static inline void LST_init_head(tListNode *head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+static inline uint8_t LST_is_empty(tListNode *head)
+{
+    return head->next == head;
+}
+
+static inline void LST_insert_tail(tListNode *head, tListNode *node)
+{
+    node->next = head;
+    node->prev = head->prev;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static inline void LST_remove_head(tListNode *head, tListNode **node)
+{
+    *node = head->next;
+    head->next = (*node)->next;
+    (*node)->next->prev = head;
+}
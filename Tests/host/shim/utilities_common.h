@@ -0,0 +1,20 @@
+#pragma once
+
+// Host stand-in for the STM32 utilities common header.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TRUE
+#define TRUE   1
+#define FALSE  0
+#endif
+
+#ifndef __weak
+#define __weak  __attribute__((weak))
+#endif
+
+#define UNUSED(x)  (void)(x)
+#define MAX(x, y)  (((x) > (y)) ? (x) : (y))
+#define MIN(x, y)  (((x) < (y)) ? (x) : (y))
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in: the host tests run the modules on one thread.
+
+#define UTILS_ENTER_CRITICAL_SECTION()
+#define UTILS_EXIT_CRITICAL_SECTION()
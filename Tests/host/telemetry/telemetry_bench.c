@@ -0,0 +1,415 @@
+#include "telemetry.h"
+#include "usart_if.h"
+#include "stm32_seq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Binary telemetry of Core/Src/telemetry.c, with the ring of spsc_ring.c and
+// the CRC of crc_calc.c, on a 9600 baud 8N1 UART model and a virtual clock.
+// For SECONDS simulated seconds the firmware's record mix goes out: an air
+// record every 3 s, a gas record per 140 ms parallel-mode heater step, an
+// impact now and then (flushed at once) and a diagnostic a minute. The
+// captured byte stream is decoded here, as Tools/tlm_decode.py does (COBS,
+// CRC-16/CCITT-FALSE, record headers): every record must come back in order
+// with its payload and timestamp, frame sequence numbers without a gap and
+// nothing dropped. Reported: bytes per record over the run, and per record
+// type the bytes alone in a frame against the text line it replaced, and the
+// host CPU time of telemetry_put() against snprintf() of the text. The old
+// lines also blocked in HAL_UART_Transmit() for their wire time;
+// telemetry_put() does not wait.
+//
+// Usage: telemetry_bench <seconds>
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+#define BAUD        9600u
+#define BYTE_US     (10u * 1000000u / BAUD)     // start, 8 data, stop
+#define CAPTURE_MAX (4u << 20)
+
+static uint32_t rng_state = 1;
+
+static uint32_t rnd(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// ---------------------------------------------------------------------------
+// Clock, sequencer and UART model
+
+static uint64_t now_us;
+static void (*tlm_task)(void);
+static int posted;
+
+static uint8_t *capture;
+static uint32_t captured;
+static int capturing;
+static uint64_t tx_end_us;
+static int tx_busy;
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(now_us / 1000u);
+}
+
+void UTIL_SEQ_RegTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Flags, void (*Task)(void))
+{
+    (void)Flags;
+    CHECK(TaskId_bm == 1U << CFG_TASK_TELEMETRY);
+    tlm_task = Task;
+}
+
+void UTIL_SEQ_SetTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Task_Prio)
+{
+    (void)Task_Prio;
+    CHECK(TaskId_bm == 1U << CFG_TASK_TELEMETRY);
+    posted = 1;
+}
+
+// Interrupt-driven TX: the bytes are on the wire until tx_end_us
+UTIL_ADV_TRACE_Status_t UART_TransmitDMA(uint8_t *pdata, uint16_t size)
+{
+    CHECK(!tx_busy && size > 0);
+    if (capturing) {
+        CHECK(captured + size <= CAPTURE_MAX);
+        memcpy(&capture[captured], pdata, size);
+        captured += size;
+    }
+    tx_busy = 1;
+    tx_end_us = now_us + (uint64_t)size * BYTE_US;
+    return UTIL_ADV_TRACE_OK;
+}
+
+// TX complete interrupts up to now
+static void uart_run(void)
+{
+    while (tx_busy && tx_end_us <= now_us) {
+        tx_busy = 0;
+        telemetry_tx_cplt();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Records put, for the decoder to compare
+
+typedef struct
+{
+    uint32_t ms;
+    uint8_t type, len;
+    uint8_t payload[TELEMETRY_FRAME_MAX];
+} rec_t;
+
+static rec_t *sent;
+static long n_sent, max_sent;
+
+static void put(uint8_t type, const void *payload, uint8_t len)
+{
+    CHECK(n_sent < max_sent);
+    CHECK(telemetry_put(type, payload, len) == HAL_OK);
+    sent[n_sent].ms = HAL_GetTick();
+    sent[n_sent].type = type;
+    sent[n_sent].len = len;
+    memcpy(sent[n_sent].payload, payload, len);
+    n_sent++;
+}
+
+static void random_air(tlm_air_t *a)
+{
+    a->t_cdeg = (int16_t)(1500 + rnd() % 1500);
+    a->rh_cpct = (uint16_t)(2000 + rnd() % 6000);
+    a->p_pa = 95000u + rnd() % 10000u;
+    a->iaq_x10 = (uint16_t)(rnd() % 5000);
+    a->iaq_accuracy = (uint8_t)(rnd() % 4);
+}
+
+static void random_impact(tlm_impact_t *m)
+{
+    m->int_status = (uint16_t)rnd();
+    m->n_samples = (uint16_t)(100 + rnd() % 70);
+    m->peak_mg = (uint16_t)(1500 + rnd() % 14000);
+    m->min_mg = (uint16_t)(rnd() % 1000);
+    m->rms_mg = (uint16_t)(1000 + rnd() % 2000);
+    m->duration_us = rnd() % 25000u;
+    m->energy = rnd() % 100000u;
+}
+
+static void random_gas(tlm_gas_t *g, uint8_t step)
+{
+    g->sensor = 0;
+    g->step = step;
+    g->meas_index = (uint8_t)rnd();
+    g->status = 0x30;
+    g->t_cdeg = (int16_t)(1500 + rnd() % 1500);
+    g->gas_ohm = 1000u + rnd() % 500000u;
+}
+
+// ---------------------------------------------------------------------------
+// Decoder
+
+static uint16_t ref_crc16(const uint8_t *p, uint32_t n)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (n--) {
+        crc ^= (uint16_t)(*p++ << 8);
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static uint32_t cobs_decode(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+    uint32_t i = 0, out = 0;
+
+    while (i < len) {
+        uint8_t code = src[i];
+
+        CHECK(code != 0 && i + code <= len);
+        memcpy(&dst[out], &src[i + 1], code - 1u);
+        out += code - 1u;
+        i += code;
+        if (code < 0xFF && i < len)
+            dst[out++] = 0;
+    }
+    return out;
+}
+
+static long n_frames;
+
+// Every frame in the capture, every record against the log
+static void decode(void)
+{
+    static uint8_t frame[2 * TELEMETRY_FRAME_MAX];
+    uint32_t start = 0;
+    long rec = 0;
+    uint16_t seq = 0;
+
+    n_frames = 0;
+    CHECK(captured > 0 && capture[0] == 0x00);
+    for (uint32_t i = 0; i < captured; i++) {
+        uint32_t n, pos, ts;
+
+        if (capture[i] != 0x00)
+            continue;
+        if (i == start) {
+            start = i + 1;
+            continue;
+        }
+        CHECK(i - start <= sizeof frame);
+        n = cobs_decode(&capture[start], i - start, frame);
+        start = i + 1;
+
+        CHECK(n >= 8 && n <= TELEMETRY_FRAME_MAX);
+        CHECK(ref_crc16(frame, n - 2) == (uint16_t)(frame[n - 2] | frame[n - 1] << 8));
+        CHECK((uint16_t)(frame[0] | frame[1] << 8) == seq);
+        ts = frame[2] | frame[3] << 8 | frame[4] << 16 | (uint32_t)frame[5] << 24;
+        seq++;
+        n_frames++;
+        for (pos = 6; pos < n - 2;) {
+            const rec_t *r = &sent[rec++];
+
+            CHECK(rec <= n_sent);
+            CHECK(pos + 4 + frame[pos + 1] <= n - 2);
+            CHECK(frame[pos] == r->type && frame[pos + 1] == r->len);
+            CHECK(ts + (frame[pos + 2] | frame[pos + 3] << 8) == r->ms);
+            CHECK(memcmp(&frame[pos + 4], r->payload, r->len) == 0);
+            pos += 4u + r->len;
+        }
+    }
+    CHECK(start == captured);
+    CHECK(rec == n_sent);
+}
+
+// ---------------------------------------------------------------------------
+// Reference: the text lines of air_app.c and bma456_app.c before telemetry
+
+static int ref_air_line(char *line, size_t size, const void *p)
+{
+    const tlm_air_t *a = p;
+
+    return snprintf(line, size, "T=%.2f C RH=%.2f %% P=%.2f hPa | IAQ=%.1f (acc=%u)\r\n",
+                    a->t_cdeg / 100.0f, a->rh_cpct / 100.0f, a->p_pa / 100.0f,
+                    a->iaq_x10 / 10.0f, (unsigned)a->iaq_accuracy);
+}
+
+static int ref_impact_line(char *line, size_t size, const void *p)
+{
+    const tlm_impact_t *m = p;
+
+    return snprintf(line, size, "Impact detected! Peak: %.2fg Dur: %.1fms Energy: %.2f (%u samples)\r\n",
+                    m->peak_mg / 1000.0f, m->duration_us / 1000.0f, m->energy / 1000.0f,
+                    (unsigned)m->n_samples);
+}
+
+// ---------------------------------------------------------------------------
+
+static void reset(void)
+{
+    now_us = 0;
+    captured = 0;
+    tx_busy = 0;
+    posted = 0;
+    n_sent = 0;
+    CHECK(telemetry_init() == HAL_OK);
+    CHECK(tlm_task != NULL);
+}
+
+// The record mix for the given time
+static void stream(long seconds)
+{
+    uint8_t step = 0;
+
+    for (uint64_t ms = 0; ms < (uint64_t)seconds * 1000u; ms++) {
+        now_us = ms * 1000u;
+        uart_run();
+        telemetry_tick();
+        if (posted) {
+            posted = 0;
+            tlm_task();
+        }
+
+        if (ms % 140 == 0) {
+            tlm_gas_t g;
+
+            random_gas(&g, step);
+            step = (uint8_t)((step + 1) % 10);
+            put(TLM_REC_GAS, &g, sizeof g);
+        }
+        if (ms % 3000 == 0) {
+            tlm_air_t a;
+
+            random_air(&a);
+            put(TLM_REC_AIR, &a, sizeof a);
+        }
+        if (ms % 60000 == 0) {
+            tlm_diag_t d = { TLM_DIAG_BMA_IRQ, rnd(), rnd() % 10 };
+
+            put(TLM_REC_DIAG, &d, sizeof d);
+        }
+        if (rnd() % 20000 == 0) {
+            tlm_impact_t m;
+
+            random_impact(&m);
+            put(TLM_REC_IMPACT, &m, sizeof m);
+            telemetry_flush();
+        }
+    }
+    telemetry_flush();
+    while (tx_busy) {
+        now_us = tx_end_us;
+        uart_run();
+    }
+}
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static volatile int sink;
+
+// Bytes alone in a frame and host ns per record: batched, flushed one by one
+// and, where there was one, the old text line
+static void per_type(const char *name, uint8_t type, const void *p, uint8_t len,
+                     int (*text)(char *, size_t, const void *), long reps)
+{
+    char line[160];
+    telemetry_stats_t st;
+    double t0, batched_ns, flushed_ns, text_ns = 0;
+    int text_len = 0;
+
+    capturing = 0;
+    reset();
+    CHECK(telemetry_put(type, p, len) == HAL_OK);
+    telemetry_flush();
+    telemetry_get_stats(&st);
+
+    // The UART finishes each frame before the next record
+    reset();
+    t0 = now_ns();
+    for (long i = 0; i < reps; i++) {
+        CHECK(telemetry_put(type, p, len) == HAL_OK);
+        now_us = tx_end_us;
+        uart_run();
+    }
+    batched_ns = (now_ns() - t0) / reps;
+
+    reset();
+    t0 = now_ns();
+    for (long i = 0; i < reps; i++) {
+        CHECK(telemetry_put(type, p, len) == HAL_OK);
+        telemetry_flush();
+        now_us = tx_end_us;
+        uart_run();
+    }
+    flushed_ns = (now_ns() - t0) / reps;
+
+    printf("  %-7s %2u B payload, %2lu B alone in a frame; ns %6.1f batched, %6.1f flushed",
+           name, len, (unsigned long)st.bytes, batched_ns, flushed_ns);
+    if (text) {
+        t0 = now_ns();
+        for (long i = 0; i < reps; i++) {
+            text_len = text(line, sizeof line, p);
+            sink += line[text_len / 2];
+        }
+        text_ns = (now_ns() - t0) / reps;
+        CHECK(st.bytes < (uint32_t)text_len);
+        printf("; text %2d B, snprintf %6.1f ns, %4.1f ms blocked at %u baud", text_len, text_ns,
+               text_len * BYTE_US / 1000.0, BAUD);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    telemetry_stats_t st;
+    tlm_air_t a;
+    tlm_impact_t m;
+    tlm_gas_t g;
+    tlm_diag_t d = { TLM_DIAG_BMA_IRQ, 1234, 5 };
+    long seconds;
+
+    CHECK(argc == 2);
+    seconds = atol(argv[1]);
+    CHECK(seconds > 0);
+    capture = malloc(CAPTURE_MAX);
+    max_sent = seconds * 8 + 100;
+    sent = malloc(max_sent * sizeof *sent);
+    CHECK(capture != NULL && sent != NULL);
+
+    capturing = 1;
+    reset();
+    stream(seconds);
+    decode();
+    telemetry_get_stats(&st);
+    CHECK(st.dropped == 0);
+    CHECK(st.records == (uint32_t)n_sent && st.frames == (uint32_t)n_frames);
+    CHECK(st.bytes + 1 == captured);
+    printf("%ld s simulated at %u baud: %ld records in %ld frames decoded, none lost; %u B, %.1f B per record, "
+           "%.1f%% of the wire, ring high water %lu B\n",
+           seconds, BAUD, n_sent, n_frames, captured, (double)captured / n_sent,
+           100.0 * captured * BYTE_US / (seconds * 1e6), (unsigned long)st.ring_high_water);
+
+    printf("per record:\n");
+    random_air(&a);
+    random_impact(&m);
+    random_gas(&g, 3);
+    per_type("air", TLM_REC_AIR, &a, sizeof a, ref_air_line, 200000);
+    per_type("impact", TLM_REC_IMPACT, &m, sizeof m, ref_impact_line, 200000);
+    per_type("gas", TLM_REC_GAS, &g, sizeof g, NULL, 200000);
+    per_type("diag", TLM_REC_DIAG, &d, sizeof d, NULL, 200000);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Decode the binary USART1 telemetry stream (see Core/Inc/telemetry.h).
+
+    python3 tlm_decode.py /dev/ttyUSB0        # needs pyserial, 9600 8N1
+    python3 tlm_decode.py capture.bin         # raw capture file
+"""
+import struct
+import sys
+
+REC_AIR, REC_IMPACT, REC_DIAG, REC_GAS = 1, 2, 3, 4
+DIAG_NAMES = {1: "bma_irq", 2: "bma_isr", 3: "bma_int", 4: "bsec_save", 5: "bma_queue", 6: "boot_init"}
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_record(rtype, payload):
+    if rtype == REC_AIR:
+        t, rh, p, iaq, acc = struct.unpack("<hHIHB", payload)
+        return "AIR T=%.2fC RH=%.2f%% P=%.2fhPa IAQ=%.1f (acc=%u)" % (t / 100, rh / 100, p / 100, iaq / 10, acc)
+    if rtype == REC_IMPACT:
+        st, n, peak, mn, rms, dur, energy = struct.unpack("<HHHHHII", payload)
+        return ("IMPACT int=0x%04X peak=%umg min=%umg rms=%umg dur=%uus energy=%.3fg2ms (%u samples)"
+                % (st, peak, mn, rms, dur, energy / 1000, n))
+    if rtype == REC_DIAG:
+        code, a, b = struct.unpack("<BII", payload)
+        return "DIAG %s a=%u b=%u" % (DIAG_NAMES.get(code, str(code)), a, b)
+    if rtype == REC_GAS:
+        sensor, step, idx, st, t, gas = struct.unpack("<BBBBhI", payload)
+        flags = ("" if st & 0x20 else " invalid") + ("" if st & 0x10 else " unstable")
+        return "GAS s%u step=%u idx=%u T=%.2fC R=%uohm%s" % (sensor, step, idx, t / 100, gas, flags)
+    return "type %u: %s" % (rtype, payload.hex())
+
+
+def decode_frame(raw):
+    frame = cobs_decode(raw)
+    if len(frame) < 8 or crc16(frame[:-2]) != struct.unpack("<H", frame[-2:])[0]:
+        raise ValueError("bad CRC")
+    seq, ts = struct.unpack("<HI", frame[:6])
+    pos, body = 6, frame[:-2]
+    while pos + 4 <= len(body):
+        rtype, rlen, dt = struct.unpack("<BBH", body[pos:pos + 4])
+        pos += 4
+        yield seq, ts + dt, decode_record(rtype, body[pos:pos + rlen])
+        pos += rlen
+
+
+def frames(stream):
+    buf = bytearray()
+    while True:
+        chunk = stream.read(64)
+        if not chunk:
+            return
+        for b in chunk:
+            if b:
+                buf.append(b)
+            elif buf:
+                yield bytes(buf)
+                buf.clear()
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "-"
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial
+        stream = serial.Serial(path, 9600, timeout=1)
+    elif path == "-":
+        stream = sys.stdin.buffer
+    else:
+        stream = open(path, "rb")
+
+    # The boot log before telemetry_init() is ASCII; it fails the CRC and is printed as text
+    for raw in frames(stream):
+        try:
+            for seq, ts, text in decode_frame(raw):
+                print("#%05u %10u ms  %s" % (seq, ts, text))
+        except (ValueError, struct.error):
+            print(raw.decode("ascii", "replace").rstrip())
+
+
+if __name__ == "__main__":
+    main()